@@ -0,0 +1,40 @@
+// CPU affinity needs the GNU extensions of <sched.h> and <pthread.h>
+#define _GNU_SOURCE
+#include "affinity.h"
+#include "config.h"
+#include <sched.h>
+
+/*
+ * Purpose: Pins the calling thread to a single CPU.
+ * Accepts: cpu - Zero-based CPU number.
+ * Returns: 0 on success, -1 on failure (errno is set).
+ */
+int affinity_pin_self(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) { errno = EINVAL; return -1; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) { errno = ret; return -1; }
+    return 0;
+}
+
+/*
+ * Purpose: Pins the calling worker thread according to g_config's affinity
+ *          list. Producers and consumers are interleaved over the list so each
+ *          producer/consumer pair with the same ID lands on neighbouring CPUs.
+ *          Does nothing when no affinity is configured.
+ * Accepts: producer - true for a producer thread, false for a consumer.
+ *          id       - The worker's 1-based ID.
+ * Returns: None (a failure is reported but is not fatal).
+ */
+void affinity_pin_worker(bool producer, int id) {
+    if (g_config.affinity_count <= 0 || id < 1) return;
+    int slot = (id - 1) * 2 + (producer ? 0 : 1);
+    int cpu = g_config.affinity_cpus[slot % g_config.affinity_count];
+    if (affinity_pin_self(cpu) == -1) {
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "%s %d", producer ? "Producer" : "Consumer", id);
+        print_error(prefix, "Failed to set CPU affinity");
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include "common.h"
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Pins the calling thread to a single CPU.
+ * Accepts: cpu - Zero-based CPU number.
+ * Returns: 0 on success, -1 on failure (errno is set).
+ */
+int affinity_pin_self(int cpu);
+
+/*
+ * Purpose: Pins the calling worker thread according to g_config's affinity
+ *          list. Producers and consumers are interleaved over the list so each
+ *          producer/consumer pair with the same ID lands on neighbouring CPUs.
+ *          Does nothing when no affinity is configured.
+ * Accepts: producer - true for a producer thread, false for a consumer.
+ *          id       - The worker's 1-based ID.
+ * Returns: None (a failure is reported but is not fatal).
+ */
+void affinity_pin_worker(bool producer, int id);
+
+#endif // AFFINITY_H
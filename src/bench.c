@@ -0,0 +1,416 @@
+// Headless benchmark: runs a matrix of engines x thread counts x capacities x
+// message sizes through the real queue and reports a table and JSON. With
+// -r each configuration is measured repeatedly (trials interleaved across
+// the matrix, so slow drift of the machine spreads over all of them); with
+// -b the trials are tested against a saved baseline for regressions.
+// Usage: bench [-m LIST] [-t LIST] [-q LIST] [-s LIST] [-d MS] [-w MS] [-k] [-r N] [-j FILE] [-b FILE] [-T PCT]
+#include "bench_run.h"
+#include "bench_compare.h"
+#include "queue_manager.h"
+
+// --- Constants ---
+#define BENCH_DEFAULT_DURATION_MS 500
+#define BENCH_DEFAULT_WARMUP_MS 100
+#define BENCH_DEFAULT_THRESHOLD_PCT 5.0 // Smallest change reported as a regression
+
+// --- Matrix ---
+typedef struct bench_matrix_s {
+    sync_mode_t modes[BENCH_MODES_MAX];
+    int mode_count;
+    int producers[BENCH_LIST_MAX];
+    int consumers[BENCH_LIST_MAX];
+    int thread_count;
+    long capacities[BENCH_LIST_MAX];
+    int capacity_count;
+    long sizes[BENCH_LIST_MAX];
+    int size_count;
+} bench_matrix_t;
+
+// --- Trials of One Configuration ---
+typedef struct bench_config_s {
+    bench_params_t params;
+    bench_result_t trials[BENCH_TRIALS_MAX];
+    int completed;           // Successful trials, stored first in trials[]
+    bench_result_t mean;     // Mean over the completed trials (hash failures summed)
+} bench_config_t;
+
+// --- Internal Helper Function Declarations ---
+static int parse_thread_pairs(const char *value, bench_matrix_t *m);
+static void aggregate_trials(bench_config_t *c);
+static void trial_samples(const bench_config_t *c, double *msgs_per_s, double *p50, double *p99);
+static int compare_with_baseline(const bench_config_t *configs, int count, const char *path, bool queue_only,
+                                 long duration_ms, double threshold_pct);
+static int print_comparison_row(const bench_params_t *p, const char *metric, const double *base, int nb,
+                                const double *cur, int nc, double scale, bool higher_is_better, double threshold_pct);
+static void print_table_header(void);
+static void print_table_row(const bench_config_t *c);
+static void print_json_row(FILE *fp, const bench_config_t *c, bool first);
+static void print_json_samples(FILE *fp, const char *key, const double *x, int n);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Parses the matrix, runs every configuration once
+ *          per trial, writes the table to stdout and, optionally, the JSON
+ *          file, then compares with the baseline if one was given.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage, a failed run or a
+ *          regression against the baseline.
+ */
+int main(int argc, char *argv[]) {
+    bench_matrix_t m = {
+        .modes = { SYNC_MODE_SEM, SYNC_MODE_CONDVAR }, .mode_count = 2,
+        .producers = { 1, 2, 4 }, .consumers = { 1, 2, 4 }, .thread_count = 3,
+        .capacities = { 10, 1000 }, .capacity_count = 2,
+        .sizes = { 16, 255 }, .size_count = 2,
+    };
+    long duration_ms = BENCH_DEFAULT_DURATION_MS;
+    long warmup_ms = BENCH_DEFAULT_WARMUP_MS;
+    bool queue_only = false;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    long trials = 1;
+    double threshold_pct = BENCH_DEFAULT_THRESHOLD_PCT;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:t:q:s:d:w:kr:j:b:T:h")) != -1) {
+        int bad = 0;
+        switch (opt) {
+            case 'm': m.mode_count = bench_parse_modes(optarg, m.modes); bad = m.mode_count == -1; break;
+            case 't': bad = parse_thread_pairs(optarg, &m) == -1; break;
+            case 'q': m.capacity_count = bench_parse_list(optarg, 1, QUEUE_CAPACITY_LIMIT, m.capacities, BENCH_LIST_MAX);
+                      bad = m.capacity_count == -1; break;
+            case 's': m.size_count = bench_parse_list(optarg, 0, MAX_DATA_SIZE - 1, m.sizes, BENCH_LIST_MAX);
+                      bad = m.size_count == -1; break;
+            case 'd': duration_ms = strtol(optarg, NULL, 10); bad = duration_ms <= 0; break;
+            case 'w': warmup_ms = strtol(optarg, NULL, 10); bad = warmup_ms < 0; break;
+            case 'k': queue_only = true; break;
+            case 'r': trials = strtol(optarg, NULL, 10); bad = trials < 1 || trials > BENCH_TRIALS_MAX; break;
+            case 'j': json_path = optarg; break;
+            case 'b': baseline_path = optarg; break;
+            case 'T': threshold_pct = strtod(optarg, NULL); bad = threshold_pct < 0.0; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    int count = m.mode_count * m.thread_count * m.capacity_count * m.size_count;
+    bench_config_t *configs = calloc((size_t)count, sizeof(bench_config_t));
+    if (!configs) { fprintf(stderr, "Error: calloc for %d configurations failed\n", count); return EXIT_FAILURE; }
+    int n = 0;
+    for (int mi = 0; mi < m.mode_count; ++mi) {
+        for (int ti = 0; ti < m.thread_count; ++ti) {
+            for (int ci = 0; ci < m.capacity_count; ++ci) {
+                for (int si = 0; si < m.size_count; ++si) {
+                    configs[n++].params = (bench_params_t){
+                        .mode = m.modes[mi], .producers = m.producers[ti], .consumers = m.consumers[ti],
+                        .capacity = (size_t)m.capacities[ci], .msg_size = (int)m.sizes[si],
+                        .queue_only = queue_only, .warmup_ms = warmup_ms, .duration_ms = duration_ms,
+                    };
+                }
+            }
+        }
+    }
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) { fprintf(stderr, "Error: cannot open %s: %s\n", json_path, strerror(errno)); free(configs); return EXIT_FAILURE; }
+        fprintf(json, "{\n  \"bench\": \"queue\",\n  \"version\": 2,\n  \"cpus\": %ld,\n  \"warmup_ms\": %ld,\n"
+                "  \"duration_ms\": %ld,\n  \"trials\": %ld,\n  \"queue_only\": %s,\n  \"results\": [\n",
+                sysconf(_SC_NPROCESSORS_ONLN), warmup_ms, duration_ms, trials, queue_only ? "true" : "false");
+    }
+
+    // Trial-major order; rows are printed as the last trial of each completes
+    bench_setup();
+    int json_rows = 0;
+    int status = EXIT_SUCCESS;
+    print_table_header();
+    for (long t = 0; t < trials; ++t) {
+        if (trials > 1) { fprintf(stderr, "Trial %ld/%ld...\n", t + 1, trials); }
+        for (int i = 0; i < count; ++i) {
+            bench_config_t *c = &configs[i];
+            if (bench_run(&c->params, &c->trials[c->completed]) == 0) c->completed++;
+            else status = EXIT_FAILURE;
+            if (t < trials - 1 || c->completed == 0) continue;
+            aggregate_trials(c);
+            print_table_row(c);
+            if (json) print_json_row(json, c, json_rows++ == 0);
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        int write_error = ferror(json);
+        if (fclose(json) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", json_path); status = EXIT_FAILURE; }
+        else printf("Results written to %s\n", json_path);
+    }
+    if (baseline_path && compare_with_baseline(configs, count, baseline_path, queue_only, duration_ms, threshold_pct) != 0) {
+        status = EXIT_FAILURE;
+    }
+    free(configs);
+    return status;
+}
+
+/*
+ * Purpose: Parses the thread list: producer x consumer pairs ("1x1,2x4").
+ * Accepts: value - The text to parse.
+ *          m     - The matrix to update.
+ * Returns: 0 on success, -1 on invalid input.
+ */
+static int parse_thread_pairs(const char *value, bench_matrix_t *m) {
+    m->thread_count = 0;
+    const char *cur = value;
+    while (*cur != '\0') {
+        char *end;
+        long prod = strtol(cur, &end, 10);
+        if (end == cur || *end != 'x') return -1;
+        cur = end + 1;
+        long cons = strtol(cur, &end, 10);
+        if (end == cur || (*end != ',' && *end != '\0')) return -1;
+        if (prod < 1 || prod > PRODUCER_THREAD_LIMIT || cons < 1 || cons > CONSUMER_THREAD_LIMIT) return -1;
+        if (m->thread_count >= BENCH_LIST_MAX) return -1;
+        m->producers[m->thread_count] = (int)prod;
+        m->consumers[m->thread_count++] = (int)cons;
+        cur = *end == ',' ? end + 1 : end;
+    }
+    return m->thread_count > 0 ? 0 : -1;
+}
+
+/*
+ * Purpose: Fills a configuration's mean result from its completed trials.
+ * Accepts: c - The configuration.
+ * Returns: None.
+ */
+static void aggregate_trials(bench_config_t *c) {
+    bench_result_t *mean = &c->mean;
+    memset(mean, 0, sizeof(*mean));
+    double p50 = 0.0, p90 = 0.0, p99 = 0.0, p999 = 0.0, max = 0.0, messages = 0.0;
+    for (int i = 0; i < c->completed; ++i) {
+        const bench_result_t *r = &c->trials[i];
+        messages += (double)r->messages;
+        mean->seconds += r->seconds;
+        mean->msgs_per_s += r->msgs_per_s;
+        mean->cpu_ns_per_msg += r->cpu_ns_per_msg;
+        mean->hash_failures += r->hash_failures;
+        p50 += (double)r->lat_p50_ns; p90 += (double)r->lat_p90_ns; p99 += (double)r->lat_p99_ns;
+        p999 += (double)r->lat_p999_ns; max += (double)r->lat_max_ns;
+    }
+    double n = (double)c->completed;
+    mean->messages = (unsigned long)(messages / n);
+    mean->seconds /= n;
+    mean->msgs_per_s /= n;
+    mean->cpu_ns_per_msg /= n;
+    mean->lat_p50_ns = (uint64_t)(p50 / n); mean->lat_p90_ns = (uint64_t)(p90 / n); mean->lat_p99_ns = (uint64_t)(p99 / n);
+    mean->lat_p999_ns = (uint64_t)(p999 / n); mean->lat_max_ns = (uint64_t)(max / n);
+}
+
+/*
+ * Purpose: Copies the per-trial samples of the compared metrics.
+ * Accepts: c          - The configuration.
+ *          msgs_per_s - Array of at least c->completed values to fill.
+ *          p50        - Same, median latency in nanoseconds.
+ *          p99        - Same, 99th percentile latency in nanoseconds.
+ * Returns: None.
+ */
+static void trial_samples(const bench_config_t *c, double *msgs_per_s, double *p50, double *p99) {
+    for (int i = 0; i < c->completed; ++i) {
+        msgs_per_s[i] = c->trials[i].msgs_per_s;
+        p50[i] = (double)c->trials[i].lat_p50_ns;
+        p99[i] = (double)c->trials[i].lat_p99_ns;
+    }
+}
+
+/*
+ * Purpose: Tests every configuration against the baseline file and prints
+ *          one line per metric (throughput, p50 and p99 latency). A change
+ *          is a regression when it is in the bad direction, at least
+ *          threshold_pct large and significant (Welch's t-test, p below
+ *          BENCH_ALPHA). Without two trials on both sides only the
+ *          threshold can be checked, and the verdict says so.
+ * Accepts: configs       - The measured configurations.
+ *          count         - How many.
+ *          path          - The baseline JSON.
+ *          queue_only    - Whether this run used -k (checked against the baseline).
+ *          duration_ms   - Measured window of this run (checked likewise).
+ *          threshold_pct - Smallest relative change that counts.
+ * Returns: 0 if no regression was found, -1 on regressions or if the
+ *          baseline cannot be loaded.
+ */
+static int compare_with_baseline(const bench_config_t *configs, int count, const char *path, bool queue_only,
+                                 long duration_ms, double threshold_pct) {
+    bench_baseline_t baseline;
+    if (bench_baseline_load(path, &baseline) == -1) return -1;
+
+    printf("\nComparison with %s (Welch's t-test, alpha %.2f, threshold %.1f%%):\n", path, BENCH_ALPHA, threshold_pct);
+    if (baseline.queue_only != queue_only) printf("Warning: the baseline was %s with -k; results are not comparable.\n",
+                                                  baseline.queue_only ? "run" : "not run");
+    if (baseline.duration_ms != 0 && baseline.duration_ms != duration_ms) {
+        printf("Warning: the baseline measured %ld ms per trial, this run %ld ms.\n", baseline.duration_ms, duration_ms);
+    }
+    printf("%-6s %4s %4s %8s %5s %-7s %20s %20s %8s %7s  %s\n", "ENGINE", "P", "C", "CAP", "SIZE", "METRIC",
+           "BASELINE", "CURRENT", "DELTA", "p", "VERDICT");
+
+    int regressions = 0, missing = 0;
+    for (int i = 0; i < count; ++i) {
+        const bench_config_t *c = &configs[i];
+        if (c->completed == 0) continue;
+        const bench_baseline_row_t *b = bench_baseline_find(&baseline, &c->params);
+        if (!b) { missing++; continue; }
+        double tput[BENCH_TRIALS_MAX], p50[BENCH_TRIALS_MAX], p99[BENCH_TRIALS_MAX];
+        trial_samples(c, tput, p50, p99);
+        regressions += print_comparison_row(&c->params, "msgs/s", b->msgs_per_s, b->trials, tput, c->completed, 1.0, true, threshold_pct);
+        regressions += print_comparison_row(&c->params, "p50 us", b->lat_p50_ns, b->trials, p50, c->completed, 1e-3, false, threshold_pct);
+        regressions += print_comparison_row(&c->params, "p99 us", b->lat_p99_ns, b->trials, p99, c->completed, 1e-3, false, threshold_pct);
+    }
+    bench_baseline_free(&baseline);
+
+    if (missing > 0) printf("%d configuration(s) not in the baseline.\n", missing);
+    if (regressions > 0) printf("REGRESSION: %d metric(s) significantly worse than the baseline.\n", regressions);
+    else printf("No significant regressions.\n");
+    fflush(stdout);
+    return regressions > 0 ? -1 : 0;
+}
+
+/*
+ * Purpose: Compares one metric of one configuration and prints its line:
+ *          mean +- 95% confidence interval on both sides, relative change,
+ *          p-value and verdict.
+ * Accepts: p                - The configuration.
+ *          metric           - Metric label.
+ *          base, nb         - Baseline samples.
+ *          cur, nc          - Current samples.
+ *          scale            - Factor applied for display (ns -> us).
+ *          higher_is_better - true for throughput, false for latency.
+ *          threshold_pct    - Smallest relative change that counts.
+ * Returns: 1 if the metric regressed, 0 otherwise.
+ */
+static int print_comparison_row(const bench_params_t *p, const char *metric, const double *base, int nb,
+                                const double *cur, int nc, double scale, bool higher_is_better, double threshold_pct) {
+    bench_summary_t sb, sc;
+    bench_summarize(base, nb, &sb);
+    bench_summarize(cur, nc, &sc);
+    double delta_pct = sb.mean != 0.0 ? (sc.mean - sb.mean) / sb.mean * 100.0 : 0.0;
+    double pvalue = bench_welch_test(base, nb, cur, nc, NULL);
+    bool worse = higher_is_better ? delta_pct <= -threshold_pct : delta_pct >= threshold_pct;
+    bool better = higher_is_better ? delta_pct >= threshold_pct : delta_pct <= -threshold_pct;
+    bool significant = pvalue >= 0.0 && pvalue < BENCH_ALPHA;
+
+    const char *verdict = "ok";
+    int regressed = 0;
+    if (pvalue < 0.0) verdict = worse ? "worse (untested: <2 trials)" : "ok (untested: <2 trials)";
+    else if (worse && significant) { verdict = "REGRESSION"; regressed = 1; }
+    else if (better && significant) verdict = "improved";
+    else if (worse || better) verdict = "noise";
+
+    char base_text[32], cur_text[32], p_text[16];
+    snprintf(base_text, sizeof(base_text), "%.1f +-%.1f", sb.mean * scale, sb.ci95 * scale);
+    snprintf(cur_text, sizeof(cur_text), "%.1f +-%.1f", sc.mean * scale, sc.ci95 * scale);
+    if (pvalue < 0.0) snprintf(p_text, sizeof(p_text), "-");
+    else snprintf(p_text, sizeof(p_text), "%.3f", pvalue);
+    printf("%-6s %4d %4d %8zu %5d %-7s %20s %20s %+7.1f%% %7s  %s\n", queue_engine_name(p->mode), p->producers,
+           p->consumers, p->capacity, p->msg_size, metric, base_text, cur_text, delta_pct, p_text, verdict);
+    return regressed;
+}
+
+/*
+ * Purpose: Prints the column headings of the results table.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void print_table_header(void) {
+    printf("%-6s %4s %4s %8s %5s %12s %7s %10s %10s %10s %10s %11s\n", "ENGINE", "P", "C", "CAP", "SIZE",
+           "MSGS/S", "+-95%", "P50 us", "P99 us", "P99.9 us", "MAX us", "CPU ns/msg");
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Prints one configuration's row of the results table (means over
+ *          the trials; +-95% is the throughput confidence interval relative
+ *          to its mean, "-" for a single trial).
+ * Accepts: c - The configuration.
+ * Returns: None.
+ */
+static void print_table_row(const bench_config_t *c) {
+    const bench_params_t *p = &c->params;
+    const bench_result_t *r = &c->mean;
+    double tput[BENCH_TRIALS_MAX], p50[BENCH_TRIALS_MAX], p99[BENCH_TRIALS_MAX];
+    trial_samples(c, tput, p50, p99);
+    bench_summary_t s;
+    bench_summarize(tput, c->completed, &s);
+    char ci_text[16];
+    if (s.n < 2 || s.mean == 0.0) snprintf(ci_text, sizeof(ci_text), "-");
+    else snprintf(ci_text, sizeof(ci_text), "%.1f%%", s.ci95 / s.mean * 100.0);
+    printf("%-6s %4d %4d %8zu %5d %12.0f %7s %10.1f %10.1f %10.1f %10.1f %11.0f%s\n", queue_engine_name(p->mode),
+           p->producers, p->consumers, p->capacity, p->msg_size, r->msgs_per_s, ci_text, (double)r->lat_p50_ns / 1e3,
+           (double)r->lat_p99_ns / 1e3, (double)r->lat_p999_ns / 1e3, (double)r->lat_max_ns / 1e3,
+           r->cpu_ns_per_msg, r->hash_failures ? "  HASH FAILURES" : "");
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Writes one configuration's result as a JSON object, one object
+ *          per line so the file also diffs and greps well. Scalar fields
+ *          are means over the trials; the *_samples arrays keep each trial
+ *          for a later comparison.
+ * Accepts: fp    - The JSON file.
+ *          c     - The configuration.
+ *          first - true for the first object (no separating comma).
+ * Returns: None.
+ */
+static void print_json_row(FILE *fp, const bench_config_t *c, bool first) {
+    const bench_params_t *p = &c->params;
+    const bench_result_t *r = &c->mean;
+    double tput[BENCH_TRIALS_MAX], p50[BENCH_TRIALS_MAX], p99[BENCH_TRIALS_MAX];
+    trial_samples(c, tput, p50, p99);
+    bench_summary_t s;
+    bench_summarize(tput, c->completed, &s);
+    fprintf(fp, "%s    {\"engine\": \"%s\", \"producers\": %d, \"consumers\": %d, \"capacity\": %zu, \"msg_size\": %d, "
+            "\"trials\": %d, \"messages\": %lu, \"seconds\": %.6f, \"msgs_per_s\": %.1f, \"msgs_per_s_ci95\": %.1f, "
+            "\"lat_p50_ns\": %llu, \"lat_p90_ns\": %llu, \"lat_p99_ns\": %llu, \"lat_p999_ns\": %llu, \"lat_max_ns\": %llu, "
+            "\"cpu_ns_per_msg\": %.1f, \"hash_failures\": %lu",
+            first ? "" : ",\n", queue_engine_name(p->mode), p->producers, p->consumers, p->capacity, p->msg_size,
+            c->completed, r->messages, r->seconds, r->msgs_per_s, s.ci95, (unsigned long long)r->lat_p50_ns,
+            (unsigned long long)r->lat_p90_ns, (unsigned long long)r->lat_p99_ns, (unsigned long long)r->lat_p999_ns,
+            (unsigned long long)r->lat_max_ns, r->cpu_ns_per_msg, r->hash_failures);
+    print_json_samples(fp, "msgs_per_s_samples", tput, c->completed);
+    print_json_samples(fp, "lat_p50_ns_samples", p50, c->completed);
+    print_json_samples(fp, "lat_p99_ns_samples", p99, c->completed);
+    fprintf(fp, "}");
+}
+
+/*
+ * Purpose: Appends a ", \"key\": [v, ...]" array to the current JSON object.
+ * Accepts: fp  - The JSON file.
+ *          key - The key.
+ *          x   - The values.
+ *          n   - How many.
+ * Returns: None.
+ */
+static void print_json_samples(FILE *fp, const char *key, const double *x, int n) {
+    fprintf(fp, ", \"%s\": [", key);
+    for (int i = 0; i < n; ++i) fprintf(fp, "%s%.1f", i ? ", " : "", x[i]);
+    fprintf(fp, "]");
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m LIST] [-t LIST] [-q LIST] [-s LIST] [-d MS] [-w MS] [-k] [-r N] [-j FILE] [-b FILE] [-T PCT]\n", prog_name);
+    fprintf(stderr, "  -m LIST  : Engines, sem and/or cond (default: sem,cond).\n");
+    fprintf(stderr, "  -t LIST  : Producer x consumer counts (default: 1x1,2x2,4x4).\n");
+    fprintf(stderr, "  -q LIST  : Queue capacities (default: 10,1000).\n");
+    fprintf(stderr, "  -s LIST  : Payload sizes in bytes, 0-%d (default: 16,255).\n", MAX_DATA_SIZE - 1);
+    fprintf(stderr, "  -d MS    : Measured duration per configuration (default: %d).\n", BENCH_DEFAULT_DURATION_MS);
+    fprintf(stderr, "  -w MS    : Warmup before measuring (default: %d).\n", BENCH_DEFAULT_WARMUP_MS);
+    fprintf(stderr, "  -k       : Queue only: send a prebuilt message, skip payload fill and hash check.\n");
+    fprintf(stderr, "  -r N     : Trials per configuration, 1-%d, interleaved across the matrix (default: 1).\n", BENCH_TRIALS_MAX);
+    fprintf(stderr, "  -j FILE  : Also write the results as JSON (usable as a baseline for -b).\n");
+    fprintf(stderr, "  -b FILE  : Compare with a baseline JSON; exit non-zero on a significant regression.\n");
+    fprintf(stderr, "  -T PCT   : Smallest change counted as a regression (default: %.1f).\n", BENCH_DEFAULT_THRESHOLD_PCT);
+}
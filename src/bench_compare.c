@@ -0,0 +1,302 @@
+#include "bench_compare.h"
+#include <math.h>
+
+// --- Constants ---
+#define BETA_CF_ITERATIONS 300
+#define BETA_CF_EPSILON 1e-12
+#define BETA_CF_TINY 1e-300
+
+// --- Internal Helper Function Declarations ---
+static double t_two_sided_p(double t, double df);
+static double t_critical_95(double df);
+static double incomplete_beta(double x, double a, double b);
+static double beta_continued_fraction(double x, double a, double b);
+static const char* json_value(const char *line, const char *key);
+static bool json_number(const char *line, const char *key, double *out);
+static int json_array(const char *line, const char *key, double *out, int max);
+static int parse_result_line(const char *line, bench_baseline_row_t *row);
+
+/*
+ * Purpose: Computes mean, standard deviation and the 95% confidence interval
+ *          (Student's t) of a sample.
+ * Accepts: x   - The values.
+ *          n   - How many (0 yields an all-zero summary).
+ *          out - Where to store the summary.
+ * Returns: None.
+ */
+void bench_summarize(const double *x, int n, bench_summary_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->n = n;
+    if (n < 1) return;
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += x[i];
+    out->mean = sum / n;
+    if (n < 2) return;
+    double ss = 0.0;
+    for (int i = 0; i < n; ++i) ss += (x[i] - out->mean) * (x[i] - out->mean);
+    out->sd = sqrt(ss / (n - 1));
+    out->ci95 = t_critical_95(n - 1) * out->sd / sqrt((double)n);
+}
+
+/*
+ * Purpose: Welch's unequal-variance t-test between two samples.
+ * Accepts: a, na - First sample (the baseline).
+ *          b, nb - Second sample (the current run).
+ *          t_out - Where to store the t statistic (may be NULL).
+ * Returns: The two-sided p-value, or -1.0 if either sample has fewer than
+ *          two values (no test possible).
+ */
+double bench_welch_test(const double *a, int na, const double *b, int nb, double *t_out) {
+    if (t_out) *t_out = 0.0;
+    if (na < 2 || nb < 2) return -1.0;
+    bench_summary_t sa, sb;
+    bench_summarize(a, na, &sa);
+    bench_summarize(b, nb, &sb);
+    double va = sa.sd * sa.sd / na, vb = sb.sd * sb.sd / nb;
+    if (va + vb == 0.0) return sa.mean == sb.mean ? 1.0 : 0.0; // Both constant
+    double t = (sb.mean - sa.mean) / sqrt(va + vb);
+    double df = (va + vb) * (va + vb) / (va * va / (na - 1) + vb * vb / (nb - 1)); // Welch-Satterthwaite
+    if (t_out) *t_out = t;
+    return t_two_sided_p(t, df);
+}
+
+/*
+ * Purpose: Loads a results file written by bench -j. Each result may carry
+ *          per-trial sample arrays; a result without them (a single-trial
+ *          run) counts as one sample of its scalar fields.
+ * Accepts: path - The JSON file.
+ *          out  - Where to store the baseline (release with
+ *                 bench_baseline_free).
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int bench_baseline_load(const char *path, bench_baseline_t *out) {
+    memset(out, 0, sizeof(*out));
+    FILE *fp = fopen(path, "r");
+    if (!fp) { print_error("Bench Baseline", "fopen failed"); return -1; }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    int capacity = 0;
+    int result = 0;
+    while (getline(&line, &line_cap, fp) != -1) {
+        double value;
+        if (!strstr(line, "\"engine\"")) { // Header fields
+            if (strstr(line, "\"queue_only\": true")) out->queue_only = true;
+            if (json_number(line, "duration_ms", &value)) out->duration_ms = (long)value;
+            continue;
+        }
+        if (out->count == capacity) {
+            int grown = capacity ? capacity * 2 : 32;
+            bench_baseline_row_t *rows = realloc(out->rows, (size_t)grown * sizeof(bench_baseline_row_t));
+            if (!rows) { print_error("Bench Baseline", "realloc failed"); result = -1; break; }
+            out->rows = rows;
+            capacity = grown;
+        }
+        if (parse_result_line(line, &out->rows[out->count]) == 0) out->count++;
+    }
+    free(line);
+    fclose(fp);
+    if (result == 0 && out->count == 0) {
+        fprintf(stderr, "Error: %s holds no bench results\n", path);
+        result = -1;
+    }
+    if (result == -1) bench_baseline_free(out);
+    return result;
+}
+
+/*
+ * Purpose: Finds the baseline row of a configuration.
+ * Accepts: b - The baseline.
+ *          p - The configuration (engine, threads, capacity, size).
+ * Returns: Pointer to the row, or NULL if the baseline does not have it.
+ */
+const bench_baseline_row_t* bench_baseline_find(const bench_baseline_t *b, const bench_params_t *p) {
+    for (int i = 0; i < b->count; ++i) {
+        const bench_baseline_row_t *r = &b->rows[i];
+        if (r->mode == p->mode && r->producers == p->producers && r->consumers == p->consumers &&
+            r->capacity == p->capacity && r->msg_size == p->msg_size) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Releases a loaded baseline.
+ * Accepts: b - The baseline.
+ * Returns: None.
+ */
+void bench_baseline_free(bench_baseline_t *b) {
+    free(b->rows);
+    b->rows = NULL;
+    b->count = 0;
+}
+
+/*
+ * Purpose: Two-sided tail probability of Student's t distribution.
+ * Accepts: t  - The statistic.
+ *          df - Degrees of freedom (may be fractional).
+ * Returns: P(|T| >= |t|).
+ */
+static double t_two_sided_p(double t, double df) {
+    return incomplete_beta(df / (df + t * t), df / 2.0, 0.5);
+}
+
+/*
+ * Purpose: Critical value of Student's t for a 95% two-sided interval,
+ *          found by bisection on t_two_sided_p.
+ * Accepts: df - Degrees of freedom (>= 1).
+ * Returns: t such that P(|T| >= t) = 0.05.
+ */
+static double t_critical_95(double df) {
+    double lo = 0.0, hi = 1000.0;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (lo + hi) / 2.0;
+        if (t_two_sided_p(mid, df) > 0.05) lo = mid;
+        else hi = mid;
+    }
+    return (lo + hi) / 2.0;
+}
+
+/*
+ * Purpose: Regularized incomplete beta function I_x(a, b).
+ * Accepts: x - Upper limit, 0..1.
+ *          a - First shape parameter (> 0).
+ *          b - Second shape parameter (> 0).
+ * Returns: I_x(a, b).
+ */
+static double incomplete_beta(double x, double a, double b) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    // The continued fraction converges fast only below (a + 1) / (a + b + 2)
+    if (x < (a + 1.0) / (a + b + 2.0)) return front * beta_continued_fraction(x, a, b) / a;
+    return 1.0 - front * beta_continued_fraction(1.0 - x, b, a) / b;
+}
+
+/*
+ * Purpose: Continued fraction of the incomplete beta function (modified
+ *          Lentz's method).
+ * Accepts: x - Upper limit.
+ *          a - First shape parameter.
+ *          b - Second shape parameter.
+ * Returns: The fraction's value.
+ */
+static double beta_continued_fraction(double x, double a, double b) {
+    double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+    if (fabs(d) < BETA_CF_TINY) d = BETA_CF_TINY;
+    d = 1.0 / d;
+    double h = d;
+    for (int m = 1; m <= BETA_CF_ITERATIONS; ++m) {
+        double m2 = 2.0 * m;
+        double num = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + num * d; if (fabs(d) < BETA_CF_TINY) d = BETA_CF_TINY;
+        c = 1.0 + num / c; if (fabs(c) < BETA_CF_TINY) c = BETA_CF_TINY;
+        d = 1.0 / d;
+        h *= d * c;
+        num = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + num * d; if (fabs(d) < BETA_CF_TINY) d = BETA_CF_TINY;
+        c = 1.0 + num / c; if (fabs(c) < BETA_CF_TINY) c = BETA_CF_TINY;
+        d = 1.0 / d;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < BETA_CF_EPSILON) break;
+    }
+    return h;
+}
+
+/*
+ * Purpose: Finds the value of a key in a one-line JSON object.
+ * Accepts: line - The line.
+ *          key  - The key, without quotes.
+ * Returns: Pointer to the first character of the value, or NULL.
+ */
+static const char* json_value(const char *line, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *at = strstr(line, pattern);
+    if (!at) return NULL;
+    at += strlen(pattern);
+    while (*at == ' ') at++;
+    return at;
+}
+
+/*
+ * Purpose: Reads a numeric value from a one-line JSON object.
+ * Accepts: line - The line.
+ *          key  - The key.
+ *          out  - Where to store the number.
+ * Returns: true if the key holds a number.
+ */
+static bool json_number(const char *line, const char *key, double *out) {
+    const char *at = json_value(line, key);
+    if (!at) return false;
+    char *end;
+    double v = strtod(at, &end);
+    if (end == at) return false;
+    *out = v;
+    return true;
+}
+
+/*
+ * Purpose: Reads an array of numbers from a one-line JSON object.
+ * Accepts: line - The line.
+ *          key  - The key.
+ *          out  - Array to fill.
+ *          max  - Capacity of the array.
+ * Returns: Number of values read (0 if the key is missing or not an array).
+ */
+static int json_array(const char *line, const char *key, double *out, int max) {
+    const char *at = json_value(line, key);
+    if (!at || *at != '[') return 0;
+    at++;
+    int n = 0;
+    while (n < max) {
+        char *end;
+        double v = strtod(at, &end);
+        if (end == at) break;
+        out[n++] = v;
+        at = end;
+        while (*at == ' ' || *at == ',') at++;
+    }
+    return n;
+}
+
+/*
+ * Purpose: Parses one result object of a bench JSON file.
+ * Accepts: line - The line holding the object.
+ *          row  - Where to store it.
+ * Returns: 0 on success, -1 if the line is not a complete result.
+ */
+static int parse_result_line(const char *line, bench_baseline_row_t *row) {
+    memset(row, 0, sizeof(*row));
+    const char *engine = json_value(line, "engine");
+    if (!engine) return -1;
+    if (strncmp(engine, "\"sem\"", 5) == 0) row->mode = SYNC_MODE_SEM;
+    else if (strncmp(engine, "\"cond\"", 6) == 0) row->mode = SYNC_MODE_CONDVAR;
+    else return -1;
+
+    double producers, consumers, capacity, msg_size;
+    if (!json_number(line, "producers", &producers) || !json_number(line, "consumers", &consumers) ||
+        !json_number(line, "capacity", &capacity) || !json_number(line, "msg_size", &msg_size)) {
+        return -1;
+    }
+    row->producers = (int)producers;
+    row->consumers = (int)consumers;
+    row->capacity = (size_t)capacity;
+    row->msg_size = (int)msg_size;
+
+    int n = json_array(line, "msgs_per_s_samples", row->msgs_per_s, BENCH_TRIALS_MAX);
+    if (n > 0 && json_array(line, "lat_p50_ns_samples", row->lat_p50_ns, BENCH_TRIALS_MAX) == n &&
+        json_array(line, "lat_p99_ns_samples", row->lat_p99_ns, BENCH_TRIALS_MAX) == n) {
+        row->trials = n;
+        return 0;
+    }
+    // Single-trial file: the scalar fields are the only sample
+    if (!json_number(line, "msgs_per_s", &row->msgs_per_s[0]) || !json_number(line, "lat_p50_ns", &row->lat_p50_ns[0]) ||
+        !json_number(line, "lat_p99_ns", &row->lat_p99_ns[0])) {
+        return -1;
+    }
+    row->trials = 1;
+    return 0;
+}
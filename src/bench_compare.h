@@ -0,0 +1,92 @@
+#ifndef BENCH_COMPARE_H
+#define BENCH_COMPARE_H
+
+#include "bench_run.h"
+
+// Statistics for repeated bench trials and the regression check against a
+// saved baseline: per-metric mean with a 95% confidence interval, Welch's
+// t-test between baseline and current samples, and a loader for the JSON
+// that bench -j writes (one result object per line).
+
+// --- Constants ---
+#define BENCH_TRIALS_MAX 32  // Trials per configuration
+#define BENCH_ALPHA 0.05     // Two-sided significance level of the regression test
+
+// --- Summary of One Metric Over the Trials ---
+typedef struct bench_summary_s {
+    int n;
+    double mean;
+    double sd;               // Sample standard deviation (0 for n < 2)
+    double ci95;             // Half-width of the 95% confidence interval of the mean (0 for n < 2)
+} bench_summary_t;
+
+// --- One Configuration of a Loaded Baseline ---
+typedef struct bench_baseline_row_s {
+    sync_mode_t mode;
+    int producers;
+    int consumers;
+    size_t capacity;
+    int msg_size;
+    double msgs_per_s[BENCH_TRIALS_MAX];
+    double lat_p50_ns[BENCH_TRIALS_MAX];
+    double lat_p99_ns[BENCH_TRIALS_MAX];
+    int trials;
+} bench_baseline_row_t;
+
+// --- Loaded Baseline ---
+typedef struct bench_baseline_s {
+    bench_baseline_row_t *rows;
+    int count;
+    bool queue_only;
+    long duration_ms;
+} bench_baseline_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Computes mean, standard deviation and the 95% confidence interval
+ *          (Student's t) of a sample.
+ * Accepts: x   - The values.
+ *          n   - How many (0 yields an all-zero summary).
+ *          out - Where to store the summary.
+ * Returns: None.
+ */
+void bench_summarize(const double *x, int n, bench_summary_t *out);
+
+/*
+ * Purpose: Welch's unequal-variance t-test between two samples.
+ * Accepts: a, na - First sample (the baseline).
+ *          b, nb - Second sample (the current run).
+ *          t_out - Where to store the t statistic (may be NULL).
+ * Returns: The two-sided p-value, or -1.0 if either sample has fewer than
+ *          two values (no test possible).
+ */
+double bench_welch_test(const double *a, int na, const double *b, int nb, double *t_out);
+
+/*
+ * Purpose: Loads a results file written by bench -j. Each result may carry
+ *          per-trial sample arrays; a result without them (a single-trial
+ *          run) counts as one sample of its scalar fields.
+ * Accepts: path - The JSON file.
+ *          out  - Where to store the baseline (release with
+ *                 bench_baseline_free).
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int bench_baseline_load(const char *path, bench_baseline_t *out);
+
+/*
+ * Purpose: Finds the baseline row of a configuration.
+ * Accepts: b - The baseline.
+ *          p - The configuration (engine, threads, capacity, size).
+ * Returns: Pointer to the row, or NULL if the baseline does not have it.
+ */
+const bench_baseline_row_t* bench_baseline_find(const bench_baseline_t *b, const bench_params_t *p);
+
+/*
+ * Purpose: Releases a loaded baseline.
+ * Accepts: b - The baseline.
+ * Returns: None.
+ */
+void bench_baseline_free(bench_baseline_t *b);
+
+#endif // BENCH_COMPARE_H
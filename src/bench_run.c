@@ -0,0 +1,308 @@
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "config.h"
+#include "log.h"
+#include "hist.h"
+
+// The queue's waits poll the termination flag; the bench raises it to stop a run
+volatile sig_atomic_t g_terminate_flag = 0;
+
+// --- Constants ---
+#define BENCH_STOP_POLL_NS 1000000L // 1ms between wake-up rounds while stopping
+
+// --- Run Phases ---
+typedef enum {
+    BENCH_PHASE_WARMUP,
+    BENCH_PHASE_MEASURE,
+    BENCH_PHASE_DONE
+} bench_phase_t;
+
+// --- Per-Run State ---
+typedef struct bench_shared_s {
+    queue_t *q;
+    const bench_params_t *p;
+    atomic_int phase;     // bench_phase_t
+    atomic_int stopped;   // Workers that have left their loop
+} bench_shared_t;
+
+typedef struct bench_worker_s {
+    bench_shared_t *shared;
+    int id;
+    pthread_t thread;
+    unsigned long messages;       // Consumed while measuring (consumers only)
+    unsigned long hash_failures;
+    hist_t latency;               // Recorded by the owning consumer only
+} bench_worker_t;
+
+// --- Internal Helper Function Declarations ---
+static void* bench_producer_func(void *arg);
+static void* bench_consumer_func(void *arg);
+static void bench_stop_workers(bench_shared_t *shared, bench_worker_t *workers, int started);
+
+/*
+ * Purpose: Prepares the process-wide state the queue code reads: default
+ *          configuration with the capacity limits opened up to
+ *          QUEUE_CAPACITY_LIMIT and logging reduced to warnings. Call once
+ *          before the first bench_run.
+ * Accepts: None.
+ * Returns: None.
+ */
+void bench_setup(void) {
+    config_set_defaults(&g_config);
+    g_config.min_capacity = MIN_QUEUE_CAPACITY;
+    g_config.max_capacity = QUEUE_CAPACITY_LIMIT;
+    g_config.log_level = LOG_LEVEL_WARN; // The condvar engine logs every wait at info level
+}
+
+/*
+ * Purpose: Runs one configuration: creates a queue, starts the threads, lets
+ *          them warm up, measures for the configured duration, then stops
+ *          and joins every thread and destroys the queue.
+ * Accepts: p   - The configuration.
+ *          out - Where to store the result.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int bench_run(const bench_params_t *p, bench_result_t *out) {
+    if (!p || !out || p->producers < 1 || p->consumers < 1 || p->capacity < 1 ||
+        p->msg_size < 0 || p->msg_size >= MAX_DATA_SIZE || p->duration_ms <= 0 || p->warmup_ms < 0) {
+        errno = EINVAL; print_error("Bench", "Invalid benchmark parameters.");
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+
+    bench_shared_t shared;
+    shared.p = p;
+    atomic_init(&shared.phase, BENCH_PHASE_WARMUP);
+    atomic_init(&shared.stopped, 0);
+    shared.q = queue_create(p->capacity, p->mode);
+    if (!shared.q) return -1;
+
+    int total = p->producers + p->consumers;
+    bench_worker_t *workers = calloc((size_t)total, sizeof(bench_worker_t));
+    if (!workers) { print_error("Bench", "calloc for the workers failed"); queue_destroy(shared.q, p->mode); return -1; }
+
+    // Consumers first, so the producers' first messages are not stamped long before anyone reads
+    int started = 0;
+    for (; started < total; ++started) {
+        bench_worker_t *w = &workers[started];
+        bool consumer = started < p->consumers;
+        w->shared = &shared;
+        w->id = consumer ? started + 1 : started - p->consumers + 1;
+        hist_reset(&w->latency);
+        int ret = pthread_create(&w->thread, NULL, consumer ? bench_consumer_func : bench_producer_func, w);
+        if (ret != 0) { errno = ret; print_error("Bench", "pthread_create failed"); break; }
+    }
+    if (started < total) {
+        bench_stop_workers(&shared, workers, started);
+        free(workers);
+        queue_destroy(shared.q, p->mode);
+        return -1;
+    }
+
+    bench_sleep_ns((uint64_t)p->warmup_ms * 1000000ULL);
+    double cpu_start = bench_cpu_seconds();
+    uint64_t start_ns = monotonic_ns();
+    atomic_store(&shared.phase, BENCH_PHASE_MEASURE);
+    bench_sleep_ns((uint64_t)p->duration_ms * 1000000ULL);
+    atomic_store(&shared.phase, BENCH_PHASE_DONE);
+    uint64_t end_ns = monotonic_ns();
+    double cpu_end = bench_cpu_seconds();
+
+    bench_stop_workers(&shared, workers, started);
+
+    hist_t *latency = malloc(sizeof(hist_t));
+    if (latency) hist_reset(latency);
+    for (int i = 0; i < p->consumers; ++i) {
+        out->messages += workers[i].messages;
+        out->hash_failures += workers[i].hash_failures;
+        if (latency) hist_merge(latency, &workers[i].latency);
+    }
+    out->seconds = (double)(end_ns - start_ns) / 1e9;
+    out->msgs_per_s = out->seconds > 0 ? (double)out->messages / out->seconds : 0.0;
+    out->cpu_ns_per_msg = out->messages > 0 ? (cpu_end - cpu_start) * 1e9 / (double)out->messages : 0.0;
+    if (latency) {
+        out->lat_p50_ns = hist_percentile(latency, 50.0);
+        out->lat_p90_ns = hist_percentile(latency, 90.0);
+        out->lat_p99_ns = hist_percentile(latency, 99.0);
+        out->lat_p999_ns = hist_percentile(latency, 99.9);
+        out->lat_max_ns = atomic_load(&latency->max);
+        free(latency);
+    }
+
+    free(workers);
+    queue_destroy(shared.q, p->mode);
+    return 0;
+}
+
+/*
+ * Purpose: Parses a comma-separated list of integers ("1,10,1000").
+ * Accepts: value - The text to parse.
+ *          lo    - Smallest accepted value.
+ *          hi    - Largest accepted value.
+ *          out   - Array to fill.
+ *          max   - Capacity of the array.
+ * Returns: Number of values parsed, or -1 on invalid input.
+ */
+int bench_parse_list(const char *value, long lo, long hi, long *out, int max) {
+    int count = 0;
+    const char *cur = value;
+    while (*cur != '\0') {
+        char *end;
+        errno = 0;
+        long v = strtol(cur, &end, 10);
+        if (end == cur || errno != 0 || v < lo || v > hi || count >= max) return -1;
+        if (*end != ',' && *end != '\0') return -1;
+        out[count++] = v;
+        cur = *end == ',' ? end + 1 : end;
+    }
+    return count > 0 ? count : -1;
+}
+
+/*
+ * Purpose: Parses the engine list ("sem", "cond" or "sem,cond").
+ * Accepts: value - The text to parse.
+ *          modes - Array of BENCH_MODES_MAX to fill.
+ * Returns: Number of engines, or -1 on invalid input.
+ */
+int bench_parse_modes(const char *value, sync_mode_t *modes) {
+    int count = 0;
+    const char *cur = value;
+    while (*cur != '\0' && count < BENCH_MODES_MAX) {
+        size_t len = strcspn(cur, ",");
+        if (len == 3 && strncmp(cur, "sem", 3) == 0) modes[count++] = SYNC_MODE_SEM;
+        else if (len == 4 && strncmp(cur, "cond", 4) == 0) modes[count++] = SYNC_MODE_CONDVAR;
+        else return -1;
+        cur += len;
+        if (*cur == ',') cur++;
+    }
+    return (*cur == '\0' && count > 0) ? count : -1;
+}
+
+/*
+ * Purpose: Producer body: builds a message (payload fill and hash, as the
+ *          demo's producers do, unless queue_only) and adds it, with no
+ *          think time, until the run is stopped.
+ * Accepts: arg - Pointer to the worker's bench_worker_t.
+ * Returns: Always NULL.
+ */
+static void* bench_producer_func(void *arg) {
+    bench_worker_t *w = (bench_worker_t *)arg;
+    const bench_params_t *p = w->shared->p;
+    unsigned int seed = (unsigned int)w->id * 2654435761u;
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    if (p->queue_only) bench_fill_message(&msg, p->msg_size, &seed);
+
+    while (!g_terminate_flag) {
+        if (!p->queue_only) bench_fill_message(&msg, p->msg_size, &seed);
+        msg.enqueue_ns = monotonic_ns();
+        if (queue_add(w->shared->q, &msg, "Bench Producer") == -1) break;
+    }
+    atomic_fetch_add(&w->shared->stopped, 1);
+    return NULL;
+}
+
+/*
+ * Purpose: Consumer body: removes messages, verifies the hash (unless
+ *          queue_only) and, during the measured window, counts them and
+ *          records their latency.
+ * Accepts: arg - Pointer to the worker's bench_worker_t.
+ * Returns: Always NULL.
+ */
+static void* bench_consumer_func(void *arg) {
+    bench_worker_t *w = (bench_worker_t *)arg;
+    const bench_params_t *p = w->shared->p;
+    message_t msg;
+
+    while (!g_terminate_flag) {
+        if (queue_remove(w->shared->q, &msg, "Bench Consumer") == -1) break;
+        uint64_t now = monotonic_ns();
+        bool hash_ok = true;
+        if (!p->queue_only) {
+            unsigned short original_hash = msg.hash;
+            msg.hash = 0;
+            hash_ok = calculate_message_hash(&msg) == original_hash;
+        }
+        if (atomic_load_explicit(&w->shared->phase, memory_order_relaxed) != BENCH_PHASE_MEASURE) continue;
+        w->messages++;
+        if (!hash_ok) w->hash_failures++;
+        hist_record(&w->latency, now - msg.enqueue_ns);
+    }
+    atomic_fetch_add(&w->shared->stopped, 1);
+    return NULL;
+}
+
+/*
+ * Purpose: Fills a message the way the demo's producers do: random type,
+ *          random payload bytes of the given size, then the hash.
+ * Accepts: msg  - The message to fill.
+ *          size - Payload size in bytes.
+ *          seed - The caller's rand_r seed.
+ * Returns: None.
+ */
+void bench_fill_message(message_t *msg, int size, unsigned int *seed) {
+    msg->type = (unsigned char)(rand_r(seed) % 256);
+    msg->size = (unsigned char)size;
+    for (int i = 0; i < size; ++i) {
+        msg->data[i] = (unsigned char)(rand_r(seed) % 256);
+    }
+    msg->hash = 0;
+    msg->hash = calculate_message_hash(msg);
+}
+
+/*
+ * Purpose: Stops the started workers: raises the termination flag and wakes
+ *          them (bench_wake_until_stopped), joins them and lowers the flag
+ *          again for the next run.
+ * Accepts: shared  - The run's shared state.
+ *          workers - The worker array.
+ *          started - How many workers were started.
+ * Returns: None.
+ */
+static void bench_stop_workers(bench_shared_t *shared, bench_worker_t *workers, int started) {
+    bench_wake_until_stopped(shared->q, &shared->stopped, started);
+    for (int i = 0; i < started; ++i) {
+        int ret = pthread_join(workers[i].thread, NULL);
+        if (ret != 0) { errno = ret; print_error("Bench", "pthread_join failed"); }
+    }
+    g_terminate_flag = 0;
+}
+
+/*
+ * Purpose: Sleeps for the given time, resuming after EINTR.
+ * Accepts: ns - Nanoseconds to sleep.
+ * Returns: None.
+ */
+void bench_sleep_ns(uint64_t ns) {
+    struct timespec req = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    while (nanosleep(&req, &req) == -1 && errno == EINTR) { }
+}
+
+/*
+ * Purpose: Reads the CPU time consumed by all threads of the process.
+ * Accepts: None.
+ * Returns: User plus system time in seconds.
+ */
+double bench_cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Purpose: Raises the termination flag and wakes the queue's waiters until
+ *          the given number of threads have left their loops (a single
+ *          wake-up can race with a thread that is about to block). The
+ *          caller joins the threads and lowers the flag.
+ * Accepts: q       - The queue the threads use.
+ *          stopped - Counter each thread increments when it leaves its loop.
+ *          started - How many threads to wait for.
+ * Returns: None.
+ */
+void bench_wake_until_stopped(queue_t *q, atomic_int *stopped, int started) {
+    g_terminate_flag = 1;
+    while (atomic_load(stopped) < started) {
+        queue_wake_all(q, started + 1);
+        bench_sleep_ns(BENCH_STOP_POLL_NS);
+    }
+}
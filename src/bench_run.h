@@ -0,0 +1,118 @@
+#ifndef BENCH_RUN_H
+#define BENCH_RUN_H
+
+#include "common.h"
+
+// Headless benchmark core shared by the bench tools: runs the real queue
+// (queue_manager.c) with producers and consumers that never think, measures
+// a fixed window after a warmup and reports throughput, end-to-end latency
+// and CPU time per message. No terminal, keyboard or control socket.
+
+// --- Constants ---
+#define BENCH_LIST_MAX 32 // Values per option list
+#define BENCH_MODES_MAX 2 // Engines an engine list can name
+
+// --- One Benchmark Configuration ---
+typedef struct bench_params_s {
+    sync_mode_t mode;
+    int producers;
+    int consumers;
+    size_t capacity;
+    int msg_size;        // Payload bytes, 0..MAX_DATA_SIZE-1
+    bool queue_only;     // Prebuilt messages: no payload fill, no hash verify
+    long warmup_ms;
+    long duration_ms;
+} bench_params_t;
+
+// --- Result of One Run ---
+typedef struct bench_result_s {
+    unsigned long messages;   // Consumed during the measured window
+    double seconds;           // Length of the measured window
+    double msgs_per_s;
+    uint64_t lat_p50_ns;      // queue_add call to queue_remove return
+    uint64_t lat_p90_ns;
+    uint64_t lat_p99_ns;
+    uint64_t lat_p999_ns;
+    uint64_t lat_max_ns;
+    double cpu_ns_per_msg;    // Process CPU time (user + system) per message
+    unsigned long hash_failures;
+} bench_result_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Prepares the process-wide state the queue code reads: default
+ *          configuration with the capacity limits opened up to
+ *          QUEUE_CAPACITY_LIMIT and logging reduced to warnings. Call once
+ *          before the first bench_run.
+ * Accepts: None.
+ * Returns: None.
+ */
+void bench_setup(void);
+
+/*
+ * Purpose: Runs one configuration: creates a queue, starts the threads, lets
+ *          them warm up, measures for the configured duration, then stops
+ *          and joins every thread and destroys the queue.
+ * Accepts: p   - The configuration.
+ *          out - Where to store the result.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int bench_run(const bench_params_t *p, bench_result_t *out);
+
+/*
+ * Purpose: Parses a comma-separated list of integers ("1,10,1000").
+ * Accepts: value - The text to parse.
+ *          lo    - Smallest accepted value.
+ *          hi    - Largest accepted value.
+ *          out   - Array to fill.
+ *          max   - Capacity of the array.
+ * Returns: Number of values parsed, or -1 on invalid input.
+ */
+int bench_parse_list(const char *value, long lo, long hi, long *out, int max);
+
+/*
+ * Purpose: Parses the engine list ("sem", "cond" or "sem,cond").
+ * Accepts: value - The text to parse.
+ *          modes - Array of BENCH_MODES_MAX to fill.
+ * Returns: Number of engines, or -1 on invalid input.
+ */
+int bench_parse_modes(const char *value, sync_mode_t *modes);
+
+/*
+ * Purpose: Fills a message the way the demo's producers do: random type,
+ *          random payload bytes of the given size, then the hash.
+ * Accepts: msg  - The message to fill.
+ *          size - Payload size in bytes.
+ *          seed - The caller's rand_r seed.
+ * Returns: None.
+ */
+void bench_fill_message(message_t *msg, int size, unsigned int *seed);
+
+/*
+ * Purpose: Raises the termination flag and wakes the queue's waiters until
+ *          the given number of threads have left their loops (a single
+ *          wake-up can race with a thread that is about to block). The
+ *          caller joins the threads and lowers the flag.
+ * Accepts: q       - The queue the threads use.
+ *          stopped - Counter each thread increments when it leaves its loop.
+ *          started - How many threads to wait for.
+ * Returns: None.
+ */
+void bench_wake_until_stopped(queue_t *q, atomic_int *stopped, int started);
+
+/*
+ * Purpose: Sleeps for the given time, resuming after EINTR.
+ * Accepts: ns - Nanoseconds to sleep.
+ * Returns: None.
+ */
+void bench_sleep_ns(uint64_t ns);
+
+/*
+ * Purpose: Reads the CPU time consumed by all threads of the process.
+ * Accepts: None.
+ * Returns: User plus system time in seconds.
+ */
+double bench_cpu_seconds(void);
+
+#endif // BENCH_RUN_H
@@ -16,6 +16,7 @@
 #include <time.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdatomic.h>
 
 // --- Constants ---
 #define INITIAL_QUEUE_CAPACITY 10
@@ -25,6 +26,10 @@
 #define MAX_PRODUCERS 10
 #define MAX_CONSUMERS 10
 #define RESIZE_STEP 1 // Adjust queue size by 1
+// Hard ceilings for the configurable limits (the values above are only defaults)
+#define QUEUE_CAPACITY_LIMIT 1000000
+#define PRODUCER_THREAD_LIMIT 256
+#define CONSUMER_THREAD_LIMIT 256
 
 // --- Synchronization Mode ---
 typedef enum {
@@ -38,6 +43,7 @@ typedef struct message_s {
     unsigned short hash;
     unsigned char size;
     unsigned char data[MAX_DATA_SIZE];
+    uint64_t enqueue_ns; // monotonic_ns() when the producer called queue_add (0: not stamped)
 } message_t;
 
 // --- Shared Queue Structure ---
@@ -57,8 +63,49 @@ typedef struct queue_s {
     // Stats
     unsigned long added_count_total;
     unsigned long extracted_count_total;
+    // Lock-free stats mirror: written inside the critical section, read without the mutex
+    atomic_size_t snap_count;
+    atomic_size_t snap_capacity;
+    atomic_ulong snap_added_total;
+    atomic_ulong snap_extracted_total;
+    atomic_int snap_head_idx;
+    atomic_int snap_tail_idx;
+    atomic_ulong resize_total;   // Completed capacity changes (written under the mutex)
+    atomic_ulong swap_total;     // Completed engine swaps
+    // Threads currently blocked in a queue wait (maintained by the wait helpers)
+    atomic_int waiting_producers;
+    atomic_int waiting_consumers;
+    atomic_int waiting_resizers;
+    // Engine selection and the gate that lets queue_swap_engine drain all operations
+    atomic_int mode;             // sync_mode_t currently used by add/remove/resize
+    atomic_int active_ops;       // Operations between queue_gate_enter and queue_gate_leave
+    atomic_bool swapping;        // Set while an engine swap is in progress
+    pthread_mutex_t gate_mutex;  // Protects sleeping on gate_cond
+    pthread_cond_t gate_cond;    // Broadcast when a swap finishes
 } queue_t;
 
+// --- Queue Stats Snapshot (filled without taking the queue mutex) ---
+typedef struct queue_stats_s {
+    sync_mode_t mode;
+    size_t count;
+    size_t capacity;
+    unsigned long added_total;
+    unsigned long extracted_total;
+    int head_idx;
+    int tail_idx;
+    int waiting_producers;
+    int waiting_consumers;
+    int waiting_resizers;
+    unsigned long resize_total;
+    unsigned long swap_total;
+} queue_stats_t;
+
+// --- Think Time Range (microseconds), adjustable at runtime ---
+typedef struct think_time_s {
+    atomic_long min_us;
+    atomic_long max_us;
+} think_time_t;
+
 // --- Thread Argument Structure ---
 typedef struct thread_args_s {
     int id;
@@ -69,6 +116,8 @@ typedef struct thread_args_s {
 // --- Global Flags ---
 extern volatile sig_atomic_t g_terminate_flag;
 extern sync_mode_t g_sync_mode;
+extern think_time_t g_producer_think;
+extern think_time_t g_consumer_think;
 
 // --- Utility Function Declarations ---
 
@@ -121,6 +170,23 @@ void print_error(const char *prefix, const char *msg);
  */
 void print_info(const char *prefix, const char *msg);
 
+/*
+ * Purpose: Reads the monotonic clock.
+ * Accepts: None.
+ * Returns: Nanoseconds since an arbitrary fixed point (CLOCK_MONOTONIC).
+ */
+uint64_t monotonic_ns(void);
+
+/*
+ * Purpose: Sleeps for a random duration within the given think time range.
+ *          Resumes after EINTR unless termination has been requested.
+ * Accepts: think  - Pointer to the think time range to draw from.
+ *          seed   - Pointer to the caller's rand_r seed.
+ *          prefix - String prefix for error messages.
+ * Returns: None.
+ */
+void think_time_sleep(think_time_t *think, unsigned int *seed, const char *prefix);
+
 /*
  * Purpose: Handles errors returned by pthread functions by printing a detailed
  *          error message including the file and line number, and then exiting.
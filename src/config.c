@@ -0,0 +1,431 @@
+// sched_getaffinity (the CPUs "spread" may use) needs the GNU extensions of <sched.h>
+#define _GNU_SOURCE
+#include "config.h"
+#include "log.h"
+#include "trace.h"
+#include "stats_shm.h"
+#include "occupancy.h"
+#include <getopt.h>
+#include <ctype.h>
+#include <sched.h>
+
+// Compiled-in defaults; g_config starts with them so tools that never parse
+// a command line still get a usable configuration.
+#define CONFIG_DEFAULT_INITIALIZER { \
+    .sync_mode = SYNC_MODE_SEM, \
+    .initial_capacity = INITIAL_QUEUE_CAPACITY, \
+    .min_capacity = MIN_QUEUE_CAPACITY, \
+    .max_capacity = MAX_QUEUE_CAPACITY, \
+    .resize_step = RESIZE_STEP, \
+    .initial_producers = 0, \
+    .initial_consumers = 0, \
+    .max_producers = MAX_PRODUCERS, \
+    .max_consumers = MAX_CONSUMERS, \
+    .producer_think_min_us = 100000L, \
+    .producer_think_max_us = 500000L, \
+    .consumer_think_min_us = 200000L, \
+    .consumer_think_max_us = 600000L, \
+    .producer_batch = 1, \
+    .consumer_batch = 1, \
+    .hash_verify = true, \
+    .latency = true, \
+    .perf_counters = false, \
+    .affinity_count = 0, \
+    .control_path = "", \
+    .watchdog_stall_ms = 5000L, \
+    .watchdog_queue_ms = 10000L, \
+    .log_level = LOG_LEVEL_INFO, \
+    .log_rate = 1000L, \
+    .trace_dir = "", \
+    .trace_events = TRACE_DEFAULT_EVENTS, \
+    .metrics_path = "", \
+    .metrics_port = 0, \
+    .stats_shm = "auto", \
+    .occupancy_us = 0, \
+    .occupancy_samples = OCCUPANCY_DEFAULT_SAMPLES, \
+    .occupancy_csv = "" \
+}
+
+config_t g_config = CONFIG_DEFAULT_INITIALIZER;
+
+// --- Configuration Keys (shared by the config file and long options) ---
+typedef struct config_key_s {
+    const char *name;
+    const char *arg_hint;
+    const char *help;
+} config_key_t;
+
+static const config_key_t config_keys[] = {
+    { "mode",             "sem|cond",     "Synchronization engine (default: sem)" },
+    { "control-socket",   "PATH",         "UNIX-domain control socket path (default: disabled)" },
+    { "capacity",         "N",            "Initial queue capacity" },
+    { "min-capacity",     "N",            "Smallest capacity a shrink may reach" },
+    { "max-capacity",     "N",            "Largest capacity a grow may reach" },
+    { "resize-step",      "N",            "Slots added/removed by '+' and '-'" },
+    { "producers",        "N",            "Producer threads started at launch" },
+    { "consumers",        "N",            "Consumer threads started at launch" },
+    { "max-producers",    "N",            "Upper limit on concurrent producers" },
+    { "max-consumers",    "N",            "Upper limit on concurrent consumers" },
+    { "producer-think",   "MIN:MAX",      "Producer think time range in microseconds" },
+    { "consumer-think",   "MIN:MAX",      "Consumer think time range in microseconds" },
+    { "producer-batch",   "N",            "Messages a producer adds per think cycle" },
+    { "consumer-batch",   "N",            "Messages a consumer removes per think cycle" },
+    { "hash-verify",      "on|off",       "Recompute and compare hashes in consumers" },
+    { "latency",          "on|off",       "Record enqueue-to-dequeue latency histograms" },
+    { "perf-counters",    "on|off",       "Count cycles, instructions, LLC misses, switches per thread" },
+    { "affinity",         "none|spread|LIST", "Pin workers to CPUs (LIST like 0,2,4-7)" },
+    { "watchdog-stall-ms", "MS",          "Flag a thread with no progress for MS (0: off)" },
+    { "watchdog-queue-ms", "MS",          "Flag a queue full/empty for MS (0: off)" },
+    { "log-level",        "error|warn|info|debug", "Most verbose level logged (default: info)" },
+    { "log-rate",         "N",            "Log lines per second per thread (0: unlimited)" },
+    { "trace-dir",        "DIR",          "Record binary per-thread traces into DIR (default: off)" },
+    { "trace-events",     "N",            "Event slots per thread trace file (oldest overwritten)" },
+    { "metrics-socket",   "PATH",         "Serve Prometheus metrics over HTTP on a UNIX socket" },
+    { "metrics-port",     "PORT",         "Serve Prometheus metrics on 127.0.0.1:PORT (0: off)" },
+    { "stats-shm",        "auto|off|/NAME", "Shared-memory stats page for queue_top (auto: /pcq-stats-PID)" },
+    { "occupancy-us",     "US",           "Sample queue occupancy every US microseconds (0: off)" },
+    { "occupancy-samples", "N",           "Occupancy samples kept (oldest overwritten)" },
+    { "occupancy-csv",    "PATH",         "Write the occupancy samples to PATH at exit" },
+};
+#define CONFIG_KEY_COUNT ((int)(sizeof(config_keys) / sizeof(config_keys[0])))
+#define CONFIG_LONG_OPT_BASE 1000
+
+// --- Internal Helper Function Declarations ---
+static int parse_long_range(const char *value, long lo, long hi, long *out);
+static int parse_think_range(const char *value, long *min_us, long *max_us);
+static int parse_cpu_list(config_t *cfg, const char *value);
+static char* trim(char *str);
+
+/*
+ * Purpose: Fills a configuration structure with the compiled-in defaults
+ *          (the constants from common.h).
+ * Accepts: cfg - Pointer to the configuration to reset.
+ * Returns: None.
+ */
+void config_set_defaults(config_t *cfg) {
+    static const config_t defaults = CONFIG_DEFAULT_INITIALIZER;
+    *cfg = defaults;
+}
+
+/*
+ * Purpose: Sets one configuration key from its textual value. Keys are the
+ *          same for the config file and the long command-line options.
+ * Accepts: cfg   - Pointer to the configuration to modify.
+ *          key   - Option name (e.g., "capacity", "producer-think").
+ *          value - Textual value (e.g., "20", "1000:5000", "0,2,4-7").
+ * Returns: 0 on success, -1 on unknown key or invalid value (prints error).
+ */
+int config_set(config_t *cfg, const char *key, const char *value) {
+    long num = 0;
+    int ok = -1;
+
+    if (!key || !value) return -1;
+    if (strcmp(key, "mode") == 0) {
+        if (strcmp(value, "sem") == 0) { cfg->sync_mode = SYNC_MODE_SEM; ok = 0; }
+        else if (strcmp(value, "cond") == 0) { cfg->sync_mode = SYNC_MODE_CONDVAR; ok = 0; }
+    } else if (strcmp(key, "control-socket") == 0) {
+        if (strlen(value) < sizeof(cfg->control_path)) { strcpy(cfg->control_path, value); ok = 0; }
+    } else if (strcmp(key, "capacity") == 0) {
+        if ((ok = parse_long_range(value, 1, QUEUE_CAPACITY_LIMIT, &num)) == 0) cfg->initial_capacity = (size_t)num;
+    } else if (strcmp(key, "min-capacity") == 0) {
+        if ((ok = parse_long_range(value, 1, QUEUE_CAPACITY_LIMIT, &num)) == 0) cfg->min_capacity = (size_t)num;
+    } else if (strcmp(key, "max-capacity") == 0) {
+        if ((ok = parse_long_range(value, 1, QUEUE_CAPACITY_LIMIT, &num)) == 0) cfg->max_capacity = (size_t)num;
+    } else if (strcmp(key, "resize-step") == 0) {
+        if ((ok = parse_long_range(value, 1, QUEUE_CAPACITY_LIMIT, &num)) == 0) cfg->resize_step = (int)num;
+    } else if (strcmp(key, "producers") == 0) {
+        if ((ok = parse_long_range(value, 0, PRODUCER_THREAD_LIMIT, &num)) == 0) cfg->initial_producers = (int)num;
+    } else if (strcmp(key, "consumers") == 0) {
+        if ((ok = parse_long_range(value, 0, CONSUMER_THREAD_LIMIT, &num)) == 0) cfg->initial_consumers = (int)num;
+    } else if (strcmp(key, "max-producers") == 0) {
+        if ((ok = parse_long_range(value, 1, PRODUCER_THREAD_LIMIT, &num)) == 0) cfg->max_producers = (int)num;
+    } else if (strcmp(key, "max-consumers") == 0) {
+        if ((ok = parse_long_range(value, 1, CONSUMER_THREAD_LIMIT, &num)) == 0) cfg->max_consumers = (int)num;
+    } else if (strcmp(key, "producer-think") == 0) {
+        ok = parse_think_range(value, &cfg->producer_think_min_us, &cfg->producer_think_max_us);
+    } else if (strcmp(key, "consumer-think") == 0) {
+        ok = parse_think_range(value, &cfg->consumer_think_min_us, &cfg->consumer_think_max_us);
+    } else if (strcmp(key, "producer-batch") == 0) {
+        if ((ok = parse_long_range(value, 1, 1000000L, &num)) == 0) cfg->producer_batch = (int)num;
+    } else if (strcmp(key, "consumer-batch") == 0) {
+        if ((ok = parse_long_range(value, 1, 1000000L, &num)) == 0) cfg->consumer_batch = (int)num;
+    } else if (strcmp(key, "hash-verify") == 0) {
+        if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0) { cfg->hash_verify = true; ok = 0; }
+        else if (strcmp(value, "off") == 0 || strcmp(value, "0") == 0) { cfg->hash_verify = false; ok = 0; }
+    } else if (strcmp(key, "latency") == 0) {
+        if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0) { cfg->latency = true; ok = 0; }
+        else if (strcmp(value, "off") == 0 || strcmp(value, "0") == 0) { cfg->latency = false; ok = 0; }
+    } else if (strcmp(key, "perf-counters") == 0) {
+        if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0) { cfg->perf_counters = true; ok = 0; }
+        else if (strcmp(value, "off") == 0 || strcmp(value, "0") == 0) { cfg->perf_counters = false; ok = 0; }
+    } else if (strcmp(key, "affinity") == 0) {
+        ok = parse_cpu_list(cfg, value);
+    } else if (strcmp(key, "watchdog-stall-ms") == 0) {
+        ok = parse_long_range(value, 0, 3600000L, &cfg->watchdog_stall_ms);
+    } else if (strcmp(key, "watchdog-queue-ms") == 0) {
+        ok = parse_long_range(value, 0, 3600000L, &cfg->watchdog_queue_ms);
+    } else if (strcmp(key, "log-level") == 0) {
+        int level = log_level_parse(value);
+        if (level >= 0) { cfg->log_level = level; ok = 0; }
+    } else if (strcmp(key, "log-rate") == 0) {
+        ok = parse_long_range(value, 0, 100000000L, &cfg->log_rate);
+    } else if (strcmp(key, "trace-dir") == 0) {
+        if (strlen(value) < sizeof(cfg->trace_dir)) { strcpy(cfg->trace_dir, value); ok = 0; }
+    } else if (strcmp(key, "trace-events") == 0) {
+        ok = parse_long_range(value, 1, 100000000L, &cfg->trace_events);
+    } else if (strcmp(key, "metrics-socket") == 0) {
+        if (strlen(value) < sizeof(cfg->metrics_path)) { strcpy(cfg->metrics_path, value); ok = 0; }
+    } else if (strcmp(key, "metrics-port") == 0) {
+        if ((ok = parse_long_range(value, 0, 65535, &num)) == 0) cfg->metrics_port = (int)num;
+    } else if (strcmp(key, "stats-shm") == 0) {
+        // POSIX shm names are "/NAME" with no further slashes
+        bool named = value[0] == '/' && value[1] != '\0' && !strchr(value + 1, '/') && strlen(value) < STATS_SHM_NAME_MAX;
+        if (named || strcmp(value, "auto") == 0 || strcmp(value, "off") == 0) { strcpy(cfg->stats_shm, value); ok = 0; }
+    } else if (strcmp(key, "occupancy-us") == 0) {
+        ok = parse_long_range(value, 0, 60000000L, &cfg->occupancy_us);
+    } else if (strcmp(key, "occupancy-samples") == 0) {
+        ok = parse_long_range(value, 1, 100000000L, &cfg->occupancy_samples);
+    } else if (strcmp(key, "occupancy-csv") == 0) {
+        if (strlen(value) < sizeof(cfg->occupancy_csv)) { strcpy(cfg->occupancy_csv, value); ok = 0; }
+    } else {
+        fprintf(stderr, "Error: Unknown configuration key '%s'.\n", key);
+        return -1;
+    }
+
+    if (ok != 0) fprintf(stderr, "Error: Invalid value '%s' for '%s'.\n", value, key);
+    return ok;
+}
+
+/*
+ * Purpose: Loads key=value lines from a file into the configuration. Blank
+ *          lines and lines starting with '#' are ignored; whitespace around
+ *          keys and values is trimmed.
+ * Accepts: cfg  - Pointer to the configuration to modify.
+ *          path - Path of the configuration file.
+ * Returns: 0 on success, -1 if the file cannot be read or has an invalid line.
+ */
+int config_load_file(config_t *cfg, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) { print_error("Config", "Failed to open config file"); return -1; }
+
+    char line[CONFIG_LINE_MAX];
+    int line_no = 0;
+    int result = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char *text = trim(line);
+        if (*text == '\0' || *text == '#') continue;
+
+        char *eq = strchr(text, '=');
+        if (!eq) {
+            fprintf(stderr, "Error: %s:%d: expected key=value.\n", path, line_no);
+            result = -1; break;
+        }
+        *eq = '\0';
+        if (config_set(cfg, trim(text), trim(eq + 1)) == -1) {
+            fprintf(stderr, "Error: %s:%d: invalid setting.\n", path, line_no);
+            result = -1; break;
+        }
+    }
+    if (ferror(fp)) { print_error("Config", "Failed to read config file"); result = -1; }
+    fclose(fp);
+    return result;
+}
+
+/*
+ * Purpose: Builds the configuration from defaults, an optional config file
+ *          (-c/--config) and command-line options, which take precedence over
+ *          the file. Validates the result.
+ * Accepts: cfg  - Pointer to the configuration to fill.
+ *          argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: 0 on success, 1 if help was requested, -1 on invalid input.
+ */
+int config_parse_args(config_t *cfg, int argc, char *argv[]) {
+    struct option long_opts[CONFIG_KEY_COUNT + 3];
+    for (int i = 0; i < CONFIG_KEY_COUNT; ++i) {
+        long_opts[i].name = config_keys[i].name;
+        long_opts[i].has_arg = required_argument;
+        long_opts[i].flag = NULL;
+        long_opts[i].val = CONFIG_LONG_OPT_BASE + i;
+    }
+    long_opts[CONFIG_KEY_COUNT] = (struct option){ "config", required_argument, NULL, 'c' };
+    long_opts[CONFIG_KEY_COUNT + 1] = (struct option){ "help", no_argument, NULL, 'h' };
+    long_opts[CONFIG_KEY_COUNT + 2] = (struct option){ NULL, 0, NULL, 0 };
+    const char *short_opts = "m:S:c:h";
+
+    config_set_defaults(cfg);
+
+    // First pass: only locate the config file so the command line can override it
+    int opt;
+    const char *config_path = NULL;
+    opterr = 0;
+    while ((opt = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1) {
+        if (opt == 'c') config_path = optarg;
+    }
+    if (config_path && config_load_file(cfg, config_path) == -1) return -1;
+
+    // Second pass: apply everything else in order
+    optind = 1;
+    opterr = 1;
+    while ((opt = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'm': if (config_set(cfg, "mode", optarg) == -1) return -1; break;
+            case 'S': if (config_set(cfg, "control-socket", optarg) == -1) return -1; break;
+            case 'c': break; // Already loaded
+            case 'h': return 1;
+            default:
+                if (opt >= CONFIG_LONG_OPT_BASE && opt < CONFIG_LONG_OPT_BASE + CONFIG_KEY_COUNT) {
+                    if (config_set(cfg, config_keys[opt - CONFIG_LONG_OPT_BASE].name, optarg) == -1) return -1;
+                    break;
+                }
+                return -1;
+        }
+    }
+    if (optind < argc) { // Check for non-option arguments if they are not input files
+        fprintf(stderr, "Error: Unexpected non-option arguments.\n");
+        return -1;
+    }
+    return config_validate(cfg);
+}
+
+/*
+ * Purpose: Checks cross-field constraints (e.g., initial <= max capacity,
+ *          min <= max think time) and clamps nothing silently.
+ * Accepts: cfg - Pointer to the configuration to check.
+ * Returns: 0 if valid, -1 otherwise (prints error).
+ */
+int config_validate(const config_t *cfg) {
+    if (cfg->min_capacity > cfg->max_capacity) {
+        fprintf(stderr, "Error: min-capacity (%zu) exceeds max-capacity (%zu).\n", cfg->min_capacity, cfg->max_capacity);
+        return -1;
+    }
+    if (cfg->initial_capacity < cfg->min_capacity || cfg->initial_capacity > cfg->max_capacity) {
+        fprintf(stderr, "Error: capacity %zu is outside [%zu, %zu].\n", cfg->initial_capacity, cfg->min_capacity, cfg->max_capacity);
+        return -1;
+    }
+    if (cfg->initial_producers > cfg->max_producers || cfg->initial_consumers > cfg->max_consumers) {
+        fprintf(stderr, "Error: initial thread count exceeds max-producers/max-consumers.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Purpose: Prints command-line usage, including every configuration key.
+ * Accepts: prog_name - The name of the executable (argv[0]).
+ * Returns: None.
+ */
+void config_print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m mode] [-S path] [-c file] [--key value ...] [-h]\n", prog_name);
+    fprintf(stderr, "  -m mode : Synchronization mode ('sem' for semaphores (default), 'cond' for condition variables).\n");
+    fprintf(stderr, "  -S path : Listen for control commands on a UNIX-domain socket at 'path'.\n");
+    fprintf(stderr, "  -c file : Load key=value settings from 'file' (command-line options override it).\n");
+    fprintf(stderr, "  -h      : Print this help message and exit.\n");
+    fprintf(stderr, "Configuration keys (use as --key VALUE or key=VALUE in the config file):\n");
+    for (int i = 0; i < CONFIG_KEY_COUNT; ++i) {
+        fprintf(stderr, "  %-18s %-18s %s\n", config_keys[i].name, config_keys[i].arg_hint, config_keys[i].help);
+    }
+}
+
+/*
+ * Purpose: Parses a decimal integer and checks it against an inclusive range.
+ * Accepts: value - Text to parse.
+ *          lo    - Smallest accepted value.
+ *          hi    - Largest accepted value.
+ *          out   - Where to store the parsed value.
+ * Returns: 0 on success, -1 on malformed or out-of-range input.
+ */
+static int parse_long_range(const char *value, long lo, long hi, long *out) {
+    char *end = NULL;
+    errno = 0;
+    long val = strtol(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || val < lo || val > hi) return -1;
+    *out = val;
+    return 0;
+}
+
+/*
+ * Purpose: Parses a "MIN:MAX" think time range (a single number sets both).
+ * Accepts: value  - Text to parse.
+ *          min_us - Where to store the lower bound.
+ *          max_us - Where to store the upper bound.
+ * Returns: 0 on success, -1 on malformed input or MIN > MAX.
+ */
+static int parse_think_range(const char *value, long *min_us, long *max_us) {
+    char buf[64];
+    long lo = 0, hi = 0;
+    if (strlen(value) >= sizeof(buf)) return -1;
+    strcpy(buf, value);
+    char *colon = strchr(buf, ':');
+    if (colon) *colon = '\0';
+    if (parse_long_range(buf, 0, 60000000L, &lo) == -1) return -1;
+    hi = lo;
+    if (colon && parse_long_range(colon + 1, 0, 60000000L, &hi) == -1) return -1;
+    if (lo > hi) return -1;
+    *min_us = lo;
+    *max_us = hi;
+    return 0;
+}
+
+/*
+ * Purpose: Parses an affinity specification: "none", "spread" (every CPU the
+ *          process may run on, so a restricted cpuset or taskset is honoured)
+ *          or a list of CPU numbers and ranges such as "0,2,4-7".
+ * Accepts: cfg   - Configuration whose affinity list is replaced.
+ *          value - Text to parse.
+ * Returns: 0 on success, -1 on malformed input.
+ */
+static int parse_cpu_list(config_t *cfg, const char *value) {
+    if (strcmp(value, "none") == 0) { cfg->affinity_count = 0; return 0; }
+    if (strcmp(value, "spread") == 0) {
+        cpu_set_t allowed;
+        int count = 0;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE && cpu < AFFINITY_MAX_CPUS; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) cfg->affinity_cpus[count++] = cpu;
+            }
+        }
+        if (count == 0) { // Mask unavailable: fall back to the online CPUs
+            long online = sysconf(_SC_NPROCESSORS_ONLN);
+            if (online < 1) online = 1;
+            if (online > AFFINITY_MAX_CPUS) online = AFFINITY_MAX_CPUS;
+            for (int i = 0; i < online; ++i) cfg->affinity_cpus[count++] = i;
+        }
+        cfg->affinity_count = count;
+        return 0;
+    }
+
+    char buf[CONFIG_LINE_MAX];
+    if (strlen(value) >= sizeof(buf)) return -1;
+    strcpy(buf, value);
+    int count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        long lo = 0, hi = 0;
+        char *dash = strchr(tok, '-');
+        if (dash) *dash = '\0';
+        if (parse_long_range(tok, 0, AFFINITY_MAX_CPUS - 1, &lo) == -1) return -1;
+        hi = lo;
+        if (dash && parse_long_range(dash + 1, lo, AFFINITY_MAX_CPUS - 1, &hi) == -1) return -1;
+        for (long cpu = lo; cpu <= hi; ++cpu) {
+            if (count >= AFFINITY_MAX_CPUS) return -1;
+            cfg->affinity_cpus[count++] = (int)cpu;
+        }
+    }
+    if (count == 0) return -1;
+    cfg->affinity_count = count;
+    return 0;
+}
+
+/*
+ * Purpose: Strips leading and trailing whitespace in place.
+ * Accepts: str - The string to trim.
+ * Returns: Pointer to the first non-space character of str.
+ */
+static char* trim(char *str) {
+    while (isspace((unsigned char)*str)) str++;
+    char *end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) *--end = '\0';
+    return str;
+}
@@ -0,0 +1,106 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "common.h"
+
+// --- Constants ---
+#define CONFIG_PATH_MAX 108      // Matches sun_path so the control socket path always fits
+#define CONFIG_LINE_MAX 512
+#define AFFINITY_MAX_CPUS 256
+
+// --- Runtime Configuration ---
+typedef struct config_s {
+    sync_mode_t sync_mode;
+    size_t initial_capacity;
+    size_t min_capacity;
+    size_t max_capacity;
+    int resize_step;
+    int initial_producers;
+    int initial_consumers;
+    int max_producers;
+    int max_consumers;
+    long producer_think_min_us;
+    long producer_think_max_us;
+    long consumer_think_min_us;
+    long consumer_think_max_us;
+    int producer_batch;          // Messages produced back-to-back per think cycle
+    int consumer_batch;          // Messages consumed back-to-back per think cycle
+    bool hash_verify;            // Consumers recompute and compare the message hash
+    bool latency;                // Stamp messages and record end-to-end latency histograms
+    bool perf_counters;          // Per-thread perf_event counters, reported per message at exit
+    int affinity_cpus[AFFINITY_MAX_CPUS];
+    int affinity_count;          // 0 means threads are not pinned
+    char control_path[CONFIG_PATH_MAX];
+    long watchdog_stall_ms;      // No-progress interval that flags a thread (0 disables)
+    long watchdog_queue_ms;      // Full/empty interval that flags the queue (0 disables)
+    int log_level;               // log_level_t; lines above it are discarded
+    long log_rate;               // Log lines per second per thread (0 = unlimited)
+    char trace_dir[CONFIG_PATH_MAX]; // Binary trace output directory ("" disables tracing)
+    long trace_events;           // Event slots per thread trace file
+    char metrics_path[CONFIG_PATH_MAX]; // Prometheus exporter UNIX socket ("" disables it)
+    int metrics_port;            // Prometheus exporter port on 127.0.0.1 (0 disables it)
+    char stats_shm[CONFIG_PATH_MAX]; // Shared-memory stats page: "auto", "off" or a /NAME
+    long occupancy_us;           // Occupancy sampling interval (0 disables the sampler)
+    long occupancy_samples;      // Occupancy ring size in samples
+    char occupancy_csv[CONFIG_PATH_MAX]; // Occupancy CSV written at exit ("" for none)
+} config_t;
+
+extern config_t g_config;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Fills a configuration structure with the compiled-in defaults
+ *          (the constants from common.h).
+ * Accepts: cfg - Pointer to the configuration to reset.
+ * Returns: None.
+ */
+void config_set_defaults(config_t *cfg);
+
+/*
+ * Purpose: Sets one configuration key from its textual value. Keys are the
+ *          same for the config file and the long command-line options.
+ * Accepts: cfg   - Pointer to the configuration to modify.
+ *          key   - Option name (e.g., "capacity", "producer-think").
+ *          value - Textual value (e.g., "20", "1000:5000", "0,2,4-7").
+ * Returns: 0 on success, -1 on unknown key or invalid value (prints error).
+ */
+int config_set(config_t *cfg, const char *key, const char *value);
+
+/*
+ * Purpose: Loads key=value lines from a file into the configuration. Blank
+ *          lines and lines starting with '#' are ignored; whitespace around
+ *          keys and values is trimmed.
+ * Accepts: cfg  - Pointer to the configuration to modify.
+ *          path - Path of the configuration file.
+ * Returns: 0 on success, -1 if the file cannot be read or has an invalid line.
+ */
+int config_load_file(config_t *cfg, const char *path);
+
+/*
+ * Purpose: Builds the configuration from defaults, an optional config file
+ *          (-c/--config) and command-line options, which take precedence over
+ *          the file. Validates the result.
+ * Accepts: cfg  - Pointer to the configuration to fill.
+ *          argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: 0 on success, 1 if help was requested, -1 on invalid input.
+ */
+int config_parse_args(config_t *cfg, int argc, char *argv[]);
+
+/*
+ * Purpose: Checks cross-field constraints (e.g., initial <= max capacity,
+ *          min <= max think time) and clamps nothing silently.
+ * Accepts: cfg - Pointer to the configuration to check.
+ * Returns: 0 if valid, -1 otherwise (prints error).
+ */
+int config_validate(const config_t *cfg);
+
+/*
+ * Purpose: Prints command-line usage, including every configuration key.
+ * Accepts: prog_name - The name of the executable (argv[0]).
+ * Returns: None.
+ */
+void config_print_usage(const char *prog_name);
+
+#endif // CONFIG_H
@@ -1,6 +1,16 @@
 #include "consumer.h"
 #include "queue_manager.h"
 #include "utils.h"
+#include "config.h"
+#include "affinity.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include "log.h"
+#include "perfctr.h"
+#include "latency.h"
+
+// --- Static Variables ---
+static atomic_ulong hash_failures = 0; // Messages whose recomputed hash did not match
 
 /*
  * Purpose: The entry point function for consumer threads. Runs a loop that
@@ -29,7 +39,14 @@ void* consumer_thread_func(void *arg) {
     char info_prefix[32];
     snprintf(info_prefix, sizeof(info_prefix), "Consumer %d", id);
     print_info(info_prefix, "Started.");
+    affinity_pin_worker(false, id);
+    thread_stats_register(THREAD_ROLE_CONSUMER, id);
+    trace_thread_attach(); // Maps the trace file now, not under the queue lock
+    pthread_cleanup_push(thread_stats_cleanup_handler, NULL); // Also runs on 'P'/'C' cancellation
+    perfctr_thread_start();
+    pthread_cleanup_push(perfctr_cleanup_handler, NULL); // Runs first, while the stats slot is still ours
 
+    int batch_pos = 0;
     while (!g_terminate_flag) {
         message_t msg;
         unsigned short original_hash;
@@ -41,41 +58,48 @@ void* consumer_thread_func(void *arg) {
             else { print_error(info_prefix, "Failed to remove message from queue."); }
             break;
         }
+        thread_stats_note_message(msg.size);
+        // Engine and capacity the message went through, for the latency breakdown
+        sync_mode_t lat_mode = (sync_mode_t)atomic_load_explicit(&q->mode, memory_order_relaxed);
+        size_t lat_capacity = atomic_load_explicit(&q->snap_capacity, memory_order_relaxed);
+        if (msg.enqueue_ns) latency_record(LATENCY_DEQUEUE, lat_mode, lat_capacity, monotonic_ns() - msg.enqueue_ns);
 
         // Process Message (Verify Hash)
+        thread_stats_set_state(THREAD_STATE_CONSUMING);
         original_hash = msg.hash;
         msg.hash = 0;
-        calculated_hash = calculate_message_hash(&msg);
+        calculated_hash = g_config.hash_verify ? calculate_message_hash(&msg) : original_hash;
         bool hash_ok = (original_hash == calculated_hash);
+        if (msg.enqueue_ns) latency_record(LATENCY_PROCESSED, lat_mode, lat_capacity, monotonic_ns() - msg.enqueue_ns);
 
-        // Print status
-        unsigned long total_extracted = queue_get_extracted_total(q);
-        printf("[%s] Extracted msg (Type:%u Size:%u Hash:%u -> %s). Total Extracted: %lu\r\n",
-               info_prefix, msg.type, msg.size, original_hash,
-               hash_ok ? "OK" : "FAIL", total_extracted);
-        fflush(stdout);
+        // Log status (buffered; the total comes from the lock-free snapshot)
+        log_write(LOG_LEVEL_INFO, "[%s] Extracted msg (Type:%u Size:%u Hash:%u -> %s). Total Extracted: %lu",
+                  info_prefix, msg.type, msg.size, original_hash, hash_ok ? "OK" : "FAIL",
+                  atomic_load_explicit(&q->snap_extracted_total, memory_order_relaxed));
         if (!hash_ok) {
-            fprintf(stderr, "WARNING: [%s] Hash mismatch! Expected %u, Calculated %u\r\n",
-                    info_prefix, original_hash, calculated_hash);
-            fflush(stderr);
+            atomic_fetch_add_explicit(&hash_failures, 1, memory_order_relaxed);
+            log_write(LOG_LEVEL_WARN, "WARNING: [%s] Hash mismatch! Expected %u, Calculated %u",
+                      info_prefix, original_hash, calculated_hash);
         }
 
-        // Delay
-        struct timespec delay_req = {0, 0};
-        struct timespec delay_rem;
-        long delay_us = (rand_r(&seed) % 400000L) + 200000L;
-        delay_req.tv_sec = delay_us / 1000000L;
-        delay_req.tv_nsec = (delay_us % 1000000L) * 1000L;
-        while (nanosleep(&delay_req, &delay_rem) == -1) {
-            if (errno == EINTR) {
-                if (g_terminate_flag) break;
-                delay_req = delay_rem;
-            } else {
-                print_error(info_prefix, "nanosleep failed"); break;
-            }
-        }
+        // Delay once per batch
+        if (++batch_pos < g_config.consumer_batch) continue;
+        batch_pos = 0;
+        thread_stats_set_state(THREAD_STATE_SLEEPING);
+        think_time_sleep(&g_consumer_think, &seed, info_prefix);
     }
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
 
     print_info(info_prefix, "Terminating.");
     return NULL;
 }
+
+/*
+ * Purpose: Returns how many messages failed hash verification so far.
+ * Accepts: None.
+ * Returns: The failure count over all consumers.
+ */
+unsigned long consumer_hash_failures(void) {
+    return atomic_load_explicit(&hash_failures, memory_order_relaxed);
+}
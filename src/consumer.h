@@ -18,4 +18,11 @@
  */
 void* consumer_thread_func(void *arg);
 
+/*
+ * Purpose: Returns how many messages failed hash verification so far.
+ * Accepts: None.
+ * Returns: The failure count over all consumers.
+ */
+unsigned long consumer_hash_failures(void);
+
 #endif // CONSUMER_H
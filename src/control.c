@@ -0,0 +1,410 @@
+#include "control.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// --- Constants ---
+#define CONTROL_WAKE_INTERVAL_NS 1000000L // 1ms between wake-ups while stopping
+#define CONTROL_OUT_MAX (2 * CONTROL_REPLY_MAX) // Unsent reply bytes kept per client
+
+// --- Static Variables ---
+typedef struct control_client_s {
+    int fd;                       // -1 once closed (the slot stays taken while busy)
+    int index;                    // Slot number; the command thread's ID is index + 1
+    size_t used;                  // Bytes of the line being assembled (keeps counting past the limit)
+    char line[CONTROL_LINE_MAX];
+    char in[CONTROL_LINE_MAX];    // Received bytes not parsed yet (held while a command runs)
+    size_t in_len;
+    char out[CONTROL_OUT_MAX];    // Reply bytes the peer has not accepted yet
+    size_t out_len;
+    bool busy;                    // A command thread runs for this client
+    atomic_bool done;             // Set by the command thread once reply is complete
+    pthread_t worker;
+    char cmd[CONTROL_LINE_MAX];   // Command line handed to the command thread
+    char reply[CONTROL_REPLY_MAX];
+} control_client_t;
+
+static int listen_fd = -1;
+static int wake_pipe[2] = { -1, -1 }; // Command threads nudge the poll loop through it
+static char bound_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pthread_t control_thread;
+static bool control_running = false;
+static atomic_bool control_stop_requested = false;
+static atomic_bool control_exited = false; // Set once the control thread and its commands have finished
+static control_handler_t control_handler = NULL;
+static control_client_t clients[CONTROL_MAX_CLIENTS];
+
+// --- Internal Helper Function Declarations ---
+static void* control_thread_func(void *arg);
+static void* control_command_func(void *arg);
+static void control_accept_client(void);
+static int control_read_client(control_client_t *client);
+static int control_process_input(control_client_t *client);
+static void control_finish_command(control_client_t *client);
+static int control_append_reply(control_client_t *client, const char *text);
+static int control_flush_client(control_client_t *client);
+static void control_close_client(control_client_t *client);
+static int control_set_nonblocking(int fd);
+
+/*
+ * Purpose: Creates a UNIX-domain stream socket bound to socket_path and starts
+ *          the control thread that accepts clients and runs each received
+ *          line through the handler on a per-client command thread. A stale
+ *          socket file at the path is replaced.
+ * Accepts: socket_path - Filesystem path for the listening socket.
+ *          handler     - Function that executes one command line.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int control_start(const char *socket_path, control_handler_t handler) {
+    if (!socket_path || !handler) { errno = EINVAL; print_error("Control", "NULL socket path or handler."); return -1; }
+    if (control_running) { print_info("Control", "Control socket already running."); return 0; }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG; print_error("Control", "Socket path too long"); return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    if (pipe(wake_pipe) == -1) { print_error("Control", "pipe failed"); return -1; }
+    if (control_set_nonblocking(wake_pipe[0]) == -1 || control_set_nonblocking(wake_pipe[1]) == -1) {
+        print_error("Control", "fcntl O_NONBLOCK (wake pipe) failed"); goto cleanup_pipe;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) { print_error("Control", "socket failed"); goto cleanup_pipe; }
+    if (control_set_nonblocking(listen_fd) == -1) { print_error("Control", "fcntl O_NONBLOCK failed"); goto cleanup_fd; }
+
+    if (unlink(socket_path) == -1 && errno != ENOENT) {
+        print_error("Control", "unlink of stale socket failed"); goto cleanup_fd;
+    }
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        print_error("Control", "bind failed"); goto cleanup_fd;
+    }
+    if (listen(listen_fd, CONTROL_MAX_CLIENTS) == -1) {
+        print_error("Control", "listen failed"); unlink(socket_path); goto cleanup_fd;
+    }
+    strcpy(bound_path, socket_path);
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+        clients[i].fd = -1;
+        clients[i].index = i;
+        clients[i].used = clients[i].in_len = clients[i].out_len = 0;
+        clients[i].busy = false;
+        atomic_store(&clients[i].done, false);
+    }
+    control_handler = handler;
+    atomic_store(&control_stop_requested, false);
+    atomic_store(&control_exited, false);
+
+    int ret = pthread_create(&control_thread, NULL, control_thread_func, NULL);
+    if (ret != 0) {
+        errno = ret; print_error("Control", "pthread_create (control) failed");
+        unlink(socket_path); goto cleanup_fd;
+    }
+    control_running = true;
+
+    char info[sizeof(bound_path) + 32];
+    snprintf(info, sizeof(info), "Listening on %s", bound_path);
+    print_info("Control", info);
+    return 0;
+
+    cleanup_fd:
+    close(listen_fd);
+    listen_fd = -1;
+    cleanup_pipe:
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    return -1;
+}
+
+/*
+ * Purpose: Stops the control thread, closes all client connections and the
+ *          listening socket, and unlinks the socket file. Safe to call when
+ *          the control socket was never started.
+ * Accepts: wake - Called until a blocked command has returned (may be NULL).
+ * Returns: None.
+ */
+void control_stop(control_wake_t wake) {
+    if (!control_running) return;
+    atomic_store(&control_stop_requested, true);
+    // A command may be blocked in the queue (a shrink waiting for free slots),
+    // and a single wake-up can be taken by another waiter: repeat until it returns
+    while (!atomic_load(&control_exited)) {
+        if (wake) wake();
+        struct timespec pause = { 0, CONTROL_WAKE_INTERVAL_NS };
+        nanosleep(&pause, NULL);
+    }
+    int ret = pthread_join(control_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("Control", "pthread_join (control) failed"); }
+    control_running = false;
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) control_close_client(&clients[i]);
+    if (listen_fd != -1) { close(listen_fd); listen_fd = -1; }
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    if (unlink(bound_path) == -1 && errno != ENOENT) print_error("Control", "unlink of socket failed");
+    print_info("Control", "Control socket closed.");
+}
+
+/*
+ * Purpose: Control thread body. Polls the listening socket, the wake pipe and
+ *          all connected clients with a short timeout so a stop request is
+ *          noticed promptly. It never runs a command itself, so one that
+ *          blocks (a shrink, an engine swap) cannot stall other clients.
+ *          On stop it waits for the command threads still running.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* control_thread_func(void *arg) {
+    (void)arg;
+    struct pollfd fds[CONTROL_MAX_CLIENTS + 2];
+    control_client_t *owners[CONTROL_MAX_CLIENTS + 2];
+
+    while (!atomic_load(&control_stop_requested)) {
+        nfds_t nfds = 0;
+        fds[nfds].fd = listen_fd; fds[nfds].events = POLLIN; fds[nfds].revents = 0;
+        owners[nfds++] = NULL;
+        fds[nfds].fd = wake_pipe[0]; fds[nfds].events = POLLIN; fds[nfds].revents = 0;
+        owners[nfds++] = NULL;
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+            control_client_t *client = &clients[i];
+            if (client->fd == -1) continue;
+            short events = 0;
+            // Read only what can be answered: one command at a time, room for its reply
+            if (!client->busy && client->in_len == 0 && client->out_len + CONTROL_REPLY_MAX <= CONTROL_OUT_MAX) events |= POLLIN;
+            if (client->out_len > 0) events |= POLLOUT;
+            if (events == 0) continue;
+            fds[nfds].fd = client->fd; fds[nfds].events = events; fds[nfds].revents = 0;
+            owners[nfds++] = client;
+        }
+
+        int ready = poll(fds, nfds, 200); // 200ms, keeps stop latency low
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            print_error("Control", "poll failed");
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+        }
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+            if (clients[i].busy && atomic_load(&clients[i].done)) control_finish_command(&clients[i]);
+        }
+        if (fds[0].revents & POLLIN) control_accept_client();
+        for (nfds_t i = 2; i < nfds; ++i) {
+            control_client_t *client = owners[i];
+            if (fds[i].revents == 0 || client->fd == -1) continue;
+            int result = 0;
+            if (fds[i].revents & (POLLOUT | POLLERR | POLLHUP)) result = control_flush_client(client);
+            if (result == 0 && (fds[i].events & POLLIN) && (fds[i].revents & (POLLIN | POLLERR | POLLHUP))) result = control_read_client(client);
+            if (result == -1) control_close_client(client);
+        }
+    }
+
+    // Commands still running finish before the slots are released
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+        if (clients[i].busy) control_finish_command(&clients[i]);
+    }
+    atomic_store(&control_exited, true);
+    return NULL;
+}
+
+/*
+ * Purpose: Command thread body: runs one command line through the handler,
+ *          then tells the control thread that the reply is ready.
+ * Accepts: arg - The control_client_t that submitted the command.
+ * Returns: Always NULL.
+ */
+static void* control_command_func(void *arg) {
+    control_client_t *client = (control_client_t *)arg;
+    thread_stats_register(THREAD_ROLE_CONTROL, client->index + 1); // Commands run here can resize the queue
+    trace_thread_attach(); // Maps the trace file now, not under the queue lock
+    client->reply[0] = '\0';
+    control_handler(client->cmd, client->reply, sizeof(client->reply));
+    thread_stats_unregister();
+    atomic_store(&client->done, true);
+    const char token = 1;
+    ssize_t written __attribute__((unused)) = write(wake_pipe[1], &token, 1); // A full pipe already wakes the loop
+    return NULL;
+}
+
+/*
+ * Purpose: Accepts a pending connection and assigns it a free client slot.
+ *          The connection is refused with an error line if all slots are
+ *          busy (a slot stays taken until its running command returns).
+ * Accepts: None.
+ * Returns: None.
+ */
+static void control_accept_client(void) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd == -1) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) print_error("Control", "accept failed");
+        return;
+    }
+    if (control_set_nonblocking(fd) == -1) {
+        print_error("Control", "fcntl O_NONBLOCK (client) failed");
+        close(fd);
+        return;
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; ++i) {
+        if (clients[i].fd == -1 && !clients[i].busy) {
+            clients[i].fd = fd;
+            clients[i].used = clients[i].in_len = clients[i].out_len = 0;
+            return;
+        }
+    }
+    const char busy[] = "ERR too many control clients\n";
+    ssize_t sent __attribute__((unused)) = send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL); // Best effort, never blocks
+    close(fd);
+}
+
+/*
+ * Purpose: Reads available bytes from a client into its input buffer and
+ *          starts parsing them.
+ * Accepts: client - The client slot with readable data.
+ * Returns: 0 to keep the connection, -1 when it should be closed.
+ */
+static int control_read_client(control_client_t *client) {
+    ssize_t n = recv(client->fd, client->in + client->in_len, sizeof(client->in) - client->in_len, 0);
+    if (n == 0) return -1; // Orderly shutdown by peer
+    if (n == -1) {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+    client->in_len += (size_t)n;
+    return control_process_input(client);
+}
+
+/*
+ * Purpose: Consumes buffered input up to the next complete command line and
+ *          hands that line to a new command thread. Carriage returns are
+ *          stripped; empty lines are ignored; overlong lines are answered
+ *          with an error. Bytes after the dispatched line stay buffered
+ *          until its reply has been queued.
+ * Accepts: client - The client slot to parse for (not busy).
+ * Returns: 0 to keep the connection, -1 when it should be closed.
+ */
+static int control_process_input(control_client_t *client) {
+    size_t i = 0;
+    while (i < client->in_len && !client->busy && client->out_len + CONTROL_REPLY_MAX <= CONTROL_OUT_MAX &&
+           !atomic_load(&control_stop_requested)) {
+        char ch = client->in[i++];
+        if (ch == '\r') continue;
+        if (ch != '\n') {
+            if (client->used < sizeof(client->line) - 1) client->line[client->used] = ch;
+            client->used++; // Keeps counting past the limit to detect overlong lines
+            continue;
+        }
+
+        size_t length = client->used;
+        client->used = 0;
+        if (length >= sizeof(client->line)) {
+            char error[64];
+            snprintf(error, sizeof(error), "ERR line too long (max %d)\n", CONTROL_LINE_MAX - 1);
+            if (control_append_reply(client, error) == -1) return -1;
+            continue;
+        }
+        if (length == 0) continue;
+
+        memcpy(client->cmd, client->line, length);
+        client->cmd[length] = '\0';
+        atomic_store(&client->done, false);
+        int ret = pthread_create(&client->worker, NULL, control_command_func, client);
+        if (ret != 0) {
+            errno = ret; print_error("Control", "pthread_create (command) failed");
+            if (control_append_reply(client, "ERR cannot start command thread\n") == -1) return -1;
+            continue;
+        }
+        client->busy = true;
+    }
+    memmove(client->in, client->in + i, client->in_len - i);
+    client->in_len -= i;
+    return control_flush_client(client);
+}
+
+/*
+ * Purpose: Joins a finished (or, on stop, still running) command thread,
+ *          queues its reply and resumes parsing the client's input. The
+ *          reply is discarded if the client disconnected meanwhile.
+ * Accepts: client - The busy client slot.
+ * Returns: None.
+ */
+static void control_finish_command(control_client_t *client) {
+    int ret = pthread_join(client->worker, NULL);
+    if (ret != 0) { errno = ret; print_error("Control", "pthread_join (command) failed"); }
+    client->busy = false;
+    if (client->fd == -1) return;
+    if (control_append_reply(client, client->reply) == -1 || control_process_input(client) == -1) {
+        control_close_client(client);
+    }
+}
+
+/*
+ * Purpose: Queues reply text for a client. The caller only parses a command
+ *          while a full reply still fits, so this fails only on a reply that
+ *          is not NUL-terminated within CONTROL_REPLY_MAX.
+ * Accepts: client - The client slot.
+ *          text   - NUL-terminated reply text.
+ * Returns: 0 on success, -1 if it does not fit.
+ */
+static int control_append_reply(control_client_t *client, const char *text) {
+    size_t len = strnlen(text, CONTROL_REPLY_MAX);
+    if (len > sizeof(client->out) - client->out_len) return -1;
+    memcpy(client->out + client->out_len, text, len);
+    client->out_len += len;
+    return 0;
+}
+
+/*
+ * Purpose: Sends as much queued reply data as the socket accepts without
+ *          blocking. Never raises SIGPIPE when the peer has gone away.
+ * Accepts: client - The client slot.
+ * Returns: 0 on success (data may remain queued), -1 on a send error.
+ */
+static int control_flush_client(control_client_t *client) {
+    size_t sent = 0;
+    while (sent < client->out_len) {
+        ssize_t n = send(client->fd, client->out + sent, client->out_len - sent, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break; // The rest goes out on POLLOUT
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+    memmove(client->out, client->out + sent, client->out_len - sent);
+    client->out_len -= sent;
+    return 0;
+}
+
+/*
+ * Purpose: Closes a client connection. The slot becomes free for a new
+ *          connection once no command thread is running for it.
+ * Accepts: client - The client slot to close.
+ * Returns: None.
+ */
+static void control_close_client(control_client_t *client) {
+    if (client->fd == -1) return;
+    close(client->fd);
+    client->fd = -1;
+    client->used = client->in_len = client->out_len = 0;
+}
+
+/*
+ * Purpose: Switches a descriptor to non-blocking mode.
+ * Accepts: fd - The descriptor.
+ * Returns: 0 on success, -1 on failure (errno set by fcntl).
+ */
+static int control_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
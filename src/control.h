@@ -0,0 +1,49 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "common.h"
+
+// --- Constants ---
+#define CONTROL_MAX_CLIENTS 8
+#define CONTROL_LINE_MAX 256
+#define CONTROL_REPLY_MAX 16384
+
+/*
+ * Handler invoked for every complete command line, on a command thread of
+ * its own: commands from different clients may run concurrently, and one
+ * that blocks delays only its own client's reply.
+ * It writes a newline-terminated reply into 'reply' (at most reply_len bytes,
+ * including the terminating NUL) and returns 0 on success, -1 on failure.
+ */
+typedef int (*control_handler_t)(const char *line, char *reply, size_t reply_len);
+
+/*
+ * Callback run repeatedly by control_stop until the command in progress
+ * returns. It must wake whatever that command may be blocked on (e.g. queue
+ * waiters); g_terminate_flag is already set when it runs.
+ */
+typedef void (*control_wake_t)(void);
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Creates a UNIX-domain stream socket bound to socket_path and starts
+ *          the control thread that accepts clients and runs each received
+ *          line through the handler on a per-client command thread. A stale
+ *          socket file at the path is replaced.
+ * Accepts: socket_path - Filesystem path for the listening socket.
+ *          handler     - Function that executes one command line.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int control_start(const char *socket_path, control_handler_t handler);
+
+/*
+ * Purpose: Stops the control thread, closes all client connections and the
+ *          listening socket, and unlinks the socket file. Safe to call when
+ *          the control socket was never started.
+ * Accepts: wake - Called until a blocked command has returned (may be NULL).
+ * Returns: None.
+ */
+void control_stop(control_wake_t wake);
+
+#endif // CONTROL_H
@@ -0,0 +1,105 @@
+#include "hist.h"
+
+/*
+ * Purpose: Clears a histogram.
+ * Accepts: h - The histogram.
+ * Returns: None.
+ */
+void hist_reset(hist_t *h) {
+    for (int i = 0; i < HIST_BUCKETS; ++i) atomic_store_explicit(&h->counts[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Maps a value to its bucket.
+ * Accepts: value - Value in nanoseconds.
+ * Returns: Bucket index in [0, HIST_BUCKETS).
+ */
+int hist_bucket_index(uint64_t value) {
+    if (value < 2 * HIST_SUB_COUNT) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HIST_SUB_BITS; // value >> shift is in [SUB_COUNT, 2*SUB_COUNT)
+    if (shift > HIST_MAX_SHIFT) return HIST_BUCKETS - 1;
+    return shift * HIST_SUB_COUNT + (int)(value >> shift);
+}
+
+/*
+ * Purpose: Returns the largest value that maps to a bucket (the value
+ *          reported for percentiles, as HDR histograms do).
+ * Accepts: index - Bucket index.
+ * Returns: The bucket's upper bound.
+ */
+uint64_t hist_bucket_high(int index) {
+    if (index < 2 * HIST_SUB_COUNT) return (uint64_t)index;
+    int shift = index / HIST_SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(index % HIST_SUB_COUNT + HIST_SUB_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+/*
+ * Purpose: Adds all counts of one histogram to another. Safe against
+ *          concurrent merges into the same destination.
+ * Accepts: dst - Histogram to add to.
+ *          src - Histogram to read (may be recorded into concurrently).
+ * Returns: None.
+ */
+void hist_merge(hist_t *dst, const hist_t *src) {
+    unsigned long total = 0;
+    for (int i = 0; i < HIST_BUCKETS; ++i) {
+        unsigned long n = atomic_load_explicit(&src->counts[i], memory_order_relaxed);
+        if (n == 0) continue;
+        atomic_fetch_add_explicit(&dst->counts[i], n, memory_order_relaxed);
+        total += n;
+    }
+    // Count from the buckets so percentiles stay consistent with a racing writer
+    atomic_fetch_add_explicit(&dst->count, total, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->sum, atomic_load_explicit(&src->sum, memory_order_relaxed), memory_order_relaxed);
+    unsigned long src_max = atomic_load_explicit(&src->max, memory_order_relaxed);
+    unsigned long cur = atomic_load_explicit(&dst->max, memory_order_relaxed);
+    while (src_max > cur && !atomic_compare_exchange_weak(&dst->max, &cur, src_max)) { }
+}
+
+/*
+ * Purpose: Counts recorded values below a bound. Exact when the bound is a
+ *          power of two of at least 2*HIST_SUB_COUNT (a bucket boundary).
+ * Accepts: h     - The histogram.
+ *          bound - Exclusive upper bound.
+ * Returns: Number of values in buckets that end below the bound.
+ */
+unsigned long hist_count_below(const hist_t *h, uint64_t bound) {
+    unsigned long total = 0;
+    for (int i = 0; i < HIST_BUCKETS && hist_bucket_high(i) < bound; ++i) {
+        total += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+    }
+    return total;
+}
+
+/*
+ * Purpose: Computes a percentile.
+ * Accepts: h   - The histogram.
+ *          pct - Percentile in [0, 100].
+ * Returns: The value at the percentile (bucket upper bound, never above the
+ *          recorded maximum), or 0 for an empty histogram.
+ */
+uint64_t hist_percentile(const hist_t *h, double pct) {
+    unsigned long count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (count == 0) return 0;
+    if (pct < 0.0) pct = 0.0;
+    if (pct > 100.0) pct = 100.0;
+    unsigned long rank = (unsigned long)((pct / 100.0) * (double)count + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    unsigned long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; ++i) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t high = hist_bucket_high(i);
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
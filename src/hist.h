@@ -0,0 +1,92 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include "common.h"
+
+// Log-linear (HDR-style) histogram of nanosecond values. Values below
+// 2*HIST_SUB_COUNT get exact buckets; above that every power of two is split
+// into HIST_SUB_COUNT buckets, so the relative error stays below 1/16.
+
+// --- Constants ---
+#define HIST_SUB_BITS 4
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_SHIFT 32 // Values of 2^37 ns (~137 s) and above share the last bucket
+#define HIST_BUCKETS ((HIST_MAX_SHIFT + 2) * HIST_SUB_COUNT)
+
+// --- Histogram ---
+// Recording is single-writer (relaxed load+store, no RMW); any thread may
+// read. Merging into a shared histogram uses atomic adds.
+typedef struct hist_s {
+    atomic_ulong counts[HIST_BUCKETS];
+    atomic_ulong count;
+    atomic_ulong sum;
+    atomic_ulong max;
+} hist_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Clears a histogram.
+ * Accepts: h - The histogram.
+ * Returns: None.
+ */
+void hist_reset(hist_t *h);
+
+/*
+ * Purpose: Maps a value to its bucket.
+ * Accepts: value - Value in nanoseconds.
+ * Returns: Bucket index in [0, HIST_BUCKETS).
+ */
+int hist_bucket_index(uint64_t value);
+
+/*
+ * Purpose: Returns the largest value that maps to a bucket (the value
+ *          reported for percentiles, as HDR histograms do).
+ * Accepts: index - Bucket index.
+ * Returns: The bucket's upper bound.
+ */
+uint64_t hist_bucket_high(int index);
+
+/*
+ * Purpose: Adds all counts of one histogram to another. Safe against
+ *          concurrent merges into the same destination.
+ * Accepts: dst - Histogram to add to.
+ *          src - Histogram to read (may be recorded into concurrently).
+ * Returns: None.
+ */
+void hist_merge(hist_t *dst, const hist_t *src);
+
+/*
+ * Purpose: Counts recorded values below a bound. Exact when the bound is a
+ *          power of two of at least 2*HIST_SUB_COUNT (a bucket boundary).
+ * Accepts: h     - The histogram.
+ *          bound - Exclusive upper bound.
+ * Returns: Number of values in buckets that end below the bound.
+ */
+unsigned long hist_count_below(const hist_t *h, uint64_t bound);
+
+/*
+ * Purpose: Computes a percentile.
+ * Accepts: h   - The histogram.
+ *          pct - Percentile in [0, 100].
+ * Returns: The value at the percentile (bucket upper bound, never above the
+ *          recorded maximum), or 0 for an empty histogram.
+ */
+uint64_t hist_percentile(const hist_t *h, double pct);
+
+/*
+ * Purpose: Records one value. Only one thread may record into a given
+ *          histogram.
+ * Accepts: h     - The histogram.
+ *          value - Value in nanoseconds.
+ * Returns: None.
+ */
+static inline void hist_record(hist_t *h, uint64_t value) {
+    atomic_ulong *bucket = &h->counts[hist_bucket_index(value)];
+    atomic_store_explicit(bucket, atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&h->sum, atomic_load_explicit(&h->sum, memory_order_relaxed) + value, memory_order_relaxed);
+    if (value > atomic_load_explicit(&h->max, memory_order_relaxed)) atomic_store_explicit(&h->max, value, memory_order_relaxed);
+    atomic_store_explicit(&h->count, atomic_load_explicit(&h->count, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+#endif // HIST_H
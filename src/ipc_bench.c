@@ -0,0 +1,629 @@
+// Kernel IPC baselines: pushes the bench message stream (whole message_t
+// records, payload filled and hashed as the demo's producers do) from one
+// producer thread to one consumer thread through a pipe, a SOCK_SEQPACKET
+// socketpair, a POSIX message queue and a shared-memory ring signalled by
+// two eventfds, and through the queue engines via bench_run, with the same
+// warmup, measured window and latency stamp. The rows form one table
+// (optionally Markdown and JSON) with each transport's throughput relative
+// to the fastest queue engine.
+// Usage: ipc_bench [-q CAP] [-s SIZE] [-d MS] [-w MS] [-k] [-M FILE] [-j FILE]
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "hist.h"
+#include <mqueue.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// --- Constants ---
+#define IPC_MQ_MSG_MAX_PATH "/proc/sys/fs/mqueue/msg_max"
+#define IPC_MQ_DEFAULT_MSG_MAX 10     // Linux default for unprivileged queues
+
+// --- Transports ---
+typedef enum {
+    IPC_QUEUE_SEM,
+    IPC_QUEUE_COND,
+    IPC_PIPE,
+    IPC_SOCKETPAIR,
+    IPC_MQUEUE,
+    IPC_EVENTFD_SHM,
+    IPC_TRANSPORT_COUNT
+} ipc_transport_t;
+
+// --- Options ---
+typedef struct ipc_params_s {
+    size_t capacity;              // Queue and ring slots, mq depth (clamped to msg_max)
+    int msg_size;
+    bool queue_only;
+    long warmup_ms;
+    long duration_ms;
+} ipc_params_t;
+
+// --- Open Channel of One Kernel Transport ---
+typedef struct ipc_channel_s {
+    ipc_transport_t kind;
+    int fds[2];                   // pipe / socketpair: [0] read, [1] write; eventfd: [0] items, [1] free slots
+    mqd_t mq;
+    char mq_name[64];
+    message_t *ring;              // eventfd transport: shared-memory slots
+    size_t ring_slots;
+    size_t head;                  // Consumer's next slot
+    size_t tail;                  // Producer's next slot
+} ipc_channel_t;
+
+// --- Per-Run State ---
+typedef struct ipc_run_s {
+    ipc_channel_t ch;
+    const ipc_params_t *p;
+    atomic_int phase;             // 0 warmup, 1 measure, 2 done
+    atomic_bool stop;
+    unsigned long messages;       // Consumed while measuring
+    unsigned long hash_failures;
+    int io_error;                 // errno of a failed send or receive, 0 if none
+    hist_t latency;
+} ipc_run_t;
+
+// --- One Table Row ---
+typedef struct ipc_row_s {
+    ipc_transport_t kind;
+    bool ok;
+    char note[96];                // Why a transport did not run, or its buffer depth
+    bench_result_t r;
+} ipc_row_t;
+
+// --- Internal Helper Function Declarations ---
+static int run_kernel(ipc_transport_t kind, const ipc_params_t *p, ipc_row_t *row);
+static int channel_open(ipc_channel_t *ch, const ipc_params_t *p, char *note, size_t note_size);
+static void channel_close(ipc_channel_t *ch);
+static int channel_send(ipc_channel_t *ch, const message_t *msg);
+static int channel_recv(ipc_channel_t *ch, message_t *msg);
+static int write_full(int fd, const void *buf, size_t len);
+static int read_full(int fd, void *buf, size_t len);
+static void* ipc_producer_func(void *arg);
+static void* ipc_consumer_func(void *arg);
+static long mq_msg_max(void);
+static void print_table(FILE *out, const ipc_row_t *rows, int count, bool markdown);
+static int write_json(const char *path, const ipc_row_t *rows, int count, const ipc_params_t *p);
+static double best_queue_rate(const ipc_row_t *rows, int count);
+static const char* transport_name(ipc_transport_t kind);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs every transport once and prints the table.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage, a failed queue run or
+ *          an output error (a kernel transport the host lacks is reported
+ *          in its row, not as a failure).
+ */
+int main(int argc, char *argv[]) {
+    ipc_params_t p = { .capacity = 1000, .msg_size = 16, .queue_only = false, .warmup_ms = 200, .duration_ms = 1000 };
+    const char *markdown_path = NULL;
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "q:s:d:w:kM:j:h")) != -1) {
+        int bad = 0;
+        long v;
+        switch (opt) {
+            case 'q': v = strtol(optarg, NULL, 10); bad = v < 1 || v > QUEUE_CAPACITY_LIMIT; p.capacity = (size_t)v; break;
+            case 's': v = strtol(optarg, NULL, 10); bad = v < 0 || v >= MAX_DATA_SIZE; p.msg_size = (int)v; break;
+            case 'd': p.duration_ms = strtol(optarg, NULL, 10); bad = p.duration_ms <= 0; break;
+            case 'w': p.warmup_ms = strtol(optarg, NULL, 10); bad = p.warmup_ms < 0; break;
+            case 'k': p.queue_only = true; break;
+            case 'M': markdown_path = optarg; break;
+            case 'j': json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    printf("ipc_bench: 1 producer -> 1 consumer, %zu-byte records, %d-byte payload%s, capacity %zu, %ld ms per transport\n",
+           sizeof(message_t), p.msg_size, p.queue_only ? " (queue only)" : "", p.capacity, p.duration_ms);
+    fflush(stdout);
+
+    bench_setup();
+    ipc_row_t rows[IPC_TRANSPORT_COUNT];
+    int status = EXIT_SUCCESS;
+    for (int k = 0; k < IPC_TRANSPORT_COUNT; ++k) {
+        ipc_row_t *row = &rows[k];
+        memset(row, 0, sizeof(*row));
+        row->kind = (ipc_transport_t)k;
+        if (row->kind == IPC_QUEUE_SEM || row->kind == IPC_QUEUE_COND) {
+            bench_params_t bp = {
+                .mode = row->kind == IPC_QUEUE_SEM ? SYNC_MODE_SEM : SYNC_MODE_CONDVAR, .producers = 1, .consumers = 1,
+                .capacity = p.capacity, .msg_size = p.msg_size, .queue_only = p.queue_only,
+                .warmup_ms = p.warmup_ms, .duration_ms = p.duration_ms,
+            };
+            row->ok = bench_run(&bp, &row->r) == 0;
+            if (!row->ok) status = EXIT_FAILURE;
+            snprintf(row->note, sizeof(row->note), "%zu slots", p.capacity);
+        } else {
+            run_kernel(row->kind, &p, row);
+        }
+        fprintf(stderr, "  %s done\n", transport_name(row->kind));
+    }
+
+    printf("\n");
+    print_table(stdout, rows, IPC_TRANSPORT_COUNT, false);
+    if (markdown_path) {
+        FILE *md = fopen(markdown_path, "w");
+        if (!md) { fprintf(stderr, "Error: cannot open %s: %s\n", markdown_path, strerror(errno)); status = EXIT_FAILURE; }
+        else {
+            fprintf(md, "1 producer thread -> 1 consumer thread, %zu-byte records, %d-byte payload%s, %ld ms measured "
+                    "after %ld ms warmup, %ld online CPUs.\n\n", sizeof(message_t), p.msg_size,
+                    p.queue_only ? " (no payload fill or hash)" : "", p.duration_ms, p.warmup_ms,
+                    sysconf(_SC_NPROCESSORS_ONLN));
+            print_table(md, rows, IPC_TRANSPORT_COUNT, true);
+            int write_error = ferror(md);
+            if (fclose(md) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", markdown_path); status = EXIT_FAILURE; }
+            else printf("Table written to %s\n", markdown_path);
+        }
+    }
+    if (json_path) {
+        if (write_json(json_path, rows, IPC_TRANSPORT_COUNT, &p) == -1) status = EXIT_FAILURE;
+        else printf("Results written to %s\n", json_path);
+    }
+    return status;
+}
+
+/*
+ * Purpose: Runs one kernel transport: opens the channel, starts the
+ *          consumer and the producer, warms up, measures, stops both and
+ *          fills the row.
+ * Accepts: kind - The transport.
+ *          p    - The options.
+ *          row  - The row to fill (ok stays false with a note if the
+ *                 transport cannot be opened or fails).
+ * Returns: 0 on success, -1 on failure.
+ */
+static int run_kernel(ipc_transport_t kind, const ipc_params_t *p, ipc_row_t *row) {
+    ipc_run_t *run = calloc(1, sizeof(ipc_run_t));
+    if (!run) { snprintf(row->note, sizeof(row->note), "calloc failed"); return -1; }
+    run->p = p;
+    run->ch.kind = kind;
+    atomic_init(&run->phase, 0);
+    atomic_init(&run->stop, false);
+    hist_reset(&run->latency);
+    if (channel_open(&run->ch, p, row->note, sizeof(row->note)) == -1) { free(run); return -1; }
+
+    pthread_t producer, consumer;
+    int ret = pthread_create(&consumer, NULL, ipc_consumer_func, run);
+    if (ret != 0) {
+        snprintf(row->note, sizeof(row->note), "pthread_create: %s", strerror(ret));
+        channel_close(&run->ch);
+        free(run);
+        return -1;
+    }
+    ret = pthread_create(&producer, NULL, ipc_producer_func, run);
+    if (ret != 0) {
+        // The consumer leaves on the stop record
+        snprintf(row->note, sizeof(row->note), "pthread_create: %s", strerror(ret));
+        message_t stop;
+        memset(&stop, 0, sizeof(stop));
+        channel_send(&run->ch, &stop);
+        pthread_join(consumer, NULL);
+        channel_close(&run->ch);
+        free(run);
+        return -1;
+    }
+
+    bench_sleep_ns((uint64_t)p->warmup_ms * 1000000ULL);
+    double cpu_start = bench_cpu_seconds();
+    uint64_t start_ns = monotonic_ns();
+    atomic_store(&run->phase, 1);
+    bench_sleep_ns((uint64_t)p->duration_ms * 1000000ULL);
+    atomic_store(&run->phase, 2);
+    uint64_t end_ns = monotonic_ns();
+    double cpu_end = bench_cpu_seconds();
+    atomic_store(&run->stop, true);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    bench_result_t *r = &row->r;
+    r->messages = run->messages;
+    r->hash_failures = run->hash_failures;
+    r->seconds = (double)(end_ns - start_ns) / 1e9;
+    r->msgs_per_s = r->seconds > 0 ? (double)r->messages / r->seconds : 0.0;
+    r->cpu_ns_per_msg = r->messages > 0 ? (cpu_end - cpu_start) * 1e9 / (double)r->messages : 0.0;
+    r->lat_p50_ns = hist_percentile(&run->latency, 50.0);
+    r->lat_p90_ns = hist_percentile(&run->latency, 90.0);
+    r->lat_p99_ns = hist_percentile(&run->latency, 99.0);
+    r->lat_p999_ns = hist_percentile(&run->latency, 99.9);
+    r->lat_max_ns = atomic_load(&run->latency.max);
+    row->ok = run->io_error == 0;
+    if (run->io_error != 0) snprintf(row->note, sizeof(row->note), "I/O error: %s", strerror(run->io_error));
+
+    channel_close(&run->ch);
+    free(run);
+    return row->ok ? 0 : -1;
+}
+
+/*
+ * Purpose: Opens a kernel transport.
+ * Accepts: ch        - The channel (kind set; the rest is filled in).
+ *          p         - The options.
+ *          note      - Buffer for the depth note, or the error.
+ *          note_size - Its size.
+ * Returns: 0 on success, -1 on failure (note holds the reason).
+ */
+static int channel_open(ipc_channel_t *ch, const ipc_params_t *p, char *note, size_t note_size) {
+    ch->fds[0] = ch->fds[1] = -1;
+    ch->mq = (mqd_t)-1;
+    switch (ch->kind) {
+        case IPC_PIPE:
+            if (pipe(ch->fds) == -1) { snprintf(note, note_size, "pipe: %s", strerror(errno)); return -1; }
+            snprintf(note, note_size, "kernel pipe buffer");
+            return 0;
+        case IPC_SOCKETPAIR:
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, ch->fds) == -1) {
+                snprintf(note, note_size, "socketpair: %s", strerror(errno));
+                return -1;
+            }
+            snprintf(note, note_size, "AF_UNIX SOCK_SEQPACKET, kernel socket buffer");
+            return 0;
+        case IPC_MQUEUE: {
+            long msg_max = mq_msg_max();
+            struct mq_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.mq_maxmsg = (long)p->capacity < msg_max ? (long)p->capacity : msg_max;
+            attr.mq_msgsize = (long)sizeof(message_t);
+            snprintf(ch->mq_name, sizeof(ch->mq_name), "/prod_cons_ipc_bench_%ld", (long)getpid());
+            ch->mq = mq_open(ch->mq_name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+            if (ch->mq == (mqd_t)-1) { snprintf(note, note_size, "mq_open: %s", strerror(errno)); return -1; }
+            mq_unlink(ch->mq_name); // The descriptor keeps it alive
+            snprintf(note, note_size, "%ld messages (fs.mqueue.msg_max %ld)", attr.mq_maxmsg, msg_max);
+            return 0;
+        }
+        case IPC_EVENTFD_SHM: {
+            char name[64];
+            snprintf(name, sizeof(name), "/prod_cons_ipc_bench_ring_%ld", (long)getpid());
+            int shm = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (shm == -1) { snprintf(note, note_size, "shm_open: %s", strerror(errno)); return -1; }
+            shm_unlink(name); // The mapping keeps it alive
+            size_t bytes = p->capacity * sizeof(message_t);
+            if (ftruncate(shm, (off_t)bytes) == -1) {
+                snprintf(note, note_size, "ftruncate: %s", strerror(errno));
+                close(shm);
+                return -1;
+            }
+            void *ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+            close(shm);
+            if (ring == MAP_FAILED) { snprintf(note, note_size, "mmap: %s", strerror(errno)); return -1; }
+            ch->ring = (message_t *)ring;
+            ch->ring_slots = p->capacity;
+            ch->fds[0] = eventfd(0, EFD_SEMAPHORE);                              // Filled slots
+            ch->fds[1] = eventfd((unsigned int)p->capacity, EFD_SEMAPHORE);      // Free slots
+            if (ch->fds[0] == -1 || ch->fds[1] == -1) {
+                snprintf(note, note_size, "eventfd: %s", strerror(errno));
+                channel_close(ch);
+                return -1;
+            }
+            snprintf(note, note_size, "%zu slots", p->capacity);
+            return 0;
+        }
+        default:
+            break;
+    }
+    snprintf(note, note_size, "not a kernel transport");
+    return -1;
+}
+
+/*
+ * Purpose: Closes a kernel transport's descriptors and mappings.
+ * Accepts: ch - The channel.
+ * Returns: None.
+ */
+static void channel_close(ipc_channel_t *ch) {
+    for (int i = 0; i < 2; ++i) {
+        if (ch->fds[i] != -1) close(ch->fds[i]);
+        ch->fds[i] = -1;
+    }
+    if (ch->mq != (mqd_t)-1) mq_close(ch->mq);
+    ch->mq = (mqd_t)-1;
+    if (ch->ring) munmap(ch->ring, ch->ring_slots * sizeof(message_t));
+    ch->ring = NULL;
+}
+
+/*
+ * Purpose: Sends one whole message, blocking while the transport is full.
+ * Accepts: ch  - The channel.
+ *          msg - The message.
+ * Returns: 0 on success, -1 on failure (errno is set).
+ */
+static int channel_send(ipc_channel_t *ch, const message_t *msg) {
+    switch (ch->kind) {
+        case IPC_PIPE:
+        case IPC_SOCKETPAIR:
+            return write_full(ch->fds[1], msg, sizeof(message_t));
+        case IPC_MQUEUE:
+            while (mq_send(ch->mq, (const char *)msg, sizeof(message_t), 0) == -1) {
+                if (errno != EINTR) return -1;
+            }
+            return 0;
+        case IPC_EVENTFD_SHM: {
+            uint64_t token;
+            if (read_full(ch->fds[1], &token, sizeof(token)) == -1) return -1; // Take a free slot
+            memcpy(&ch->ring[ch->tail], msg, sizeof(message_t));
+            ch->tail = (ch->tail + 1) % ch->ring_slots;
+            token = 1;
+            return write_full(ch->fds[0], &token, sizeof(token));              // Publish it
+        }
+        default:
+            break;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * Purpose: Receives one whole message, blocking while the transport is
+ *          empty.
+ * Accepts: ch  - The channel.
+ *          msg - Where to store the message.
+ * Returns: 0 on success, -1 on failure (errno is set).
+ */
+static int channel_recv(ipc_channel_t *ch, message_t *msg) {
+    switch (ch->kind) {
+        case IPC_PIPE:
+        case IPC_SOCKETPAIR:
+            return read_full(ch->fds[0], msg, sizeof(message_t));
+        case IPC_MQUEUE:
+            for (;;) {
+                ssize_t n = mq_receive(ch->mq, (char *)msg, sizeof(message_t), NULL);
+                if (n == (ssize_t)sizeof(message_t)) return 0;
+                if (n == -1 && errno == EINTR) continue;
+                if (n != -1) errno = EMSGSIZE;
+                return -1;
+            }
+        case IPC_EVENTFD_SHM: {
+            uint64_t token;
+            if (read_full(ch->fds[0], &token, sizeof(token)) == -1) return -1; // Take a filled slot
+            memcpy(msg, &ch->ring[ch->head], sizeof(message_t));
+            ch->head = (ch->head + 1) % ch->ring_slots;
+            token = 1;
+            return write_full(ch->fds[1], &token, sizeof(token));              // Free it
+        }
+        default:
+            break;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * Purpose: Writes a whole buffer, retrying short writes and EINTR.
+ * Accepts: fd  - The descriptor.
+ *          buf - The data.
+ *          len - Its length.
+ * Returns: 0 on success, -1 on failure (errno is set).
+ */
+static int write_full(int fd, const void *buf, size_t len) {
+    const unsigned char *at = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, at, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        at += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Purpose: Reads a whole buffer, retrying short reads and EINTR.
+ * Accepts: fd  - The descriptor.
+ *          buf - Where to store the data.
+ *          len - How many bytes.
+ * Returns: 0 on success, -1 on failure or end of file (errno is set).
+ */
+static int read_full(int fd, void *buf, size_t len) {
+    unsigned char *at = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, at, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) { errno = EPIPE; return -1; }
+        at += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Purpose: Producer body: builds a message (unless queue_only), stamps it
+ *          and sends it until the run stops, then sends the stop record
+ *          (enqueue_ns 0).
+ * Accepts: arg - Pointer to the run's ipc_run_t.
+ * Returns: Always NULL.
+ */
+static void* ipc_producer_func(void *arg) {
+    ipc_run_t *run = (ipc_run_t *)arg;
+    unsigned int seed = 2654435761u;
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    if (run->p->queue_only) bench_fill_message(&msg, run->p->msg_size, &seed);
+
+    while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+        if (!run->p->queue_only) bench_fill_message(&msg, run->p->msg_size, &seed);
+        msg.enqueue_ns = monotonic_ns();
+        if (channel_send(&run->ch, &msg) == -1) { run->io_error = errno; break; }
+    }
+    msg.enqueue_ns = 0;
+    if (channel_send(&run->ch, &msg) == -1 && run->io_error == 0) run->io_error = errno;
+    return NULL;
+}
+
+/*
+ * Purpose: Consumer body: receives messages, verifies the hash (unless
+ *          queue_only) and, while measuring, counts them and records their
+ *          latency; leaves on the stop record.
+ * Accepts: arg - Pointer to the run's ipc_run_t.
+ * Returns: Always NULL.
+ */
+static void* ipc_consumer_func(void *arg) {
+    ipc_run_t *run = (ipc_run_t *)arg;
+    message_t msg;
+    for (;;) {
+        if (channel_recv(&run->ch, &msg) == -1) { run->io_error = errno; break; }
+        if (msg.enqueue_ns == 0) break;
+        uint64_t now = monotonic_ns();
+        bool hash_ok = true;
+        if (!run->p->queue_only) {
+            unsigned short original_hash = msg.hash;
+            msg.hash = 0;
+            hash_ok = calculate_message_hash(&msg) == original_hash;
+        }
+        if (atomic_load_explicit(&run->phase, memory_order_relaxed) != 1) continue;
+        run->messages++;
+        if (!hash_ok) run->hash_failures++;
+        hist_record(&run->latency, now - msg.enqueue_ns);
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Reads the host's per-queue message limit for POSIX message
+ *          queues.
+ * Accepts: None.
+ * Returns: fs.mqueue.msg_max, or the Linux default if it cannot be read.
+ */
+static long mq_msg_max(void) {
+    FILE *fp = fopen(IPC_MQ_MSG_MAX_PATH, "r");
+    if (!fp) return IPC_MQ_DEFAULT_MSG_MAX;
+    long value;
+    if (fscanf(fp, "%ld", &value) != 1 || value < 1) value = IPC_MQ_DEFAULT_MSG_MAX;
+    fclose(fp);
+    return value;
+}
+
+/*
+ * Purpose: Prints the result table, as aligned text or as Markdown.
+ * Accepts: out      - Where to print.
+ *          rows     - The rows.
+ *          count    - How many.
+ *          markdown - true for a Markdown table.
+ * Returns: None.
+ */
+static void print_table(FILE *out, const ipc_row_t *rows, int count, bool markdown) {
+    double best = best_queue_rate(rows, count);
+    if (markdown) {
+        fprintf(out, "| Transport | Msgs/s | vs best queue | p50 us | p99 us | p99.9 us | Max us | CPU ns/msg | Buffer |\n");
+        fprintf(out, "|---|---:|---:|---:|---:|---:|---:|---:|---|\n");
+    } else {
+        fprintf(out, "%-14s %12s %8s %9s %9s %9s %10s %10s  %s\n", "TRANSPORT", "MSGS/S", "VS QUEUE", "P50 us",
+                "P99 us", "P99.9 us", "MAX us", "CPU ns/msg", "BUFFER");
+    }
+    for (int i = 0; i < count; ++i) {
+        const ipc_row_t *row = &rows[i];
+        const bench_result_t *r = &row->r;
+        if (!row->ok) {
+            if (markdown) fprintf(out, "| %s | - | - | - | - | - | - | - | not run: %s |\n", transport_name(row->kind), row->note);
+            else fprintf(out, "%-14s  (not run: %s)\n", transport_name(row->kind), row->note);
+            continue;
+        }
+        char ratio[16] = "-";
+        if (best > 0.0) snprintf(ratio, sizeof(ratio), "%.2fx", r->msgs_per_s / best);
+        fprintf(out, markdown ? "| %s | %.0f | %s | %.1f | %.1f | %.1f | %.1f | %.0f | %s%s |\n"
+                              : "%-14s %12.0f %8s %9.1f %9.1f %9.1f %10.1f %10.0f  %s%s\n",
+                transport_name(row->kind), r->msgs_per_s, ratio, (double)r->lat_p50_ns / 1e3,
+                (double)r->lat_p99_ns / 1e3, (double)r->lat_p999_ns / 1e3, (double)r->lat_max_ns / 1e3,
+                r->cpu_ns_per_msg, row->note, r->hash_failures > 0 ? ", HASH FAILURES" : "");
+    }
+    if (!markdown) {
+        fprintf(out, "VS QUEUE: throughput relative to the faster queue engine. Latency: send call to receive return.\n"
+                     "CPU ns/msg: process CPU time (both threads, user + system) per message.\n"
+                     "The producer never waits, so latency is mostly time spent in a full buffer: compare it\n"
+                     "at equal depth (-q), and see pingpong for the cost of a single handoff.\n");
+    }
+    fflush(out);
+}
+
+/*
+ * Purpose: Writes the rows as JSON, one per line.
+ * Accepts: path  - The JSON file.
+ *          rows  - The rows.
+ *          count - How many.
+ *          p     - The options.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+static int write_json(const char *path, const ipc_row_t *rows, int count, const ipc_params_t *p) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) { fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno)); return -1; }
+    fprintf(fp, "{\n  \"bench\": \"ipc_bench\",\n  \"version\": 1,\n  \"cpus\": %ld,\n  \"record_bytes\": %zu,\n"
+            "  \"msg_size\": %d,\n  \"capacity\": %zu,\n  \"queue_only\": %s,\n  \"duration_ms\": %ld,\n  \"results\": [\n",
+            sysconf(_SC_NPROCESSORS_ONLN), sizeof(message_t), p->msg_size, p->capacity,
+            p->queue_only ? "true" : "false", p->duration_ms);
+    for (int i = 0; i < count; ++i) {
+        const ipc_row_t *row = &rows[i];
+        const bench_result_t *r = &row->r;
+        fprintf(fp, "%s    {\"transport\": \"%s\", \"ok\": %s, \"note\": \"%s\", \"messages\": %lu, \"msgs_per_s\": %.1f, "
+                "\"lat_p50_ns\": %llu, \"lat_p90_ns\": %llu, \"lat_p99_ns\": %llu, \"lat_p999_ns\": %llu, "
+                "\"lat_max_ns\": %llu, \"cpu_ns_per_msg\": %.1f, \"hash_failures\": %lu}", i ? ",\n" : "",
+                transport_name(row->kind), row->ok ? "true" : "false", row->note, r->messages, r->msgs_per_s,
+                (unsigned long long)r->lat_p50_ns, (unsigned long long)r->lat_p90_ns, (unsigned long long)r->lat_p99_ns,
+                (unsigned long long)r->lat_p999_ns, (unsigned long long)r->lat_max_ns, r->cpu_ns_per_msg,
+                r->hash_failures);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    int write_error = ferror(fp);
+    if (fclose(fp) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", path); return -1; }
+    return 0;
+}
+
+/*
+ * Purpose: Finds the higher throughput of the two queue engine rows.
+ * Accepts: rows  - The rows.
+ *          count - How many.
+ * Returns: Messages per second, 0 if neither ran.
+ */
+static double best_queue_rate(const ipc_row_t *rows, int count) {
+    double best = 0.0;
+    for (int i = 0; i < count; ++i) {
+        if ((rows[i].kind == IPC_QUEUE_SEM || rows[i].kind == IPC_QUEUE_COND) && rows[i].ok && rows[i].r.msgs_per_s > best) {
+            best = rows[i].r.msgs_per_s;
+        }
+    }
+    return best;
+}
+
+/*
+ * Purpose: Names a transport for the table.
+ * Accepts: kind - The transport.
+ * Returns: Pointer to a static string.
+ */
+static const char* transport_name(ipc_transport_t kind) {
+    switch (kind) {
+        case IPC_QUEUE_SEM: return "queue sem";
+        case IPC_QUEUE_COND: return "queue cond";
+        case IPC_PIPE: return "pipe";
+        case IPC_SOCKETPAIR: return "socketpair";
+        case IPC_MQUEUE: return "posix mq";
+        case IPC_EVENTFD_SHM: return "eventfd+shm";
+        case IPC_TRANSPORT_COUNT: break;
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-q CAP] [-s SIZE] [-d MS] [-w MS] [-k] [-M FILE] [-j FILE]\n", prog_name);
+    fprintf(stderr, "  -q CAP   : Queue and shared-memory ring slots; mq depth up to fs.mqueue.msg_max (default: 1000).\n");
+    fprintf(stderr, "  -s SIZE  : Payload bytes (default: 16). Every transport carries whole %zu-byte records.\n", sizeof(message_t));
+    fprintf(stderr, "  -d MS    : Measured duration per transport (default: 1000).\n");
+    fprintf(stderr, "  -w MS    : Warmup per transport (default: 200).\n");
+    fprintf(stderr, "  -k       : No payload fill or hash check, to compare the transports alone.\n");
+    fprintf(stderr, "  -M FILE  : Write the table as Markdown.\n");
+    fprintf(stderr, "  -j FILE  : Write the results as JSON.\n");
+}
@@ -0,0 +1,176 @@
+#include "latency.h"
+
+// --- Static Variables ---
+typedef struct latency_table_s {
+    _Atomic(hist_t *) hists[LATENCY_METRIC_COUNT][LATENCY_ENGINES][LATENCY_CAP_CLASSES];
+} latency_table_t;
+
+// Live per-thread tables; a thread publishes its table here on first use
+static _Atomic(latency_table_t *) latency_tables[LATENCY_MAX_TABLES];
+// Histograms of exited threads, so merged results never go backwards
+static hist_t *retired_hists[LATENCY_METRIC_COUNT][LATENCY_ENGINES][LATENCY_CAP_CLASSES];
+// Serializes snapshots with table retirement (never taken on the record path)
+static pthread_mutex_t latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const metric_names[LATENCY_METRIC_COUNT] = { "dequeue", "processed" };
+
+static pthread_once_t latency_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t latency_key;
+static _Thread_local latency_table_t *tls_latency = NULL;
+static _Thread_local bool tls_latency_failed = false; // Do not retry a failed claim per sample
+
+// --- Internal Helper Function Declarations ---
+static latency_table_t* latency_thread_table(void);
+static void latency_key_init(void);
+static void latency_table_release(void *arg);
+
+/*
+ * Purpose: Records one latency sample into the calling thread's histogram for
+ *          the given engine and queue capacity. The thread's table and each
+ *          histogram are allocated on first use; the table is folded into
+ *          the retired totals when the thread exits.
+ * Accepts: metric   - Which latency the sample measures.
+ *          mode     - Sync engine the message went through.
+ *          capacity - Queue capacity when the message was dequeued.
+ *          ns       - The latency in nanoseconds.
+ * Returns: None.
+ */
+void latency_record(latency_metric_t metric, sync_mode_t mode, size_t capacity, uint64_t ns) {
+    latency_table_t *table = tls_latency ? tls_latency : latency_thread_table();
+    if (!table) return;
+    _Atomic(hist_t *) *slot = &table->hists[metric][mode][latency_cap_class(capacity)];
+    hist_t *h = atomic_load_explicit(slot, memory_order_relaxed); // Only this thread stores the pointer
+    if (!h) {
+        h = calloc(1, sizeof(hist_t));
+        if (!h) return;
+        atomic_store_explicit(slot, h, memory_order_release);
+    }
+    hist_record(h, ns);
+}
+
+/*
+ * Purpose: Merges the histograms of live and exited threads for one
+ *          metric, engine and capacity class.
+ * Accepts: metric    - The metric.
+ *          mode      - The sync engine.
+ *          cap_class - Capacity class index (see latency_cap_class).
+ *          out       - Histogram to fill (reset first).
+ * Returns: Number of samples merged (0 if the combination was never seen).
+ */
+unsigned long latency_snapshot(latency_metric_t metric, sync_mode_t mode, int cap_class, hist_t *out) {
+    hist_reset(out);
+    int ret = pthread_mutex_lock(&latency_mutex); PTHREAD_CHECK(ret, "Latency: Lock Mutex");
+    if (retired_hists[metric][mode][cap_class]) hist_merge(out, retired_hists[metric][mode][cap_class]);
+    for (int i = 0; i < LATENCY_MAX_TABLES; ++i) {
+        latency_table_t *table = atomic_load_explicit(&latency_tables[i], memory_order_acquire);
+        if (!table) continue;
+        hist_t *h = atomic_load_explicit(&table->hists[metric][mode][cap_class], memory_order_acquire);
+        if (h) hist_merge(out, h);
+    }
+    ret = pthread_mutex_unlock(&latency_mutex); PTHREAD_CHECK(ret, "Latency: Unlock Mutex");
+    return atomic_load_explicit(&out->count, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Maps a queue capacity to its class.
+ * Accepts: capacity - Queue capacity (>= 1).
+ * Returns: Class index in [0, LATENCY_CAP_CLASSES).
+ */
+int latency_cap_class(size_t capacity) {
+    if (capacity <= 1) return 0;
+    int cls = 63 - __builtin_clzll((unsigned long long)capacity);
+    return cls < LATENCY_CAP_CLASSES ? cls : LATENCY_CAP_CLASSES - 1;
+}
+
+/*
+ * Purpose: Returns the capacity range covered by a class.
+ * Accepts: cap_class - Class index.
+ *          lo        - Where to store the smallest capacity.
+ *          hi        - Where to store the largest capacity.
+ * Returns: None.
+ */
+void latency_cap_class_range(int cap_class, size_t *lo, size_t *hi) {
+    *lo = (size_t)1 << cap_class;
+    *hi = cap_class == LATENCY_CAP_CLASSES - 1 ? QUEUE_CAPACITY_LIMIT : ((size_t)2 << cap_class) - 1;
+}
+
+/*
+ * Purpose: Returns a short fixed name for a metric, for reports.
+ * Accepts: metric - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* latency_metric_name(latency_metric_t metric) {
+    return (metric >= 0 && metric < LATENCY_METRIC_COUNT) ? metric_names[metric] : "?";
+}
+
+/*
+ * Purpose: Allocates the calling thread's histogram table and publishes it
+ *          in a free registry slot (slow path of latency_record).
+ * Accepts: None.
+ * Returns: The table, or NULL if allocation failed or the registry is full.
+ */
+static latency_table_t* latency_thread_table(void) {
+    if (tls_latency_failed) return NULL;
+    tls_latency_failed = true; // Cleared below on success
+    if (pthread_once(&latency_key_once, latency_key_init) != 0) return NULL;
+
+    latency_table_t *table = calloc(1, sizeof(latency_table_t));
+    if (!table) { print_error("Latency", "Failed to allocate histogram table"); return NULL; }
+    for (int i = 0; i < LATENCY_MAX_TABLES; ++i) {
+        latency_table_t *expected = NULL;
+        if (atomic_load_explicit(&latency_tables[i], memory_order_relaxed)) continue;
+        if (!atomic_compare_exchange_strong(&latency_tables[i], &expected, table)) continue;
+        tls_latency = table;
+        tls_latency_failed = false;
+        pthread_setspecific(latency_key, table);
+        return table;
+    }
+    free(table);
+    print_info("Latency", "No free histogram table; thread's latencies are not recorded.");
+    return NULL;
+}
+
+/*
+ * Purpose: Creates the thread-specific-data key whose destructor retires a
+ *          thread's table. Run once through pthread_once.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void latency_key_init(void) {
+    int ret = pthread_key_create(&latency_key, latency_table_release);
+    if (ret != 0) { errno = ret; print_error("Latency", "pthread_key_create failed"); }
+}
+
+/*
+ * Purpose: Thread exit destructor: unpublishes the thread's table, folds its
+ *          histograms into the retired totals and frees it.
+ * Accepts: arg - The exiting thread's table.
+ * Returns: None.
+ */
+static void latency_table_release(void *arg) {
+    latency_table_t *table = (latency_table_t *)arg;
+    if (!table) return;
+    tls_latency = NULL;
+    tls_latency_failed = true; // Late samples of this thread are not recorded
+
+    int ret = pthread_mutex_lock(&latency_mutex); PTHREAD_CHECK(ret, "Latency: Lock Mutex");
+    for (int i = 0; i < LATENCY_MAX_TABLES; ++i) {
+        if (atomic_load_explicit(&latency_tables[i], memory_order_relaxed) == table) {
+            atomic_store_explicit(&latency_tables[i], NULL, memory_order_relaxed);
+            break;
+        }
+    }
+    for (int m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        for (int e = 0; e < LATENCY_ENGINES; ++e) {
+            for (int c = 0; c < LATENCY_CAP_CLASSES; ++c) {
+                hist_t *h = atomic_load_explicit(&table->hists[m][e][c], memory_order_relaxed);
+                if (!h) continue;
+                if (!retired_hists[m][e][c]) retired_hists[m][e][c] = calloc(1, sizeof(hist_t));
+                if (retired_hists[m][e][c]) hist_merge(retired_hists[m][e][c], h);
+                free(h);
+            }
+        }
+    }
+    ret = pthread_mutex_unlock(&latency_mutex); PTHREAD_CHECK(ret, "Latency: Unlock Mutex");
+    free(table);
+}
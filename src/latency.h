@@ -0,0 +1,68 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "common.h"
+#include "hist.h"
+
+// --- Constants ---
+#define LATENCY_CAP_CLASSES 20 // Capacity classes [2^k, 2^(k+1)); covers QUEUE_CAPACITY_LIMIT
+#define LATENCY_ENGINES 2      // Indexed by sync_mode_t
+#define LATENCY_MAX_TABLES (CONSUMER_THREAD_LIMIT + 16)
+
+// --- Latency Metrics ---
+typedef enum {
+    LATENCY_DEQUEUE,   // queue_add call (producer) to queue_remove return (consumer)
+    LATENCY_PROCESSED, // queue_add call to the end of message processing
+    LATENCY_METRIC_COUNT
+} latency_metric_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Records one latency sample into the calling thread's histogram for
+ *          the given engine and queue capacity. The thread's table and each
+ *          histogram are allocated on first use; the table is folded into
+ *          the retired totals when the thread exits.
+ * Accepts: metric   - Which latency the sample measures.
+ *          mode     - Sync engine the message went through.
+ *          capacity - Queue capacity when the message was dequeued.
+ *          ns       - The latency in nanoseconds.
+ * Returns: None.
+ */
+void latency_record(latency_metric_t metric, sync_mode_t mode, size_t capacity, uint64_t ns);
+
+/*
+ * Purpose: Merges the histograms of live and exited threads for one
+ *          metric, engine and capacity class.
+ * Accepts: metric    - The metric.
+ *          mode      - The sync engine.
+ *          cap_class - Capacity class index (see latency_cap_class).
+ *          out       - Histogram to fill (reset first).
+ * Returns: Number of samples merged (0 if the combination was never seen).
+ */
+unsigned long latency_snapshot(latency_metric_t metric, sync_mode_t mode, int cap_class, hist_t *out);
+
+/*
+ * Purpose: Maps a queue capacity to its class.
+ * Accepts: capacity - Queue capacity (>= 1).
+ * Returns: Class index in [0, LATENCY_CAP_CLASSES).
+ */
+int latency_cap_class(size_t capacity);
+
+/*
+ * Purpose: Returns the capacity range covered by a class.
+ * Accepts: cap_class - Class index.
+ *          lo        - Where to store the smallest capacity.
+ *          hi        - Where to store the largest capacity.
+ * Returns: None.
+ */
+void latency_cap_class_range(int cap_class, size_t *lo, size_t *hi);
+
+/*
+ * Purpose: Returns a short fixed name for a metric, for reports.
+ * Accepts: metric - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* latency_metric_name(latency_metric_t metric);
+
+#endif // LATENCY_H
@@ -0,0 +1,174 @@
+#include "lockprof.h"
+
+// --- Static Variables ---
+static const char *const site_names[LOCK_SITE_COUNT] = { "add", "remove", "resize", "getter", "swap" };
+
+#ifdef PROFILE_LOCK
+typedef struct lock_site_counters_s {
+    atomic_ulong acquisitions;
+    atomic_ulong contended;
+    atomic_ulong wait_ns;
+    atomic_ulong hold_ns;
+    atomic_ulong max_wait_ns;
+    atomic_ulong max_hold_ns;
+} lock_site_counters_t;
+
+static lock_site_counters_t site_counters[LOCK_SITE_COUNT];
+static _Thread_local int tls_site = -1;           // Site of the mutex this thread holds
+static _Thread_local uint64_t tls_hold_start = 0; // Start of the current hold segment
+
+// --- Internal Helper Function Declarations ---
+static void lockprof_update_max(atomic_ulong *max, uint64_t value);
+static void lockprof_end_hold(void);
+#endif
+
+/*
+ * Purpose: Tells whether the profiler is compiled in.
+ * Accepts: None.
+ * Returns: true with PROFILE_LOCK, false otherwise.
+ */
+bool lockprof_enabled(void) {
+#ifdef PROFILE_LOCK
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Purpose: Reads the totals of one call site.
+ * Accepts: site - The call site.
+ *          out  - Where to store the totals (zeroed when profiling is off).
+ * Returns: None.
+ */
+void lockprof_get(lock_site_t site, lock_site_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+#ifdef PROFILE_LOCK
+    lock_site_counters_t *c = &site_counters[site];
+    out->acquisitions = atomic_load_explicit(&c->acquisitions, memory_order_relaxed);
+    out->contended = atomic_load_explicit(&c->contended, memory_order_relaxed);
+    out->wait_ns = atomic_load_explicit(&c->wait_ns, memory_order_relaxed);
+    out->hold_ns = atomic_load_explicit(&c->hold_ns, memory_order_relaxed);
+    out->max_wait_ns = atomic_load_explicit(&c->max_wait_ns, memory_order_relaxed);
+    out->max_hold_ns = atomic_load_explicit(&c->max_hold_ns, memory_order_relaxed);
+#else
+    (void)site;
+#endif
+}
+
+/*
+ * Purpose: Returns a short fixed name for a call site, for reports.
+ * Accepts: site - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* lockprof_site_name(lock_site_t site) {
+    return (site >= 0 && site < LOCK_SITE_COUNT) ? site_names[site] : "?";
+}
+
+/*
+ * Purpose: Prints one line per call site that took the lock to stdout.
+ *          Does nothing when profiling is off.
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_print_summary(void) {
+    if (!lockprof_enabled()) return;
+    for (int i = 0; i < LOCK_SITE_COUNT; ++i) {
+        lock_site_stats_t st;
+        lockprof_get((lock_site_t)i, &st);
+        if (st.acquisitions == 0) continue;
+        printf("[Lock Profile] %-6s %lu acquisitions, %lu contended (%.1f%%), wait %.3f ms (max %.1f us), hold %.3f ms (avg %.2f us, max %.1f us)\r\n",
+               lockprof_site_name((lock_site_t)i), st.acquisitions, st.contended,
+               100.0 * (double)st.contended / (double)st.acquisitions,
+               st.wait_ns / 1e6, st.max_wait_ns / 1000.0,
+               st.hold_ns / 1e6, st.hold_ns / 1000.0 / (double)st.acquisitions, st.max_hold_ns / 1000.0);
+    }
+    fflush(stdout);
+}
+
+#ifdef PROFILE_LOCK
+
+/*
+ * Purpose: Locks a mutex, trying trylock first so contended acquisitions and
+ *          their wait time are attributed to the call site; starts the
+ *          calling thread's hold timer.
+ * Accepts: mutex - The mutex.
+ *          site  - The call site.
+ * Returns: The pthread_mutex_lock result (0 on success).
+ */
+int lockprof_lock(pthread_mutex_t *mutex, lock_site_t site) {
+    lock_site_counters_t *c = &site_counters[site];
+    int ret = pthread_mutex_trylock(mutex);
+    if (ret == EBUSY) {
+        uint64_t wait_start = monotonic_ns();
+        ret = pthread_mutex_lock(mutex);
+        uint64_t waited = monotonic_ns() - wait_start;
+        atomic_fetch_add_explicit(&c->contended, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->wait_ns, waited, memory_order_relaxed);
+        lockprof_update_max(&c->max_wait_ns, waited);
+    }
+    if (ret != 0) return ret;
+    atomic_fetch_add_explicit(&c->acquisitions, 1, memory_order_relaxed);
+    tls_site = (int)site;
+    tls_hold_start = monotonic_ns();
+    return 0;
+}
+
+/*
+ * Purpose: Unlocks a mutex and records the hold time since lockprof_lock
+ *          (or the last lockprof_hold_resume).
+ * Accepts: mutex - The mutex.
+ * Returns: The pthread_mutex_unlock result (0 on success).
+ */
+int lockprof_unlock(pthread_mutex_t *mutex) {
+    lockprof_end_hold();
+    tls_site = -1;
+    return pthread_mutex_unlock(mutex);
+}
+
+/*
+ * Purpose: Ends the current hold segment before a condition wait releases
+ *          the mutex, so the sleep is not counted as hold time.
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_hold_pause(void) {
+    lockprof_end_hold();
+}
+
+/*
+ * Purpose: Starts a new hold segment after a condition wait re-acquired the
+ *          mutex (same call site as the original acquisition).
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_hold_resume(void) {
+    if (tls_site >= 0) tls_hold_start = monotonic_ns();
+}
+
+/*
+ * Purpose: Adds the current hold segment, if any, to the site's hold time.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void lockprof_end_hold(void) {
+    if (tls_site < 0 || tls_hold_start == 0) return;
+    lock_site_counters_t *c = &site_counters[tls_site];
+    uint64_t held = monotonic_ns() - tls_hold_start;
+    tls_hold_start = 0;
+    atomic_fetch_add_explicit(&c->hold_ns, held, memory_order_relaxed);
+    lockprof_update_max(&c->max_hold_ns, held);
+}
+
+/*
+ * Purpose: Raises a shared maximum if the new value is larger.
+ * Accepts: max   - The maximum to update.
+ *          value - The candidate value.
+ * Returns: None.
+ */
+static void lockprof_update_max(atomic_ulong *max, uint64_t value) {
+    unsigned long cur = atomic_load_explicit(max, memory_order_relaxed);
+    while (value > cur && !atomic_compare_exchange_weak(max, &cur, value)) { }
+}
+
+#endif // PROFILE_LOCK
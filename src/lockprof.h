@@ -0,0 +1,112 @@
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+#include "common.h"
+
+// Contention profiler for the queue mutex, compiled in with PROFILE_LOCK=1
+// (make PROFILE_LOCK=1 ...). Without it QUEUE_LOCK/QUEUE_UNLOCK are plain
+// pthread_mutex_lock/unlock and the report functions return nothing.
+
+// --- Call Sites ---
+typedef enum {
+    LOCK_SITE_ADD,
+    LOCK_SITE_REMOVE,
+    LOCK_SITE_RESIZE,
+    LOCK_SITE_GETTER, // queue_get_count and friends
+    LOCK_SITE_SWAP,
+    LOCK_SITE_COUNT
+} lock_site_t;
+
+// --- Per-Site Totals ---
+typedef struct lock_site_stats_s {
+    unsigned long acquisitions;
+    unsigned long contended;  // trylock failed, so the thread had to block
+    uint64_t wait_ns;         // Time blocked in the contended acquisitions
+    uint64_t hold_ns;         // Time between acquisition and release
+    uint64_t max_wait_ns;
+    uint64_t max_hold_ns;
+} lock_site_stats_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Tells whether the profiler is compiled in.
+ * Accepts: None.
+ * Returns: true with PROFILE_LOCK, false otherwise.
+ */
+bool lockprof_enabled(void);
+
+/*
+ * Purpose: Reads the totals of one call site.
+ * Accepts: site - The call site.
+ *          out  - Where to store the totals (zeroed when profiling is off).
+ * Returns: None.
+ */
+void lockprof_get(lock_site_t site, lock_site_stats_t *out);
+
+/*
+ * Purpose: Returns a short fixed name for a call site, for reports.
+ * Accepts: site - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* lockprof_site_name(lock_site_t site);
+
+/*
+ * Purpose: Prints one line per call site that took the lock to stdout.
+ *          Does nothing when profiling is off.
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_print_summary(void);
+
+#ifdef PROFILE_LOCK
+
+/*
+ * Purpose: Locks a mutex, trying trylock first so contended acquisitions and
+ *          their wait time are attributed to the call site; starts the
+ *          calling thread's hold timer.
+ * Accepts: mutex - The mutex.
+ *          site  - The call site.
+ * Returns: The pthread_mutex_lock result (0 on success).
+ */
+int lockprof_lock(pthread_mutex_t *mutex, lock_site_t site);
+
+/*
+ * Purpose: Unlocks a mutex and records the hold time since lockprof_lock
+ *          (or the last lockprof_hold_resume).
+ * Accepts: mutex - The mutex.
+ * Returns: The pthread_mutex_unlock result (0 on success).
+ */
+int lockprof_unlock(pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Ends the current hold segment before a condition wait releases
+ *          the mutex, so the sleep is not counted as hold time.
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_hold_pause(void);
+
+/*
+ * Purpose: Starts a new hold segment after a condition wait re-acquired the
+ *          mutex (same call site as the original acquisition).
+ * Accepts: None.
+ * Returns: None.
+ */
+void lockprof_hold_resume(void);
+
+#define QUEUE_LOCK(q, site) lockprof_lock(&(q)->mutex, (site))
+#define QUEUE_UNLOCK(q) lockprof_unlock(&(q)->mutex)
+#define QUEUE_HOLD_PAUSE() lockprof_hold_pause()
+#define QUEUE_HOLD_RESUME() lockprof_hold_resume()
+
+#else
+
+#define QUEUE_LOCK(q, site) pthread_mutex_lock(&(q)->mutex)
+#define QUEUE_UNLOCK(q) pthread_mutex_unlock(&(q)->mutex)
+#define QUEUE_HOLD_PAUSE() ((void)0)
+#define QUEUE_HOLD_RESUME() ((void)0)
+
+#endif // PROFILE_LOCK
+
+#endif // LOCKPROF_H
@@ -0,0 +1,397 @@
+#include "log.h"
+#include "config.h"
+#include <stdarg.h>
+
+// --- Static Variables ---
+// Ring ownership: FREE -> CLAIMING -> OWNED (by one thread) -> CLOSING (thread
+// exited; the writer drains it) -> FREE. Buffers are kept for reuse.
+enum { RING_FREE, RING_CLAIMING, RING_OWNED, RING_CLOSING };
+
+typedef struct log_entry_s {
+    uint64_t ts_ns;
+    int level;
+    char text[LOG_LINE_MAX];
+} log_entry_t;
+
+// Single-producer (owning thread) / single-consumer (writer) ring
+typedef struct log_ring_s {
+    atomic_size_t head;          // Next entry to write out (writer only)
+    atomic_size_t tail;          // Next entry to fill (owner only)
+    atomic_ulong dropped;        // Owner only (relaxed load+store)
+    atomic_ulong suppressed;     // Owner only (relaxed load+store)
+    uint64_t window_start_ns;    // Rate limit window, owner only
+    long window_count;
+    unsigned long window_suppressed;
+    log_entry_t entries[LOG_RING_ENTRIES];
+} log_ring_t;
+
+static log_ring_t *rings[LOG_MAX_RINGS];
+static atomic_int ring_state[LOG_MAX_RINGS];
+static atomic_ulong retired_dropped; // Also counts lines of threads that got no ring
+static atomic_ulong retired_suppressed;
+
+static atomic_bool writer_running = false;
+static atomic_bool writer_stop_requested = false;
+static pthread_t writer_thread;
+static atomic_int log_level = LOG_LEVEL_INFO;
+static long log_rate = 0; // Lines per second per thread, 0 = unlimited
+
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static _Thread_local log_ring_t *tls_ring = NULL;
+static _Thread_local int tls_ring_index = -1;
+static _Thread_local bool tls_no_ring = false; // Writer thread, or no ring could be claimed
+static _Thread_local bool tls_is_writer = false;
+
+static const char *const level_names[LOG_LEVEL_COUNT] = { "error", "warn", "info", "debug" };
+
+// --- Internal Helper Function Declarations ---
+static void* log_writer_func(void *arg);
+static void log_drain(void);
+static log_ring_t* log_thread_ring(void);
+static void log_ring_key_init(void);
+static void log_ring_release(void *arg);
+static bool log_rate_admit(log_ring_t *ring);
+static void log_push(log_ring_t *ring, log_level_t level, const char *fmt, va_list ap);
+static void log_push_notice(log_ring_t *ring, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void log_write_direct(log_level_t level, const char *fmt, va_list ap);
+static void log_counter_add(atomic_ulong *counter, unsigned long n);
+
+/*
+ * Purpose: Starts the background writer thread. From then on log_write only
+ *          copies lines into the calling thread's ring; the writer merges all
+ *          rings by timestamp and writes them out (ERROR and WARN to stderr,
+ *          the rest to stdout), flushing once per pass. Level and rate limit
+ *          come from g_config.log_level and g_config.log_rate.
+ * Accepts: None.
+ * Returns: 0 on success, -1 on failure (logging then stays synchronous).
+ */
+int log_start(void) {
+    atomic_store(&log_level, g_config.log_level);
+    log_rate = g_config.log_rate;
+    if (atomic_load(&writer_running)) return 0;
+
+    atomic_store(&writer_stop_requested, false);
+    int ret = pthread_create(&writer_thread, NULL, log_writer_func, NULL);
+    if (ret != 0) { errno = ret; print_error("Log", "pthread_create (writer) failed"); return -1; }
+    atomic_store(&writer_running, true);
+    return 0;
+}
+
+/*
+ * Purpose: Drains every ring, stops the writer thread and reports dropped or
+ *          suppressed lines. Later log_write calls write synchronously. Call
+ *          after the threads that log have been joined.
+ * Accepts: None.
+ * Returns: None.
+ */
+void log_stop(void) {
+    if (!atomic_load(&writer_running)) return;
+    atomic_store(&writer_stop_requested, true);
+    int ret = pthread_join(writer_thread, NULL); // The writer drains once more before exiting
+    atomic_store(&writer_running, false);
+    if (ret != 0) { errno = ret; print_error("Log", "pthread_join (writer) failed"); }
+
+    unsigned long dropped = 0, suppressed = 0;
+    log_get_counters(&dropped, &suppressed);
+    if (dropped > 0 || suppressed > 0) {
+        char info[128];
+        snprintf(info, sizeof(info), "%lu line(s) dropped (full or no ring), %lu suppressed by the rate limit.", dropped, suppressed);
+        print_info("Log", info);
+    }
+}
+
+/*
+ * Purpose: Logs one line (without trailing newline). Never blocks once the
+ *          writer runs: the line is dropped if the thread's ring is full or
+ *          no ring is available (all taken, or the thread is exiting), and
+ *          suppressed if the thread exceeds the rate limit (ERROR lines are
+ *          never rate limited). Without a ring, ERROR lines and the writer
+ *          thread's own lines are still written directly, since errors are
+ *          rare and must not vanish. Before log_start or after log_stop
+ *          every line is written directly and flushed.
+ * Accepts: level - Severity of the line.
+ *          fmt   - printf-style format.
+ * Returns: None.
+ */
+void log_write(log_level_t level, const char *fmt, ...) {
+    if (!log_enabled(level)) return;
+    va_list ap;
+    va_start(ap, fmt);
+    log_ring_t *ring = NULL;
+    if (!atomic_load_explicit(&writer_running, memory_order_acquire)) log_write_direct(level, fmt, ap);
+    else if (!(ring = log_thread_ring())) {
+        if (level == LOG_LEVEL_ERROR || tls_is_writer) log_write_direct(level, fmt, ap);
+        else atomic_fetch_add_explicit(&retired_dropped, 1, memory_order_relaxed);
+    }
+    else if (level == LOG_LEVEL_ERROR || log_rate_admit(ring)) log_push(ring, level, fmt, ap);
+    va_end(ap);
+}
+
+/*
+ * Purpose: Reports how many lines were lost so far.
+ * Accepts: dropped    - Where to store lines dropped on a full or missing ring (may be NULL).
+ *          suppressed - Where to store lines suppressed by the rate limit (may be NULL).
+ * Returns: None.
+ */
+void log_get_counters(unsigned long *dropped, unsigned long *suppressed) {
+    unsigned long drop_sum = atomic_load(&retired_dropped);
+    unsigned long supp_sum = atomic_load(&retired_suppressed);
+    for (int i = 0; i < LOG_MAX_RINGS; ++i) {
+        int state = atomic_load_explicit(&ring_state[i], memory_order_acquire);
+        if (state != RING_OWNED && state != RING_CLOSING) continue;
+        drop_sum += atomic_load_explicit(&rings[i]->dropped, memory_order_relaxed);
+        supp_sum += atomic_load_explicit(&rings[i]->suppressed, memory_order_relaxed);
+    }
+    if (dropped) *dropped = drop_sum;
+    if (suppressed) *suppressed = supp_sum;
+}
+
+/*
+ * Purpose: Parses a level name ("error", "warn", "info", "debug").
+ * Accepts: name - The name to parse.
+ * Returns: The level, or -1 if the name is unknown.
+ */
+int log_level_parse(const char *name) {
+    for (int i = 0; i < LOG_LEVEL_COUNT; ++i) {
+        if (strcmp(name, level_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * Purpose: Checks whether a line of the given level would be kept, so callers
+ *          can skip building expensive arguments.
+ * Accepts: level - Severity to check.
+ * Returns: true if enabled.
+ */
+bool log_enabled(log_level_t level) {
+    int current = atomic_load_explicit(&log_level, memory_order_relaxed);
+    if (!atomic_load_explicit(&writer_running, memory_order_relaxed)) current = g_config.log_level;
+    return (int)level <= current;
+}
+
+/*
+ * Purpose: Writer thread body. Drains the rings every flush interval until a
+ *          stop is requested, then drains one final time.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* log_writer_func(void *arg) {
+    (void)arg;
+    tls_no_ring = true; // Anything the writer itself logs goes straight out (see log_write)
+    tls_is_writer = true;
+    while (!atomic_load(&writer_stop_requested)) {
+        struct timespec pause = { 0, LOG_FLUSH_INTERVAL_NS };
+        nanosleep(&pause, NULL);
+        log_drain();
+    }
+    log_drain();
+    return NULL;
+}
+
+/*
+ * Purpose: Writes out everything currently buffered, merging the rings by
+ *          timestamp so lines from different threads appear in time order.
+ *          Rings of exited threads are released once empty.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void log_drain(void) {
+    static size_t limit[LOG_MAX_RINGS]; // Writer thread only
+    static int active[LOG_MAX_RINGS];
+    int active_count = 0;
+
+    for (int i = 0; i < LOG_MAX_RINGS; ++i) {
+        int state = atomic_load_explicit(&ring_state[i], memory_order_acquire);
+        if (state != RING_OWNED && state != RING_CLOSING) continue;
+        limit[i] = atomic_load_explicit(&rings[i]->tail, memory_order_acquire);
+        active[active_count++] = i;
+    }
+
+    bool wrote_out = false, wrote_err = false;
+    for (;;) {
+        int best = -1;
+        uint64_t best_ts = 0;
+        for (int k = 0; k < active_count; ++k) {
+            log_ring_t *ring = rings[active[k]];
+            size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            if (head == limit[active[k]]) continue;
+            uint64_t ts = ring->entries[head & (LOG_RING_ENTRIES - 1)].ts_ns;
+            if (best == -1 || ts < best_ts) { best = active[k]; best_ts = ts; }
+        }
+        if (best == -1) break;
+
+        log_ring_t *ring = rings[best];
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        log_entry_t *entry = &ring->entries[head & (LOG_RING_ENTRIES - 1)];
+        FILE *out = entry->level <= LOG_LEVEL_WARN ? stderr : stdout;
+        fputs(entry->text, out);
+        fputs("\r\n", out);
+        if (out == stderr) wrote_err = true; else wrote_out = true;
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release); // Slot may be reused now
+    }
+    if (wrote_out) fflush(stdout);
+    if (wrote_err) fflush(stderr);
+
+    for (int k = 0; k < active_count; ++k) {
+        int i = active[k];
+        if (atomic_load_explicit(&ring_state[i], memory_order_acquire) != RING_CLOSING) continue;
+        if (atomic_load_explicit(&rings[i]->head, memory_order_relaxed) != atomic_load_explicit(&rings[i]->tail, memory_order_acquire)) continue;
+        atomic_fetch_add(&retired_dropped, atomic_load_explicit(&rings[i]->dropped, memory_order_relaxed));
+        atomic_fetch_add(&retired_suppressed, atomic_load_explicit(&rings[i]->suppressed, memory_order_relaxed));
+        atomic_store_explicit(&ring_state[i], RING_FREE, memory_order_release);
+    }
+}
+
+/*
+ * Purpose: Returns the calling thread's ring, claiming (and on first use
+ *          allocating) one if needed. The ring is handed back to the writer
+ *          by a thread-specific-data destructor when the thread exits, which
+ *          also covers cancellation.
+ * Accepts: None.
+ * Returns: The ring, or NULL if none is available (log_write then writes
+ *          ERROR lines directly and drops the rest).
+ */
+static log_ring_t* log_thread_ring(void) {
+    if (tls_ring) return tls_ring;
+    if (tls_no_ring) return NULL;
+    if (pthread_once(&ring_key_once, log_ring_key_init) != 0) { tls_no_ring = true; return NULL; }
+
+    for (int i = 0; i < LOG_MAX_RINGS; ++i) {
+        int expected = RING_FREE;
+        if (atomic_load_explicit(&ring_state[i], memory_order_relaxed) != RING_FREE) continue;
+        if (!atomic_compare_exchange_strong(&ring_state[i], &expected, RING_CLAIMING)) continue;
+
+        if (!rings[i]) rings[i] = malloc(sizeof(log_ring_t));
+        if (!rings[i]) { atomic_store(&ring_state[i], RING_FREE); break; }
+        log_ring_t *ring = rings[i];
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->dropped, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->suppressed, 0, memory_order_relaxed);
+        ring->window_start_ns = monotonic_ns();
+        ring->window_count = 0;
+        ring->window_suppressed = 0;
+        atomic_store_explicit(&ring_state[i], RING_OWNED, memory_order_release); // Publishes the reset ring
+
+        tls_ring = ring;
+        tls_ring_index = i;
+        pthread_setspecific(ring_key, ring);
+        return ring;
+    }
+    tls_no_ring = true;
+    return NULL;
+}
+
+/*
+ * Purpose: Creates the thread-specific-data key whose destructor releases a
+ *          thread's ring. Run once through pthread_once.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void log_ring_key_init(void) {
+    int ret = pthread_key_create(&ring_key, log_ring_release);
+    if (ret != 0) { errno = ret; print_error("Log", "pthread_key_create failed"); }
+}
+
+/*
+ * Purpose: Thread exit destructor: marks the thread's ring as closing so the
+ *          writer drains what is left and then frees the slot.
+ * Accepts: arg - The exiting thread's ring.
+ * Returns: None.
+ */
+static void log_ring_release(void *arg) {
+    (void)arg;
+    if (tls_ring_index < 0) return;
+    atomic_store_explicit(&ring_state[tls_ring_index], RING_CLOSING, memory_order_release);
+    tls_ring = NULL;
+    tls_ring_index = -1;
+    tls_no_ring = true; // Later in this thread's teardown only ERROR lines get out (directly)
+}
+
+/*
+ * Purpose: Applies the per-thread rate limit (a one-second window). When a
+ *          new window starts after lines were suppressed, a notice with the
+ *          number of suppressed lines is queued first.
+ * Accepts: ring - The calling thread's ring.
+ * Returns: true if the line may be logged.
+ */
+static bool log_rate_admit(log_ring_t *ring) {
+    if (log_rate <= 0) return true;
+    uint64_t now = monotonic_ns();
+    if (now - ring->window_start_ns >= 1000000000ULL) {
+        unsigned long missed = ring->window_suppressed;
+        ring->window_start_ns = now;
+        ring->window_count = 0;
+        ring->window_suppressed = 0;
+        if (missed > 0) log_push_notice(ring, "[Log] %lu line(s) suppressed (limit %ld lines/s per thread).", missed, log_rate);
+    }
+    if (ring->window_count >= log_rate) {
+        ring->window_suppressed++;
+        log_counter_add(&ring->suppressed, 1);
+        return false;
+    }
+    ring->window_count++;
+    return true;
+}
+
+/*
+ * Purpose: Formats a line straight into the next free slot of the ring, or
+ *          counts it as dropped if the ring is full.
+ * Accepts: ring  - The calling thread's ring.
+ *          level - Severity of the line.
+ *          fmt   - printf-style format.
+ *          ap    - Format arguments.
+ * Returns: None.
+ */
+static void log_push(log_ring_t *ring, log_level_t level, const char *fmt, va_list ap) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= LOG_RING_ENTRIES) { log_counter_add(&ring->dropped, 1); return; }
+
+    log_entry_t *entry = &ring->entries[tail & (LOG_RING_ENTRIES - 1)];
+    entry->ts_ns = monotonic_ns();
+    entry->level = (int)level;
+    vsnprintf(entry->text, sizeof(entry->text), fmt, ap);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release); // Publishes the entry
+}
+
+/*
+ * Purpose: Variadic adapter for log_push, used for WARN-level notices from
+ *          the logger itself.
+ * Accepts: ring - The calling thread's ring.
+ *          fmt  - printf-style format.
+ * Returns: None.
+ */
+static void log_push_notice(log_ring_t *ring, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    log_push(ring, LOG_LEVEL_WARN, fmt, ap);
+    va_end(ap);
+}
+
+/*
+ * Purpose: Synchronous fallback: writes the line and flushes, ERROR and WARN
+ *          to stderr, everything else to stdout.
+ * Accepts: level - Severity of the line.
+ *          fmt   - printf-style format.
+ *          ap    - Format arguments.
+ * Returns: None.
+ */
+static void log_write_direct(log_level_t level, const char *fmt, va_list ap) {
+    FILE *out = level <= LOG_LEVEL_WARN ? stderr : stdout;
+    vfprintf(out, fmt, ap);
+    fputs("\r\n", out);
+    fflush(out);
+}
+
+/*
+ * Purpose: Adds to a counter that only the owning thread writes (no RMW).
+ * Accepts: counter - The counter.
+ *          n       - Amount to add.
+ * Returns: None.
+ */
+static void log_counter_add(atomic_ulong *counter, unsigned long n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
@@ -0,0 +1,81 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "common.h"
+
+// --- Constants ---
+#define LOG_LINE_MAX 256          // Longer lines are truncated
+#define LOG_RING_ENTRIES 256      // Lines buffered per thread (power of two)
+#define LOG_MAX_RINGS (PRODUCER_THREAD_LIMIT + CONSUMER_THREAD_LIMIT + 16)
+#define LOG_FLUSH_INTERVAL_NS 5000000L // Writer drains the rings every 5ms
+
+// --- Log Levels (a line is kept if its level <= the configured level) ---
+typedef enum {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+} log_level_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Starts the background writer thread. From then on log_write only
+ *          copies lines into the calling thread's ring; the writer merges all
+ *          rings by timestamp and writes them out (ERROR and WARN to stderr,
+ *          the rest to stdout), flushing once per pass. Level and rate limit
+ *          come from g_config.log_level and g_config.log_rate.
+ * Accepts: None.
+ * Returns: 0 on success, -1 on failure (logging then stays synchronous).
+ */
+int log_start(void);
+
+/*
+ * Purpose: Drains every ring, stops the writer thread and reports dropped or
+ *          suppressed lines. Later log_write calls write synchronously. Call
+ *          after the threads that log have been joined.
+ * Accepts: None.
+ * Returns: None.
+ */
+void log_stop(void);
+
+/*
+ * Purpose: Logs one line (without trailing newline). Never blocks once the
+ *          writer runs: the line is dropped if the thread's ring is full or
+ *          no ring is available (all taken, or the thread is exiting), and
+ *          suppressed if the thread exceeds the rate limit (ERROR lines are
+ *          never rate limited). Without a ring, ERROR lines and the writer
+ *          thread's own lines are still written directly, since errors are
+ *          rare and must not vanish. Before log_start or after log_stop
+ *          every line is written directly and flushed.
+ * Accepts: level - Severity of the line.
+ *          fmt   - printf-style format.
+ * Returns: None.
+ */
+void log_write(log_level_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/*
+ * Purpose: Reports how many lines were lost so far.
+ * Accepts: dropped    - Where to store lines dropped on a full or missing ring (may be NULL).
+ *          suppressed - Where to store lines suppressed by the rate limit (may be NULL).
+ * Returns: None.
+ */
+void log_get_counters(unsigned long *dropped, unsigned long *suppressed);
+
+/*
+ * Purpose: Parses a level name ("error", "warn", "info", "debug").
+ * Accepts: name - The name to parse.
+ * Returns: The level, or -1 if the name is unknown.
+ */
+int log_level_parse(const char *name);
+
+/*
+ * Purpose: Checks whether a line of the given level would be kept, so callers
+ *          can skip building expensive arguments.
+ * Accepts: level - Severity to check.
+ * Returns: true if enabled.
+ */
+bool log_enabled(log_level_t level);
+
+#endif // LOG_H
@@ -4,21 +4,47 @@
 #include "producer.h"
 #include "consumer.h"
 #include "utils.h"
+#include "control.h"
+#include "config.h"
+#include "thread_stats.h"
+#include "watchdog.h"
+#include "log.h"
+#include "trace.h"
+#include "latency.h"
+#include "lockprof.h"
+#include "rates.h"
+#include "metrics.h"
+#include "stats_shm.h"
+#include "perfctr.h"
+#include "occupancy.h"
 #include <getopt.h>
+#include <stdarg.h>
 
 // --- Global Variables ---
 volatile sig_atomic_t g_terminate_flag = 0;
 sync_mode_t g_sync_mode = SYNC_MODE_SEM; // Default
+think_time_t g_producer_think = { 100000L, 500000L };
+think_time_t g_consumer_think = { 200000L, 600000L };
 
-// Thread tracking
-static pthread_t producer_threads[MAX_PRODUCERS];
-static int producer_created_count = 0; // Number of currently active/joinable producers
+// Thread tracking (counts are atomic so status replies can read them without command_mutex)
+static pthread_t producer_threads[PRODUCER_THREAD_LIMIT];
+static atomic_int producer_created_count = 0; // Number of currently active/joinable producers
 
-static pthread_t consumer_threads[MAX_CONSUMERS];
-static int consumer_created_count = 0; // Number of currently active/joinable consumers
+static pthread_t consumer_threads[CONSUMER_THREAD_LIMIT];
+static atomic_int consumer_created_count = 0; // Number of currently active/joinable consumers
 
 static queue_t *g_queue = NULL;
 
+// Serializes commands arriving from the keyboard and from the control socket
+static pthread_mutex_t command_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Serializes resize and engine commands instead: they can block in the queue
+// until workers make progress, so they must not hold command_mutex, which
+// adding or removing those workers needs (lock order: resize, then command)
+static pthread_mutex_t resize_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Scratch histogram for status reports (keyboard and control thread may report concurrently)
+static hist_t report_hist;
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // --- Static Function Declarations ---
 /*
  * Purpose: Signal handler for SIGINT and SIGTERM in the main thread.
@@ -45,6 +71,14 @@ static void register_main_signal_handlers(void);
  */
 static void cleanup_threads(void);
 
+/*
+ * Purpose: Wakes every thread blocked in the queue so it can observe
+ *          g_terminate_flag. Also the control socket's stop callback.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void wake_queue_waiters(void);
+
 /*
  * Purpose: Prints command-line usage instructions to stderr.
  * Accepts: prog_name - The name of the executable (argv[0]).
@@ -52,6 +86,88 @@ static void cleanup_threads(void);
  */
 static void print_usage(const char *prog_name);
 
+/*
+ * Purpose: Appends a formatted line to the command reply buffer, or prints it
+ *          as a "[Main]" message when the command came from the keyboard.
+ * Accepts: reply     - Reply buffer, or NULL for keyboard use.
+ *          reply_len - Size of the reply buffer.
+ *          fmt       - printf-style format of the line (without newline).
+ * Returns: None.
+ */
+static void command_reply(char *reply, size_t reply_len, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/*
+ * Purpose: Parses an optional positive count argument of a command.
+ * Accepts: arg      - The argument token, or NULL if absent.
+ *          fallback - Value used when the argument is absent.
+ *          out      - Where to store the parsed value.
+ * Returns: 0 on success, -1 if the argument is not a positive integer.
+ */
+static int parse_count_arg(const char *arg, long fallback, long *out);
+
+/*
+ * Purpose: Creates one producer or consumer thread and records it in the
+ *          matching thread array. Caller must hold command_mutex.
+ * Accepts: producer - true to create a producer, false for a consumer.
+ * Returns: 0 on success, -1 if the limit is reached or creation failed.
+ */
+static int spawn_worker(bool producer);
+
+/*
+ * Purpose: Cancels and joins the most recently created producer or consumer
+ *          thread. Caller must hold command_mutex.
+ * Accepts: producer - true to remove a producer, false for a consumer.
+ * Returns: 0 on success, -1 if none is running or cancel/join failed.
+ */
+static int cancel_last_worker(bool producer);
+
+/*
+ * Purpose: Prints the human-readable status table for the 's' key, using the
+ *          lock-free queue stats snapshot.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void print_status(void);
+
+/*
+ * Purpose: Reports end-to-end latency percentiles for every engine and
+ *          capacity class that has samples, one line each.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_latency(char *reply, size_t reply_len);
+
+/*
+ * Purpose: Reports blocking-wait counts, blocked time and wait-duration
+ *          percentiles per role and, for replies, per live thread.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_waits(char *reply, size_t reply_len);
+
+/*
+ * Purpose: Reports 1 s / 10 s / 60 s message and byte rates overall, per
+ *          role and per live producer or consumer.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_rates(char *reply, size_t reply_len);
+
+/*
+ * Purpose: Parses and executes one command line (single-key form such as "p"
+ *          or the parameterized form such as "add-producers 3"). Used both by
+ *          the keyboard loop and as the control socket handler.
+ * Accepts: line      - The command line, without trailing newline.
+ *          reply     - Buffer for the reply text, or NULL for keyboard use
+ *                      (results are then printed to stdout).
+ *          reply_len - Size of the reply buffer.
+ * Returns: 0 on success, -1 on failure or unknown command.
+ */
+static int execute_command(const char *line, char *reply, size_t reply_len);
+
 /*
  * Purpose: Main entry point of the application. Parses command-line arguments,
  *          initializes resources (terminal, queue, signals, cleanup handler),
@@ -62,8 +178,7 @@ static void print_usage(const char *prog_name);
  * Returns: EXIT_SUCCESS on normal completion, EXIT_FAILURE on error.
  */
 int main(int argc, char *argv[]) {
-    int opt;
-    const char *mode_str = "sem";
+    const char *mode_str;
 
     // Check for arguments if program requires them (example, not strictly needed by this program's current design if defaults are fine)
     // if (argc < MIN_EXPECTED_ARGS_IF_ANY && strcmp(argv[1], "-h") != 0 && strcmp(argv[1], "--help") != 0) {
@@ -72,35 +187,32 @@ int main(int argc, char *argv[]) {
     // }
 
 
-    // Parse Command Line Options
-    while ((opt = getopt(argc, argv, "m:h")) != -1) {
-        switch (opt) {
-            case 'm': mode_str = optarg; break;
-            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
-            default: print_usage(argv[0]); return EXIT_FAILURE;
-        }
-    }
-    if (optind < argc) { // Check for non-option arguments if they are not input files
-        fprintf(stderr, "Error: Unexpected non-option arguments.\n");
-        print_usage(argv[0]);
-        return EXIT_FAILURE;
-    }
+    // Parse Command Line Options (defaults < config file < command line)
+    int parse_ret = config_parse_args(&g_config, argc, argv);
+    if (parse_ret == 1) { print_usage(argv[0]); return EXIT_SUCCESS; }
+    if (parse_ret == -1) { print_usage(argv[0]); return EXIT_FAILURE; }
 
 
     // Determine synchronization mode
-    if (strcmp(mode_str, "sem") == 0) { g_sync_mode = SYNC_MODE_SEM; print_info("Main", "Using POSIX Semaphores."); }
-    else if (strcmp(mode_str, "cond") == 0) { g_sync_mode = SYNC_MODE_CONDVAR; print_info("Main", "Using Condition Variables."); }
-    else { fprintf(stderr, "Error: Invalid mode '%s'.\n", mode_str); print_usage(argv[0]); return EXIT_FAILURE; }
+    g_sync_mode = g_config.sync_mode;
+    if (g_sync_mode == SYNC_MODE_SEM) { mode_str = "sem"; print_info("Main", "Using POSIX Semaphores."); }
+    else { mode_str = "cond"; print_info("Main", "Using Condition Variables."); }
+
+    atomic_store(&g_producer_think.min_us, g_config.producer_think_min_us);
+    atomic_store(&g_producer_think.max_us, g_config.producer_think_max_us);
+    atomic_store(&g_consumer_think.min_us, g_config.consumer_think_min_us);
+    atomic_store(&g_consumer_think.max_us, g_config.consumer_think_max_us);
 
     // Initialize static memory (example, if any static memory needed runtime init)
     // initialize_static_data(); // Placeholder for explicit static memory initialization
 
     srand((unsigned int)time(NULL) ^ (unsigned int)getpid());
+    thread_stats_register(THREAD_ROLE_CONTROL, 0); // The main thread runs keyboard commands and resizes
     print_info("Main", "Initializing system...");
     setup_terminal_noecho_nonblock();
 
     // Create queue
-    g_queue = queue_create(INITIAL_QUEUE_CAPACITY, g_sync_mode);
+    g_queue = queue_create(g_config.initial_capacity, g_sync_mode);
     if (!g_queue) {
         restore_terminal(); // Ensure terminal is restored on early exit
         return EXIT_FAILURE;
@@ -115,18 +227,67 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (log_start() == -1) {
+        print_info("Main", "Asynchronous logging unavailable; writing log lines directly.");
+    }
+
+    if (g_config.trace_dir[0] != '\0' && trace_start(g_config.trace_dir, g_config.trace_events) == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    if (g_config.control_path[0] != '\0' && control_start(g_config.control_path, execute_command) == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    if (watchdog_start(g_queue) == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    if (rates_start() == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    if (metrics_start(g_queue, g_config.metrics_path, g_config.metrics_port) == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    if (strcmp(g_config.stats_shm, "off") != 0) {
+        char shm_name[CONFIG_PATH_MAX];
+        if (strcmp(g_config.stats_shm, "auto") == 0) snprintf(shm_name, sizeof(shm_name), "/" STATS_SHM_PREFIX "%ld", (long)getpid());
+        else strcpy(shm_name, g_config.stats_shm);
+        if (stats_shm_start(g_queue, shm_name) == -1) {
+            return EXIT_FAILURE; // atexit handler performs the cleanup
+        }
+    }
+
+    if (g_config.occupancy_us > 0 &&
+        occupancy_start(g_queue, g_config.occupancy_us, g_config.occupancy_samples, g_config.occupancy_csv) == -1) {
+        return EXIT_FAILURE; // atexit handler performs the cleanup
+    }
+
+    // Start the initial workers requested by the configuration
+    char start_cmd[64];
+    if (g_config.initial_producers > 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "add-producers %d", g_config.initial_producers);
+        execute_command(start_cmd, NULL, 0);
+    }
+    if (g_config.initial_consumers > 0) {
+        snprintf(start_cmd, sizeof(start_cmd), "add-consumers %d", g_config.initial_consumers);
+        execute_command(start_cmd, NULL, 0);
+    }
+
     // Print usage instructions
     printf("\r\n--- Producer/Consumer Control (Mode: %s) ---\r\n", mode_str);
     printf("  p: Add Producer        c: Add Consumer\r\n");
     printf("  P: Remove Last Producer  C: Remove Last Consumer\r\n");
     printf("  +: Increase Queue Cap.  -: Decrease Queue Cap.\r\n");
+    printf("  m: Switch Sync Engine\r\n");
     printf("  s: Show Status         q: Quit\r\n");
     printf("--------------------------------------------------\r\n");
     printf("Enter command: ");
     fflush(stdout);
 
     char command = 0;
-    int ret;
 
     // Main command loop
     while (!g_terminate_flag) {
@@ -134,123 +295,8 @@ int main(int argc, char *argv[]) {
             command = (char)getchar();
             printf("\r\n"); // Echo command for clarity, then proceed
 
-            switch (command) {
-                case 'p':
-                    if (producer_created_count < MAX_PRODUCERS) {
-                        thread_args_t *args = malloc(sizeof(thread_args_t));
-                        if (!args) { print_error("Main", "Failed to allocate args for producer"); abort(); }
-                        args->id = producer_created_count + 1; // User-friendly 1-based ID
-                        args->queue = g_queue;
-                        args->sync_mode = g_sync_mode; // Pass current sync mode
-                        ret = pthread_create(&producer_threads[producer_created_count], NULL, producer_thread_func, args);
-                        if (ret == 0) {
-                            producer_created_count++;
-                            print_info("Main", "Producer thread created.");
-                        } else {
-                            errno = ret; print_error("Main", "pthread_create (producer) failed");
-                            free(args); // Free args if thread creation failed
-                        }
-                    } else { print_info("Main", "Maximum producer threads reached."); }
-                    break;
-                case 'c':
-                    if (consumer_created_count < MAX_CONSUMERS) {
-                        thread_args_t *args = malloc(sizeof(thread_args_t));
-                        if (!args) { print_error("Main", "Failed to allocate args for consumer"); abort(); }
-                        args->id = consumer_created_count + 1; // User-friendly 1-based ID
-                        args->queue = g_queue;
-                        args->sync_mode = g_sync_mode; // Pass current sync mode
-                        ret = pthread_create(&consumer_threads[consumer_created_count], NULL, consumer_thread_func, args);
-                        if (ret == 0) {
-                            consumer_created_count++;
-                            print_info("Main", "Consumer thread created.");
-                        } else {
-                            errno = ret; print_error("Main", "pthread_create (consumer) failed");
-                            free(args); // Free args if thread creation failed
-                        }
-                    } else { print_info("Main", "Maximum consumer threads reached."); }
-                    break;
-                case 'P':
-                    if (producer_created_count > 0) {
-                        int target_idx = producer_created_count - 1;
-                        pthread_t thread_to_cancel = producer_threads[target_idx];
-                        // The ID passed to the thread was `target_idx + 1`
-                        printf("[Main] Attempting to cancel producer thread (ID %d)...\r\n", target_idx + 1);
-
-                        int cancel_ret = pthread_cancel(thread_to_cancel);
-                        if (cancel_ret == 0) {
-                            // print_info("Main", "Cancellation request sent to producer thread.");
-                            void *join_res;
-                            int join_ret = pthread_join(thread_to_cancel, &join_res);
-                            if (join_ret == 0) {
-                                if (join_res == PTHREAD_CANCELED) {
-                                    printf("[Main] Producer thread (ID %d) successfully canceled and joined.\r\n", target_idx + 1);
-                                } else {
-                                    printf("[Main] Producer thread (ID %d) joined (exited normally, value: %p).\r\n", target_idx + 1, join_res);
-                                }
-                                producer_created_count--; // Successfully removed
-                                // The slot producer_threads[target_idx] can now be reused by a new thread.
-                            } else {
-                                errno = join_ret;
-                                print_error("Main", "pthread_join failed for canceled producer");
-                            }
-                        } else {
-                            errno = cancel_ret;
-                            print_error("Main", "pthread_cancel failed for last producer");
-                        }
-                    } else { print_info("Main", "No active producers to remove."); }
-                    break;
-                case 'C':
-                    if (consumer_created_count > 0) {
-                        int target_idx = consumer_created_count - 1;
-                        pthread_t thread_to_cancel = consumer_threads[target_idx];
-                        printf("[Main] Attempting to cancel consumer thread (ID %d)...\r\n", target_idx + 1);
-
-                        int cancel_ret = pthread_cancel(thread_to_cancel);
-                        if (cancel_ret == 0) {
-                            // print_info("Main", "Cancellation request sent to consumer thread.");
-                            void *join_res;
-                            int join_ret = pthread_join(thread_to_cancel, &join_res);
-                            if (join_ret == 0) {
-                                if (join_res == PTHREAD_CANCELED) {
-                                    printf("[Main] Consumer thread (ID %d) successfully canceled and joined.\r\n", target_idx + 1);
-                                } else {
-                                    printf("[Main] Consumer thread (ID %d) joined (exited normally, value: %p).\r\n", target_idx + 1, join_res);
-                                }
-                                consumer_created_count--; // Successfully removed
-                            } else {
-                                errno = join_ret;
-                                print_error("Main", "pthread_join failed for canceled consumer");
-                            }
-                        } else {
-                            errno = cancel_ret;
-                            print_error("Main", "pthread_cancel failed for last consumer");
-                        }
-                    } else { print_info("Main", "No active consumers to remove."); }
-                    break;
-                case '+': queue_resize(g_queue, RESIZE_STEP); break;
-                case '-': queue_resize(g_queue, -RESIZE_STEP); break;
-                case 's':
-                {
-                    size_t cap = queue_get_capacity(g_queue);
-                    size_t count = queue_get_count(g_queue);
-                    unsigned long added = queue_get_added_total(g_queue);
-                    unsigned long extracted = queue_get_extracted_total(g_queue);
-                    printf("\n--- System Status ---\r\n");
-                    printf("Mode:                %s\r\n", g_sync_mode == SYNC_MODE_SEM ? "Semaphores" : "CondVars");
-                    printf("Queue Capacity:      %zu\r\n", cap);
-                    printf("Queue Occupied:      %zu\r\n", count);
-                    printf("Queue Free:          %zu\r\n", cap > count ? cap - count : 0);
-                    printf("Total Added:         %lu\r\n", added);
-                    printf("Total Extracted:     %lu\r\n", extracted);
-                    printf("Active Producers:    %d / %d\r\n", producer_created_count, MAX_PRODUCERS);
-                    printf("Active Consumers:    %d / %d\r\n", consumer_created_count, MAX_CONSUMERS);
-                    printf("---------------------\r\n");
-                    fflush(stdout);
-                }
-                break;
-                case 'q': print_info("Main", "Quit command received..."); g_terminate_flag = 1; break;
-                default: printf("[Main] Unknown command: '%c'\r\n", command); break;
-            }
+            char line[2] = { command, '\0' };
+            execute_command(line, NULL, 0);
             if (!g_terminate_flag) { printf("Enter command: "); fflush(stdout); }
         }
 
@@ -274,10 +320,463 @@ int main(int argc, char *argv[]) {
  * Returns: None.
  */
 static void print_usage(const char *prog_name) {
-    fprintf(stderr, "Usage: %s [-m mode] [-h]\n", prog_name);
-    fprintf(stderr, "  -m mode : Synchronization mode ('sem' for semaphores (default), 'cond' for condition variables).\n");
-    fprintf(stderr, "            Default is 'sem'.\n");
-    fprintf(stderr, "  -h      : Print this help message and exit.\n");
+    config_print_usage(prog_name);
+}
+
+/*
+ * Purpose: Appends a formatted line to the command reply buffer, or prints it
+ *          as a "[Main]" message when the command came from the keyboard.
+ * Accepts: reply     - Reply buffer, or NULL for keyboard use.
+ *          reply_len - Size of the reply buffer.
+ *          fmt       - printf-style format of the line (without newline).
+ * Returns: None.
+ */
+static void command_reply(char *reply, size_t reply_len, const char *fmt, ...) {
+    char text[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(text, sizeof(text), fmt, ap);
+    va_end(ap);
+
+    if (!reply) {
+        printf("[Main] %s\r\n", text);
+        fflush(stdout);
+        return;
+    }
+    size_t used = strlen(reply);
+    if (used < reply_len) snprintf(reply + used, reply_len - used, "%s\n", text);
+}
+
+/*
+ * Purpose: Creates one producer or consumer thread and records it in the
+ *          matching thread array. Caller must hold command_mutex.
+ * Accepts: producer - true to create a producer, false for a consumer.
+ * Returns: 0 on success, -1 if the limit is reached or creation failed.
+ */
+static int spawn_worker(bool producer) {
+    pthread_t *threads = producer ? producer_threads : consumer_threads;
+    atomic_int *created = producer ? &producer_created_count : &consumer_created_count;
+    int max_threads = producer ? g_config.max_producers : g_config.max_consumers;
+    const char *role = producer ? "producer" : "consumer";
+
+    if (*created >= max_threads) {
+        printf("[Main] Maximum %s threads reached.\r\n", role);
+        fflush(stdout);
+        return -1;
+    }
+    thread_args_t *args = malloc(sizeof(thread_args_t));
+    if (!args) { print_error("Main", "Failed to allocate thread args"); abort(); }
+    args->id = *created + 1; // User-friendly 1-based ID
+    args->queue = g_queue;
+    args->sync_mode = g_sync_mode; // Pass current sync mode
+    int ret = pthread_create(&threads[*created], NULL, producer ? producer_thread_func : consumer_thread_func, args);
+    if (ret != 0) {
+        errno = ret;
+        printf("[Main] pthread_create (%s) failed.\r\n", role);
+        print_error("Main", "pthread_create failed");
+        free(args); // Free args if thread creation failed
+        return -1;
+    }
+    (*created)++;
+    printf("[Main] %s thread created.\r\n", producer ? "Producer" : "Consumer");
+    fflush(stdout);
+    return 0;
+}
+
+/*
+ * Purpose: Cancels and joins the most recently created producer or consumer
+ *          thread. Caller must hold command_mutex.
+ * Accepts: producer - true to remove a producer, false for a consumer.
+ * Returns: 0 on success, -1 if none is running or cancel/join failed.
+ */
+static int cancel_last_worker(bool producer) {
+    pthread_t *threads = producer ? producer_threads : consumer_threads;
+    atomic_int *created = producer ? &producer_created_count : &consumer_created_count;
+    const char *role = producer ? "Producer" : "Consumer";
+
+    if (*created <= 0) {
+        printf("[Main] No active %s threads to remove.\r\n", producer ? "producer" : "consumer");
+        fflush(stdout);
+        return -1;
+    }
+    int target_idx = *created - 1;
+    pthread_t thread_to_cancel = threads[target_idx];
+    // The ID passed to the thread was `target_idx + 1`
+    printf("[Main] Attempting to cancel %s thread (ID %d)...\r\n", producer ? "producer" : "consumer", target_idx + 1);
+
+    int cancel_ret = pthread_cancel(thread_to_cancel);
+    if (cancel_ret != 0) {
+        errno = cancel_ret;
+        print_error("Main", "pthread_cancel failed for last thread");
+        return -1;
+    }
+    void *join_res;
+    int join_ret = pthread_join(thread_to_cancel, &join_res);
+    if (join_ret != 0) {
+        errno = join_ret;
+        print_error("Main", "pthread_join failed for canceled thread");
+        return -1;
+    }
+    if (join_res == PTHREAD_CANCELED) {
+        printf("[Main] %s thread (ID %d) successfully canceled and joined.\r\n", role, target_idx + 1);
+    } else {
+        printf("[Main] %s thread (ID %d) joined (exited normally, value: %p).\r\n", role, target_idx + 1, join_res);
+    }
+    fflush(stdout);
+    (*created)--; // Successfully removed; the slot can now be reused by a new thread
+    return 0;
+}
+
+/*
+ * Purpose: Prints the human-readable status table for the 's' key, using the
+ *          lock-free queue stats snapshot.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void print_status(void) {
+    queue_stats_t st;
+    queue_get_stats_snapshot(g_queue, &st);
+    printf("\n--- System Status ---\r\n");
+    printf("Mode:                %s\r\n", st.mode == SYNC_MODE_SEM ? "Semaphores" : "CondVars");
+    printf("Queue Capacity:      %zu\r\n", st.capacity);
+    printf("Queue Occupied:      %zu\r\n", st.count);
+    printf("Queue Free:          %zu\r\n", st.capacity > st.count ? st.capacity - st.count : 0);
+    printf("Total Added:         %lu\r\n", st.added_total);
+    printf("Total Extracted:     %lu\r\n", st.extracted_total);
+    printf("Active Producers:    %d / %d\r\n", atomic_load(&producer_created_count), g_config.max_producers);
+    printf("Active Consumers:    %d / %d\r\n", atomic_load(&consumer_created_count), g_config.max_consumers);
+    printf("Rates (1s / 10s / 60s EWMA):\r\n");
+    report_rates(NULL, 0);
+    printf("Blocking Waits:\r\n");
+    report_waits(NULL, 0);
+    if (g_config.latency) {
+        printf("Latency (us):        p50 / p99 / p99.9 / max\r\n");
+        report_latency(NULL, 0);
+    }
+    lockprof_print_summary();
+    printf("---------------------\r\n");
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Reports end-to-end latency percentiles for every engine and
+ *          capacity class that has samples, one line each.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_latency(char *reply, size_t reply_len) {
+    int ret = pthread_mutex_lock(&report_mutex); PTHREAD_CHECK(ret, "Latency Report: Lock Mutex");
+    for (int m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        for (int e = 0; e < LATENCY_ENGINES; ++e) {
+            for (int c = 0; c < LATENCY_CAP_CLASSES; ++c) {
+                unsigned long n = latency_snapshot((latency_metric_t)m, (sync_mode_t)e, c, &report_hist);
+                if (n == 0) continue;
+                size_t lo = 0, hi = 0;
+                latency_cap_class_range(c, &lo, &hi);
+                double p50 = hist_percentile(&report_hist, 50.0) / 1000.0;
+                double p99 = hist_percentile(&report_hist, 99.0) / 1000.0;
+                double p999 = hist_percentile(&report_hist, 99.9) / 1000.0;
+                double max = atomic_load(&report_hist.max) / 1000.0;
+                if (reply) {
+                    command_reply(reply, reply_len, "latency %s %s %zu-%zu count %lu p50_us %.1f p99_us %.1f p999_us %.1f max_us %.1f",
+                                  latency_metric_name((latency_metric_t)m), queue_engine_name((sync_mode_t)e), lo, hi, n,
+                                  p50, p99, p999, max);
+                } else {
+                    printf("  %-9s %-4s cap %zu-%zu: %.1f / %.1f / %.1f / %.1f (n=%lu)\r\n",
+                           latency_metric_name((latency_metric_t)m), queue_engine_name((sync_mode_t)e), lo, hi,
+                           p50, p99, p999, max, n);
+                }
+            }
+        }
+    }
+    ret = pthread_mutex_unlock(&report_mutex); PTHREAD_CHECK(ret, "Latency Report: Unlock Mutex");
+}
+
+/*
+ * Purpose: Reports blocking-wait counts, blocked time and wait-duration
+ *          percentiles per role and, for replies, per live thread.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_waits(char *reply, size_t reply_len) {
+    int ret = pthread_mutex_lock(&report_mutex); PTHREAD_CHECK(ret, "Wait Report: Lock Mutex");
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        unsigned long waits = 0;
+        uint64_t wait_ns = 0;
+        thread_stats_role_waits((thread_role_t)r, &waits, &wait_ns, &report_hist);
+        double p50 = hist_percentile(&report_hist, 50.0) / 1000.0;
+        double p99 = hist_percentile(&report_hist, 99.0) / 1000.0;
+        double max = atomic_load(&report_hist.max) / 1000.0;
+        if (reply) {
+            command_reply(reply, reply_len, "wait %s count %lu blocked_ms %.1f p50_us %.1f p99_us %.1f p999_us %.1f max_us %.1f",
+                          thread_role_name((thread_role_t)r), waits, wait_ns / 1e6, p50, p99,
+                          hist_percentile(&report_hist, 99.9) / 1000.0, max);
+        } else {
+            printf("  %-9s %lu waits, %.1f ms blocked, p50 %.1f / p99 %.1f / max %.1f us\r\n",
+                   thread_role_name((thread_role_t)r), waits, wait_ns / 1e6, p50, p99, max);
+        }
+    }
+    ret = pthread_mutex_unlock(&report_mutex); PTHREAD_CHECK(ret, "Wait Report: Unlock Mutex");
+    if (!reply) return;
+
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire)) continue;
+        unsigned long waits = atomic_load_explicit(&ts->waits, memory_order_relaxed);
+        if (waits == 0) continue;
+        command_reply(reply, reply_len, "wait_thread %s %d count %lu blocked_ms %.1f p99_us %.1f max_us %.1f",
+                      thread_role_name((thread_role_t)atomic_load(&ts->role)), atomic_load(&ts->id), waits,
+                      atomic_load_explicit(&ts->wait_ns, memory_order_relaxed) / 1e6,
+                      hist_percentile(&ts->wait_hist, 99.0) / 1000.0,
+                      atomic_load_explicit(&ts->wait_hist.max, memory_order_relaxed) / 1000.0);
+    }
+}
+
+/*
+ * Purpose: Reports 1 s / 10 s / 60 s message and byte rates overall, per
+ *          role and per live producer or consumer.
+ * Accepts: reply     - Reply buffer, or NULL to print status-table lines.
+ *          reply_len - Size of the reply buffer.
+ * Returns: None.
+ */
+static void report_rates(char *reply, size_t reply_len) {
+    rate_t rate;
+    for (int r = -1; r < THREAD_ROLE_CONTROL; ++r) { // -1 is the overall line
+        const char *name = r < 0 ? "total" : thread_role_name((thread_role_t)r);
+        if (r < 0) rates_get_total(&rate);
+        else rates_get_role((thread_role_t)r, &rate);
+        if (reply) {
+            command_reply(reply, reply_len, "rate %s msgs_1s %.1f msgs_10s %.1f msgs_60s %.1f bytes_1s %.0f bytes_10s %.0f bytes_60s %.0f",
+                          name, rate.msgs[0], rate.msgs[1], rate.msgs[2], rate.bytes[0], rate.bytes[1], rate.bytes[2]);
+        } else {
+            printf("  %-9s %9.1f / %9.1f / %9.1f msg/s  %11.0f / %11.0f / %11.0f B/s\r\n",
+                   name, rate.msgs[0], rate.msgs[1], rate.msgs[2], rate.bytes[0], rate.bytes[1], rate.bytes[2]);
+        }
+    }
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_role_t role;
+        int id;
+        if (!rates_get_thread(i, &rate, &role, &id)) continue;
+        if (reply) {
+            command_reply(reply, reply_len, "rate_thread %s %d msgs_1s %.1f msgs_10s %.1f msgs_60s %.1f bytes_1s %.0f bytes_10s %.0f bytes_60s %.0f",
+                          thread_role_name(role), id, rate.msgs[0], rate.msgs[1], rate.msgs[2],
+                          rate.bytes[0], rate.bytes[1], rate.bytes[2]);
+        } else {
+            printf("  %c%-8d %9.1f / %9.1f / %9.1f msg/s  %11.0f / %11.0f / %11.0f B/s\r\n",
+                   role == THREAD_ROLE_PRODUCER ? 'P' : 'C', id, rate.msgs[0], rate.msgs[1], rate.msgs[2],
+                   rate.bytes[0], rate.bytes[1], rate.bytes[2]);
+        }
+    }
+}
+
+/*
+ * Purpose: Parses an optional positive count argument of a command.
+ * Accepts: arg      - The argument token, or NULL if absent.
+ *          fallback - Value used when the argument is absent.
+ *          out      - Where to store the parsed value.
+ * Returns: 0 on success, -1 if the argument is not a positive integer.
+ */
+static int parse_count_arg(const char *arg, long fallback, long *out) {
+    if (!arg) { *out = fallback; return 0; }
+    char *end = NULL;
+    errno = 0;
+    long val = strtol(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || val <= 0) return -1;
+    *out = val;
+    return 0;
+}
+
+/*
+ * Purpose: Parses and executes one command line (single-key form such as "p"
+ *          or the parameterized form such as "add-producers 3"). Used both by
+ *          the keyboard loop and as the control socket handler.
+ * Accepts: line      - The command line, without trailing newline.
+ *          reply     - Buffer for the reply text, or NULL for keyboard use
+ *                      (results are then printed to stdout).
+ *          reply_len - Size of the reply buffer.
+ * Returns: 0 on success, -1 on failure or unknown command.
+ */
+static int execute_command(const char *line, char *reply, size_t reply_len) {
+    char buf[CONTROL_LINE_MAX];
+    snprintf(buf, sizeof(buf), "%s", line);
+    char *save = NULL;
+    char *cmd = strtok_r(buf, " \t", &save);
+    char *arg1 = cmd ? strtok_r(NULL, " \t", &save) : NULL;
+    char *arg2 = arg1 ? strtok_r(NULL, " \t", &save) : NULL;
+    char *arg3 = arg2 ? strtok_r(NULL, " \t", &save) : NULL;
+    if (!cmd) return 0;
+
+    // Status and quit never touch the thread arrays, so they skip command_mutex
+    if (strcmp(cmd, "s") == 0 || strcmp(cmd, "status") == 0) {
+        if (!reply) { print_status(); return 0; }
+        queue_stats_t st;
+        queue_get_stats_snapshot(g_queue, &st);
+        command_reply(reply, reply_len, "mode %s", queue_engine_name(st.mode));
+        command_reply(reply, reply_len, "capacity %zu", st.capacity);
+        command_reply(reply, reply_len, "count %zu", st.count);
+        command_reply(reply, reply_len, "added_total %lu", st.added_total);
+        command_reply(reply, reply_len, "extracted_total %lu", st.extracted_total);
+        command_reply(reply, reply_len, "resize_total %lu", st.resize_total);
+        command_reply(reply, reply_len, "swap_total %lu", st.swap_total);
+        command_reply(reply, reply_len, "hash_failures %lu", consumer_hash_failures());
+        command_reply(reply, reply_len, "producers %d", atomic_load(&producer_created_count));
+        command_reply(reply, reply_len, "consumers %d", atomic_load(&consumer_created_count));
+        command_reply(reply, reply_len, "producer_think_us %ld %ld",
+                      atomic_load(&g_producer_think.min_us), atomic_load(&g_producer_think.max_us));
+        command_reply(reply, reply_len, "consumer_think_us %ld %ld",
+                      atomic_load(&g_consumer_think.min_us), atomic_load(&g_consumer_think.max_us));
+        unsigned long log_dropped = 0, log_suppressed = 0;
+        log_get_counters(&log_dropped, &log_suppressed);
+        command_reply(reply, reply_len, "log_dropped %lu", log_dropped);
+        command_reply(reply, reply_len, "log_suppressed %lu", log_suppressed);
+        report_rates(reply, reply_len);
+        report_waits(reply, reply_len);
+        if (g_config.latency) report_latency(reply, reply_len);
+        for (int i = 0; lockprof_enabled() && i < LOCK_SITE_COUNT; ++i) {
+            lock_site_stats_t ls;
+            lockprof_get((lock_site_t)i, &ls);
+            command_reply(reply, reply_len, "lock %s acquisitions %lu contended %lu wait_ms %.3f hold_ms %.3f max_wait_us %.1f max_hold_us %.1f",
+                          lockprof_site_name((lock_site_t)i), ls.acquisitions, ls.contended, ls.wait_ns / 1e6,
+                          ls.hold_ns / 1e6, ls.max_wait_ns / 1000.0, ls.max_hold_ns / 1000.0);
+        }
+        command_reply(reply, reply_len, "OK");
+        return 0;
+    }
+    if (strcmp(cmd, "q") == 0 || strcmp(cmd, "quit") == 0) {
+        print_info("Main", "Quit command received...");
+        g_terminate_flag = 1;
+        if (reply) command_reply(reply, reply_len, "OK");
+        return 0;
+    }
+    if (strcmp(cmd, "help") == 0) {
+        command_reply(reply, reply_len, "p|add-producers [K]   c|add-consumers [K]");
+        command_reply(reply, reply_len, "P|remove-producers [K] C|remove-consumers [K]");
+        command_reply(reply, reply_len, "+|grow [N]  -|shrink [N]  resize N");
+        command_reply(reply, reply_len, "rate producer|consumer MIN_US MAX_US");
+        command_reply(reply, reply_len, "m|engine [sem|cond]  (no argument toggles)");
+        command_reply(reply, reply_len, "trace on|off  (requires --trace-dir)");
+        command_reply(reply, reply_len, "occupancy-dump [PATH]  (requires --occupancy-us)");
+        command_reply(reply, reply_len, "s|status  q|quit  help");
+        if (reply) command_reply(reply, reply_len, "OK");
+        return 0;
+    }
+
+    int result = 0;
+    long n = 0;
+    bool add_prod = strcmp(cmd, "p") == 0 || strcmp(cmd, "add-producers") == 0;
+    bool add_cons = strcmp(cmd, "c") == 0 || strcmp(cmd, "add-consumers") == 0;
+    bool rm_prod = strcmp(cmd, "P") == 0 || strcmp(cmd, "remove-producers") == 0;
+    bool rm_cons = strcmp(cmd, "C") == 0 || strcmp(cmd, "remove-consumers") == 0;
+    bool grow = strcmp(cmd, "+") == 0 || strcmp(cmd, "grow") == 0;
+    bool shrink = strcmp(cmd, "-") == 0 || strcmp(cmd, "shrink") == 0;
+    bool blocking = grow || shrink || strcmp(cmd, "resize") == 0 || strcmp(cmd, "m") == 0 || strcmp(cmd, "engine") == 0;
+    pthread_mutex_t *cmd_lock = blocking ? &resize_mutex : &command_mutex;
+    int ret_lock = pthread_mutex_lock(cmd_lock); PTHREAD_CHECK(ret_lock, "Command: Lock Mutex");
+
+    if (add_prod || add_cons || rm_prod || rm_cons) {
+        if (parse_count_arg(arg1, 1, &n) == -1) {
+            command_reply(reply, reply_len, "ERR invalid count '%s'", arg1);
+            result = -1;
+        } else {
+            long done = 0;
+            for (long i = 0; i < n; ++i) {
+                int r = (add_prod || add_cons) ? spawn_worker(add_prod) : cancel_last_worker(rm_prod);
+                if (r == -1) break;
+                done++;
+            }
+            if (done < n) result = -1;
+            if (reply) {
+                if (done == n) command_reply(reply, reply_len, "OK %ld", done);
+                else command_reply(reply, reply_len, "ERR completed %ld of %ld", done, n);
+            }
+        }
+    } else if (grow || shrink) {
+        if (parse_count_arg(arg1, g_config.resize_step, &n) == -1 || n > (long)g_config.max_capacity) {
+            command_reply(reply, reply_len, "ERR invalid step '%s'", arg1);
+            result = -1;
+        } else {
+            result = queue_resize(g_queue, grow ? (int)n : -(int)n);
+            if (reply) command_reply(reply, reply_len, result == 0 ? "OK" : "ERR resize failed");
+        }
+    } else if (strcmp(cmd, "resize") == 0) {
+        if (!arg1 || parse_count_arg(arg1, 0, &n) == -1 || n < (long)g_config.min_capacity || n > (long)g_config.max_capacity) {
+            command_reply(reply, reply_len, "ERR capacity must be %zu..%zu", g_config.min_capacity, g_config.max_capacity);
+            result = -1;
+        } else {
+            long delta = n - (long)queue_get_capacity(g_queue);
+            if (delta != 0) result = queue_resize(g_queue, (int)delta);
+            if (reply) command_reply(reply, reply_len, result == 0 ? "OK" : "ERR resize failed");
+        }
+    } else if (strcmp(cmd, "m") == 0 || strcmp(cmd, "engine") == 0) {
+        sync_mode_t current = (sync_mode_t)atomic_load(&g_queue->mode);
+        sync_mode_t target = current == SYNC_MODE_SEM ? SYNC_MODE_CONDVAR : SYNC_MODE_SEM; // Toggle by default
+        bool valid = true;
+        if (arg1 && strcmp(arg1, "sem") == 0) target = SYNC_MODE_SEM;
+        else if (arg1 && strcmp(arg1, "cond") == 0) target = SYNC_MODE_CONDVAR;
+        else if (arg1) valid = false;
+        uint64_t pause_ns = 0;
+        if (!valid) {
+            command_reply(reply, reply_len, "ERR usage: engine [sem|cond]");
+            result = -1;
+        } else if (queue_swap_engine(g_queue, target, &pause_ns) == -1) {
+            if (reply) command_reply(reply, reply_len, "ERR engine swap failed");
+            result = -1;
+        } else {
+            ret_lock = pthread_mutex_lock(&command_mutex); PTHREAD_CHECK(ret_lock, "Command: Lock Mutex");
+            g_sync_mode = target; // Handed to threads created from now on
+            int ret_mode = pthread_mutex_unlock(&command_mutex); PTHREAD_CHECK(ret_mode, "Command: Unlock Mutex");
+            if (reply) command_reply(reply, reply_len, "OK %s pause_us %.1f", queue_engine_name(target), (double)pause_ns / 1e3);
+        }
+    } else if (strcmp(cmd, "trace") == 0) {
+        bool on = arg1 && strcmp(arg1, "on") == 0;
+        if (!arg1 || (!on && strcmp(arg1, "off") != 0)) {
+            command_reply(reply, reply_len, "ERR usage: trace on|off");
+            result = -1;
+        } else if (trace_set_active(on) == -1) {
+            command_reply(reply, reply_len, "ERR tracing not configured (start with --trace-dir)");
+            result = -1;
+        } else {
+            command_reply(reply, reply_len, reply ? "OK" : "Tracing updated.");
+        }
+    } else if (strcmp(cmd, "occupancy-dump") == 0) {
+        const char *path = arg1 ? arg1 : g_config.occupancy_csv;
+        size_t rows = 0;
+        if (path[0] == '\0') {
+            command_reply(reply, reply_len, "ERR usage: occupancy-dump PATH (no --occupancy-csv configured)");
+            result = -1;
+        } else if (occupancy_dump(path, &rows) == -1) {
+            if (errno == ENODATA) command_reply(reply, reply_len, "ERR occupancy sampler not running (start with --occupancy-us)");
+            else command_reply(reply, reply_len, "ERR cannot write '%s': %s", path, strerror(errno));
+            result = -1;
+        } else {
+            if (reply) command_reply(reply, reply_len, "OK %zu samples", rows);
+            else printf("[Main] Wrote %zu occupancy samples to %s.\r\n", rows, path);
+        }
+    } else if (strcmp(cmd, "rate") == 0) {
+        think_time_t *think = NULL;
+        if (arg1 && strcmp(arg1, "producer") == 0) think = &g_producer_think;
+        else if (arg1 && strcmp(arg1, "consumer") == 0) think = &g_consumer_think;
+        char *end1 = NULL, *end2 = NULL;
+        long min_us = arg2 ? strtol(arg2, &end1, 10) : -1;
+        long max_us = arg3 ? strtol(arg3, &end2, 10) : -1;
+        if (!think || !arg3 || *end1 != '\0' || *end2 != '\0' || min_us < 0 || max_us < min_us) {
+            command_reply(reply, reply_len, "ERR usage: rate producer|consumer MIN_US MAX_US");
+            result = -1;
+        } else {
+            atomic_store(&think->min_us, min_us);
+            atomic_store(&think->max_us, max_us);
+            command_reply(reply, reply_len, reply ? "OK" : "Think time updated.");
+        }
+    } else {
+        if (!reply) printf("[Main] Unknown command: '%s'\r\n", cmd);
+        else command_reply(reply, reply_len, "ERR unknown command '%s'", cmd);
+        result = -1;
+    }
+
+    int ret_unlock = pthread_mutex_unlock(cmd_lock); PTHREAD_CHECK(ret_unlock, "Command: Unlock Mutex");
+    return result;
 }
 
 /*
@@ -338,37 +837,16 @@ static void cleanup_threads(void) {
     print_info("Cleanup", "Starting cleanup via atexit...");
     restore_terminal(); // Restore terminal settings first, important for user visibility
     g_terminate_flag = 1; // Ensure flag is globally set for all threads
+    control_stop(wake_queue_waiters); // No new commands may arrive while threads are being joined
+    watchdog_stop();
+    occupancy_stop(); // Writes the exit CSV; before queue_destroy, the sampler reads the queue
+    stats_shm_stop(); // Before rates_stop and queue_destroy: the publisher reads both
+    metrics_stop(); // Before rates_stop and queue_destroy: scrapes read both
+    rates_stop();
 
     if (g_queue) {
         print_info("Cleanup", "Signaling sync primitives to unblock any waiting threads...");
-        if (g_sync_mode == SYNC_MODE_CONDVAR) {
-            // Best effort to lock, broadcast, and unlock.
-            // Mutex might be in an inconsistent state if program crashed badly,
-            // but pthread_cond_broadcast is the correct way to wake waiters.
-            int ret_lock = pthread_mutex_trylock(&g_queue->mutex); // Use trylock to avoid deadlock if mutex is held
-            if (ret_lock == 0) {
-                pthread_cond_broadcast(&g_queue->not_empty);
-                pthread_cond_broadcast(&g_queue->not_full);
-                pthread_mutex_unlock(&g_queue->mutex);
-            } else if (ret_lock == EBUSY) {
-                print_error("Cleanup", "Queue mutex busy during cond_broadcast attempt. Threads might not wake immediately.");
-            } else {
-                errno = ret_lock; print_error("Cleanup", "Failed to trylock queue mutex for cond_broadcast");
-            }
-        } else { // SYNC_MODE_SEM
-            // Post semaphores generously. sem_post is safe to call multiple times.
-            // This helps unblock any threads stuck in sem_wait.
-            for (int i = 0; i < (MAX_PRODUCERS + MAX_CONSUMERS + 5); ++i) { // A few extra posts
-                if (sem_post(&g_queue->empty_slots) == -1 && errno != EINVAL) {
-                    // EINVAL means semaphore is already destroyed, which is possible if cleanup runs multiple times
-                    // or after an error. Other errors are more problematic.
-                    // print_error("Cleanup", "sem_post(empty_slots) failed");
-                }
-                if (sem_post(&g_queue->full_slots) == -1 && errno != EINVAL) {
-                    // print_error("Cleanup", "sem_post(full_slots) failed");
-                }
-            }
-        }
+        wake_queue_waiters();
     }
 
     // Join all *remaining* created threads
@@ -408,7 +886,24 @@ static void cleanup_threads(void) {
         g_queue = NULL;
     }
 
+    trace_stop();
+    log_stop(); // Every thread that logs asynchronously has been joined
+    lockprof_print_summary();
+    perfctr_print_summary(); // Every worker has stopped its counters
     print_info("Cleanup", "Cleanup complete.");
     fflush(stdout); // Ensure all messages are printed
     fflush(stderr);
 }
+
+/*
+ * Purpose: Wakes every thread blocked in the queue so it can observe
+ *          g_terminate_flag. Also the control socket's stop callback.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void wake_queue_waiters(void) {
+    if (!g_queue) return;
+    // Wake waiters of every engine; a swap may have changed it since startup.
+    // Semaphores are posted generously: sem_post is safe to call many times.
+    queue_wake_all(g_queue, PRODUCER_THREAD_LIMIT + CONSUMER_THREAD_LIMIT + 5);
+}
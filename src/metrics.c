@@ -0,0 +1,394 @@
+#include "metrics.h"
+#include "queue_manager.h"
+#include "consumer.h"
+#include "thread_stats.h"
+#include "latency.h"
+#include "rates.h"
+#include "log.h"
+#include <stdarg.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// --- Constants ---
+#define METRICS_HIST_MIN_SHIFT 10 // Smallest exported bucket bound: 2^10 ns (~1 us)
+#define METRICS_HIST_MAX_SHIFT 36 // Largest finite bucket bound: 2^36 ns (~69 s)
+
+// --- Static Variables ---
+typedef struct metrics_buf_s {
+    char *data;
+    size_t len;
+    size_t cap;
+    bool failed; // An allocation failed; the response is dropped
+} metrics_buf_t;
+
+static int unix_fd = -1;
+static int tcp_fd = -1;
+static char bound_path[108];
+static pthread_t metrics_thread;
+static bool metrics_running = false;
+static atomic_bool metrics_stop_requested = false;
+static queue_t *exported_queue = NULL;
+static hist_t scratch_hist; // Only the metrics thread uses it
+
+// --- Internal Helper Function Declarations ---
+static void* metrics_thread_func(void *arg);
+static void metrics_serve(int listen_fd);
+static void metrics_render(metrics_buf_t *buf);
+static void metrics_put_hist(metrics_buf_t *buf, const char *name, const char *labels, const hist_t *h);
+static void metrics_appendf(metrics_buf_t *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static int metrics_send_all(int fd, const char *data, size_t len);
+static void metrics_close_listeners(void);
+
+/*
+ * Purpose: Starts the metrics thread, which answers every HTTP request on a
+ *          UNIX-domain socket and/or a 127.0.0.1 TCP port with a Prometheus
+ *          text exposition. Scrapes read only lock-free snapshots and
+ *          per-thread counters, never the queue mutex.
+ * Accepts: q           - Pointer to the queue to export.
+ *          socket_path - UNIX socket path, or "" for none.
+ *          port        - TCP port on 127.0.0.1, or 0 for none.
+ * Returns: 0 on success (or when both listeners are disabled), -1 on failure
+ *          (prints error message).
+ */
+int metrics_start(queue_t *q, const char *socket_path, int port) {
+    if (!q || !socket_path) { errno = EINVAL; print_error("Metrics", "NULL queue or socket path."); return -1; }
+    if (metrics_running || (socket_path[0] == '\0' && port == 0)) return 0;
+    exported_queue = q;
+
+    if (socket_path[0] != '\0') {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(socket_path) >= sizeof(addr.sun_path) || strlen(socket_path) >= sizeof(bound_path)) {
+            errno = ENAMETOOLONG; print_error("Metrics", "Socket path too long"); return -1;
+        }
+        strcpy(addr.sun_path, socket_path);
+        unix_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (unix_fd == -1) { print_error("Metrics", "socket (unix) failed"); return -1; }
+        if (unlink(socket_path) == -1 && errno != ENOENT) { print_error("Metrics", "unlink of stale socket failed"); goto cleanup; }
+        if (bind(unix_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) { print_error("Metrics", "bind (unix) failed"); goto cleanup; }
+        strcpy(bound_path, socket_path);
+        if (listen(unix_fd, 4) == -1) { print_error("Metrics", "listen (unix) failed"); goto cleanup; }
+    }
+
+    if (port > 0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never exposed beyond the host
+        tcp_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (tcp_fd == -1) { print_error("Metrics", "socket (tcp) failed"); goto cleanup; }
+        int one = 1;
+        setsockopt(tcp_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(tcp_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) { print_error("Metrics", "bind (tcp) failed"); goto cleanup; }
+        if (listen(tcp_fd, 4) == -1) { print_error("Metrics", "listen (tcp) failed"); goto cleanup; }
+    }
+
+    atomic_store(&metrics_stop_requested, false);
+    int ret = pthread_create(&metrics_thread, NULL, metrics_thread_func, NULL);
+    if (ret != 0) { errno = ret; print_error("Metrics", "pthread_create (metrics) failed"); goto cleanup; }
+    metrics_running = true;
+
+    char info[sizeof(bound_path) + 64];
+    if (bound_path[0] != '\0' && port > 0) snprintf(info, sizeof(info), "Serving Prometheus metrics on %s and 127.0.0.1:%d.", bound_path, port);
+    else if (port > 0) snprintf(info, sizeof(info), "Serving Prometheus metrics on 127.0.0.1:%d.", port);
+    else snprintf(info, sizeof(info), "Serving Prometheus metrics on %s.", bound_path);
+    print_info("Metrics", info);
+    return 0;
+
+    cleanup:
+    metrics_close_listeners();
+    return -1;
+}
+
+/*
+ * Purpose: Stops the metrics thread, closes the listeners and unlinks the
+ *          socket file. Safe to call when the exporter was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void metrics_stop(void) {
+    if (!metrics_running) return;
+    atomic_store(&metrics_stop_requested, true);
+    int ret = pthread_join(metrics_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("Metrics", "pthread_join (metrics) failed"); }
+    metrics_running = false;
+    metrics_close_listeners();
+    print_info("Metrics", "Metrics exporter stopped.");
+}
+
+/*
+ * Purpose: Metrics thread body. Polls the listeners with a short timeout so
+ *          a stop request is noticed promptly, and serves one scrape at a
+ *          time.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* metrics_thread_func(void *arg) {
+    (void)arg;
+    struct pollfd fds[2];
+    while (!atomic_load(&metrics_stop_requested)) {
+        nfds_t nfds = 0;
+        if (unix_fd != -1) { fds[nfds].fd = unix_fd; fds[nfds].events = POLLIN; fds[nfds].revents = 0; nfds++; }
+        if (tcp_fd != -1) { fds[nfds].fd = tcp_fd; fds[nfds].events = POLLIN; fds[nfds].revents = 0; nfds++; }
+
+        int ready = poll(fds, nfds, 200); // 200ms, keeps stop latency low
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            print_error("Metrics", "poll failed");
+            break;
+        }
+        for (nfds_t i = 0; ready > 0 && i < nfds; ++i) {
+            if (fds[i].revents & POLLIN) metrics_serve(fds[i].fd);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Accepts one connection, reads the request header (any method and
+ *          path are answered the same way) and sends the exposition as an
+ *          HTTP/1.0 response, then closes the connection.
+ * Accepts: listen_fd - The listener with a pending connection.
+ * Returns: None.
+ */
+static void metrics_serve(int listen_fd) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd == -1) {
+        if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) print_error("Metrics", "accept failed");
+        return;
+    }
+    // Non-blocking so a scraper that stops reading cannot park send() forever;
+    // both directions wait in poll() for at most METRICS_IO_TIMEOUT_MS instead
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        print_error("Metrics", "fcntl O_NONBLOCK failed");
+        close(fd);
+        return;
+    }
+
+    char request[METRICS_REQUEST_MAX];
+    size_t used = 0;
+    while (used < sizeof(request) - 1) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) <= 0) break;
+        ssize_t n = recv(fd, request + used, sizeof(request) - 1 - used, 0);
+        if (n == -1 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0) break;
+        used += (size_t)n;
+        request[used] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+
+    metrics_buf_t body = { NULL, 0, 0, false };
+    metrics_render(&body);
+    if (!body.failed) {
+        char header[160];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", body.len);
+        if (metrics_send_all(fd, header, (size_t)header_len) == 0) metrics_send_all(fd, body.data, body.len);
+    } else {
+        const char error[] = "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        metrics_send_all(fd, error, sizeof(error) - 1);
+    }
+    free(body.data);
+    close(fd);
+}
+
+/*
+ * Purpose: Renders the full exposition: queue gauges and counters, thread
+ *          counts, rates, wait histograms per role, latency histograms per
+ *          engine and capacity class, hash failures and logger counters.
+ * Accepts: buf - Buffer to append to.
+ * Returns: None.
+ */
+static void metrics_render(metrics_buf_t *buf) {
+    queue_stats_t st;
+    queue_get_stats_snapshot(exported_queue, &st);
+
+    metrics_appendf(buf, "# HELP pcq_queue_depth Messages currently in the queue.\n# TYPE pcq_queue_depth gauge\n");
+    metrics_appendf(buf, "pcq_queue_depth %zu\n", st.count);
+    metrics_appendf(buf, "# HELP pcq_queue_capacity Current queue capacity.\n# TYPE pcq_queue_capacity gauge\n");
+    metrics_appendf(buf, "pcq_queue_capacity %zu\n", st.capacity);
+    metrics_appendf(buf, "# HELP pcq_sync_engine Active synchronization engine (1 for the active one).\n# TYPE pcq_sync_engine gauge\n");
+    metrics_appendf(buf, "pcq_sync_engine{engine=\"sem\"} %d\n", st.mode == SYNC_MODE_SEM);
+    metrics_appendf(buf, "pcq_sync_engine{engine=\"cond\"} %d\n", st.mode == SYNC_MODE_CONDVAR);
+    metrics_appendf(buf, "# HELP pcq_messages_added_total Messages added to the queue.\n# TYPE pcq_messages_added_total counter\n");
+    metrics_appendf(buf, "pcq_messages_added_total %lu\n", st.added_total);
+    metrics_appendf(buf, "# HELP pcq_messages_extracted_total Messages removed from the queue.\n# TYPE pcq_messages_extracted_total counter\n");
+    metrics_appendf(buf, "pcq_messages_extracted_total %lu\n", st.extracted_total);
+    metrics_appendf(buf, "# HELP pcq_resizes_total Completed capacity changes.\n# TYPE pcq_resizes_total counter\n");
+    metrics_appendf(buf, "pcq_resizes_total %lu\n", st.resize_total);
+    metrics_appendf(buf, "# HELP pcq_engine_swaps_total Completed sync engine swaps.\n# TYPE pcq_engine_swaps_total counter\n");
+    metrics_appendf(buf, "pcq_engine_swaps_total %lu\n", st.swap_total);
+    metrics_appendf(buf, "# HELP pcq_hash_failures_total Messages that failed hash verification.\n# TYPE pcq_hash_failures_total counter\n");
+    metrics_appendf(buf, "pcq_hash_failures_total %lu\n", consumer_hash_failures());
+    metrics_appendf(buf, "# HELP pcq_queue_waiters Threads blocked in a queue wait.\n# TYPE pcq_queue_waiters gauge\n");
+    metrics_appendf(buf, "pcq_queue_waiters{role=\"producer\"} %d\n", st.waiting_producers);
+    metrics_appendf(buf, "pcq_queue_waiters{role=\"consumer\"} %d\n", st.waiting_consumers);
+    metrics_appendf(buf, "pcq_queue_waiters{role=\"resizer\"} %d\n", st.waiting_resizers);
+
+    int threads[THREAD_ROLE_COUNT] = { 0 };
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        if (!atomic_load_explicit(&g_thread_stats[i].in_use, memory_order_acquire)) continue;
+        int role = atomic_load(&g_thread_stats[i].role);
+        if (role >= 0 && role < THREAD_ROLE_COUNT) threads[role]++;
+    }
+    metrics_appendf(buf, "# HELP pcq_threads Registered threads per role.\n# TYPE pcq_threads gauge\n");
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        metrics_appendf(buf, "pcq_threads{role=\"%s\"} %d\n", thread_role_name((thread_role_t)r), threads[r]);
+    }
+
+    metrics_appendf(buf, "# HELP pcq_role_messages_total Queue operations per role, exited threads included.\n# TYPE pcq_role_messages_total counter\n");
+    for (int r = 0; r < THREAD_ROLE_CONTROL; ++r) {
+        unsigned long messages = 0;
+        thread_stats_role_totals((thread_role_t)r, &messages, NULL);
+        metrics_appendf(buf, "pcq_role_messages_total{role=\"%s\"} %lu\n", thread_role_name((thread_role_t)r), messages);
+    }
+    metrics_appendf(buf, "# HELP pcq_role_bytes_total Payload bytes per role, exited threads included.\n# TYPE pcq_role_bytes_total counter\n");
+    for (int r = 0; r < THREAD_ROLE_CONTROL; ++r) {
+        unsigned long bytes = 0;
+        thread_stats_role_totals((thread_role_t)r, NULL, &bytes);
+        metrics_appendf(buf, "pcq_role_bytes_total{role=\"%s\"} %lu\n", thread_role_name((thread_role_t)r), bytes);
+    }
+
+    metrics_appendf(buf, "# HELP pcq_rate_messages_per_second EWMA of queue operations per second.\n# TYPE pcq_rate_messages_per_second gauge\n");
+    for (int r = 0; r < THREAD_ROLE_CONTROL; ++r) {
+        rate_t rate;
+        rates_get_role((thread_role_t)r, &rate);
+        for (int w = 0; w < RATE_WINDOWS; ++w) {
+            metrics_appendf(buf, "pcq_rate_messages_per_second{role=\"%s\",window=\"%s\"} %.3f\n",
+                            thread_role_name((thread_role_t)r), rates_window_name(w), rate.msgs[w]);
+        }
+    }
+    metrics_appendf(buf, "# HELP pcq_rate_bytes_per_second EWMA of payload bytes per second.\n# TYPE pcq_rate_bytes_per_second gauge\n");
+    for (int r = 0; r < THREAD_ROLE_CONTROL; ++r) {
+        rate_t rate;
+        rates_get_role((thread_role_t)r, &rate);
+        for (int w = 0; w < RATE_WINDOWS; ++w) {
+            metrics_appendf(buf, "pcq_rate_bytes_per_second{role=\"%s\",window=\"%s\"} %.1f\n",
+                            thread_role_name((thread_role_t)r), rates_window_name(w), rate.bytes[w]);
+        }
+    }
+
+    metrics_appendf(buf, "# HELP pcq_wait_seconds Duration of queue waits that blocked.\n# TYPE pcq_wait_seconds histogram\n");
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        char labels[64];
+        thread_stats_role_waits((thread_role_t)r, NULL, NULL, &scratch_hist);
+        snprintf(labels, sizeof(labels), "role=\"%s\"", thread_role_name((thread_role_t)r));
+        metrics_put_hist(buf, "pcq_wait_seconds", labels, &scratch_hist);
+    }
+
+    metrics_appendf(buf, "# HELP pcq_latency_seconds Time from queue_add call to dequeue or end of processing.\n# TYPE pcq_latency_seconds histogram\n");
+    for (int m = 0; m < LATENCY_METRIC_COUNT; ++m) {
+        for (int e = 0; e < LATENCY_ENGINES; ++e) {
+            for (int c = 0; c < LATENCY_CAP_CLASSES; ++c) {
+                if (latency_snapshot((latency_metric_t)m, (sync_mode_t)e, c, &scratch_hist) == 0) continue;
+                size_t lo = 0, hi = 0;
+                char labels[128];
+                latency_cap_class_range(c, &lo, &hi);
+                snprintf(labels, sizeof(labels), "stage=\"%s\",engine=\"%s\",capacity=\"%zu-%zu\"",
+                         latency_metric_name((latency_metric_t)m), queue_engine_name((sync_mode_t)e), lo, hi);
+                metrics_put_hist(buf, "pcq_latency_seconds", labels, &scratch_hist);
+            }
+        }
+    }
+
+    unsigned long log_dropped = 0, log_suppressed = 0;
+    log_get_counters(&log_dropped, &log_suppressed);
+    metrics_appendf(buf, "# HELP pcq_log_lines_dropped_total Log lines lost to full rings.\n# TYPE pcq_log_lines_dropped_total counter\n");
+    metrics_appendf(buf, "pcq_log_lines_dropped_total %lu\n", log_dropped);
+    metrics_appendf(buf, "# HELP pcq_log_lines_suppressed_total Log lines over the rate limit.\n# TYPE pcq_log_lines_suppressed_total counter\n");
+    metrics_appendf(buf, "pcq_log_lines_suppressed_total %lu\n", log_suppressed);
+}
+
+/*
+ * Purpose: Appends one histogram series: cumulative buckets at powers of two
+ *          nanoseconds (exact bucket boundaries of hist_t), +Inf, sum and
+ *          count, all in seconds.
+ * Accepts: buf    - Buffer to append to.
+ *          name   - Metric family name.
+ *          labels - Label pairs without braces (e.g. role="producer").
+ *          h      - The histogram.
+ * Returns: None.
+ */
+static void metrics_put_hist(metrics_buf_t *buf, const char *name, const char *labels, const hist_t *h) {
+    for (int shift = METRICS_HIST_MIN_SHIFT; shift <= METRICS_HIST_MAX_SHIFT; ++shift) {
+        uint64_t bound = 1ULL << shift;
+        metrics_appendf(buf, "%s_bucket{%s,le=\"%.9g\"} %lu\n", name, labels, (double)bound / 1e9, hist_count_below(h, bound));
+    }
+    unsigned long count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    metrics_appendf(buf, "%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, count);
+    metrics_appendf(buf, "%s_sum{%s} %.9f\n", name, labels, (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e9);
+    metrics_appendf(buf, "%s_count{%s} %lu\n", name, labels, count);
+}
+
+/*
+ * Purpose: Appends formatted text to a growable buffer.
+ * Accepts: buf - Buffer to append to (marked failed if it cannot grow).
+ *          fmt - printf-style format.
+ * Returns: None.
+ */
+static void metrics_appendf(metrics_buf_t *buf, const char *fmt, ...) {
+    if (buf->failed) return;
+    for (;;) {
+        size_t room = buf->cap - buf->len;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf->data ? buf->data + buf->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) { buf->failed = true; return; }
+        if ((size_t)n < room) { buf->len += (size_t)n; return; }
+
+        size_t new_cap = buf->cap ? buf->cap * 2 : 16384;
+        while (new_cap - buf->len <= (size_t)n) new_cap *= 2;
+        char *grown = realloc(buf->data, new_cap);
+        if (!grown) { buf->failed = true; return; }
+        buf->data = grown;
+        buf->cap = new_cap;
+    }
+}
+
+/*
+ * Purpose: Writes the whole buffer to a socket, retrying on short writes and
+ *          EINTR. Never raises SIGPIPE when the scraper has gone away, and
+ *          gives up when the socket stays full for METRICS_IO_TIMEOUT_MS.
+ * Accepts: fd   - Connected non-blocking socket.
+ *          data - Data to send.
+ *          len  - Number of bytes to send.
+ * Returns: 0 on success, -1 on failure.
+ */
+static int metrics_send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) <= 0) return -1; // Scraper stopped reading
+            continue;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Purpose: Closes both listeners and unlinks the UNIX socket file, if any.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void metrics_close_listeners(void) {
+    if (unix_fd != -1) { close(unix_fd); unix_fd = -1; }
+    if (tcp_fd != -1) { close(tcp_fd); tcp_fd = -1; }
+    if (bound_path[0] != '\0') {
+        if (unlink(bound_path) == -1 && errno != ENOENT) print_error("Metrics", "unlink of socket failed");
+        bound_path[0] = '\0';
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+// --- Constants ---
+#define METRICS_REQUEST_MAX 2048      // Request bytes read before answering
+#define METRICS_IO_TIMEOUT_MS 1000    // A slow scraper is dropped after this
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Starts the metrics thread, which answers every HTTP request on a
+ *          UNIX-domain socket and/or a 127.0.0.1 TCP port with a Prometheus
+ *          text exposition. Scrapes read only lock-free snapshots and
+ *          per-thread counters, never the queue mutex.
+ * Accepts: q           - Pointer to the queue to export.
+ *          socket_path - UNIX socket path, or "" for none.
+ *          port        - TCP port on 127.0.0.1, or 0 for none.
+ * Returns: 0 on success (or when both listeners are disabled), -1 on failure
+ *          (prints error message).
+ */
+int metrics_start(queue_t *q, const char *socket_path, int port);
+
+/*
+ * Purpose: Stops the metrics thread, closes the listeners and unlinks the
+ *          socket file. Safe to call when the exporter was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void metrics_stop(void);
+
+#endif // METRICS_H
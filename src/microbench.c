@@ -0,0 +1,423 @@
+// Microbenchmarks of the per-message kernels: hashing, payload generation,
+// slot copies and ring index advance, each timed in isolation.
+// Usage: microbench [-s LIST] [-r REPS] [-w REPS] [-c NS] [-j FILE]
+#include "common.h"
+#include <stddef.h>
+
+// utils.c reads the termination flag (think_time_sleep); nothing here raises it
+volatile sig_atomic_t g_terminate_flag = 0;
+
+// --- Constants ---
+#define MB_SIZES_MAX 16
+#define MB_DEFAULT_REPS 15
+#define MB_DEFAULT_WARMUP 3
+#define MB_MIN_REP_NS 2000000ULL   // Iterations per repetition are doubled until one takes 2ms
+#define MB_COPY_SLOTS 64           // Copy destinations cycle through a small ring, as slots do
+#define MB_RING_CAPACITY 1000      // Capacity for the index kernels (not a power of two)
+#define MB_RING_CAPACITY_POW2 1024 // Capacity for the mask variant
+#define MB_CALIBRATE_NS 50000000ULL
+
+// --- Kernels ---
+typedef struct kernel_ctx_s {
+    message_t src;
+    message_t *slots;        // MB_COPY_SLOTS copy destinations
+    int size;                // Payload bytes
+    unsigned int seed;
+} kernel_ctx_t;
+
+typedef uint64_t (*kernel_fn)(kernel_ctx_t *ctx, long iters);
+
+typedef struct kernel_def_s {
+    const char *name;
+    kernel_fn fn;
+    bool sized;              // Cost depends on the payload size
+} kernel_def_t;
+
+// --- Result of One Kernel at One Size ---
+typedef struct kernel_result_s {
+    double cycles_median;    // Per operation
+    double cycles_min;
+    double ns_median;
+    long iters;              // Operations per repetition
+} kernel_result_t;
+
+// --- Internal Helper Function Declarations ---
+static uint64_t kernel_hash(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_fill(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_copy_full(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_copy_sized(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_index_mod(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_index_wrap(kernel_ctx_t *ctx, long iters);
+static uint64_t kernel_index_mask(kernel_ctx_t *ctx, long iters);
+static void measure_kernel(const kernel_def_t *k, kernel_ctx_t *ctx, int reps, int warmup, kernel_result_t *out);
+static double calibrate_cycles_per_ns(void);
+static inline uint64_t read_cycles(void);
+static int compare_double(const void *a, const void *b);
+static void print_breakdown(int size, const kernel_result_t *res, double total_ns);
+static void print_usage(const char *prog_name);
+
+enum { K_HASH, K_FILL, K_COPY_FULL, K_COPY_SIZED, K_INDEX_MOD, K_INDEX_WRAP, K_INDEX_MASK, K_COUNT };
+
+static const kernel_def_t kernels[K_COUNT] = {
+    { "hash",        kernel_hash,       true },
+    { "rand_fill",   kernel_fill,       true },
+    { "copy_full",   kernel_copy_full,  false },
+    { "copy_sized",  kernel_copy_sized, true },
+    { "index_mod",   kernel_index_mod,  false },
+    { "index_wrap",  kernel_index_wrap, false },
+    { "index_mask",  kernel_index_mask, false },
+};
+
+// Written by every kernel so the compiler cannot drop the work
+static volatile uint64_t sink;
+// Read through a volatile so the index kernels cannot fold the divisor
+static volatile size_t ring_capacity = MB_RING_CAPACITY;
+static volatile size_t ring_capacity_pow2 = MB_RING_CAPACITY_POW2;
+static double cycles_per_ns = 1.0;
+
+/*
+ * Purpose: Entry point. Times every kernel (sized ones at each payload size),
+ *          prints a table and a per-message cost breakdown per size, and
+ *          optionally writes JSON.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage.
+ */
+int main(int argc, char *argv[]) {
+    long sizes[MB_SIZES_MAX] = { 0, 16, 64, 128, 255 };
+    int size_count = 5;
+    int reps = MB_DEFAULT_REPS;
+    int warmup = MB_DEFAULT_WARMUP;
+    double total_ns = 0.0;
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:w:c:j:h")) != -1) {
+        int bad = 0;
+        switch (opt) {
+            case 's': size_count = 0;
+                      for (char *tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+                          char *end;
+                          long v = strtol(tok, &end, 10);
+                          if (*end != '\0' || v < 0 || v >= MAX_DATA_SIZE || size_count >= MB_SIZES_MAX) { bad = 1; break; }
+                          sizes[size_count++] = v;
+                      }
+                      bad |= size_count == 0; break;
+            case 'r': reps = (int)strtol(optarg, NULL, 10); bad = reps < 1 || reps > 1000; break;
+            case 'w': warmup = (int)strtol(optarg, NULL, 10); bad = warmup < 0 || warmup > 1000; break;
+            case 'c': total_ns = strtod(optarg, NULL); bad = total_ns <= 0.0; break;
+            case 'j': json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    kernel_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.slots = calloc(MB_COPY_SLOTS, sizeof(message_t));
+    if (!ctx.slots) { perror("calloc"); return EXIT_FAILURE; }
+    ctx.seed = 12345u;
+    for (int i = 0; i < MAX_DATA_SIZE; ++i) ctx.src.data[i] = (unsigned char)(rand_r(&ctx.seed) % 256);
+
+    cycles_per_ns = calibrate_cycles_per_ns();
+#if defined(__x86_64__) || defined(__i386__)
+    printf("Timer: TSC, %.3f GHz (reference cycles, not core cycles under frequency scaling)\n", cycles_per_ns);
+#else
+    printf("Timer: CLOCK_MONOTONIC (no cycle counter on this architecture; cycles shown as ns)\n");
+#endif
+    printf("Repetitions: %d measured after %d warmup, median and minimum per operation\n\n", reps, warmup);
+    printf("%-11s %5s %12s %12s %10s %10s\n", "KERNEL", "SIZE", "CYC/OP MED", "CYC/OP MIN", "NS/OP MED", "ITERS/REP");
+
+    // Size-independent kernels are measured once and shared by every size
+    static kernel_result_t results[MB_SIZES_MAX][K_COUNT];
+    for (int si = 0; si < size_count; ++si) {
+        ctx.size = (int)sizes[si];
+        ctx.src.size = (unsigned char)ctx.size;
+        for (int k = 0; k < K_COUNT; ++k) {
+            if (!kernels[k].sized && si > 0) { results[si][k] = results[0][k]; continue; }
+            measure_kernel(&kernels[k], &ctx, reps, warmup, &results[si][k]);
+            char size_col[8];
+            if (kernels[k].sized) snprintf(size_col, sizeof(size_col), "%d", ctx.size);
+            else strcpy(size_col, "-");
+            printf("%-11s %5s %12.1f %12.1f %10.2f %10ld\n", kernels[k].name, size_col, results[si][k].cycles_median,
+                   results[si][k].cycles_min, results[si][k].ns_median, results[si][k].iters);
+            fflush(stdout);
+        }
+    }
+
+    for (int si = 0; si < size_count; ++si) print_breakdown((int)sizes[si], results[si], total_ns);
+
+    int status = EXIT_SUCCESS;
+    if (json_path) {
+        FILE *fp = fopen(json_path, "w");
+        if (!fp) { fprintf(stderr, "Error: cannot open %s: %s\n", json_path, strerror(errno)); free(ctx.slots); return EXIT_FAILURE; }
+        fprintf(fp, "{\n  \"bench\": \"microbench\",\n  \"version\": 1,\n  \"cycles_per_ns\": %.4f,\n  \"reps\": %d,\n"
+                "  \"results\": [", cycles_per_ns, reps);
+        bool first = true;
+        for (int si = 0; si < size_count; ++si) {
+            for (int k = 0; k < K_COUNT; ++k) {
+                if (!kernels[k].sized && si > 0) continue;
+                fprintf(fp, "%s\n    {\"kernel\": \"%s\", \"size\": %ld, \"cycles_median\": %.2f, \"cycles_min\": %.2f, "
+                        "\"ns_median\": %.3f}", first ? "" : ",", kernels[k].name, kernels[k].sized ? sizes[si] : -1L,
+                        results[si][k].cycles_median, results[si][k].cycles_min, results[si][k].ns_median);
+                first = false;
+            }
+        }
+        fprintf(fp, "\n  ]\n}\n");
+        int write_error = ferror(fp);
+        if (fclose(fp) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", json_path); status = EXIT_FAILURE; }
+        else printf("\nResults written to %s\n", json_path);
+    }
+    free(ctx.slots);
+    return status;
+}
+
+/*
+ * Purpose: Hash kernel: calculate_message_hash over the current payload
+ *          size, as producers (sign) and consumers (verify) run it. The type
+ *          changes every call so no result can be reused.
+ * Accepts: ctx   - Kernel state.
+ *          iters - Operations to run.
+ * Returns: A value derived from the results.
+ */
+static uint64_t kernel_hash(kernel_ctx_t *ctx, long iters) {
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; ++i) {
+        ctx->src.type = (unsigned char)i;
+        acc += calculate_message_hash(&ctx->src);
+    }
+    return acc;
+}
+
+/*
+ * Purpose: Payload generation kernel: one rand_r call per payload byte, the
+ *          producers' loop.
+ * Accepts: ctx   - Kernel state.
+ *          iters - Operations (whole payloads) to generate.
+ * Returns: A value derived from the results.
+ */
+static uint64_t kernel_fill(kernel_ctx_t *ctx, long iters) {
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; ++i) {
+        for (int b = 0; b < ctx->size; ++b) {
+            ctx->src.data[b] = (unsigned char)(rand_r(&ctx->seed) % 256);
+        }
+        acc += ctx->src.data[0];
+    }
+    return acc;
+}
+
+/*
+ * Purpose: Full slot copy kernel: memcpy of a whole message_t, what
+ *          queue_add and queue_remove each do regardless of payload size.
+ * Accepts: ctx   - Kernel state.
+ *          iters - Copies to make.
+ * Returns: A value derived from the copies.
+ */
+static uint64_t kernel_copy_full(kernel_ctx_t *ctx, long iters) {
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; ++i) {
+        message_t *dst = &ctx->slots[i % MB_COPY_SLOTS];
+        ctx->src.type = (unsigned char)i;
+        memcpy(dst, &ctx->src, sizeof(message_t));
+        acc += dst->type;
+    }
+    return acc;
+}
+
+/*
+ * Purpose: Size-only copy kernel: the header, the used payload bytes and
+ *          the timestamp, the alternative to copying the whole message_t.
+ * Accepts: ctx   - Kernel state.
+ *          iters - Copies to make.
+ * Returns: A value derived from the copies.
+ */
+static uint64_t kernel_copy_sized(kernel_ctx_t *ctx, long iters) {
+    uint64_t acc = 0;
+    size_t used = offsetof(message_t, data) + (size_t)ctx->size;
+    for (long i = 0; i < iters; ++i) {
+        message_t *dst = &ctx->slots[i % MB_COPY_SLOTS];
+        ctx->src.type = (unsigned char)i;
+        memcpy(dst, &ctx->src, used);
+        dst->enqueue_ns = ctx->src.enqueue_ns;
+        acc += dst->type;
+    }
+    return acc;
+}
+
+/*
+ * Purpose: Index advance as the queue does it: (idx + 1) % capacity, with
+ *          the capacity unknown at compile time (an integer division).
+ * Accepts: ctx   - Kernel state (unused).
+ *          iters - Advances to make.
+ * Returns: The final index.
+ */
+static uint64_t kernel_index_mod(kernel_ctx_t *ctx, long iters) {
+    (void)ctx;
+    size_t cap = ring_capacity;
+    size_t idx = 0;
+    for (long i = 0; i < iters; ++i) idx = (idx + 1) % cap;
+    return idx;
+}
+
+/*
+ * Purpose: Index advance with a compare-and-reset instead of the division.
+ * Accepts: ctx   - Kernel state (unused).
+ *          iters - Advances to make.
+ * Returns: The final index.
+ */
+static uint64_t kernel_index_wrap(kernel_ctx_t *ctx, long iters) {
+    (void)ctx;
+    size_t cap = ring_capacity;
+    size_t idx = 0;
+    for (long i = 0; i < iters; ++i) {
+        if (++idx == cap) idx = 0;
+    }
+    return idx;
+}
+
+/*
+ * Purpose: Index advance with a mask, possible only for power-of-two
+ *          capacities.
+ * Accepts: ctx   - Kernel state (unused).
+ *          iters - Advances to make.
+ * Returns: The final index.
+ */
+static uint64_t kernel_index_mask(kernel_ctx_t *ctx, long iters) {
+    (void)ctx;
+    size_t mask = ring_capacity_pow2 - 1;
+    size_t idx = 0;
+    for (long i = 0; i < iters; ++i) idx = (idx + 1) & mask;
+    return idx;
+}
+
+/*
+ * Purpose: Times one kernel. The operations per repetition are doubled
+ *          until a repetition takes MB_MIN_REP_NS (timer resolution and
+ *          loop overhead become negligible), then warmup repetitions are
+ *          discarded and the measured ones summarized.
+ * Accepts: k      - The kernel.
+ *          ctx    - Kernel state.
+ *          reps   - Measured repetitions.
+ *          warmup - Discarded repetitions.
+ *          out    - Where to store the result.
+ * Returns: None.
+ */
+static void measure_kernel(const kernel_def_t *k, kernel_ctx_t *ctx, int reps, int warmup, kernel_result_t *out) {
+    long iters = 64;
+    for (;;) {
+        uint64_t start = monotonic_ns();
+        sink = k->fn(ctx, iters);
+        if (monotonic_ns() - start >= MB_MIN_REP_NS || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+    for (int w = 0; w < warmup; ++w) sink = k->fn(ctx, iters);
+
+    double *per_op = malloc((size_t)reps * sizeof(double));
+    if (!per_op) { perror("malloc"); exit(EXIT_FAILURE); }
+    for (int r = 0; r < reps; ++r) {
+        uint64_t c0 = read_cycles();
+        sink = k->fn(ctx, iters);
+        uint64_t c1 = read_cycles();
+        per_op[r] = (double)(c1 - c0) / (double)iters;
+    }
+    qsort(per_op, (size_t)reps, sizeof(double), compare_double);
+    out->cycles_min = per_op[0];
+    out->cycles_median = reps % 2 ? per_op[reps / 2] : (per_op[reps / 2 - 1] + per_op[reps / 2]) / 2.0;
+    out->ns_median = out->cycles_median / cycles_per_ns;
+    out->iters = iters;
+    free(per_op);
+}
+
+/*
+ * Purpose: Measures how many cycle-counter ticks elapse per nanosecond of
+ *          CLOCK_MONOTONIC, to convert cycles to time.
+ * Accepts: None.
+ * Returns: Ticks per nanosecond (1.0 when the counter is the clock itself).
+ */
+static double calibrate_cycles_per_ns(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t t0 = monotonic_ns();
+    uint64_t c0 = read_cycles();
+    while (monotonic_ns() - t0 < MB_CALIBRATE_NS) { }
+    uint64_t c1 = read_cycles();
+    uint64_t t1 = monotonic_ns();
+    return (double)(c1 - c0) / (double)(t1 - t0);
+#else
+    return 1.0;
+#endif
+}
+
+/*
+ * Purpose: Reads the cycle counter: the TSC on x86, otherwise the monotonic
+ *          clock in nanoseconds.
+ * Accepts: None.
+ * Returns: The counter value.
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+/*
+ * Purpose: qsort comparator for doubles, ascending.
+ * Accepts: a, b - Pointers to the values.
+ * Returns: Negative, zero or positive.
+ */
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Purpose: Prints what one message of the given size costs in kernels along
+ *          its path (fill and hash in the producer, a full copy and an index
+ *          advance each in queue_add and queue_remove, the verifying hash in
+ *          the consumer) and each kernel's share. With a measured total CPU
+ *          cost per message the shares are of that total instead.
+ * Accepts: size     - Payload size.
+ *          res      - Kernel results at that size.
+ *          total_ns - Measured CPU ns per message, or 0 to use the kernel sum.
+ * Returns: None.
+ */
+static void print_breakdown(int size, const kernel_result_t *res, double total_ns) {
+    const struct { const char *what; int kernel; int count; } path[] = {
+        { "payload fill (producer)", K_FILL, 1 },
+        { "hash (producer + consumer)", K_HASH, 2 },
+        { "slot copy (add + remove)", K_COPY_FULL, 2 },
+        { "index advance (add + remove)", K_INDEX_MOD, 2 },
+    };
+    int steps = (int)(sizeof(path) / sizeof(path[0]));
+    double sum = 0.0;
+    for (int i = 0; i < steps; ++i) sum += res[path[i].kernel].ns_median * path[i].count;
+    double base = total_ns > 0.0 ? total_ns : sum;
+
+    printf("\nPer-message kernels at %d bytes: %.1f ns%s\n", size, sum,
+           total_ns > 0.0 ? " (shares of the given CPU ns/msg)" : " (shares of the kernel sum)");
+    for (int i = 0; i < steps; ++i) {
+        double ns = res[path[i].kernel].ns_median * path[i].count;
+        printf("  %-30s %9.1f ns %6.1f%%\n", path[i].what, ns, 100.0 * ns / base);
+    }
+    if (total_ns > 0.0) printf("  %-30s %9.1f ns %6.1f%%\n", "everything else", total_ns - sum, 100.0 * (total_ns - sum) / base);
+    double saved = 2.0 * (res[K_COPY_FULL].ns_median - res[K_COPY_SIZED].ns_median);
+    printf("  size-only copies would change the copies by %+.1f ns\n", -saved);
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-s LIST] [-r REPS] [-w REPS] [-c NS] [-j FILE]\n", prog_name);
+    fprintf(stderr, "  -s LIST  : Payload sizes in bytes, 0-%d (default: 0,16,64,128,255).\n", MAX_DATA_SIZE - 1);
+    fprintf(stderr, "  -r REPS  : Measured repetitions per kernel (default: %d).\n", MB_DEFAULT_REPS);
+    fprintf(stderr, "  -w REPS  : Warmup repetitions per kernel (default: %d).\n", MB_DEFAULT_WARMUP);
+    fprintf(stderr, "  -c NS    : Measured CPU ns per message (e.g. from bench) to express kernels as shares of it.\n");
+    fprintf(stderr, "  -j FILE  : Also write the results as JSON.\n");
+}
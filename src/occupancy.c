@@ -0,0 +1,190 @@
+#include "occupancy.h"
+#include "queue_manager.h"
+#include "config.h"
+
+// --- Static Variables ---
+static occupancy_sample_t *ring = NULL;
+static size_t ring_size = 0;
+static uint64_t ring_written = 0;  // Samples recorded so far (slot = index % ring_size)
+static uint64_t origin_ns = 0;     // Sampler start, the CSV's time origin
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t occupancy_thread;
+static bool occupancy_running = false;
+static atomic_bool occupancy_stop_requested = false;
+static queue_t *sampled_queue = NULL;
+static long sample_interval_ns = 0;
+static char exit_path[CONFIG_PATH_MAX];
+
+// --- Internal Helper Function Declarations ---
+static void* occupancy_thread_func(void *arg);
+static void occupancy_sample(void);
+
+/*
+ * Purpose: Allocates the sample ring and starts the sampler thread, which
+ *          records the queue's lock-free snapshot every interval. Once the
+ *          ring is full the oldest samples are overwritten.
+ * Accepts: q           - Pointer to the queue to sample.
+ *          interval_us - Sampling interval in microseconds (> 0).
+ *          samples     - Ring size in samples (> 0).
+ *          exit_csv    - CSV written by occupancy_stop, or "" for none.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int occupancy_start(queue_t *q, long interval_us, long samples, const char *exit_csv) {
+    if (!q || !exit_csv || interval_us <= 0 || samples <= 0) { errno = EINVAL; print_error("Occupancy", "Invalid sampler settings."); return -1; }
+    if (occupancy_running) return 0;
+    if (strlen(exit_csv) >= sizeof(exit_path)) { errno = ENAMETOOLONG; print_error("Occupancy", "CSV path too long"); return -1; }
+
+    // Preallocated up front, so sampling never allocates
+    ring = calloc((size_t)samples, sizeof(occupancy_sample_t));
+    if (!ring) { print_error("Occupancy", "calloc for the sample ring failed"); return -1; }
+    ring_size = (size_t)samples;
+    ring_written = 0;
+    sampled_queue = q;
+    sample_interval_ns = interval_us * 1000L;
+    strcpy(exit_path, exit_csv);
+    origin_ns = monotonic_ns();
+
+    atomic_store(&occupancy_stop_requested, false);
+    int ret = pthread_create(&occupancy_thread, NULL, occupancy_thread_func, NULL);
+    if (ret != 0) {
+        errno = ret; print_error("Occupancy", "pthread_create (occupancy) failed");
+        free(ring); ring = NULL; ring_size = 0;
+        return -1;
+    }
+    occupancy_running = true;
+
+    char info[96];
+    snprintf(info, sizeof(info), "Sampling occupancy every %ld us (%ld samples kept).", interval_us, samples);
+    print_info("Occupancy", info);
+    return 0;
+}
+
+/*
+ * Purpose: Stops the sampler, writes the exit CSV if one was configured and
+ *          frees the ring. Safe to call when it was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void occupancy_stop(void) {
+    if (!occupancy_running) return;
+    atomic_store(&occupancy_stop_requested, true);
+    int ret = pthread_join(occupancy_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("Occupancy", "pthread_join (occupancy) failed"); }
+
+    if (exit_path[0] != '\0') {
+        size_t rows = 0;
+        if (occupancy_dump(exit_path, &rows) == -1) {
+            print_error("Occupancy", "Failed to write the occupancy CSV");
+        } else {
+            char info[CONFIG_PATH_MAX + 64];
+            snprintf(info, sizeof(info), "Wrote %zu occupancy samples to %s.", rows, exit_path);
+            print_info("Occupancy", info);
+        }
+    }
+    occupancy_running = false;
+    ret = pthread_mutex_lock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Lock Mutex");
+    free(ring);
+    ring = NULL;
+    ring_size = 0;
+    ret = pthread_mutex_unlock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Unlock Mutex");
+}
+
+/*
+ * Purpose: Writes the samples currently in the ring, oldest first, as CSV.
+ *          The ring is copied under its mutex first, so the sampler is held
+ *          up only for the copy, never for the file I/O.
+ * Accepts: path - Output file (overwritten).
+ *          rows - Where to store the number of samples written (may be NULL).
+ * Returns: 0 on success, -1 if the sampler is not running or on I/O failure
+ *          (errno set).
+ */
+int occupancy_dump(const char *path, size_t *rows) {
+    int ret = pthread_mutex_lock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Lock Mutex");
+    if (!ring) {
+        ret = pthread_mutex_unlock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Unlock Mutex");
+        errno = ENODATA;
+        return -1;
+    }
+    size_t kept = ring_written < ring_size ? (size_t)ring_written : ring_size;
+    uint64_t start = ring_written - kept; // Index of the oldest surviving sample
+    occupancy_sample_t *copy = malloc((kept > 0 ? kept : 1) * sizeof(occupancy_sample_t));
+    if (copy) {
+        // At most two contiguous runs: oldest..end of ring, then start of ring..newest
+        size_t first = (size_t)(start % ring_size);
+        size_t head_run = kept < ring_size - first ? kept : ring_size - first;
+        memcpy(copy, &ring[first], head_run * sizeof(occupancy_sample_t));
+        memcpy(copy + head_run, ring, (kept - head_run) * sizeof(occupancy_sample_t));
+    }
+    uint64_t base_ns = origin_ns;
+    ret = pthread_mutex_unlock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Unlock Mutex");
+    if (!copy) return -1;
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) { free(copy); return -1; }
+    fprintf(fp, "t_ms,count,capacity,engine,waiting_producers,waiting_consumers,waiting_resizers,added_total,extracted_total\n");
+    for (size_t i = 0; i < kept; ++i) {
+        const occupancy_sample_t *s = &copy[i];
+        fprintf(fp, "%.3f,%u,%u,%s,%d,%d,%d,%llu,%llu\n", (double)(s->ts_ns - base_ns) / 1e6, s->count, s->capacity,
+                queue_engine_name((sync_mode_t)s->mode), s->waiting_producers, s->waiting_consumers, s->waiting_resizers,
+                (unsigned long long)s->added_total, (unsigned long long)s->extracted_total);
+    }
+    free(copy);
+    int write_error = ferror(fp);
+    int result = (fclose(fp) != 0 || write_error) ? -1 : 0;
+    if (result == 0 && rows) *rows = kept;
+    return result;
+}
+
+/*
+ * Purpose: Sampler thread body. Sleeps to absolute deadlines so the interval
+ *          does not drift by the time each sample takes; after a long stall
+ *          it resynchronizes instead of catching up with a burst.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* occupancy_thread_func(void *arg) {
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load(&occupancy_stop_requested)) {
+        occupancy_sample();
+
+        next.tv_nsec += sample_interval_ns;
+        while (next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; next.tv_sec++; }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now; // Overran the deadline: skip the missed samples
+            continue;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL); // EINTR just samples early
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Records one sample of the queue's lock-free snapshot (the queue
+ *          mutex is never taken).
+ * Accepts: None.
+ * Returns: None.
+ */
+static void occupancy_sample(void) {
+    queue_stats_t st;
+    queue_get_stats_snapshot(sampled_queue, &st);
+    occupancy_sample_t s = {
+        .ts_ns = monotonic_ns(),
+        .added_total = st.added_total,
+        .extracted_total = st.extracted_total,
+        .count = (uint32_t)st.count,
+        .capacity = (uint32_t)st.capacity,
+        .mode = (uint32_t)st.mode,
+        .waiting_producers = st.waiting_producers,
+        .waiting_consumers = st.waiting_consumers,
+        .waiting_resizers = st.waiting_resizers,
+    };
+    int ret = pthread_mutex_lock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Lock Mutex");
+    ring[ring_written % ring_size] = s;
+    ring_written++;
+    ret = pthread_mutex_unlock(&ring_mutex); PTHREAD_CHECK(ret, "Occupancy: Unlock Mutex");
+}
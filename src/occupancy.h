@@ -0,0 +1,55 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "common.h"
+
+// --- Constants ---
+#define OCCUPANCY_DEFAULT_SAMPLES 60000L // 60 s of history at 1 ms
+
+// --- One Sample (48 bytes) ---
+typedef struct occupancy_sample_s {
+    uint64_t ts_ns;            // CLOCK_MONOTONIC
+    uint64_t added_total;
+    uint64_t extracted_total;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t mode;             // sync_mode_t
+    int32_t waiting_producers;
+    int32_t waiting_consumers;
+    int32_t waiting_resizers;
+} occupancy_sample_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Allocates the sample ring and starts the sampler thread, which
+ *          records the queue's lock-free snapshot every interval. Once the
+ *          ring is full the oldest samples are overwritten.
+ * Accepts: q           - Pointer to the queue to sample.
+ *          interval_us - Sampling interval in microseconds (> 0).
+ *          samples     - Ring size in samples (> 0).
+ *          exit_csv    - CSV written by occupancy_stop, or "" for none.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int occupancy_start(queue_t *q, long interval_us, long samples, const char *exit_csv);
+
+/*
+ * Purpose: Stops the sampler, writes the exit CSV if one was configured and
+ *          frees the ring. Safe to call when it was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void occupancy_stop(void);
+
+/*
+ * Purpose: Writes the samples currently in the ring, oldest first, as CSV.
+ *          The ring is copied under its mutex first, so the sampler is held
+ *          up only for the copy, never for the file I/O.
+ * Accepts: path - Output file (overwritten).
+ *          rows - Where to store the number of samples written (may be NULL).
+ * Returns: 0 on success, -1 if the sampler is not running or on I/O failure
+ *          (errno set).
+ */
+int occupancy_dump(const char *path, size_t *rows);
+
+#endif // OCCUPANCY_H
@@ -0,0 +1,193 @@
+// perf_event_open has no libc wrapper; syscall() needs the GNU extensions of <unistd.h>
+#define _GNU_SOURCE
+#include "perfctr.h"
+#include "config.h"
+#include "thread_stats.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+// --- Static Variables ---
+typedef struct perf_counter_def_s {
+    uint32_t type;
+    uint64_t config;
+    bool kernel;      // Counted in the kernel, so it cannot exclude kernel mode
+    const char *name;
+} perf_counter_def_t;
+
+static const perf_counter_def_t counter_defs[PERF_COUNTER_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       false, "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     false, "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     false, "llc-misses" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, true,  "ctx-switches" },
+};
+
+// Totals of the threads of one role that have stopped their counters
+typedef struct perf_role_totals_s {
+    uint64_t value[PERF_COUNTER_COUNT];
+    unsigned long counted_threads[PERF_COUNTER_COUNT]; // Threads that had the counter open
+    unsigned long messages[PERF_COUNTER_COUNT];        // Queue operations of those threads
+    unsigned long threads;
+} perf_role_totals_t;
+
+static perf_role_totals_t role_totals[THREAD_ROLE_COUNT];
+static pthread_mutex_t perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int first_open_errno = 0; // Why the first refused counter was refused
+
+static _Thread_local int perf_fds[PERF_COUNTER_COUNT] = { -1, -1, -1, -1 };
+static _Thread_local bool perf_started = false;
+
+// --- Internal Helper Function Declarations ---
+static int perf_open(const perf_counter_def_t *def);
+static bool perf_read_scaled(int fd, uint64_t *value);
+
+/*
+ * Purpose: Opens and starts the counters of the calling thread. Counters the
+ *          kernel refuses (no PMU in a VM, perf_event_paranoid, seccomp) are
+ *          skipped and reported as unavailable. Does nothing unless
+ *          g_config.perf_counters is set.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_thread_start(void) {
+    if (!g_config.perf_counters || perf_started) return;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        perf_fds[i] = perf_open(&counter_defs[i]);
+        if (perf_fds[i] == -1) {
+            int expected = 0;
+            atomic_compare_exchange_strong(&first_open_errno, &expected, errno);
+        }
+    }
+    // Start all counters together so the ratios cover the same interval
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (perf_fds[i] != -1) ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    perf_started = true;
+}
+
+/*
+ * Purpose: Reads and closes the calling thread's counters and adds them,
+ *          with the thread's queue operation count, to its role's totals.
+ *          Call before thread_stats_unregister. Safe to call when not
+ *          started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_thread_stop(void) {
+    if (!perf_started) return;
+    perf_started = false;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (perf_fds[i] != -1) ioctl(perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    thread_stats_t *ts = tls_thread_stats;
+    int role = ts ? atomic_load(&ts->role) : THREAD_ROLE_CONTROL;
+    unsigned long messages = ts ? atomic_load_explicit(&ts->messages, memory_order_relaxed) : 0;
+    if (role < 0 || role >= THREAD_ROLE_COUNT) role = THREAD_ROLE_CONTROL;
+
+    int ret = pthread_mutex_lock(&perf_mutex); PTHREAD_CHECK(ret, "PerfCounters: Lock Mutex");
+    perf_role_totals_t *totals = &role_totals[role];
+    totals->threads++;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (perf_fds[i] == -1) continue;
+        uint64_t value;
+        if (perf_read_scaled(perf_fds[i], &value)) {
+            totals->value[i] += value;
+            totals->counted_threads[i]++;
+            totals->messages[i] += messages;
+        }
+        close(perf_fds[i]);
+        perf_fds[i] = -1;
+    }
+    ret = pthread_mutex_unlock(&perf_mutex); PTHREAD_CHECK(ret, "PerfCounters: Unlock Mutex");
+}
+
+/*
+ * Purpose: Cleanup-handler adapter for perfctr_thread_stop, suitable for
+ *          pthread_cleanup_push.
+ * Accepts: arg - Unused.
+ * Returns: None.
+ */
+void perfctr_cleanup_handler(void *arg) {
+    (void)arg;
+    perfctr_thread_stop();
+}
+
+/*
+ * Purpose: Prints the per-message ratios of every role that recorded
+ *          counters, or why no counter could be opened. Does nothing unless
+ *          g_config.perf_counters is set.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_print_summary(void) {
+    if (!g_config.perf_counters) return;
+    int open_errno = atomic_load(&first_open_errno);
+    if (open_errno != 0) {
+        printf("[Perf Counters] Some counters are unavailable (%s); check /proc/sys/kernel/perf_event_paranoid.\r\n",
+               strerror(open_errno));
+    }
+
+    int ret = pthread_mutex_lock(&perf_mutex); PTHREAD_CHECK(ret, "PerfCounters: Lock Mutex");
+    for (int r = 0; r < THREAD_ROLE_CONTROL; ++r) {
+        const perf_role_totals_t *totals = &role_totals[r];
+        if (totals->threads == 0) continue;
+        char line[512];
+        int len = snprintf(line, sizeof(line), "[Perf Counters] %-8s %lu threads:", thread_role_name((thread_role_t)r), totals->threads);
+        for (int i = 0; i < PERF_COUNTER_COUNT && len < (int)sizeof(line); ++i) {
+            if (totals->counted_threads[i] == 0 || totals->messages[i] == 0) {
+                len += snprintf(line + len, sizeof(line) - (size_t)len, " %s/msg n/a", counter_defs[i].name);
+            } else {
+                len += snprintf(line + len, sizeof(line) - (size_t)len, " %s/msg %.2f", counter_defs[i].name,
+                                (double)totals->value[i] / (double)totals->messages[i]);
+            }
+        }
+        // IPC only when both counters covered the same threads
+        if (len < (int)sizeof(line) && totals->counted_threads[PERF_COUNTER_CYCLES] != 0 &&
+            totals->value[PERF_COUNTER_CYCLES] != 0 &&
+            totals->counted_threads[PERF_COUNTER_CYCLES] == totals->counted_threads[PERF_COUNTER_INSTRUCTIONS]) {
+            snprintf(line + len, sizeof(line) - (size_t)len, " IPC %.2f",
+                     (double)totals->value[PERF_COUNTER_INSTRUCTIONS] / (double)totals->value[PERF_COUNTER_CYCLES]);
+        }
+        printf("%s\r\n", line);
+    }
+    ret = pthread_mutex_unlock(&perf_mutex); PTHREAD_CHECK(ret, "PerfCounters: Unlock Mutex");
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Opens one disabled counter for the calling thread on any CPU.
+ *          Hardware counters exclude kernel and hypervisor time (user-space
+ *          cost of the queue code, and usable at the default
+ *          perf_event_paranoid level); context switches happen in the kernel
+ *          and need perf_event_paranoid <= 1 or CAP_PERFMON.
+ * Accepts: def - The counter to open.
+ * Returns: The counter's file descriptor, or -1 (errno set).
+ */
+static int perf_open(const perf_counter_def_t *def) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = def->type;
+    attr.config = def->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = def->kernel ? 0 : 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    long fd = syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any CPU */, -1, 0UL);
+    return fd < 0 ? -1 : (int)fd;
+}
+
+/*
+ * Purpose: Reads a counter, scaled up for the time it was multiplexed out
+ *          when more events are open than the PMU has registers.
+ * Accepts: fd    - The counter.
+ *          value - Where to store the (estimated) count.
+ * Returns: true if the counter ran at all, false otherwise.
+ */
+static bool perf_read_scaled(int fd, uint64_t *value) {
+    uint64_t data[3]; // value, time enabled, time running
+    if (read(fd, data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) return false;
+    *value = data[2] < data[1] ? (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]) : data[0];
+    return true;
+}
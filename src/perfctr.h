@@ -0,0 +1,59 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include "common.h"
+
+// Per-thread hardware counters via perf_event_open (perf-counters on). Each
+// producer and consumer counts its own user-space cycles, instructions and
+// last-level cache misses plus its context switches; the totals of exited
+// threads are divided by their queue operations in the end-of-run report.
+
+// --- Counters ---
+typedef enum {
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_LLC_MISSES,
+    PERF_COUNTER_CTX_SWITCHES,
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Opens and starts the counters of the calling thread. Counters the
+ *          kernel refuses (no PMU in a VM, perf_event_paranoid, seccomp) are
+ *          skipped and reported as unavailable. Does nothing unless
+ *          g_config.perf_counters is set.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_thread_start(void);
+
+/*
+ * Purpose: Reads and closes the calling thread's counters and adds them,
+ *          with the thread's queue operation count, to its role's totals.
+ *          Call before thread_stats_unregister. Safe to call when not
+ *          started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_thread_stop(void);
+
+/*
+ * Purpose: Cleanup-handler adapter for perfctr_thread_stop, suitable for
+ *          pthread_cleanup_push.
+ * Accepts: arg - Unused.
+ * Returns: None.
+ */
+void perfctr_cleanup_handler(void *arg);
+
+/*
+ * Purpose: Prints the per-message ratios of every role that recorded
+ *          counters, or why no counter could be opened. Does nothing unless
+ *          g_config.perf_counters is set.
+ * Accepts: None.
+ * Returns: None.
+ */
+void perfctr_print_summary(void);
+
+#endif // PERFCTR_H
@@ -0,0 +1,547 @@
+// Ping-pong round-trip benchmark: thread A adds a message to the ping
+// queue, thread B removes it and adds a reply to the pong queue, and A
+// times the round trip from its queue_add call to the return of its
+// queue_remove of the reply. One message is in flight at a time, so each
+// round is two one-hop handoffs with nothing to batch or overlap. Runs for
+// each engine, wait policy of the receiving side and CPU placement of A
+// and B.
+// Usage: pingpong [-m LIST] [-W LIST] [-P LIST] [-S NS] [-q CAP] [-s SIZE] [-d MS] [-w MS] [-j FILE]
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "affinity.h"
+#include "hist.h"
+
+// --- Constants ---
+#define PP_DEFAULT_SPIN_NS 20000      // Adaptive policy: spin this long before parking
+#define PP_TYPE_PING 1
+#define PP_TYPE_STOP 2                // Last message of a run: B leaves without replying
+#define PP_MAX_LAYOUTS 8
+#define PP_CPU_UNPINNED -1
+#define PP_TOPOLOGY_PATH "/sys/devices/system/cpu/cpu%d/topology/%s"
+
+// --- Wait Policies of the Receiving Side ---
+typedef enum {
+    PP_WAIT_SPIN,       // Poll the lock-free count until a message is there, never park
+    PP_WAIT_ADAPTIVE,   // Poll for up to -S ns, then park in queue_remove
+    PP_WAIT_PARK,       // Call queue_remove directly and block in the engine
+    PP_WAIT_COUNT
+} pp_wait_t;
+
+// --- CPU Placement of A and B ---
+typedef enum {
+    PP_LAYOUT_NONE,     // Unpinned, the scheduler places both
+    PP_LAYOUT_SAME,     // Both on one CPU
+    PP_LAYOUT_SMT,      // Hyperthread siblings of one core
+    PP_LAYOUT_CORE,     // Different cores of one package
+    PP_LAYOUT_SOCKET,   // Different packages
+    PP_LAYOUT_EXPLICIT  // -P A:B
+} pp_layout_kind_t;
+
+typedef struct pp_layout_s {
+    pp_layout_kind_t kind;
+    int cpu_a;          // PP_CPU_UNPINNED when not pinned
+    int cpu_b;
+} pp_layout_t;
+
+// --- One Run ---
+typedef struct pp_params_s {
+    sync_mode_t mode;
+    pp_wait_t wait;
+    pp_layout_t layout;
+    size_t capacity;
+    int msg_size;
+    long spin_ns;
+    long warmup_ms;
+    long duration_ms;
+} pp_params_t;
+
+typedef struct pp_run_s {
+    const pp_params_t *p;
+    queue_t *ping;
+    queue_t *pong;
+    hist_t rtt;                 // Recorded by A while measuring
+    unsigned long rounds;
+    unsigned long parks;        // A's measured receives that blocked in the engine
+    atomic_ulong b_parks;       // B's, stored when B leaves
+    atomic_bool measuring;      // Raised by A for the measured window
+    atomic_int pin_errors;
+} pp_run_t;
+
+// --- Internal Helper Function Declarations ---
+static int run_one(const pp_params_t *p, FILE *json, bool first);
+static void* pp_a_func(void *arg);
+static void* pp_b_func(void *arg);
+static int pp_receive(pp_run_t *run, queue_t *q, message_t *msg, bool *parked);
+static void pp_pin(pp_run_t *run, int cpu);
+static int parse_waits(const char *value, pp_wait_t *waits);
+static int parse_layouts(const char *value, pp_layout_t *layouts);
+static bool resolve_layout(pp_layout_t *layout);
+static int read_topology(int cpu, const char *name);
+static void cpu_relax(void);
+static const char* wait_name(pp_wait_t wait);
+static const char* layout_name(pp_layout_kind_t kind);
+static double us(uint64_t ns);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs every engine x wait policy x layout and prints
+ *          one row of round-trip percentiles per run.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage or a failed run.
+ */
+int main(int argc, char *argv[]) {
+    sync_mode_t modes[BENCH_MODES_MAX] = { SYNC_MODE_SEM, SYNC_MODE_CONDVAR };
+    int mode_count = 2;
+    pp_wait_t waits[PP_WAIT_COUNT] = { PP_WAIT_SPIN, PP_WAIT_ADAPTIVE, PP_WAIT_PARK };
+    int wait_count = PP_WAIT_COUNT;
+    pp_layout_t layouts[PP_MAX_LAYOUTS] = { { PP_LAYOUT_NONE, PP_CPU_UNPINNED, PP_CPU_UNPINNED } };
+    int layout_count = 1;
+    pp_params_t base = {
+        .capacity = 1, .msg_size = 16, .spin_ns = PP_DEFAULT_SPIN_NS, .warmup_ms = 100, .duration_ms = 1000,
+    };
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:W:P:S:q:s:d:w:j:h")) != -1) {
+        int bad = 0;
+        long v;
+        switch (opt) {
+            case 'm': mode_count = bench_parse_modes(optarg, modes); bad = mode_count == -1; break;
+            case 'W': wait_count = parse_waits(optarg, waits); bad = wait_count == -1; break;
+            case 'P': layout_count = parse_layouts(optarg, layouts); bad = layout_count == -1; break;
+            case 'S': base.spin_ns = strtol(optarg, NULL, 10); bad = base.spin_ns < 0; break;
+            case 'q': v = strtol(optarg, NULL, 10); bad = v < 1 || v > QUEUE_CAPACITY_LIMIT; base.capacity = (size_t)v; break;
+            case 's': v = strtol(optarg, NULL, 10); bad = v < 0 || v >= MAX_DATA_SIZE; base.msg_size = (int)v; break;
+            case 'd': base.duration_ms = strtol(optarg, NULL, 10); bad = base.duration_ms <= 0; break;
+            case 'w': base.warmup_ms = strtol(optarg, NULL, 10); bad = base.warmup_ms < 0; break;
+            case 'j': json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) { fprintf(stderr, "Error: cannot open %s: %s\n", json_path, strerror(errno)); return EXIT_FAILURE; }
+        fprintf(json, "{\n  \"bench\": \"pingpong\",\n  \"version\": 1,\n  \"results\": [\n");
+    }
+
+    printf("pingpong: %ld online CPUs, capacity %zu, %d-byte payload, adaptive spin %ld ns, %ld ms per run\n",
+           sysconf(_SC_NPROCESSORS_ONLN), base.capacity, base.msg_size, base.spin_ns, base.duration_ms);
+    printf("%-6s %-9s %-8s %7s %10s %9s %9s %9s %9s %9s %9s %7s\n", "ENGINE", "WAIT", "LAYOUT", "CPUS", "ROUNDS",
+           "RT/S", "P50 us", "P90 us", "P99 us", "P99.9 us", "MAX us", "PARKED");
+    fflush(stdout);
+
+    bench_setup();
+    int status = EXIT_SUCCESS;
+    bool first = true;
+    for (int li = 0; li < layout_count; ++li) {
+        pp_layout_t layout = layouts[li];
+        if (!resolve_layout(&layout)) {
+            printf("%-6s %-9s %-8s  (no such CPU pair on this host)\n", "-", "-", layout_name(layout.kind));
+            continue;
+        }
+        for (int mi = 0; mi < mode_count; ++mi) {
+            for (int wi = 0; wi < wait_count; ++wi) {
+                pp_params_t p = base;
+                p.mode = modes[mi];
+                p.wait = waits[wi];
+                p.layout = layout;
+                if (run_one(&p, json, first) == -1) status = EXIT_FAILURE;
+                else first = false;
+            }
+        }
+    }
+    printf("Round trip: A's queue_add call to the return of its queue_remove of B's reply (two handoffs).\n"
+           "PARKED: share of receives (A and B) that blocked in the engine because no message was there\n"
+           "(for adaptive: none arrived within the spin budget).\n");
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        int write_error = ferror(json);
+        if (fclose(json) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", json_path); status = EXIT_FAILURE; }
+        else printf("Results written to %s\n", json_path);
+    }
+    return status;
+}
+
+/*
+ * Purpose: Runs one configuration: creates both queues, starts B then A,
+ *          lets A ping for the warmup and the measured window, waits for
+ *          both to finish and prints (and optionally writes) the result.
+ * Accepts: p     - The configuration.
+ *          json  - Open JSON file, or NULL.
+ *          first - true for the first result written to json.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+static int run_one(const pp_params_t *p, FILE *json, bool first) {
+    pp_run_t *run = calloc(1, sizeof(pp_run_t));
+    if (!run) { print_error("Pingpong", "calloc for the run failed"); return -1; }
+    run->p = p;
+    hist_reset(&run->rtt);
+    atomic_init(&run->b_parks, 0);
+    atomic_init(&run->measuring, false);
+    atomic_init(&run->pin_errors, 0);
+    run->ping = queue_create(p->capacity, p->mode);
+    run->pong = run->ping ? queue_create(p->capacity, p->mode) : NULL;
+    if (!run->pong) {
+        if (run->ping) queue_destroy(run->ping, p->mode);
+        free(run);
+        return -1;
+    }
+
+    pthread_t a, b;
+    int result = 0;
+    int ret = pthread_create(&b, NULL, pp_b_func, run);
+    if (ret != 0) { errno = ret; print_error("Pingpong", "pthread_create(B) failed"); result = -1; }
+    else {
+        ret = pthread_create(&a, NULL, pp_a_func, run);
+        if (ret != 0) {
+            errno = ret; print_error("Pingpong", "pthread_create(A) failed"); result = -1;
+            message_t stop;
+            memset(&stop, 0, sizeof(stop));
+            stop.type = PP_TYPE_STOP;
+            queue_add(run->ping, &stop, "Pingpong");
+        } else {
+            ret = pthread_join(a, NULL);
+            if (ret != 0) { errno = ret; print_error("Pingpong", "pthread_join(A) failed"); }
+        }
+        ret = pthread_join(b, NULL);
+        if (ret != 0) { errno = ret; print_error("Pingpong", "pthread_join(B) failed"); }
+    }
+    if (atomic_load(&run->pin_errors) > 0) result = -1;
+
+    if (result == 0) {
+        const hist_t *h = &run->rtt;
+        double seconds = (double)p->duration_ms / 1e3;
+        unsigned long receives = 2 * run->rounds;
+        double parked = receives > 0 ? (double)(run->parks + atomic_load(&run->b_parks)) / (double)receives * 100.0 : 0.0;
+        char cpus[16] = "-";
+        if (p->layout.cpu_a != PP_CPU_UNPINNED) snprintf(cpus, sizeof(cpus), "%d:%d", p->layout.cpu_a, p->layout.cpu_b);
+        printf("%-6s %-9s %-8s %7s %10lu %9.0f %9.2f %9.2f %9.2f %9.2f %9.1f %6.1f%%\n", queue_engine_name(p->mode),
+               wait_name(p->wait), layout_name(p->layout.kind), cpus, run->rounds, (double)run->rounds / seconds,
+               us(hist_percentile(h, 50.0)), us(hist_percentile(h, 90.0)), us(hist_percentile(h, 99.0)),
+               us(hist_percentile(h, 99.9)), us(atomic_load(&h->max)), parked);
+        fflush(stdout);
+        if (json) {
+            fprintf(json, "%s    {\"engine\": \"%s\", \"wait\": \"%s\", \"layout\": \"%s\", \"cpu_a\": %d, \"cpu_b\": %d, "
+                    "\"capacity\": %zu, \"msg_size\": %d, \"spin_ns\": %ld, \"rounds\": %lu, \"rtt_p50_ns\": %llu, "
+                    "\"rtt_p90_ns\": %llu, \"rtt_p99_ns\": %llu, \"rtt_p999_ns\": %llu, \"rtt_max_ns\": %lu, "
+                    "\"parked_pct\": %.2f}", first ? "" : ",\n", queue_engine_name(p->mode), wait_name(p->wait),
+                    layout_name(p->layout.kind), p->layout.cpu_a, p->layout.cpu_b, p->capacity, p->msg_size,
+                    p->spin_ns, run->rounds, (unsigned long long)hist_percentile(h, 50.0),
+                    (unsigned long long)hist_percentile(h, 90.0), (unsigned long long)hist_percentile(h, 99.0),
+                    (unsigned long long)hist_percentile(h, 99.9), atomic_load(&h->max), parked);
+        }
+    }
+
+    queue_destroy(run->ping, p->mode);
+    queue_destroy(run->pong, p->mode);
+    free(run);
+    return result;
+}
+
+/*
+ * Purpose: Thread A: pings, waits for each reply and records the round
+ *          trip once the warmup is over; sends the stop message at the end
+ *          of the measured window.
+ * Accepts: arg - Pointer to the run's pp_run_t.
+ * Returns: Always NULL.
+ */
+static void* pp_a_func(void *arg) {
+    pp_run_t *run = (pp_run_t *)arg;
+    const pp_params_t *p = run->p;
+    pp_pin(run, p->layout.cpu_a);
+
+    message_t msg, reply;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = PP_TYPE_PING;
+    msg.size = (unsigned char)p->msg_size;
+    uint64_t now = monotonic_ns();
+    uint64_t measure_ns = now + (uint64_t)p->warmup_ms * 1000000ULL;
+    uint64_t end_ns = measure_ns + (uint64_t)p->duration_ms * 1000000ULL;
+    while (now < end_ns) {
+        uint64_t t0 = monotonic_ns();
+        msg.enqueue_ns = t0;
+        if (queue_add(run->ping, &msg, "Pingpong A") == -1) break;
+        bool parked = false;
+        if (pp_receive(run, run->pong, &reply, &parked) == -1) break;
+        now = monotonic_ns();
+        if (t0 >= measure_ns) {
+            if (run->rounds == 0) atomic_store(&run->measuring, true);
+            hist_record(&run->rtt, now - t0);
+            run->rounds++;
+            if (parked) run->parks++;
+        }
+    }
+
+    atomic_store(&run->measuring, false);
+    msg.type = PP_TYPE_STOP;
+    queue_add(run->ping, &msg, "Pingpong A");
+    return NULL;
+}
+
+/*
+ * Purpose: Thread B: echoes every ping into the pong queue until the stop
+ *          message arrives.
+ * Accepts: arg - Pointer to the run's pp_run_t.
+ * Returns: Always NULL.
+ */
+static void* pp_b_func(void *arg) {
+    pp_run_t *run = (pp_run_t *)arg;
+    pp_pin(run, run->p->layout.cpu_b);
+
+    message_t msg;
+    unsigned long parks = 0;
+    for (;;) {
+        bool parked = false;
+        if (pp_receive(run, run->ping, &msg, &parked) == -1 || msg.type == PP_TYPE_STOP) break;
+        if (parked && atomic_load_explicit(&run->measuring, memory_order_relaxed)) parks++;
+        if (queue_add(run->pong, &msg, "Pingpong B") == -1) break;
+    }
+    atomic_store(&run->b_parks, parks);
+    return NULL;
+}
+
+/*
+ * Purpose: Receives one message under the run's wait policy. Spinning polls
+ *          the queue's lock-free count snapshot, so it neither takes the
+ *          mutex nor enters the engine's wait until a message is there;
+ *          the following queue_remove then finds it without blocking (each
+ *          queue has a single receiver).
+ * Accepts: run    - The run.
+ *          q      - The queue to receive from.
+ *          msg    - Where to store the message.
+ *          parked - Set to true if the receive blocked in the engine.
+ * Returns: 0 on success, -1 on failure.
+ */
+static int pp_receive(pp_run_t *run, queue_t *q, message_t *msg, bool *parked) {
+    const pp_params_t *p = run->p;
+    if (p->wait != PP_WAIT_PARK) {
+        uint64_t deadline = p->wait == PP_WAIT_ADAPTIVE ? monotonic_ns() + (uint64_t)p->spin_ns : 0;
+        unsigned int polls = 0;
+        while (atomic_load_explicit(&q->snap_count, memory_order_acquire) == 0) {
+            cpu_relax();
+            // Read the clock every 64 polls only; a clock read costs more than a poll
+            if (p->wait == PP_WAIT_ADAPTIVE && (++polls & 63) == 0 && monotonic_ns() >= deadline) {
+                *parked = true;
+                break;
+            }
+        }
+    } else {
+        *parked = atomic_load_explicit(&q->snap_count, memory_order_acquire) == 0;
+    }
+    return queue_remove(q, msg, "Pingpong");
+}
+
+/*
+ * Purpose: Pins the calling thread, unless the layout leaves it unpinned.
+ * Accepts: run - The run (a failure is counted in pin_errors).
+ *          cpu - The CPU, or PP_CPU_UNPINNED.
+ * Returns: None.
+ */
+static void pp_pin(pp_run_t *run, int cpu) {
+    if (cpu == PP_CPU_UNPINNED) return;
+    if (affinity_pin_self(cpu) == -1) {
+        print_error("Pingpong", "affinity_pin_self failed");
+        atomic_fetch_add(&run->pin_errors, 1);
+    }
+}
+
+/*
+ * Purpose: Parses the wait policy list (spin, adaptive, park).
+ * Accepts: value - The text to parse.
+ *          waits - Array of PP_WAIT_COUNT to fill.
+ * Returns: Number of policies, or -1 on invalid input.
+ */
+static int parse_waits(const char *value, pp_wait_t *waits) {
+    int count = 0;
+    const char *cur = value;
+    while (*cur != '\0') {
+        size_t len = strcspn(cur, ",");
+        int found = -1;
+        for (int w = 0; w < PP_WAIT_COUNT; ++w) {
+            const char *name = wait_name((pp_wait_t)w);
+            if (strlen(name) == len && strncmp(cur, name, len) == 0) found = w;
+        }
+        if (found == -1 || count >= PP_WAIT_COUNT) return -1;
+        waits[count++] = (pp_wait_t)found;
+        cur += len;
+        if (*cur == ',') cur++;
+    }
+    return count > 0 ? count : -1;
+}
+
+/*
+ * Purpose: Parses the layout list: none, same, smt, core, socket, or an
+ *          explicit CPU pair A:B.
+ * Accepts: value   - The text to parse.
+ *          layouts - Array of PP_MAX_LAYOUTS to fill.
+ * Returns: Number of layouts, or -1 on invalid input.
+ */
+static int parse_layouts(const char *value, pp_layout_t *layouts) {
+    int count = 0;
+    const char *cur = value;
+    while (*cur != '\0') {
+        size_t len = strcspn(cur, ",");
+        if (count >= PP_MAX_LAYOUTS) return -1;
+        pp_layout_t *l = &layouts[count];
+        l->cpu_a = PP_CPU_UNPINNED;
+        l->cpu_b = PP_CPU_UNPINNED;
+        int found = -1;
+        for (int k = PP_LAYOUT_NONE; k < PP_LAYOUT_EXPLICIT; ++k) {
+            const char *name = layout_name((pp_layout_kind_t)k);
+            if (strlen(name) == len && strncmp(cur, name, len) == 0) found = k;
+        }
+        if (found != -1) {
+            l->kind = (pp_layout_kind_t)found;
+        } else {
+            char *end;
+            long a = strtol(cur, &end, 10);
+            if (end == cur || *end != ':' || a < 0) return -1;
+            const char *b_text = end + 1;
+            long b = strtol(b_text, &end, 10);
+            if (end == b_text || (*end != ',' && *end != '\0') || b < 0) return -1;
+            l->kind = PP_LAYOUT_EXPLICIT;
+            l->cpu_a = (int)a;
+            l->cpu_b = (int)b;
+        }
+        count++;
+        cur += len;
+        if (*cur == ',') cur++;
+    }
+    return count > 0 ? count : -1;
+}
+
+/*
+ * Purpose: Picks the CPU pair of a named layout from the sysfs topology:
+ *          A on the first online CPU, B on the first CPU that has the
+ *          wanted relation to it.
+ * Accepts: layout - The layout; cpu_a and cpu_b are filled in.
+ * Returns: true if the layout can be run on this host.
+ */
+static bool resolve_layout(pp_layout_t *layout) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    switch (layout->kind) {
+        case PP_LAYOUT_NONE: return true;
+        case PP_LAYOUT_EXPLICIT: return layout->cpu_a < cpus && layout->cpu_b < cpus;
+        case PP_LAYOUT_SAME: layout->cpu_a = 0; layout->cpu_b = 0; return true;
+        default: break;
+    }
+    int core_a = read_topology(0, "core_id");
+    int package_a = read_topology(0, "physical_package_id");
+    if (core_a == -1 || package_a == -1) return false;
+    for (int cpu = 1; cpu < cpus; ++cpu) {
+        int core = read_topology(cpu, "core_id");
+        int package = read_topology(cpu, "physical_package_id");
+        bool match = (layout->kind == PP_LAYOUT_SMT && package == package_a && core == core_a) ||
+                     (layout->kind == PP_LAYOUT_CORE && package == package_a && core != core_a) ||
+                     (layout->kind == PP_LAYOUT_SOCKET && package != package_a);
+        if (match && core != -1 && package != -1) {
+            layout->cpu_a = 0;
+            layout->cpu_b = cpu;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Purpose: Reads one topology attribute of a CPU from sysfs.
+ * Accepts: cpu  - The CPU.
+ *          name - Attribute file (core_id, physical_package_id).
+ * Returns: The value, or -1 if it cannot be read.
+ */
+static int read_topology(int cpu, const char *name) {
+    char path[128];
+    snprintf(path, sizeof(path), PP_TOPOLOGY_PATH, cpu, name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int value;
+    if (fscanf(fp, "%d", &value) != 1) value = -1;
+    fclose(fp);
+    return value;
+}
+
+/*
+ * Purpose: Spin-loop hint: lets the sibling hyperthread run and saves power
+ *          while polling.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/*
+ * Purpose: Names a wait policy as accepted by -W.
+ * Accepts: wait - The policy.
+ * Returns: Pointer to a static string.
+ */
+static const char* wait_name(pp_wait_t wait) {
+    switch (wait) {
+        case PP_WAIT_SPIN: return "spin";
+        case PP_WAIT_ADAPTIVE: return "adaptive";
+        case PP_WAIT_PARK: return "park";
+        case PP_WAIT_COUNT: break;
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Names a layout as accepted by -P.
+ * Accepts: kind - The layout.
+ * Returns: Pointer to a static string.
+ */
+static const char* layout_name(pp_layout_kind_t kind) {
+    switch (kind) {
+        case PP_LAYOUT_NONE: return "none";
+        case PP_LAYOUT_SAME: return "same";
+        case PP_LAYOUT_SMT: return "smt";
+        case PP_LAYOUT_CORE: return "core";
+        case PP_LAYOUT_SOCKET: return "socket";
+        case PP_LAYOUT_EXPLICIT: return "pair";
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Converts nanoseconds to microseconds.
+ * Accepts: ns - Nanoseconds.
+ * Returns: Microseconds.
+ */
+static double us(uint64_t ns) {
+    return (double)ns / 1e3;
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m LIST] [-W LIST] [-P LIST] [-S NS] [-q CAP] [-s SIZE] [-d MS] [-w MS] [-j FILE]\n", prog_name);
+    fprintf(stderr, "  -m LIST  : Engines, sem and/or cond (default: sem,cond).\n");
+    fprintf(stderr, "  -W LIST  : Wait policies of the receiving side (default: spin,adaptive,park):\n");
+    fprintf(stderr, "             spin     = poll the lock-free count, never block\n");
+    fprintf(stderr, "             adaptive = poll for up to -S ns, then block in the engine\n");
+    fprintf(stderr, "             park     = block in the engine right away\n");
+    fprintf(stderr, "  -P LIST  : CPU layouts of A and B (default: none): none, same, smt, core, socket,\n");
+    fprintf(stderr, "             or a pair A:B such as 0:4. Layouts the host lacks are skipped.\n");
+    fprintf(stderr, "  -S NS    : Adaptive spin budget (default: %d).\n", PP_DEFAULT_SPIN_NS);
+    fprintf(stderr, "  -q CAP   : Capacity of both queues (default: 1).\n");
+    fprintf(stderr, "  -s SIZE  : Payload bytes (default: 16).\n");
+    fprintf(stderr, "  -d MS    : Measured duration per run (default: 1000).\n");
+    fprintf(stderr, "  -w MS    : Warmup per run (default: 100).\n");
+    fprintf(stderr, "  -j FILE  : Write the results as JSON.\n");
+    fprintf(stderr, "Spinning on one CPU (layout same, or fewer CPUs than threads) only hands over at the\n");
+    fprintf(stderr, "end of a time slice; run spin with A and B on different CPUs.\n");
+}
@@ -1,6 +1,12 @@
 #include "producer.h"
 #include "queue_manager.h"
 #include "utils.h"
+#include "config.h"
+#include "affinity.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include "log.h"
+#include "perfctr.h"
 
 /*
  * Purpose: The entry point function for producer threads. Runs a loop that
@@ -29,11 +35,19 @@ void* producer_thread_func(void *arg) {
     char info_prefix[32];
     snprintf(info_prefix, sizeof(info_prefix), "Producer %d", id);
     print_info(info_prefix, "Started.");
+    affinity_pin_worker(true, id);
+    thread_stats_register(THREAD_ROLE_PRODUCER, id);
+    trace_thread_attach(); // Maps the trace file now, not under the queue lock
+    pthread_cleanup_push(thread_stats_cleanup_handler, NULL); // Also runs on 'P'/'C' cancellation
+    perfctr_thread_start();
+    pthread_cleanup_push(perfctr_cleanup_handler, NULL); // Runs first, while the stats slot is still ours
 
+    int batch_pos = 0;
     while (!g_terminate_flag) {
         message_t msg;
 
         // Create Message
+        thread_stats_set_state(THREAD_STATE_PRODUCING);
         msg.type = (unsigned char)(rand_r(&seed) % 256);
         msg.size = (unsigned char)(rand_r(&seed) % MAX_DATA_SIZE);
         for (int i = 0; i < msg.size; ++i) {
@@ -42,34 +56,28 @@ void* producer_thread_func(void *arg) {
         msg.hash = 0;
         msg.hash = calculate_message_hash(&msg);
 
-        // Add to Queue (blocks if full)
+        // Add to Queue (blocks if full); the stamp includes any wait for a slot
+        msg.enqueue_ns = g_config.latency ? monotonic_ns() : 0;
         if (queue_add(q, &msg, info_prefix) == -1) {
             if (g_terminate_flag) { /* Normal termination */ }
             else { print_error(info_prefix, "Failed to add message to queue."); }
             break;
         }
+        thread_stats_note_message(msg.size);
 
-        // Print status
-        unsigned long total_added = queue_get_added_total(q);
-        printf("[%s] Added msg (Type:%u Size:%u Hash:%u). Total Added: %lu\r\n",
-               info_prefix, msg.type, msg.size, msg.hash, total_added);
-        fflush(stdout);
+        // Log status (buffered; the total comes from the lock-free snapshot)
+        log_write(LOG_LEVEL_INFO, "[%s] Added msg (Type:%u Size:%u Hash:%u). Total Added: %lu",
+                  info_prefix, msg.type, msg.size, msg.hash,
+                  atomic_load_explicit(&q->snap_added_total, memory_order_relaxed));
 
-        // Delay
-        struct timespec delay_req = {0, 0};
-        struct timespec delay_rem;
-        long delay_us = (rand_r(&seed) % 400000L) + 100000L;
-        delay_req.tv_sec = delay_us / 1000000L;
-        delay_req.tv_nsec = (delay_us % 1000000L) * 1000L;
-        while (nanosleep(&delay_req, &delay_rem) == -1) {
-            if (errno == EINTR) {
-                if (g_terminate_flag) break;
-                delay_req = delay_rem;
-            } else {
-                print_error(info_prefix, "nanosleep failed"); break;
-            }
-        }
+        // Delay once per batch
+        if (++batch_pos < g_config.producer_batch) continue;
+        batch_pos = 0;
+        thread_stats_set_state(THREAD_STATE_SLEEPING);
+        think_time_sleep(&g_producer_think, &seed, info_prefix);
     }
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
 
     print_info(info_prefix, "Terminating.");
     return NULL;
@@ -1,28 +1,59 @@
 #include "queue_manager.h"
+#include "config.h"
+#include "thread_stats.h"
+#include "trace.h"
+#include "tracepoint.h"
+#include "lockprof.h"
+#include "log.h"
+#ifdef SCHED_EXPLORE
+#include "sched_hooks.h" // Last: redirects the primitives used below to the explorer
+#endif
 
-// Global variable indicating sync mode (defined in main.c)
-extern sync_mode_t g_sync_mode; // Used by queue_add/remove dispatchers and resize
 extern volatile sig_atomic_t g_terminate_flag; // Used for graceful exit during waits
 
+// --- Constants ---
+#define QUEUE_RETRY (-3)              // An engine swap evicted the operation; the dispatcher retries it
+#define SWAP_KICK_INTERVAL_NS 200000L // 200us between wake-up rounds while a swap drains the queue
+
 // --- Internal Helper Function Declarations ---
 static int queue_add_sem(queue_t *q, const message_t *msg, const char* caller_prefix);
 static int queue_remove_sem(queue_t *q, message_t *msg, const char* caller_prefix);
 static int queue_add_condvar(queue_t *q, const message_t *msg, const char* caller_prefix);
 static int queue_remove_condvar(queue_t *q, message_t *msg, const char* caller_prefix);
+static void queue_publish_stats(queue_t *q);
+static int queue_sem_wait(queue_t *q, sem_t *sem, atomic_int *waiters);
+static int queue_cond_wait(queue_t *q, pthread_cond_t *cond, atomic_int *waiters);
+static void queue_wait_cleanup(void *arg);
+static int queue_resize_impl(queue_t *q, int change);
+static int queue_gate_enter(queue_t *q);
+static void queue_gate_wait(queue_t *q);
+static void queue_gate_leave(queue_t *q);
+static void queue_gate_cleanup(void *arg);
+static void queue_unlock_cleanup(void *arg);
+static void queue_kick_waiters(queue_t *q, int sem_posts);
+static int queue_reset_sems(queue_t *q);
+static uint32_t queue_wait_kind(queue_t *q, atomic_int *waiters);
+
+// State undone by queue_wait_cleanup if a waiting thread is canceled
+typedef struct wait_cleanup_s {
+    atomic_int *waiters;
+    pthread_mutex_t *mutex; // Re-acquired by a canceled pthread_cond_wait; NULL for semaphores
+} wait_cleanup_t;
 
 /*
  * Purpose: Allocates and initializes a new shared queue structure, including
- *          memory for the message buffer and the appropriate synchronization
- *          primitives (semaphores or condition variables) based on the mode.
+ *          memory for the message buffer and the synchronization primitives
+ *          of every engine, so the queue can later be switched between them
+ *          with queue_swap_engine. The mode selects the engine used first.
  * Accepts: initial_capacity - The desired initial size of the queue buffer.
  *          mode             - The synchronization mode (SYNC_MODE_SEM or SYNC_MODE_CONDVAR).
  * Returns: A pointer to the newly created queue_t structure on success,
  *          NULL on failure (prints error message).
  */
 queue_t* queue_create(size_t initial_capacity, sync_mode_t mode) {
-    if (initial_capacity == 0) initial_capacity = INITIAL_QUEUE_CAPACITY;
-    if (initial_capacity < MIN_QUEUE_CAPACITY) initial_capacity = MIN_QUEUE_CAPACITY;
-    if (initial_capacity > MAX_QUEUE_CAPACITY) initial_capacity = MAX_QUEUE_CAPACITY;
+    if (initial_capacity == 0) initial_capacity = g_config.initial_capacity;
+    if (initial_capacity < g_config.min_capacity) initial_capacity = g_config.min_capacity;
+    if (initial_capacity > g_config.max_capacity) initial_capacity = g_config.max_capacity;
 
     queue_t *q = malloc(sizeof(queue_t));
     if (!q) { print_error("Queue Create", "Failed to allocate queue structure"); return NULL; }
@@ -36,28 +67,55 @@ queue_t* queue_create(size_t initial_capacity, sync_mode_t mode) {
     q->tail_idx = 0;
     q->added_count_total = 0;
     q->extracted_count_total = 0;
+    atomic_init(&q->snap_count, 0);
+    atomic_init(&q->snap_capacity, initial_capacity);
+    atomic_init(&q->snap_added_total, 0);
+    atomic_init(&q->snap_extracted_total, 0);
+    atomic_init(&q->snap_head_idx, 0);
+    atomic_init(&q->snap_tail_idx, 0);
+    atomic_init(&q->resize_total, 0);
+    atomic_init(&q->swap_total, 0);
+    atomic_init(&q->waiting_producers, 0);
+    atomic_init(&q->waiting_consumers, 0);
+    atomic_init(&q->waiting_resizers, 0);
+    atomic_init(&q->mode, (int)mode);
+    atomic_init(&q->active_ops, 0);
+    atomic_init(&q->swapping, false);
 
     int ret = pthread_mutex_init(&q->mutex, NULL);
     if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_mutex_init failed"); free(q->messages); free(q); return NULL; }
-
-    if (mode == SYNC_MODE_SEM) {
-        if (sem_init(&q->empty_slots, 0, (unsigned int)initial_capacity) == -1) {
-            print_error("Queue Create", "sem_init(empty_slots) failed"); goto cleanup_mutex;
-        }
-        if (sem_init(&q->full_slots, 0, 0) == -1) { // Initially 0 full slots
-            print_error("Queue Create", "sem_init(full_slots) failed"); sem_destroy(&q->empty_slots); goto cleanup_mutex;
-        }
-        print_info("Queue Create", "Queue initialized successfully (Semaphore Mode).");
-    } else { // SYNC_MODE_CONDVAR
-        ret = pthread_cond_init(&q->not_empty, NULL);
-        if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_cond_init(not_empty) failed"); goto cleanup_mutex; }
-        ret = pthread_cond_init(&q->not_full, NULL);
-        if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_cond_init(not_full) failed"); pthread_cond_destroy(&q->not_empty); goto cleanup_mutex; }
-        print_info("Queue Create", "Queue initialized successfully (CondVar Mode).");
+    ret = pthread_mutex_init(&q->gate_mutex, NULL);
+    if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_mutex_init(gate) failed"); goto cleanup_mutex; }
+    ret = pthread_cond_init(&q->gate_cond, NULL);
+    if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_cond_init(gate) failed"); goto cleanup_gate_mutex; }
+
+    // Semaphore engine
+    if (sem_init(&q->empty_slots, 0, (unsigned int)initial_capacity) == -1) {
+        print_error("Queue Create", "sem_init(empty_slots) failed"); goto cleanup_gate_cond;
     }
-
+    if (sem_init(&q->full_slots, 0, 0) == -1) { // Initially 0 full slots
+        print_error("Queue Create", "sem_init(full_slots) failed"); goto cleanup_empty_sem;
+    }
+    // Condition variable engine
+    ret = pthread_cond_init(&q->not_empty, NULL);
+    if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_cond_init(not_empty) failed"); goto cleanup_full_sem; }
+    ret = pthread_cond_init(&q->not_full, NULL);
+    if (ret != 0) { errno = ret; print_error("Queue Create", "pthread_cond_init(not_full) failed"); goto cleanup_not_empty; }
+
+    print_info("Queue Create", mode == SYNC_MODE_SEM ? "Queue initialized successfully (Semaphore Mode)."
+                                                     : "Queue initialized successfully (CondVar Mode).");
     return q;
 
+    cleanup_not_empty:
+    pthread_cond_destroy(&q->not_empty);
+    cleanup_full_sem:
+    sem_destroy(&q->full_slots);
+    cleanup_empty_sem:
+    sem_destroy(&q->empty_slots);
+    cleanup_gate_cond:
+    pthread_cond_destroy(&q->gate_cond);
+    cleanup_gate_mutex:
+    pthread_mutex_destroy(&q->gate_mutex);
     cleanup_mutex:
     pthread_mutex_destroy(&q->mutex); // Ensure mutex is destroyed on error path
     free(q->messages);
@@ -66,26 +124,30 @@ queue_t* queue_create(size_t initial_capacity, sync_mode_t mode) {
 }
 
 /*
- * Purpose: Destroys the synchronization primitives (semaphores or condition
- *          variables and mutex) and frees the memory associated with the queue.
+ * Purpose: Destroys the synchronization primitives of all engines (semaphores,
+ *          condition variables, gate and mutex) and frees the memory
+ *          associated with the queue.
  * Accepts: q    - A pointer to the queue_t structure to destroy.
- *          mode - The synchronization mode the queue was created with.
+ *          mode - The synchronization mode the queue was created with (unused;
+ *                 every engine's primitives exist regardless of the mode).
  * Returns: None.
  */
 void queue_destroy(queue_t *q, sync_mode_t mode) {
+    (void)mode;
     if (!q) return;
     print_info("Queue Destroy", "Destroying queue resources...");
 
     // Destroy synchronization primitives first
-    if (mode == SYNC_MODE_SEM) {
-        if (sem_destroy(&q->empty_slots) == -1 && errno != EINVAL) print_error("Queue Destroy", "sem_destroy(empty_slots) failed");
-        if (sem_destroy(&q->full_slots) == -1 && errno != EINVAL) print_error("Queue Destroy", "sem_destroy(full_slots) failed");
-    } else { // SYNC_MODE_CONDVAR
-        int ret_cond_ne = pthread_cond_destroy(&q->not_empty);
-        if (ret_cond_ne != 0 && ret_cond_ne != EINVAL) { errno = ret_cond_ne; print_error("Queue Destroy", "pthread_cond_destroy(not_empty) failed"); }
-        int ret_cond_nf = pthread_cond_destroy(&q->not_full);
-        if (ret_cond_nf != 0 && ret_cond_nf != EINVAL) { errno = ret_cond_nf; print_error("Queue Destroy", "pthread_cond_destroy(not_full) failed"); }
-    }
+    if (sem_destroy(&q->empty_slots) == -1 && errno != EINVAL) print_error("Queue Destroy", "sem_destroy(empty_slots) failed");
+    if (sem_destroy(&q->full_slots) == -1 && errno != EINVAL) print_error("Queue Destroy", "sem_destroy(full_slots) failed");
+    int ret_cond_ne = pthread_cond_destroy(&q->not_empty);
+    if (ret_cond_ne != 0 && ret_cond_ne != EINVAL) { errno = ret_cond_ne; print_error("Queue Destroy", "pthread_cond_destroy(not_empty) failed"); }
+    int ret_cond_nf = pthread_cond_destroy(&q->not_full);
+    if (ret_cond_nf != 0 && ret_cond_nf != EINVAL) { errno = ret_cond_nf; print_error("Queue Destroy", "pthread_cond_destroy(not_full) failed"); }
+    int ret_gate_cond = pthread_cond_destroy(&q->gate_cond);
+    if (ret_gate_cond != 0 && ret_gate_cond != EINVAL) { errno = ret_gate_cond; print_error("Queue Destroy", "pthread_cond_destroy(gate) failed"); }
+    int ret_gate = pthread_mutex_destroy(&q->gate_mutex);
+    if (ret_gate != 0 && ret_gate != EINVAL) { errno = ret_gate; print_error("Queue Destroy", "pthread_mutex_destroy(gate) failed"); }
 
     int ret_mutex = pthread_mutex_destroy(&q->mutex);
     if (ret_mutex != 0 && ret_mutex != EINVAL) { errno = ret_mutex; print_error("Queue Destroy", "pthread_mutex_destroy failed"); }
@@ -102,8 +164,9 @@ void queue_destroy(queue_t *q, sync_mode_t mode) {
 
 /*
  * Purpose: Adds a message to the shared queue. This function acts as a dispatcher,
- *          calling the appropriate internal implementation based on the global
- *          g_sync_mode. Blocks if the queue is full. Handles EINTR.
+ *          calling the implementation of the queue's current engine. Blocks if
+ *          the queue is full. Handles EINTR. An operation evicted by an engine
+ *          swap is retried transparently under the new engine.
  * Accepts: q             - Pointer to the shared queue.
  *          msg           - Pointer to the message to add.
  *          caller_prefix - String prefix for logging messages (e.g., "Producer N").
@@ -114,17 +177,31 @@ int queue_add(queue_t *q, const message_t *msg, const char* caller_prefix) {
         print_error(caller_prefix ? caller_prefix : "Queue Add", "NULL queue or message pointer.");
         return -1;
     }
-    if (g_sync_mode == SYNC_MODE_SEM) {
-        return queue_add_sem(q, msg, caller_prefix);
-    } else {
-        return queue_add_condvar(q, msg, caller_prefix);
-    }
+    TRACEPOINT(TRACE_EV_OP_BEGIN, TRACE_OP_ADD, msg->size, 0);
+    int result;
+    do {
+        if (queue_gate_enter(q) == -1) {
+            print_info(caller_prefix, "Terminating while waiting for engine swap.");
+            TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_ADD, 0, 1);
+            return -1;
+        }
+        pthread_cleanup_push(queue_gate_cleanup, q);
+        if (atomic_load(&q->mode) == SYNC_MODE_SEM) {
+            result = queue_add_sem(q, msg, caller_prefix);
+        } else {
+            result = queue_add_condvar(q, msg, caller_prefix);
+        }
+        pthread_cleanup_pop(1);
+    } while (result == QUEUE_RETRY);
+    TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_ADD, msg->size, result != 0);
+    return result;
 }
 
 /*
  * Purpose: Removes a message from the shared queue. This function acts as a dispatcher,
- *          calling the appropriate internal implementation based on the global
- *          g_sync_mode. Blocks if the queue is empty. Handles EINTR.
+ *          calling the implementation of the queue's current engine. Blocks if
+ *          the queue is empty. Handles EINTR. An operation evicted by an engine
+ *          swap is retried transparently under the new engine.
  * Accepts: q             - Pointer to the shared queue.
  *          msg           - Pointer to a message_t structure to store the removed message.
  *          caller_prefix - String prefix for logging messages (e.g., "Consumer N").
@@ -135,11 +212,118 @@ int queue_remove(queue_t *q, message_t *msg, const char* caller_prefix) {
         print_error(caller_prefix ? caller_prefix : "Queue Remove", "NULL queue or message pointer.");
         return -1;
     }
-    if (g_sync_mode == SYNC_MODE_SEM) {
-        return queue_remove_sem(q, msg, caller_prefix);
-    } else {
-        return queue_remove_condvar(q, msg, caller_prefix);
+    TRACEPOINT(TRACE_EV_OP_BEGIN, TRACE_OP_REMOVE, 0, 0);
+    int result;
+    do {
+        if (queue_gate_enter(q) == -1) {
+            print_info(caller_prefix, "Terminating while waiting for engine swap.");
+            TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_REMOVE, 0, 1);
+            return -1;
+        }
+        pthread_cleanup_push(queue_gate_cleanup, q);
+        if (atomic_load(&q->mode) == SYNC_MODE_SEM) {
+            result = queue_remove_sem(q, msg, caller_prefix);
+        } else {
+            result = queue_remove_condvar(q, msg, caller_prefix);
+        }
+        pthread_cleanup_pop(1);
+    } while (result == QUEUE_RETRY);
+    TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_REMOVE, result == 0 ? msg->size : 0, result != 0);
+    return result;
+}
+
+/*
+ * Purpose: Mirrors the mutex-protected counters into the lock-free snapshot
+ *          fields. Must be called with q->mutex held, after each change.
+ * Accepts: q - Pointer to the shared queue.
+ * Returns: None.
+ */
+static void queue_publish_stats(queue_t *q) {
+    atomic_store_explicit(&q->snap_count, q->count, memory_order_relaxed);
+    atomic_store_explicit(&q->snap_capacity, q->capacity, memory_order_relaxed);
+    atomic_store_explicit(&q->snap_added_total, q->added_count_total, memory_order_relaxed);
+    atomic_store_explicit(&q->snap_extracted_total, q->extracted_count_total, memory_order_relaxed);
+    atomic_store_explicit(&q->snap_head_idx, q->head_idx, memory_order_relaxed);
+    atomic_store_explicit(&q->snap_tail_idx, q->tail_idx, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Cancellation cleanup for the wait helpers: drops the waiter count
+ *          and, for condition variables, releases the re-acquired mutex so a
+ *          canceled thread cannot leave the queue locked.
+ * Accepts: arg - Pointer to the wait_cleanup_t of the interrupted wait.
+ * Returns: None.
+ */
+static void queue_wait_cleanup(void *arg) {
+    wait_cleanup_t *wc = (wait_cleanup_t *)arg;
+    atomic_fetch_sub(wc->waiters, 1);
+    if (wc->mutex) pthread_mutex_unlock(wc->mutex);
+}
+
+/*
+ * Purpose: Decrements a semaphore, blocking if needed. A wait that can be
+ *          satisfied immediately is not counted as a wait; a blocking one
+ *          is reflected in the waiter count and the thread state. Retries
+ *          on EINTR unless termination is requested.
+ * Accepts: q       - Pointer to the shared queue (checked for a pending swap).
+ *          sem     - The semaphore to decrement.
+ *          waiters - Waiter counter of the waiting role.
+ * Returns: 0 on success, -1 if terminating after EINTR, -2 on other errors
+ *          (errno is preserved for the caller's message), QUEUE_RETRY if an
+ *          engine swap started (the decrement is then void: the swap
+ *          rebuilds the semaphore counts).
+ */
+static int queue_sem_wait(queue_t *q, sem_t *sem, atomic_int *waiters) {
+    if (sem_trywait(sem) == 0) return atomic_load(&q->swapping) ? QUEUE_RETRY : 0;
+
+    int result = 0;
+    wait_cleanup_t wc = { waiters, NULL };
+    atomic_fetch_add(waiters, 1);
+    thread_stats_set_state(THREAD_STATE_WAITING);
+    trace_record(TRACE_EV_WAIT_BEGIN, 0, 0, queue_wait_kind(q, waiters));
+    uint64_t wait_start = monotonic_ns();
+    pthread_cleanup_push(queue_wait_cleanup, &wc);
+    while (sem_wait(sem) == -1) {
+        if (errno == EINTR) {
+            if (g_terminate_flag) { result = -1; break; }
+            continue; // Retry if interrupted but not terminating
+        }
+        result = -2;
+        break;
     }
+    pthread_cleanup_pop(0);
+    thread_stats_note_wait(monotonic_ns() - wait_start);
+    atomic_fetch_sub(waiters, 1);
+    trace_record(TRACE_EV_WAIT_END, 0, 0, queue_wait_kind(q, waiters));
+    if (result == 0 && atomic_load(&q->swapping)) result = QUEUE_RETRY;
+    return result;
+}
+
+/*
+ * Purpose: Waits on a queue condition variable with q->mutex held, keeping
+ *          the waiter count and thread state up to date.
+ * Accepts: q       - Pointer to the shared queue (its mutex must be held).
+ *          cond    - The condition variable to wait on.
+ *          waiters - Waiter counter of the waiting role.
+ * Returns: The pthread_cond_wait result (0 on success).
+ */
+static int queue_cond_wait(queue_t *q, pthread_cond_t *cond, atomic_int *waiters) {
+    int ret;
+    wait_cleanup_t wc = { waiters, &q->mutex };
+    atomic_fetch_add(waiters, 1);
+    thread_stats_set_state(THREAD_STATE_WAITING);
+    trace_record(TRACE_EV_WAIT_BEGIN, 0, 0, queue_wait_kind(q, waiters));
+    uint64_t wait_start = monotonic_ns();
+    QUEUE_HOLD_PAUSE();
+    pthread_cleanup_push(queue_wait_cleanup, &wc);
+    ret = pthread_cond_wait(cond, &q->mutex); // Unlocks mutex, waits, re-locks on wake
+    pthread_cleanup_pop(0);
+    QUEUE_HOLD_RESUME();
+    thread_stats_note_wait(monotonic_ns() - wait_start); // Includes re-acquiring the mutex
+    atomic_fetch_sub(waiters, 1);
+    trace_record(TRACE_EV_WAIT_END, 0, 0, queue_wait_kind(q, waiters));
+    thread_stats_set_state(THREAD_STATE_IN_QUEUE);
+    return ret;
 }
 
 /*
@@ -153,14 +337,10 @@ int queue_remove(queue_t *q, message_t *msg, const char* caller_prefix) {
  */
 static int queue_add_sem(queue_t *q, const message_t *msg, const char* caller_prefix) {
     // Wait for an empty slot
-    while (sem_wait(&q->empty_slots) == -1) {
-        if (errno == EINTR) {
-            if (g_terminate_flag) { print_info(caller_prefix, "Terminating during wait for empty slot (EINTR)."); return -1; }
-            continue; // Retry if interrupted but not terminating
-        } else {
-            print_error(caller_prefix, "sem_wait(empty_slots) failed"); return -1;
-        }
-    }
+    int ret_wait = queue_sem_wait(q, &q->empty_slots, &q->waiting_producers);
+    if (ret_wait == QUEUE_RETRY) return QUEUE_RETRY;
+    if (ret_wait == -1) { print_info(caller_prefix, "Terminating during wait for empty slot (EINTR)."); return -1; }
+    if (ret_wait == -2) { print_error(caller_prefix, "sem_wait(empty_slots) failed"); return -1; }
 
     // Check termination flag *after* acquiring semaphore, before locking mutex
     if (g_terminate_flag) {
@@ -169,24 +349,32 @@ static int queue_add_sem(queue_t *q, const message_t *msg, const char* caller_pr
         return -1;
     }
 
-    int ret_lock = pthread_mutex_lock(&q->mutex); PTHREAD_CHECK(ret_lock, "AddSem: Lock Mutex");
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_ADD); PTHREAD_CHECK(ret_lock, "AddSem: Lock Mutex");
+    thread_stats_set_state(THREAD_STATE_IN_QUEUE);
 
     // Critical section: Add message to queue
     // This check should ideally not fail if semaphore logic is correct
     if (q->count >= q->capacity) {
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
+        thread_stats_set_state(THREAD_STATE_RUNNING);
+        if (atomic_load(&q->swapping)) return QUEUE_RETRY; // The swap rebuilds the token counts
         sem_post(&q->empty_slots); // Give back the slot if something is wrong
         print_error(caller_prefix, "Queue full after acquiring mutex (sem logic error?)");
         return -1;
     }
-    memcpy(&q->messages[q->tail_idx], msg, sizeof(message_t));
+    int slot = q->tail_idx;
+    memcpy(&q->messages[slot], msg, sizeof(message_t));
     q->tail_idx = (q->tail_idx + 1) % q->capacity;
     q->count++;
     q->added_count_total++;
+    queue_publish_stats(q);
+    trace_record(TRACE_EV_ADD, (uint32_t)slot, msg->size, (uint32_t)q->count);
 
-    int ret_unlock = pthread_mutex_unlock(&q->mutex); PTHREAD_CHECK(ret_unlock, "AddSem: Unlock Mutex");
+    int ret_unlock = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret_unlock, "AddSem: Unlock Mutex");
+    thread_stats_set_state(THREAD_STATE_RUNNING);
 
     // Signal that a slot is now full
+    TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_FULL_SLOTS, 0, 1);
     if (sem_post(&q->full_slots) == -1) {
         print_error(caller_prefix, "sem_post(full_slots) failed");
         // This is a non-fatal error for the current operation but indicates a problem
@@ -205,14 +393,10 @@ static int queue_add_sem(queue_t *q, const message_t *msg, const char* caller_pr
  */
 static int queue_remove_sem(queue_t *q, message_t *msg, const char* caller_prefix) {
     // Wait for a full slot
-    while (sem_wait(&q->full_slots) == -1) {
-        if (errno == EINTR) {
-            if (g_terminate_flag) { print_info(caller_prefix, "Terminating during wait for full slot (EINTR)."); return -1; }
-            continue; // Retry
-        } else {
-            print_error(caller_prefix, "sem_wait(full_slots) failed"); return -1;
-        }
-    }
+    int ret_wait = queue_sem_wait(q, &q->full_slots, &q->waiting_consumers);
+    if (ret_wait == QUEUE_RETRY) return QUEUE_RETRY;
+    if (ret_wait == -1) { print_info(caller_prefix, "Terminating during wait for full slot (EINTR)."); return -1; }
+    if (ret_wait == -2) { print_error(caller_prefix, "sem_wait(full_slots) failed"); return -1; }
 
     if (g_terminate_flag) {
         sem_post(&q->full_slots); // Release acquired slot
@@ -220,21 +404,29 @@ static int queue_remove_sem(queue_t *q, message_t *msg, const char* caller_prefi
         return -1;
     }
 
-    int ret_lock = pthread_mutex_lock(&q->mutex); PTHREAD_CHECK(ret_lock, "RemoveSem: Lock Mutex");
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_REMOVE); PTHREAD_CHECK(ret_lock, "RemoveSem: Lock Mutex");
+    thread_stats_set_state(THREAD_STATE_IN_QUEUE);
 
     if (q->count == 0) { // Should not happen if semaphores are correct
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
+        thread_stats_set_state(THREAD_STATE_RUNNING);
+        if (atomic_load(&q->swapping)) return QUEUE_RETRY;
         sem_post(&q->full_slots); // Give back slot
         print_error(caller_prefix, "Queue empty after acquiring mutex (sem logic error?)");
         return -1;
     }
-    memcpy(msg, &q->messages[q->head_idx], sizeof(message_t));
+    int slot = q->head_idx;
+    memcpy(msg, &q->messages[slot], sizeof(message_t));
     q->head_idx = (q->head_idx + 1) % q->capacity;
     q->count--;
     q->extracted_count_total++;
+    queue_publish_stats(q);
+    trace_record(TRACE_EV_REMOVE, (uint32_t)slot, msg->size, (uint32_t)q->count);
 
-    int ret_unlock = pthread_mutex_unlock(&q->mutex); PTHREAD_CHECK(ret_unlock, "RemoveSem: Unlock Mutex");
+    int ret_unlock = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret_unlock, "RemoveSem: Unlock Mutex");
+    thread_stats_set_state(THREAD_STATE_RUNNING);
 
+    TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_EMPTY_SLOTS, 0, 1);
     if (sem_post(&q->empty_slots) == -1) {
         print_error(caller_prefix, "sem_post(empty_slots) failed");
     }
@@ -252,43 +444,54 @@ static int queue_remove_sem(queue_t *q, message_t *msg, const char* caller_prefi
  */
 static int queue_add_condvar(queue_t *q, const message_t *msg, const char* caller_prefix) {
     int ret;
-    ret = pthread_mutex_lock(&q->mutex); PTHREAD_CHECK(ret, "AddCond: Lock Mutex");
+    ret = QUEUE_LOCK(q, LOCK_SITE_ADD); PTHREAD_CHECK(ret, "AddCond: Lock Mutex");
+    thread_stats_set_state(THREAD_STATE_IN_QUEUE);
 
     while (q->count == q->capacity && !g_terminate_flag) {
         print_info(caller_prefix, "Queue full, waiting...");
-        ret = pthread_cond_wait(&q->not_full, &q->mutex); // Unlocks mutex, waits, re-locks on wake
+        ret = queue_cond_wait(q, &q->not_full, &q->waiting_producers);
         if (ret != 0) {
             errno = ret; print_error(caller_prefix, "pthread_cond_wait(not_full) failed");
-            pthread_mutex_unlock(&q->mutex); // Ensure mutex is unlocked on error
+            QUEUE_UNLOCK(q); // Ensure mutex is unlocked on error
             return -1;
         }
+        if (atomic_load(&q->swapping)) { // Evicted by an engine swap
+            QUEUE_UNLOCK(q);
+            thread_stats_set_state(THREAD_STATE_RUNNING);
+            return QUEUE_RETRY;
+        }
         // Spurious wakeup or actual signal, re-check condition
     }
 
     if (g_terminate_flag) { // Check termination after potential wait
         print_info(caller_prefix, "Terminating while waiting to add (or after wake-up).");
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
         return -1;
     }
 
     // At this point, q->count < q->capacity (or terminate flag was set and handled)
     if (q->count >= q->capacity) { // Should not happen if logic is correct and not terminating
         print_error(caller_prefix, "Queue still full after cond_wait (logic error or race).");
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
         return -1;
     }
 
 
-    memcpy(&q->messages[q->tail_idx], msg, sizeof(message_t));
+    int slot = q->tail_idx;
+    memcpy(&q->messages[slot], msg, sizeof(message_t));
     q->tail_idx = (q->tail_idx + 1) % q->capacity;
     q->count++;
     q->added_count_total++;
+    queue_publish_stats(q);
+    trace_record(TRACE_EV_ADD, (uint32_t)slot, msg->size, (uint32_t)q->count);
 
     // Signal one waiting consumer (if any) that queue is no longer empty
+    TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_NOT_EMPTY, 0, 0);
     ret = pthread_cond_signal(&q->not_empty);
     if (ret != 0) { errno = ret; print_error(caller_prefix, "pthread_cond_signal(not_empty) failed"); }
 
-    ret = pthread_mutex_unlock(&q->mutex); PTHREAD_CHECK(ret, "AddCond: Unlock Mutex");
+    ret = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret, "AddCond: Unlock Mutex");
+    thread_stats_set_state(THREAD_STATE_RUNNING);
     return 0;
 }
 
@@ -303,39 +506,50 @@ static int queue_add_condvar(queue_t *q, const message_t *msg, const char* calle
  */
 static int queue_remove_condvar(queue_t *q, message_t *msg, const char* caller_prefix) {
     int ret;
-    ret = pthread_mutex_lock(&q->mutex); PTHREAD_CHECK(ret, "RemoveCond: Lock Mutex");
+    ret = QUEUE_LOCK(q, LOCK_SITE_REMOVE); PTHREAD_CHECK(ret, "RemoveCond: Lock Mutex");
+    thread_stats_set_state(THREAD_STATE_IN_QUEUE);
 
     while (q->count == 0 && !g_terminate_flag) {
         print_info(caller_prefix, "Queue empty, waiting...");
-        ret = pthread_cond_wait(&q->not_empty, &q->mutex);
+        ret = queue_cond_wait(q, &q->not_empty, &q->waiting_consumers);
         if (ret != 0) {
             errno = ret; print_error(caller_prefix, "pthread_cond_wait(not_empty) failed");
-            pthread_mutex_unlock(&q->mutex);
+            QUEUE_UNLOCK(q);
             return -1;
         }
+        if (atomic_load(&q->swapping)) { // Evicted by an engine swap
+            QUEUE_UNLOCK(q);
+            thread_stats_set_state(THREAD_STATE_RUNNING);
+            return QUEUE_RETRY;
+        }
     }
 
     if (g_terminate_flag) {
         print_info(caller_prefix, "Terminating while waiting to remove (or after wake-up).");
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
         return -1;
     }
 
     if (q->count == 0) { // Should not happen if logic is correct and not terminating
         print_error(caller_prefix, "Queue still empty after cond_wait (logic error or race).");
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
         return -1;
     }
 
-    memcpy(msg, &q->messages[q->head_idx], sizeof(message_t));
+    int slot = q->head_idx;
+    memcpy(msg, &q->messages[slot], sizeof(message_t));
     q->head_idx = (q->head_idx + 1) % q->capacity;
     q->count--;
     q->extracted_count_total++;
+    queue_publish_stats(q);
+    trace_record(TRACE_EV_REMOVE, (uint32_t)slot, msg->size, (uint32_t)q->count);
 
+    TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_NOT_FULL, 0, 0);
     ret = pthread_cond_signal(&q->not_full);
     if (ret != 0) { errno = ret; print_error(caller_prefix, "pthread_cond_signal(not_full) failed"); }
 
-    ret = pthread_mutex_unlock(&q->mutex); PTHREAD_CHECK(ret, "RemoveCond: Unlock Mutex");
+    ret = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret, "RemoveCond: Unlock Mutex");
+    thread_stats_set_state(THREAD_STATE_RUNNING);
     return 0;
 }
 
@@ -343,7 +557,8 @@ static int queue_remove_condvar(queue_t *q, message_t *msg, const char* caller_p
 /*
  * Purpose: Attempts to resize the queue's message buffer and adjust associated
  *          synchronization primitives. Handles both increasing and decreasing size.
- *          Shrinking requires waiting for enough empty slots (semaphore mode).
+ *          Shrinking requires waiting for enough empty slots (semaphore mode);
+ *          a resize evicted by an engine swap is retried under the new engine.
  *          Correctly handles ring buffer data by linearizing it.
  * Accepts: q      - Pointer to the shared queue.
  *          change - The amount to change the capacity by (positive to increase,
@@ -352,52 +567,127 @@ static int queue_remove_condvar(queue_t *q, message_t *msg, const char* caller_p
  */
 int queue_resize(queue_t *q, int change) {
     if (!q || change == 0) return -1;
+    TRACEPOINT(TRACE_EV_OP_BEGIN, TRACE_OP_RESIZE, 0, 0);
+    int result;
+    do {
+        if (queue_gate_enter(q) == -1) { TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_RESIZE, 0, 1); return -1; }
+        thread_stats_set_state(THREAD_STATE_RESIZING);
+        result = queue_resize_impl(q, change);
+        thread_stats_set_state(THREAD_STATE_RUNNING);
+        queue_gate_leave(q);
+    } while (result == QUEUE_RETRY);
+    TRACEPOINT(TRACE_EV_OP_END, TRACE_OP_RESIZE, 0, result != 0);
+    return result;
+}
 
+/*
+ * Purpose: Body of queue_resize; the public wrapper tracks thread state so
+ *          the watchdog can see a resize that does not finish, and retries
+ *          a resize evicted by an engine swap.
+ *          In semaphore mode a shrink first reserves the removed slots'
+ *          empty_slots tokens, before taking the mutex: a producer that
+ *          already holds a token needs the mutex to use it, and a consumer
+ *          needs it to free a slot, so waiting for tokens under the mutex
+ *          could block forever.
+ * Accepts: q      - Pointer to the shared queue.
+ *          change - The amount to change the capacity by (non-zero).
+ * Returns: 0 on success, -1 on failure, QUEUE_RETRY if an engine swap
+ *          started while reserving (the reserved tokens are void: the swap
+ *          rebuilds the semaphore counts).
+ */
+static int queue_resize_impl(queue_t *q, int change) {
     char prefix[64];
     snprintf(prefix, sizeof(prefix), "Queue Resize (%s by %d)", change > 0 ? "Increase" : "Decrease", change > 0 ? change : -change);
     print_info(prefix, "Resize requested.");
 
-    int ret_lock = pthread_mutex_lock(&q->mutex); PTHREAD_CHECK(ret_lock, "Resize: Lock Mutex");
+    // Reserve the tokens of the slots a shrink removes (at most down to the
+    // minimum capacity, as of the lock-free snapshot; re-checked under the lock)
+    size_t reserved = 0;
+    bool sem_mode = atomic_load(&q->mode) == SYNC_MODE_SEM;
+    if (change < 0 && sem_mode) {
+        size_t snap_capacity = atomic_load_explicit(&q->snap_capacity, memory_order_relaxed);
+        size_t wanted = snap_capacity > g_config.min_capacity ? snap_capacity - g_config.min_capacity : 0;
+        if ((size_t)(-change) < wanted) wanted = (size_t)(-change);
+        if (wanted > 0) log_write(LOG_LEVEL_INFO, "[%s] Waiting to acquire %zu removed empty semaphore slots...", prefix, wanted);
+        for (; reserved < wanted; ++reserved) {
+            // Succeeds at once for a slot that is empty; otherwise blocks until
+            // a consumer frees one, or until termination
+            int ret_wait = queue_sem_wait(q, &q->empty_slots, &q->waiting_resizers);
+            thread_stats_set_state(THREAD_STATE_RESIZING);
+            if (ret_wait == QUEUE_RETRY) {
+                print_info(prefix, "Engine swap started; retrying the resize after it.");
+                return QUEUE_RETRY;
+            }
+            if (ret_wait != 0) {
+                if (ret_wait == -1) print_info(prefix, "Terminating during sem_wait for shrink.");
+                else print_error(prefix, "sem_wait(empty_slots) failed during shrink");
+                for (size_t i = 0; i < reserved; ++i) sem_post(&q->empty_slots); // Give the reservation back
+                return -1;
+            }
+            // Shutdown wakes this wait with a post (queue_wake_all), not EINTR
+            if (g_terminate_flag) {
+                print_info(prefix, "Terminating while reserving slots for shrink.");
+                for (size_t i = 0; i <= reserved; ++i) sem_post(&q->empty_slots); // Including the token just taken
+                return -1;
+            }
+        }
+    }
+
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_RESIZE); PTHREAD_CHECK(ret_lock, "Resize: Lock Mutex");
+    TRACEPOINT(TRACE_EV_RESIZE_PHASE, TRACE_RESIZE_LOCKED, 0, q->capacity);
 
     size_t old_capacity = q->capacity;
     size_t current_count = q->count;
     size_t new_capacity;
 
+    size_t max_capacity = g_config.max_capacity;
+    size_t min_capacity = g_config.min_capacity;
+
     if (change > 0) {
-        if ((size_t)change > MAX_QUEUE_CAPACITY - old_capacity) { // Check for overflow before addition
-            new_capacity = MAX_QUEUE_CAPACITY;
+        if (old_capacity >= max_capacity || (size_t)change > max_capacity - old_capacity) { // Check for overflow before addition
+            new_capacity = max_capacity;
         } else {
             new_capacity = old_capacity + (size_t)change;
         }
-        if (new_capacity > MAX_QUEUE_CAPACITY) new_capacity = MAX_QUEUE_CAPACITY;
+        if (new_capacity > max_capacity) new_capacity = max_capacity;
     } else { // change < 0
-        size_t decrease_amount = (size_t)(-change);
+        // Semaphore mode can only remove the slots whose tokens it reserved
+        size_t decrease_amount = sem_mode ? reserved : (size_t)(-change);
         if (decrease_amount >= old_capacity) { // Prevent underflow to 0 or negative
-            new_capacity = MIN_QUEUE_CAPACITY;
+            new_capacity = min_capacity;
         } else {
             new_capacity = old_capacity - decrease_amount;
         }
-        if (new_capacity < MIN_QUEUE_CAPACITY) new_capacity = MIN_QUEUE_CAPACITY;
+        if (new_capacity < min_capacity) new_capacity = min_capacity;
+        if (decrease_amount == 0) new_capacity = old_capacity;
+    }
+
+    // Reserved tokens the shrink does not use go back (the capacity moved
+    // since the snapshot, or the shrink is refused)
+    size_t used = (sem_mode && new_capacity < old_capacity && new_capacity >= current_count) ? old_capacity - new_capacity : 0;
+    for (size_t i = used; i < reserved; ++i) {
+        if (sem_post(&q->empty_slots) == -1) print_error(prefix, "sem_post(empty_slots) failed returning reserved slots");
     }
 
     if (new_capacity == old_capacity) {
         print_info(prefix, "No change in capacity needed/possible (already at min/max or no effective change).");
-        pthread_mutex_unlock(&q->mutex);
+        QUEUE_UNLOCK(q);
         return 0;
     }
 
     if (new_capacity < current_count) {
-        printf("[%s] Cannot shrink queue: new capacity %zu is smaller than current item count %zu.\r\n", prefix, new_capacity, current_count);
-        pthread_mutex_unlock(&q->mutex);
+        log_write(LOG_LEVEL_INFO, "[%s] Cannot shrink queue: new capacity %zu is smaller than current item count %zu.", prefix, new_capacity, current_count);
+        QUEUE_UNLOCK(q);
         return -1;
     }
 
-    printf("[%s] Attempting to change capacity from %zu to %zu (current items: %zu).\r\n", prefix, old_capacity, new_capacity, current_count);
+    log_write(LOG_LEVEL_INFO, "[%s] Attempting to change capacity from %zu to %zu (current items: %zu).", prefix, old_capacity, new_capacity, current_count);
 
     message_t *new_messages_buffer = malloc(new_capacity * sizeof(message_t));
     if (!new_messages_buffer) {
         print_error(prefix, "malloc for new message buffer failed");
-        pthread_mutex_unlock(&q->mutex);
+        for (size_t i = 0; i < used; ++i) sem_post(&q->empty_slots);
+        QUEUE_UNLOCK(q);
         return -1; // Malloc failure, abort not appropriate here, return error
     }
 
@@ -423,56 +713,38 @@ int queue_resize(queue_t *q, int change) {
     // If current_count == new_capacity, then tail_idx is new_capacity.
     // Let's simplify: if current_count == new_capacity, tail_idx is 0. Else tail_idx is current_count.
     q->tail_idx = (current_count == new_capacity && new_capacity > 0) ? 0 : current_count;
+    queue_publish_stats(q);
+    atomic_store_explicit(&q->resize_total, atomic_load_explicit(&q->resize_total, memory_order_relaxed) + 1, memory_order_relaxed);
+    trace_record(TRACE_EV_RESIZE, (uint32_t)old_capacity, 0, (uint32_t)new_capacity);
+    TRACEPOINT(TRACE_EV_RESIZE_PHASE, TRACE_RESIZE_COPIED, 0, new_capacity);
 
 
-    printf("[%s] Buffer reallocated. New capacity: %zu, head: %d, tail: %d, count: %zu\r\n",
+    log_write(LOG_LEVEL_INFO, "[%s] Buffer reallocated. New capacity: %zu, head: %d, tail: %d, count: %zu",
            prefix, q->capacity, q->head_idx, q->tail_idx, q->count);
 
     // Adjust Synchronization Primitives
-    if (g_sync_mode == SYNC_MODE_SEM) {
+    if (atomic_load(&q->mode) == SYNC_MODE_SEM) {
         if (new_capacity > old_capacity) { // Increased size
             size_t added_slots = new_capacity - old_capacity;
-            printf("[%s] Posting %zu new empty semaphore slots...\r\n", prefix, added_slots);
+            log_write(LOG_LEVEL_INFO, "[%s] Posting %zu new empty semaphore slots...", prefix, added_slots);
+            TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_EMPTY_SLOTS, 0, added_slots);
             for (size_t i = 0; i < added_slots; ++i) {
                 if (sem_post(&q->empty_slots) == -1) print_error(prefix, "sem_post(empty_slots) failed during grow");
             }
-        } else { // Decreased size (new_capacity < old_capacity)
-            size_t removed_slots = old_capacity - new_capacity;
-            printf("[%s] Waiting to acquire %zu removed empty semaphore slots...\r\n", prefix, removed_slots);
-            for (size_t i = 0; i < removed_slots; ++i) {
-                // This loop attempts to decrement the empty_slots semaphore.
-                // It effectively "takes back" the slots that are no longer part of the queue.
-                // If these slots are currently "empty" (sem_wait succeeds), they are reclaimed.
-                // If they are notionally "full" (sem_wait would block), this call will block
-                // until a consumer makes them empty, or until termination.
-                while (sem_wait(&q->empty_slots) == -1) {
-                    if (errno == EINTR) {
-                        if (g_terminate_flag) {
-                            print_info(prefix, "Terminating during sem_wait for shrink.");
-                            // Unlock and return error, as resize cannot complete.
-                            // The queue might be in an inconsistent state regarding semaphore counts.
-                            pthread_mutex_unlock(&q->mutex);
-                            return -1;
-                        }
-                        continue; // Retry if interrupted
-                    } else {
-                        print_error(prefix, "sem_wait(empty_slots) failed during shrink");
-                        pthread_mutex_unlock(&q->mutex); // Unlock before failing
-                        return -1;
-                    }
-                }
-            }
-            printf("[%s] Acquired %zu empty slots for shrinking.\r\n", prefix, removed_slots);
+        } else { // Decreased size: the removed slots' tokens were reserved before locking
+            log_write(LOG_LEVEL_INFO, "[%s] Acquired %zu empty slots for shrinking.", prefix, used);
         }
     } else { // SYNC_MODE_CONDVAR
         // After resize, conditions for not_empty or not_full might have changed.
         // Broadcast to wake up any waiting threads so they can re-evaluate.
         print_info(prefix, "Broadcasting condition variables after resize...");
+        TRACEPOINT(TRACE_EV_SIGNAL, TRACE_SIGNAL_BROADCAST, 0, 0);
         pthread_cond_broadcast(&q->not_empty);
         pthread_cond_broadcast(&q->not_full);
     }
+    TRACEPOINT(TRACE_EV_RESIZE_PHASE, TRACE_RESIZE_SYNCED, 0, q->capacity);
 
-    int ret_unlock = pthread_mutex_unlock(&q->mutex); PTHREAD_CHECK(ret_unlock, "Resize: Unlock Mutex");
+    int ret_unlock = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret_unlock, "Resize: Unlock Mutex");
     print_info(prefix, "Resize complete.");
     return 0;
 }
@@ -486,10 +758,10 @@ int queue_resize(queue_t *q, int change) {
 size_t queue_get_count(queue_t *q) {
     if (!q) return 0;
     size_t count_val = 0;
-    int ret_lock = pthread_mutex_lock(&q->mutex);
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_GETTER);
     if (ret_lock != 0) { errno = ret_lock; print_error("QueueGetCount", "Failed to lock mutex"); return 0; /* Or some error indicator */ }
     count_val = q->count;
-    pthread_mutex_unlock(&q->mutex);
+    QUEUE_UNLOCK(q);
     return count_val;
 }
 
@@ -501,10 +773,10 @@ size_t queue_get_count(queue_t *q) {
 size_t queue_get_capacity(queue_t *q) {
     if (!q) return 0;
     size_t cap_val = 0;
-    int ret_lock = pthread_mutex_lock(&q->mutex);
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_GETTER);
     if (ret_lock != 0) { errno = ret_lock; print_error("QueueGetCapacity", "Failed to lock mutex"); return 0; }
     cap_val = q->capacity;
-    pthread_mutex_unlock(&q->mutex);
+    QUEUE_UNLOCK(q);
     return cap_val;
 }
 
@@ -516,10 +788,10 @@ size_t queue_get_capacity(queue_t *q) {
 unsigned long queue_get_added_total(queue_t *q) {
     if (!q) return 0;
     unsigned long added_val = 0;
-    int ret_lock = pthread_mutex_lock(&q->mutex);
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_GETTER);
     if (ret_lock != 0) { errno = ret_lock; print_error("QueueGetAdded", "Failed to lock mutex"); return 0; }
     added_val = q->added_count_total;
-    pthread_mutex_unlock(&q->mutex);
+    QUEUE_UNLOCK(q);
     return added_val;
 }
 
@@ -531,9 +803,257 @@ unsigned long queue_get_added_total(queue_t *q) {
 unsigned long queue_get_extracted_total(queue_t *q) {
     if (!q) return 0;
     unsigned long extracted_val = 0;
-    int ret_lock = pthread_mutex_lock(&q->mutex);
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_GETTER);
     if (ret_lock != 0) { errno = ret_lock; print_error("QueueGetExtracted", "Failed to lock mutex"); return 0; }
     extracted_val = q->extracted_count_total;
-    pthread_mutex_unlock(&q->mutex);
+    QUEUE_UNLOCK(q);
     return extracted_val;
 }
+
+/*
+ * Purpose: Fills a stats snapshot from the lock-free mirror fields without
+ *          taking the queue mutex. Fields are individually consistent; the
+ *          set as a whole may straddle a concurrent add or remove.
+ * Accepts: q   - Pointer to the shared queue.
+ *          out - Pointer to the snapshot structure to fill.
+ * Returns: None.
+ */
+void queue_get_stats_snapshot(queue_t *q, queue_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!q) return;
+    out->mode = (sync_mode_t)atomic_load_explicit(&q->mode, memory_order_relaxed);
+    out->count = atomic_load_explicit(&q->snap_count, memory_order_relaxed);
+    out->capacity = atomic_load_explicit(&q->snap_capacity, memory_order_relaxed);
+    out->added_total = atomic_load_explicit(&q->snap_added_total, memory_order_relaxed);
+    out->extracted_total = atomic_load_explicit(&q->snap_extracted_total, memory_order_relaxed);
+    out->head_idx = atomic_load_explicit(&q->snap_head_idx, memory_order_relaxed);
+    out->tail_idx = atomic_load_explicit(&q->snap_tail_idx, memory_order_relaxed);
+    out->waiting_producers = atomic_load_explicit(&q->waiting_producers, memory_order_relaxed);
+    out->waiting_consumers = atomic_load_explicit(&q->waiting_consumers, memory_order_relaxed);
+    out->waiting_resizers = atomic_load_explicit(&q->waiting_resizers, memory_order_relaxed);
+    out->resize_total = atomic_load_explicit(&q->resize_total, memory_order_relaxed);
+    out->swap_total = atomic_load_explicit(&q->swap_total, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Switches a live queue to another synchronization engine. New
+ *          operations are held at the gate, operations already inside the
+ *          queue are woken and evicted (they retry under the new engine once
+ *          the swap completes), and the new engine's state is derived from
+ *          the ring buffer, which all engines share and which therefore
+ *          stays in place. Reports the pause on stdout.
+ * Accepts: q        - Pointer to the shared queue.
+ *          new_mode - The engine to switch to.
+ *          pause_ns - Where to store how long operations were held, in
+ *                     nanoseconds (may be NULL; 0 if nothing was swapped).
+ * Returns: 0 on success (including when new_mode is already active),
+ *          -1 on invalid mode, a concurrent swap, or a failed engine reset.
+ */
+int queue_swap_engine(queue_t *q, sync_mode_t new_mode, uint64_t *pause_ns) {
+    if (pause_ns) *pause_ns = 0;
+    if (!q || (new_mode != SYNC_MODE_SEM && new_mode != SYNC_MODE_CONDVAR)) {
+        errno = EINVAL; print_error("Queue Swap", "Invalid queue or engine."); return -1;
+    }
+    sync_mode_t old_mode = (sync_mode_t)atomic_load(&q->mode);
+    if (old_mode == new_mode) return 0;
+
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&q->swapping, &expected, true)) {
+        print_info("Queue Swap", "Another engine swap is already in progress.");
+        return -1;
+    }
+    uint64_t start_ns = monotonic_ns();
+    int evicted = atomic_load(&q->waiting_producers) + atomic_load(&q->waiting_consumers) + atomic_load(&q->waiting_resizers);
+
+    // Drain the gate. Wake-ups are repeated because one can race with a
+    // thread that is just about to block; every woken thread sees the swap.
+    while (atomic_load(&q->active_ops) > 0) {
+        queue_kick_waiters(q, 1);
+        struct timespec kick_pause = { 0, SWAP_KICK_INTERVAL_NS };
+        nanosleep(&kick_pause, NULL);
+    }
+
+    int result = 0;
+    int ret_lock = QUEUE_LOCK(q, LOCK_SITE_SWAP); PTHREAD_CHECK(ret_lock, "Swap: Lock Mutex");
+    if (new_mode == SYNC_MODE_SEM) result = queue_reset_sems(q); // Condition variables carry no state
+    if (result == 0) {
+        atomic_store(&q->mode, (int)new_mode);
+        atomic_fetch_add_explicit(&q->swap_total, 1, memory_order_relaxed);
+    }
+    size_t count = q->count, capacity = q->capacity;
+    int ret_unlock = QUEUE_UNLOCK(q); PTHREAD_CHECK(ret_unlock, "Swap: Unlock Mutex");
+
+    // Reopen the gate
+    atomic_store(&q->swapping, false);
+    int ret_gate = pthread_mutex_lock(&q->gate_mutex); PTHREAD_CHECK(ret_gate, "Swap: Lock Gate");
+    pthread_cond_broadcast(&q->gate_cond);
+    ret_gate = pthread_mutex_unlock(&q->gate_mutex); PTHREAD_CHECK(ret_gate, "Swap: Unlock Gate");
+
+    uint64_t paused = monotonic_ns() - start_ns;
+    if (pause_ns) *pause_ns = paused;
+    trace_record(TRACE_EV_SWAP, (uint32_t)new_mode, 0, (uint32_t)(paused / 1000));
+    if (result == 0) {
+        printf("[Queue Swap] Engine %s -> %s: paused %.1f us, %d waiter(s) migrated, %zu/%zu items kept in place.\r\n",
+               queue_engine_name(old_mode), queue_engine_name(new_mode), (double)paused / 1e3, evicted, count, capacity);
+        fflush(stdout);
+    }
+    return result;
+}
+
+/*
+ * Purpose: Wakes every thread blocked anywhere in the queue, regardless of
+ *          the current engine: posts both semaphores, broadcasts both
+ *          condition variables (if the mutex can be taken without blocking)
+ *          and releases operations held at the swap gate. Intended for
+ *          shutdown, after g_terminate_flag has been set.
+ * Accepts: q         - Pointer to the shared queue.
+ *          sem_posts - How many times to post each semaphore.
+ * Returns: None.
+ */
+void queue_wake_all(queue_t *q, int sem_posts) {
+    if (!q) return;
+    queue_kick_waiters(q, sem_posts);
+    int ret_gate = pthread_mutex_lock(&q->gate_mutex);
+    if (ret_gate != 0) { errno = ret_gate; print_error("Queue Wake", "Failed to lock gate mutex"); return; }
+    pthread_cond_broadcast(&q->gate_cond);
+    pthread_mutex_unlock(&q->gate_mutex);
+}
+
+/*
+ * Purpose: Returns the short name of an engine ("sem" or "cond"), matching
+ *          the values accepted by the mode option.
+ * Accepts: mode - The engine to name.
+ * Returns: Pointer to a static string.
+ */
+const char* queue_engine_name(sync_mode_t mode) {
+    switch (mode) {
+        case SYNC_MODE_SEM: return "sem";
+        case SYNC_MODE_CONDVAR: return "cond";
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Admits an operation into the queue. While an engine swap is in
+ *          progress the caller sleeps on the gate until the swap finishes.
+ * Accepts: q - Pointer to the shared queue.
+ * Returns: 0 once admitted (pair with queue_gate_leave), -1 if termination
+ *          was requested while held at the gate.
+ */
+static int queue_gate_enter(queue_t *q) {
+    for (;;) {
+        atomic_fetch_add(&q->active_ops, 1);
+        if (!atomic_load(&q->swapping)) return 0;
+        queue_gate_leave(q); // Back out so the swap can finish draining
+        queue_gate_wait(q);
+        if (g_terminate_flag) return -1;
+    }
+}
+
+/*
+ * Purpose: Sleeps until the engine swap in progress finishes or termination
+ *          is requested.
+ * Accepts: q - Pointer to the shared queue.
+ * Returns: None.
+ */
+static void queue_gate_wait(queue_t *q) {
+    int ret = pthread_mutex_lock(&q->gate_mutex); PTHREAD_CHECK(ret, "Gate: Lock Mutex");
+    thread_stats_set_state(THREAD_STATE_WAITING);
+    trace_record(TRACE_EV_WAIT_BEGIN, 0, 0, TRACE_WAIT_GATE);
+    uint64_t wait_start = monotonic_ns();
+    pthread_cleanup_push(queue_unlock_cleanup, &q->gate_mutex);
+    while (atomic_load(&q->swapping) && !g_terminate_flag) {
+        ret = pthread_cond_wait(&q->gate_cond, &q->gate_mutex);
+        if (ret != 0) { errno = ret; print_error("Gate", "pthread_cond_wait(gate) failed"); break; }
+    }
+    pthread_cleanup_pop(1); // Unlocks gate_mutex
+    thread_stats_note_wait(monotonic_ns() - wait_start);
+    trace_record(TRACE_EV_WAIT_END, 0, 0, TRACE_WAIT_GATE);
+    thread_stats_set_state(THREAD_STATE_RUNNING);
+}
+
+/*
+ * Purpose: Marks an operation admitted by queue_gate_enter as finished.
+ * Accepts: q - Pointer to the shared queue.
+ * Returns: None.
+ */
+static void queue_gate_leave(queue_t *q) {
+    atomic_fetch_sub(&q->active_ops, 1);
+}
+
+/*
+ * Purpose: Cleanup-handler adapter for queue_gate_leave, so a thread canceled
+ *          inside an operation does not block future swaps forever.
+ * Accepts: arg - Pointer to the shared queue.
+ * Returns: None.
+ */
+static void queue_gate_cleanup(void *arg) {
+    queue_gate_leave((queue_t *)arg);
+}
+
+/*
+ * Purpose: Cleanup handler that unlocks a mutex.
+ * Accepts: arg - Pointer to the pthread_mutex_t to unlock.
+ * Returns: None.
+ */
+static void queue_unlock_cleanup(void *arg) {
+    pthread_mutex_unlock((pthread_mutex_t *)arg);
+}
+
+/*
+ * Purpose: Wakes threads blocked in either engine. Semaphores are posted
+ *          blindly; the condition variables are broadcast only if the mutex
+ *          is free, so a wake-up round never blocks behind its holder.
+ * Accepts: q         - Pointer to the shared queue.
+ *          sem_posts - How many times to post each semaphore.
+ * Returns: None.
+ */
+static void queue_kick_waiters(queue_t *q, int sem_posts) {
+    for (int i = 0; i < sem_posts; ++i) {
+        // EINVAL (already destroyed) or EOVERFLOW are harmless here
+        sem_post(&q->empty_slots);
+        sem_post(&q->full_slots);
+    }
+    int ret_lock = pthread_mutex_trylock(&q->mutex);
+    if (ret_lock == 0) {
+        pthread_cond_broadcast(&q->not_empty);
+        pthread_cond_broadcast(&q->not_full);
+        pthread_mutex_unlock(&q->mutex);
+    } else if (ret_lock != EBUSY) {
+        errno = ret_lock; print_error("Queue Wake", "Failed to trylock queue mutex for cond_broadcast");
+    }
+}
+
+/*
+ * Purpose: Re-creates both semaphores with counts derived from the ring
+ *          buffer. Only valid while the gate is drained (no thread can be
+ *          waiting on them) and with q->mutex held.
+ * Accepts: q - Pointer to the shared queue.
+ * Returns: 0 on success, -1 if a semaphore could not be initialized.
+ */
+static int queue_reset_sems(queue_t *q) {
+    sem_destroy(&q->empty_slots);
+    sem_destroy(&q->full_slots);
+    if (sem_init(&q->empty_slots, 0, (unsigned int)(q->capacity - q->count)) == -1) {
+        print_error("Queue Swap", "sem_init(empty_slots) failed");
+        return -1;
+    }
+    if (sem_init(&q->full_slots, 0, (unsigned int)q->count) == -1) {
+        print_error("Queue Swap", "sem_init(full_slots) failed");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Purpose: Maps a waiter counter to the wait kind recorded in trace events.
+ * Accepts: q       - Pointer to the shared queue.
+ *          waiters - One of the queue's waiter counters.
+ * Returns: A trace_wait_kind_t value.
+ */
+static uint32_t queue_wait_kind(queue_t *q, atomic_int *waiters) {
+    if (waiters == &q->waiting_producers) return TRACE_WAIT_SLOT;
+    if (waiters == &q->waiting_consumers) return TRACE_WAIT_ITEM;
+    return TRACE_WAIT_SHRINK;
+}
@@ -7,8 +7,9 @@
 
 /*
  * Purpose: Allocates and initializes a new shared queue structure, including
- *          memory for the message buffer and the appropriate synchronization
- *          primitives (semaphores or condition variables) based on the mode.
+ *          memory for the message buffer and the synchronization primitives
+ *          of every engine, so the queue can later be switched between them
+ *          with queue_swap_engine. The mode selects the engine used first.
  * Accepts: initial_capacity - The desired initial size of the queue buffer.
  *          mode             - The synchronization mode (SYNC_MODE_SEM or SYNC_MODE_CONDVAR).
  * Returns: A pointer to the newly created queue_t structure on success,
@@ -17,18 +18,21 @@
 queue_t* queue_create(size_t initial_capacity, sync_mode_t mode);
 
 /*
- * Purpose: Destroys the synchronization primitives (semaphores or condition
- *          variables and mutex) and frees the memory associated with the queue.
+ * Purpose: Destroys the synchronization primitives of all engines (semaphores,
+ *          condition variables, gate and mutex) and frees the memory
+ *          associated with the queue.
  * Accepts: q    - A pointer to the queue_t structure to destroy.
- *          mode - The synchronization mode the queue was created with.
+ *          mode - The synchronization mode the queue was created with (unused;
+ *                 every engine's primitives exist regardless of the mode).
  * Returns: None.
  */
 void queue_destroy(queue_t *q, sync_mode_t mode);
 
 /*
  * Purpose: Adds a message to the shared queue. This function acts as a dispatcher,
- *          calling the appropriate internal implementation based on the global
- *          g_sync_mode. Blocks if the queue is full. Handles EINTR.
+ *          calling the implementation of the queue's current engine. Blocks if
+ *          the queue is full. Handles EINTR. An operation evicted by an engine
+ *          swap is retried transparently under the new engine.
  * Accepts: q             - Pointer to the shared queue.
  *          msg           - Pointer to the message to add.
  *          caller_prefix - String prefix for logging messages (e.g., "Producer N").
@@ -38,8 +42,9 @@ int queue_add(queue_t *q, const message_t *msg, const char* caller_prefix);
 
 /*
  * Purpose: Removes a message from the shared queue. This function acts as a dispatcher,
- *          calling the appropriate internal implementation based on the global
- *          g_sync_mode. Blocks if the queue is empty. Handles EINTR.
+ *          calling the implementation of the queue's current engine. Blocks if
+ *          the queue is empty. Handles EINTR. An operation evicted by an engine
+ *          swap is retried transparently under the new engine.
  * Accepts: q             - Pointer to the shared queue.
  *          msg           - Pointer to a message_t structure to store the removed message.
  *          caller_prefix - String prefix for logging messages (e.g., "Consumer N").
@@ -50,7 +55,8 @@ int queue_remove(queue_t *q, message_t *msg, const char* caller_prefix);
 /*
  * Purpose: Attempts to resize the queue's message buffer and adjust associated
  *          synchronization primitives. Handles both increasing and decreasing size.
- *          Shrinking requires waiting for enough empty slots.
+ *          Shrinking requires waiting for enough empty slots. A resize evicted
+ *          by an engine swap is retried transparently under the new engine.
  * Accepts: q      - Pointer to the shared queue.
  *          change - The amount to change the capacity by (positive to increase,
  *                   negative to decrease).
@@ -87,4 +93,50 @@ unsigned long queue_get_added_total(queue_t *q);
  */
 unsigned long queue_get_extracted_total(queue_t *q);
 
+/*
+ * Purpose: Fills a stats snapshot from the lock-free mirror fields without
+ *          taking the queue mutex. Fields are individually consistent; the
+ *          set as a whole may straddle a concurrent add or remove.
+ * Accepts: q   - Pointer to the shared queue.
+ *          out - Pointer to the snapshot structure to fill.
+ * Returns: None.
+ */
+void queue_get_stats_snapshot(queue_t *q, queue_stats_t *out);
+
+/*
+ * Purpose: Switches a live queue to another synchronization engine. New
+ *          operations are held at the gate, operations already inside the
+ *          queue are woken and evicted (they retry under the new engine once
+ *          the swap completes), and the new engine's state is derived from
+ *          the ring buffer, which all engines share and which therefore
+ *          stays in place. Reports the pause on stdout.
+ * Accepts: q        - Pointer to the shared queue.
+ *          new_mode - The engine to switch to.
+ *          pause_ns - Where to store how long operations were held, in
+ *                     nanoseconds (may be NULL; 0 if nothing was swapped).
+ * Returns: 0 on success (including when new_mode is already active),
+ *          -1 on invalid mode, a concurrent swap, or a failed engine reset.
+ */
+int queue_swap_engine(queue_t *q, sync_mode_t new_mode, uint64_t *pause_ns);
+
+/*
+ * Purpose: Wakes every thread blocked anywhere in the queue, regardless of
+ *          the current engine: posts both semaphores, broadcasts both
+ *          condition variables (if the mutex can be taken without blocking)
+ *          and releases operations held at the swap gate. Intended for
+ *          shutdown, after g_terminate_flag has been set.
+ * Accepts: q         - Pointer to the shared queue.
+ *          sem_posts - How many times to post each semaphore.
+ * Returns: None.
+ */
+void queue_wake_all(queue_t *q, int sem_posts);
+
+/*
+ * Purpose: Returns the short name of an engine ("sem" or "cond"), matching
+ *          the values accepted by the mode option.
+ * Accepts: mode - The engine to name.
+ * Returns: Pointer to a static string.
+ */
+const char* queue_engine_name(sync_mode_t mode);
+
 #endif // QUEUE_MANAGER_H
@@ -0,0 +1,218 @@
+// Live monitor for running instances, reading their shared-memory stats pages.
+// Usage: queue_top [-i MS] [-n COUNT] [-s] [NAME...]
+#include "stats_shm_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// --- Constants ---
+#define TOP_MAX_INSTANCES 32
+#define TOP_NAME_MAX 64
+#define TOP_READ_RETRIES 1000     // Seqlock retries before a page is reported busy
+#define TOP_STALE_NS 2000000000ULL // No update for 2 s: the publisher is stuck or gone
+
+// --- Types ---
+typedef enum { PAGE_OK, PAGE_MISSING, PAGE_INVALID, PAGE_BUSY } page_status_t;
+
+// Indexed by thread_role_t / thread_state_t of the publisher
+static const char role_tags[] = { 'P', 'C', 'M' };
+static const char *const state_names[] = { "RUN", "PROD", "CONS", "WAIT", "INQ", "SLEEP", "RESIZE" };
+static const char *const engine_names[] = { "sem", "cond" };
+
+// --- Internal Helper Function Declarations ---
+static int find_instances(char names[][TOP_NAME_MAX], int max);
+static page_status_t read_page(const char *name, stats_shm_page_t *out);
+static void print_instance(const char *name, page_status_t status, const stats_shm_page_t *pg, int show_threads);
+static uint64_t now_ns(void);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Repeatedly reads every selected page (or every page
+ *          found in /dev/shm) and redraws the table.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage.
+ */
+int main(int argc, char *argv[]) {
+    long interval_ms = 100;
+    long iterations = 0; // 0: until interrupted
+    int show_threads = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:sh")) != -1) {
+        switch (opt) {
+            case 'i': interval_ms = strtol(optarg, NULL, 10); break;
+            case 'n': iterations = strtol(optarg, NULL, 10); break;
+            case 's': show_threads = 0; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: print_usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (interval_ms <= 0 || iterations < 0) { print_usage(argv[0]); return EXIT_FAILURE; }
+    if (argc - optind > TOP_MAX_INSTANCES) { fprintf(stderr, "Error: at most %d names.\n", TOP_MAX_INSTANCES); return EXIT_FAILURE; }
+
+    static char names[TOP_MAX_INSTANCES][TOP_NAME_MAX];
+    static stats_shm_page_t pg;
+    int fixed = argc - optind;
+    for (int i = 0; i < fixed; ++i) {
+        const char *arg = argv[optind + i];
+        // Accept "/pcq-stats-1234", "pcq-stats-1234" or just the PID
+        if (arg[0] >= '0' && arg[0] <= '9') snprintf(names[i], TOP_NAME_MAX, "/" STATS_SHM_PREFIX "%s", arg);
+        else snprintf(names[i], TOP_NAME_MAX, "%s%s", arg[0] == '/' ? "" : "/", arg);
+    }
+    int clear = isatty(STDOUT_FILENO);
+
+    for (long iter = 0; iterations == 0 || iter < iterations; ++iter) {
+        int count = fixed > 0 ? fixed : find_instances(names, TOP_MAX_INSTANCES);
+        if (clear) fputs("\033[H\033[2J", stdout);
+        else if (iter > 0) putchar('\n');
+        printf("queue_top: %d instance(s), every %ld ms\n", count, interval_ms);
+        printf("%-8s %-6s %-6s %11s %12s %12s %9s %9s %8s %7s %6s %6s %4s\n", "PID", "STATUS", "ENGINE", "DEPTH/CAP",
+               "ADDED", "EXTRACTED", "PROD/s", "CONS/s", "WAIT P/C", "RESIZES", "SWAPS", "HASH!", "THR");
+        for (int i = 0; i < count; ++i) {
+            page_status_t status = read_page(names[i], &pg);
+            print_instance(names[i], status, &pg, show_threads);
+        }
+        fflush(stdout);
+
+        if (iterations != 0 && iter + 1 >= iterations) break;
+        struct timespec pause = { interval_ms / 1000, (interval_ms % 1000) * 1000000L };
+        nanosleep(&pause, NULL);
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Purpose: Lists the default-named pages in /dev/shm (Linux mounts POSIX
+ *          shared memory there), sorted by name.
+ * Accepts: names - Output array of shm names ("/pcq-stats-PID").
+ *          max   - Capacity of the array.
+ * Returns: Number of names found.
+ */
+static int find_instances(char names[][TOP_NAME_MAX], int max) {
+    DIR *dir = opendir("/dev/shm");
+    if (!dir) return 0;
+    int count = 0;
+    struct dirent *ent;
+    while (count < max && (ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, STATS_SHM_PREFIX, strlen(STATS_SHM_PREFIX)) != 0) continue;
+        size_t len = strlen(ent->d_name);
+        if (len + 2 > TOP_NAME_MAX) continue;
+        names[count][0] = '/';
+        memcpy(names[count++] + 1, ent->d_name, len + 1);
+    }
+    closedir(dir);
+    for (int i = 1; i < count; ++i) { // Insertion sort; a handful of entries
+        char tmp[TOP_NAME_MAX];
+        memcpy(tmp, names[i], TOP_NAME_MAX);
+        int j = i - 1;
+        while (j >= 0 && strcmp(names[j], tmp) > 0) { memcpy(names[j + 1], names[j], TOP_NAME_MAX); j--; }
+        memcpy(names[j + 1], tmp, TOP_NAME_MAX);
+    }
+    return count;
+}
+
+/*
+ * Purpose: Maps one page read-only and copies a consistent snapshot of it:
+ *          the copy is retried while the sequence is odd (update in progress)
+ *          or changed during the copy. The publisher is never blocked.
+ * Accepts: name - POSIX shm name.
+ *          out  - Where to store the snapshot.
+ * Returns: PAGE_OK, or why no snapshot was taken.
+ */
+static page_status_t read_page(const char *name, stats_shm_page_t *out) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) return PAGE_MISSING;
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || (size_t)sb.st_size < sizeof(stats_shm_page_t)) { close(fd); return PAGE_INVALID; }
+    void *addr = mmap(NULL, sizeof(stats_shm_page_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return PAGE_INVALID;
+    stats_shm_page_t *shared = addr;
+
+    page_status_t status = PAGE_BUSY;
+    if (memcmp(shared->magic, STATS_SHM_MAGIC, STATS_SHM_MAGIC_LEN) != 0 || shared->version != STATS_SHM_VERSION ||
+        shared->page_size != sizeof(stats_shm_page_t)) {
+        status = PAGE_INVALID;
+    } else {
+        for (int attempt = 0; attempt < TOP_READ_RETRIES; ++attempt) {
+            uint64_t begin = atomic_load_explicit(&shared->seq, memory_order_acquire);
+            if (begin & 1) continue;
+            memcpy(out, shared, sizeof(*out));
+            atomic_thread_fence(memory_order_acquire); // Copy completes before the sequence is rechecked
+            if (atomic_load_explicit(&shared->seq, memory_order_relaxed) == begin) { status = PAGE_OK; break; }
+        }
+    }
+    munmap(addr, sizeof(stats_shm_page_t));
+    return status;
+}
+
+/*
+ * Purpose: Prints one instance row and, optionally, its thread rows.
+ * Accepts: name         - The page's shm name (shown when it cannot be read).
+ *          status       - Result of read_page.
+ *          pg           - The snapshot (valid only for PAGE_OK).
+ *          show_threads - Non-zero to list the threads.
+ * Returns: None.
+ */
+static void print_instance(const char *name, page_status_t status, const stats_shm_page_t *pg, int show_threads) {
+    if (status != PAGE_OK) {
+        const char *why = status == PAGE_MISSING ? "gone" : status == PAGE_INVALID ? "invalid" : "busy";
+        printf("%-8s %-6s %s\n", "-", why, name);
+        return;
+    }
+    // A killed process cannot unlink its page; show such pages as dead
+    const char *state = "live";
+    if (kill((pid_t)pg->pid, 0) == -1 && errno == ESRCH) state = "dead";
+    else if (now_ns() - pg->update_ns > TOP_STALE_NS) state = "stale";
+
+    char depth[32], waits[24];
+    snprintf(depth, sizeof(depth), "%llu/%llu", (unsigned long long)pg->count, (unsigned long long)pg->capacity);
+    snprintf(waits, sizeof(waits), "%d/%d", pg->waiting_producers, pg->waiting_consumers);
+    printf("%-8u %-6s %-6s %11s %12llu %12llu %9.1f %9.1f %8s %7llu %6llu %6llu %4d\n", pg->pid, state,
+           pg->mode < 2 ? engine_names[pg->mode] : "?", depth, (unsigned long long)pg->added_total,
+           (unsigned long long)pg->extracted_total, pg->producer_rate[0], pg->consumer_rate[0], waits,
+           (unsigned long long)pg->resize_total, (unsigned long long)pg->swap_total,
+           (unsigned long long)pg->hash_failures, pg->thread_count);
+
+    if (!show_threads) return;
+    uint32_t listed = pg->listed_threads < STATS_SHM_MAX_THREADS ? pg->listed_threads : STATS_SHM_MAX_THREADS;
+    for (uint32_t i = 0; i < listed; ++i) {
+        const stats_shm_thread_t *t = &pg->threads[i];
+        printf("    %c%-4u %-6s msgs %10llu  %8.1f/s  waits %8llu  blocked %10.1f ms\n",
+               t->role < 3 ? role_tags[t->role] : '?', t->id, t->state < 7 ? state_names[t->state] : "?",
+               (unsigned long long)t->messages, t->msgs_per_s, (unsigned long long)t->waits, (double)t->wait_ns / 1e6);
+    }
+    if (pg->thread_count > (int32_t)listed) printf("    ... %d more threads\n", pg->thread_count - (int32_t)listed);
+}
+
+/*
+ * Purpose: Reads CLOCK_MONOTONIC, the clock the publisher stamps pages with.
+ * Accepts: None.
+ * Returns: Nanoseconds.
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-i MS] [-n COUNT] [-s] [NAME|PID...]\n", prog_name);
+    fprintf(stderr, "  -i MS     : Refresh interval (default: 100).\n");
+    fprintf(stderr, "  -n COUNT  : Exit after COUNT refreshes (default: run until interrupted).\n");
+    fprintf(stderr, "  -s        : Summary rows only, no per-thread rows.\n");
+    fprintf(stderr, "  NAME|PID  : Stats pages to show (default: every /dev/shm/" STATS_SHM_PREFIX "*).\n");
+}
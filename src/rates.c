@@ -0,0 +1,218 @@
+#include "rates.h"
+#include <math.h>
+
+// --- Static Variables ---
+static const double window_seconds[RATE_WINDOWS] = { 1.0, 10.0, 60.0 };
+static const char *const window_names[RATE_WINDOWS] = { "1s", "10s", "60s" };
+
+// Sampler state per counter source (owned by the sampler thread)
+typedef struct rate_track_s {
+    unsigned long messages;
+    unsigned long bytes;
+    bool primed;       // First sample taken; rates start from the first delta
+    bool seeded;       // First delta applied to every window
+} rate_track_t;
+
+typedef struct thread_track_s {
+    rate_track_t track;
+    unsigned generation;
+    thread_role_t role;
+    int id;
+    bool active;       // Slot holds a producer or consumer
+} thread_track_t;
+
+static rate_track_t role_track[THREAD_ROLE_COUNT];
+static thread_track_t thread_track[THREAD_STATS_SLOTS];
+
+// Published rates; the sampler writes them under rates_mutex once per tick
+static rate_t role_rates[THREAD_ROLE_COUNT];
+static rate_t thread_rates[THREAD_STATS_SLOTS];
+static pthread_mutex_t rates_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t rates_thread;
+static bool rates_running = false;
+static atomic_bool rates_stop_requested = false;
+
+// --- Internal Helper Function Declarations ---
+static void* rates_thread_func(void *arg);
+static void rates_sample(double interval_s);
+static void rates_update(rate_t *rate, rate_track_t *track, unsigned long messages, unsigned long bytes,
+                         double interval_s, const double *alpha);
+
+/*
+ * Purpose: Starts the sampler thread, which reads the lock-free per-thread
+ *          counters every RATES_TICK_NS and folds the deltas into 1 s, 10 s
+ *          and 60 s exponentially weighted moving averages.
+ * Accepts: None.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int rates_start(void) {
+    if (rates_running) return 0;
+    atomic_store(&rates_stop_requested, false);
+    int ret = pthread_create(&rates_thread, NULL, rates_thread_func, NULL);
+    if (ret != 0) { errno = ret; print_error("Rates", "pthread_create (rates) failed"); return -1; }
+    rates_running = true;
+    return 0;
+}
+
+/*
+ * Purpose: Stops and joins the sampler thread. Safe to call when it was
+ *          never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void rates_stop(void) {
+    if (!rates_running) return;
+    atomic_store(&rates_stop_requested, true);
+    int ret = pthread_join(rates_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("Rates", "pthread_join (rates) failed"); }
+    rates_running = false;
+}
+
+/*
+ * Purpose: Reads the rates of all queue operations (adds and removes).
+ * Accepts: out - Where to store the rates.
+ * Returns: None.
+ */
+void rates_get_total(rate_t *out) {
+    rate_t producer, consumer;
+    rates_get_role(THREAD_ROLE_PRODUCER, &producer);
+    rates_get_role(THREAD_ROLE_CONSUMER, &consumer);
+    for (int w = 0; w < RATE_WINDOWS; ++w) {
+        out->msgs[w] = producer.msgs[w] + consumer.msgs[w];
+        out->bytes[w] = producer.bytes[w] + consumer.bytes[w];
+    }
+}
+
+/*
+ * Purpose: Reads the rates of one role (exited threads included, so rates
+ *          do not dip when a thread is removed).
+ * Accepts: role - The role.
+ *          out  - Where to store the rates.
+ * Returns: None.
+ */
+void rates_get_role(thread_role_t role, rate_t *out) {
+    int ret = pthread_mutex_lock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Lock Mutex");
+    *out = role_rates[role];
+    ret = pthread_mutex_unlock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Unlock Mutex");
+}
+
+/*
+ * Purpose: Reads the rates of the thread in one stats slot.
+ * Accepts: slot - Index into g_thread_stats.
+ *          out  - Where to store the rates.
+ *          role - Where to store the thread's role.
+ *          id   - Where to store the thread's ID.
+ * Returns: true if the slot holds a sampled producer or consumer, false
+ *          otherwise.
+ */
+bool rates_get_thread(int slot, rate_t *out, thread_role_t *role, int *id) {
+    if (slot < 0 || slot >= THREAD_STATS_SLOTS) return false;
+    int ret = pthread_mutex_lock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Lock Mutex");
+    bool active = thread_track[slot].active;
+    if (active) {
+        *out = thread_rates[slot];
+        *role = thread_track[slot].role;
+        *id = thread_track[slot].id;
+    }
+    ret = pthread_mutex_unlock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Unlock Mutex");
+    return active;
+}
+
+/*
+ * Purpose: Returns the label of an EWMA window, for reports.
+ * Accepts: window - Window index in [0, RATE_WINDOWS).
+ * Returns: Pointer to a static string such as "1s".
+ */
+const char* rates_window_name(int window) {
+    return (window >= 0 && window < RATE_WINDOWS) ? window_names[window] : "?";
+}
+
+/*
+ * Purpose: Sampler thread body. Samples every tick, using the measured
+ *          interval so a late wake-up does not inflate the rates.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* rates_thread_func(void *arg) {
+    (void)arg;
+    uint64_t last = monotonic_ns();
+    while (!atomic_load(&rates_stop_requested)) {
+        struct timespec tick = { 0, (long)RATES_TICK_NS };
+        nanosleep(&tick, NULL); // EINTR just shortens one tick
+
+        uint64_t now = monotonic_ns();
+        rates_sample((double)(now - last) / 1e9);
+        last = now;
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Takes one sample of the role totals and of every stats slot and
+ *          publishes the updated rates. The EWMA weights come from the
+ *          measured interval, so a late tick (or one cut short) carries
+ *          exactly its share of each window. A reused slot (new generation)
+ *          starts over.
+ * Accepts: interval_s - Seconds since the previous sample.
+ * Returns: None.
+ */
+static void rates_sample(double interval_s) {
+    if (interval_s <= 0.0) return;
+    double alpha[RATE_WINDOWS];
+    for (int w = 0; w < RATE_WINDOWS; ++w) alpha[w] = 1.0 - exp(-interval_s / window_seconds[w]);
+    int ret = pthread_mutex_lock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Lock Mutex");
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        unsigned long messages = 0, bytes = 0;
+        thread_stats_role_totals((thread_role_t)r, &messages, &bytes);
+        rates_update(&role_rates[r], &role_track[r], messages, bytes, interval_s, alpha);
+    }
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        thread_track_t *tt = &thread_track[i];
+        unsigned generation = atomic_load_explicit(&ts->generation, memory_order_acquire);
+        thread_role_t role = (thread_role_t)atomic_load(&ts->role);
+        bool worker = role == THREAD_ROLE_PRODUCER || role == THREAD_ROLE_CONSUMER;
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire) || !worker) { tt->active = false; continue; }
+        if (!tt->active || tt->generation != generation) {
+            memset(tt, 0, sizeof(*tt));
+            memset(&thread_rates[i], 0, sizeof(thread_rates[i]));
+            tt->generation = generation;
+            tt->role = role;
+            tt->id = atomic_load(&ts->id);
+            tt->active = true;
+        }
+        rates_update(&thread_rates[i], &tt->track, atomic_load_explicit(&ts->messages, memory_order_relaxed),
+                     atomic_load_explicit(&ts->bytes, memory_order_relaxed), interval_s, alpha);
+    }
+    ret = pthread_mutex_unlock(&rates_mutex); PTHREAD_CHECK(ret, "Rates: Unlock Mutex");
+}
+
+/*
+ * Purpose: Folds one counter delta into a set of EWMAs. The first delta of
+ *          a source seeds every window, so long windows do not start at 0.
+ * Accepts: rate       - The rates to update.
+ *          track      - The source's previous counter values.
+ *          messages   - Current message counter.
+ *          bytes      - Current byte counter.
+ *          interval_s - Seconds since the previous sample.
+ *          alpha      - EWMA weight of this interval, per window.
+ * Returns: None.
+ */
+static void rates_update(rate_t *rate, rate_track_t *track, unsigned long messages, unsigned long bytes,
+                         double interval_s, const double *alpha) {
+    if (track->primed) {
+        // Counters of a reused slot restart at 0; treat a decrease as no progress
+        double msg_rate = messages >= track->messages ? (double)(messages - track->messages) / interval_s : 0.0;
+        double byte_rate = bytes >= track->bytes ? (double)(bytes - track->bytes) / interval_s : 0.0;
+        for (int w = 0; w < RATE_WINDOWS; ++w) {
+            if (!track->seeded) { rate->msgs[w] = msg_rate; rate->bytes[w] = byte_rate; continue; }
+            rate->msgs[w] += alpha[w] * (msg_rate - rate->msgs[w]);
+            rate->bytes[w] += alpha[w] * (byte_rate - rate->bytes[w]);
+        }
+        track->seeded = true;
+    }
+    track->messages = messages;
+    track->bytes = bytes;
+    track->primed = true;
+}
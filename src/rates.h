@@ -0,0 +1,70 @@
+#ifndef RATES_H
+#define RATES_H
+
+#include "common.h"
+#include "thread_stats.h"
+
+// --- Constants ---
+#define RATES_TICK_NS 250000000ULL // 250ms sampling period
+#define RATE_WINDOWS 3             // EWMA time constants: 1 s, 10 s, 60 s
+
+// --- Windowed Rates ---
+typedef struct rate_s {
+    double msgs[RATE_WINDOWS];  // Queue operations per second
+    double bytes[RATE_WINDOWS]; // Payload bytes per second
+} rate_t;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Starts the sampler thread, which reads the lock-free per-thread
+ *          counters every RATES_TICK_NS and folds the deltas into 1 s, 10 s
+ *          and 60 s exponentially weighted moving averages.
+ * Accepts: None.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int rates_start(void);
+
+/*
+ * Purpose: Stops and joins the sampler thread. Safe to call when it was
+ *          never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void rates_stop(void);
+
+/*
+ * Purpose: Reads the rates of all queue operations (adds and removes).
+ * Accepts: out - Where to store the rates.
+ * Returns: None.
+ */
+void rates_get_total(rate_t *out);
+
+/*
+ * Purpose: Reads the rates of one role (exited threads included, so rates
+ *          do not dip when a thread is removed).
+ * Accepts: role - The role.
+ *          out  - Where to store the rates.
+ * Returns: None.
+ */
+void rates_get_role(thread_role_t role, rate_t *out);
+
+/*
+ * Purpose: Reads the rates of the thread in one stats slot.
+ * Accepts: slot - Index into g_thread_stats.
+ *          out  - Where to store the rates.
+ *          role - Where to store the thread's role.
+ *          id   - Where to store the thread's ID.
+ * Returns: true if the slot holds a sampled producer or consumer, false
+ *          otherwise.
+ */
+bool rates_get_thread(int slot, rate_t *out, thread_role_t *role, int *id);
+
+/*
+ * Purpose: Returns the label of an EWMA window, for reports.
+ * Accepts: window - Window index in [0, RATE_WINDOWS).
+ * Returns: Pointer to a static string such as "1s".
+ */
+const char* rates_window_name(int window);
+
+#endif // RATES_H
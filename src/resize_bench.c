@@ -0,0 +1,501 @@
+// Resize-under-load benchmark: producers and consumers run at full rate
+// while a resizer walks the queue through a cycle of target capacities
+// (small steps and large jumps). Every queue_add and queue_remove is timed
+// and classified as steady or as overlapping a queue_resize call, and every
+// queue_resize call is timed per step of the cycle, so the stop-the-world
+// cost of copying the ring under q->mutex shows directly.
+// Usage: resize_bench [-m LIST] [-p N] [-c N] [-q CAP] [-t LIST] [-i MS] [-s SIZE] [-d MS] [-w MS] [-k] [-j FILE]
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "hist.h"
+
+// --- Constants ---
+#define RB_DEFAULT_TARGETS "1016,1000,984,1000,100000,1000,16,1000"
+
+// --- Operation Classes ---
+typedef enum {
+    RB_OP_ADD,
+    RB_OP_REMOVE,
+    RB_OP_COUNT
+} rb_op_t;
+
+typedef enum {
+    RB_WINDOW_STEADY,   // No resize started or finished during the call
+    RB_WINDOW_RESIZE,   // The call overlapped a queue_resize
+    RB_WINDOW_COUNT
+} rb_window_t;
+
+// --- Run Phases ---
+typedef enum {
+    RB_PHASE_WARMUP,
+    RB_PHASE_MEASURE,
+    RB_PHASE_DONE
+} rb_phase_t;
+
+// --- Options ---
+typedef struct rb_params_s {
+    sync_mode_t mode;
+    int producers;
+    int consumers;
+    size_t capacity;
+    long targets[BENCH_LIST_MAX];
+    int target_count;
+    long interval_ms;
+    int msg_size;
+    bool queue_only;
+    long warmup_ms;
+    long duration_ms;
+} rb_params_t;
+
+// --- Per-Step Record of the Resizer ---
+typedef struct rb_step_s {
+    hist_t duration;              // queue_resize wall time, successful calls
+    unsigned long failed;         // Rejected (e.g. a cond-engine shrink below the count)
+    unsigned long count_sum;      // Messages queued when each successful call started, summed
+} rb_step_t;
+
+// --- Per-Run State ---
+typedef struct rb_shared_s {
+    queue_t *q;
+    const rb_params_t *p;
+    atomic_int phase;             // rb_phase_t
+    atomic_ulong resize_seq;      // Odd while a queue_resize call is in progress
+    atomic_bool resizer_stop;
+    atomic_int stopped;           // Workers that have left their loop
+    uint64_t resize_ns;           // Time inside measured queue_resize calls
+    unsigned long resizes;
+    rb_step_t *steps;             // One per target
+} rb_shared_t;
+
+typedef struct rb_worker_s {
+    rb_shared_t *shared;
+    int id;
+    bool producer;
+    pthread_t thread;
+    unsigned long hash_failures;
+    hist_t latency[RB_WINDOW_COUNT]; // Call duration of this worker's operation
+} rb_worker_t;
+
+// --- Internal Helper Function Declarations ---
+static int run_engine(const rb_params_t *p, FILE *json, bool first);
+static void* rb_producer_func(void *arg);
+static void* rb_consumer_func(void *arg);
+static void* rb_resizer_func(void *arg);
+static void rb_record(rb_worker_t *w, uint64_t start_seq, uint64_t start_ns);
+static void stop_workers(rb_shared_t *shared, rb_worker_t *workers, int started);
+static void print_report(const rb_params_t *p, const rb_shared_t *shared, hist_t merged[RB_OP_COUNT][RB_WINDOW_COUNT],
+                         double seconds, unsigned long hash_failures);
+static void write_json(FILE *json, bool first, const rb_params_t *p, const rb_shared_t *shared,
+                       hist_t merged[RB_OP_COUNT][RB_WINDOW_COUNT], double seconds);
+static double us(uint64_t ns);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs the benchmark once per selected engine and
+ *          prints the latency split and the per-step resize times.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage or a failed run.
+ */
+int main(int argc, char *argv[]) {
+    sync_mode_t modes[BENCH_MODES_MAX] = { SYNC_MODE_SEM, SYNC_MODE_CONDVAR };
+    int mode_count = 2;
+    rb_params_t p = {
+        .producers = 4, .consumers = 4, .capacity = 1000, .interval_ms = 10,
+        .msg_size = 16, .queue_only = false, .warmup_ms = 200, .duration_ms = 2000,
+    };
+    p.target_count = bench_parse_list(RB_DEFAULT_TARGETS, 1, QUEUE_CAPACITY_LIMIT, p.targets, BENCH_LIST_MAX);
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:c:q:t:i:s:d:w:kj:h")) != -1) {
+        int bad = 0;
+        long v;
+        switch (opt) {
+            case 'm': mode_count = bench_parse_modes(optarg, modes); bad = mode_count == -1; break;
+            case 'p': p.producers = (int)strtol(optarg, NULL, 10); bad = p.producers < 1 || p.producers > PRODUCER_THREAD_LIMIT; break;
+            case 'c': p.consumers = (int)strtol(optarg, NULL, 10); bad = p.consumers < 1 || p.consumers > CONSUMER_THREAD_LIMIT; break;
+            case 'q': v = strtol(optarg, NULL, 10); bad = v < 1 || v > QUEUE_CAPACITY_LIMIT; p.capacity = (size_t)v; break;
+            case 't': p.target_count = bench_parse_list(optarg, 1, QUEUE_CAPACITY_LIMIT, p.targets, BENCH_LIST_MAX);
+                      bad = p.target_count == -1; break;
+            case 'i': p.interval_ms = strtol(optarg, NULL, 10); bad = p.interval_ms < 0; break;
+            case 's': v = strtol(optarg, NULL, 10); bad = v < 0 || v >= MAX_DATA_SIZE; p.msg_size = (int)v; break;
+            case 'd': p.duration_ms = strtol(optarg, NULL, 10); bad = p.duration_ms <= 0; break;
+            case 'w': p.warmup_ms = strtol(optarg, NULL, 10); bad = p.warmup_ms < 0; break;
+            case 'k': p.queue_only = true; break;
+            case 'j': json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) { fprintf(stderr, "Error: cannot open %s: %s\n", json_path, strerror(errno)); return EXIT_FAILURE; }
+        fprintf(json, "{\n  \"bench\": \"resize_bench\",\n  \"version\": 1,\n  \"results\": [\n");
+    }
+
+    printf("resize_bench: %d producers, %d consumers, capacity %zu, targets", p.producers, p.consumers, p.capacity);
+    for (int i = 0; i < p.target_count; ++i) printf("%s%ld", i ? "," : " ", p.targets[i]);
+    printf(" every %ld ms, %d-byte payload%s, %ld ms measured\n", p.interval_ms, p.msg_size,
+           p.queue_only ? " (queue only)" : "", p.duration_ms);
+    fflush(stdout);
+
+    bench_setup();
+    int status = EXIT_SUCCESS;
+    for (int mi = 0; mi < mode_count; ++mi) {
+        p.mode = modes[mi];
+        if (run_engine(&p, json, mi == 0) == -1) status = EXIT_FAILURE;
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        int write_error = ferror(json);
+        if (fclose(json) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", json_path); status = EXIT_FAILURE; }
+        else printf("Results written to %s\n", json_path);
+    }
+    return status;
+}
+
+/*
+ * Purpose: Runs one engine: creates the queue, starts consumers, producers
+ *          and the resizer, warms up, measures, stops everything and
+ *          reports.
+ * Accepts: p     - The options, with the engine set.
+ *          json  - Open JSON file, or NULL.
+ *          first - true for the first result written to json.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+static int run_engine(const rb_params_t *p, FILE *json, bool first) {
+    rb_shared_t shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.p = p;
+    atomic_init(&shared.phase, RB_PHASE_WARMUP);
+    atomic_init(&shared.resize_seq, 0);
+    atomic_init(&shared.resizer_stop, false);
+    atomic_init(&shared.stopped, 0);
+    shared.steps = calloc((size_t)p->target_count, sizeof(rb_step_t));
+    if (!shared.steps) { print_error("Resize Bench", "calloc for the steps failed"); return -1; }
+    for (int i = 0; i < p->target_count; ++i) hist_reset(&shared.steps[i].duration);
+    shared.q = queue_create(p->capacity, p->mode);
+    if (!shared.q) { free(shared.steps); return -1; }
+
+    int total = p->producers + p->consumers;
+    rb_worker_t *workers = calloc((size_t)total, sizeof(rb_worker_t));
+    if (!workers) {
+        print_error("Resize Bench", "calloc for the workers failed");
+        queue_destroy(shared.q, p->mode);
+        free(shared.steps);
+        return -1;
+    }
+
+    // Consumers first, so the queue does not start out full
+    int started = 0;
+    for (; started < total; ++started) {
+        rb_worker_t *w = &workers[started];
+        w->shared = &shared;
+        w->producer = started >= p->consumers;
+        w->id = w->producer ? started - p->consumers + 1 : started + 1;
+        for (int win = 0; win < RB_WINDOW_COUNT; ++win) hist_reset(&w->latency[win]);
+        int ret = pthread_create(&w->thread, NULL, w->producer ? rb_producer_func : rb_consumer_func, w);
+        if (ret != 0) { errno = ret; print_error("Resize Bench", "pthread_create failed"); break; }
+    }
+    pthread_t resizer;
+    bool resizer_started = false;
+    if (started == total && p->interval_ms > 0) {
+        int ret = pthread_create(&resizer, NULL, rb_resizer_func, &shared);
+        if (ret != 0) { errno = ret; print_error("Resize Bench", "pthread_create(resizer) failed"); }
+        else resizer_started = true;
+    }
+    int result = (started == total && (resizer_started || p->interval_ms == 0)) ? 0 : -1;
+
+    uint64_t start_ns = 0, end_ns = 0;
+    if (result == 0) {
+        bench_sleep_ns((uint64_t)p->warmup_ms * 1000000ULL);
+        start_ns = monotonic_ns();
+        atomic_store(&shared.phase, RB_PHASE_MEASURE);
+        bench_sleep_ns((uint64_t)p->duration_ms * 1000000ULL);
+        atomic_store(&shared.phase, RB_PHASE_DONE);
+        end_ns = monotonic_ns();
+    }
+
+    // The resizer goes first: a sem-engine shrink waits on consumers to free slots
+    atomic_store(&shared.resizer_stop, true);
+    if (resizer_started) {
+        int ret = pthread_join(resizer, NULL);
+        if (ret != 0) { errno = ret; print_error("Resize Bench", "pthread_join(resizer) failed"); }
+    }
+    stop_workers(&shared, workers, started);
+
+    if (result == 0) {
+        hist_t (*merged)[RB_WINDOW_COUNT] = malloc(sizeof(hist_t[RB_OP_COUNT][RB_WINDOW_COUNT]));
+        if (!merged) { print_error("Resize Bench", "malloc for the histograms failed"); result = -1; }
+        else {
+            for (int op = 0; op < RB_OP_COUNT; ++op) {
+                for (int win = 0; win < RB_WINDOW_COUNT; ++win) hist_reset(&merged[op][win]);
+            }
+            unsigned long hash_failures = 0;
+            for (int i = 0; i < total; ++i) {
+                hash_failures += workers[i].hash_failures;
+                rb_op_t op = workers[i].producer ? RB_OP_ADD : RB_OP_REMOVE;
+                for (int win = 0; win < RB_WINDOW_COUNT; ++win) hist_merge(&merged[op][win], &workers[i].latency[win]);
+            }
+            double seconds = (double)(end_ns - start_ns) / 1e9;
+            print_report(p, &shared, merged, seconds, hash_failures);
+            if (hash_failures > 0) result = -1;
+            if (json) write_json(json, first, p, &shared, merged, seconds);
+            free(merged);
+        }
+    }
+
+    free(workers);
+    queue_destroy(shared.q, p->mode);
+    free(shared.steps);
+    return result;
+}
+
+/*
+ * Purpose: Producer body: builds a message (unless queue_only) and times
+ *          its queue_add, with no think time, until the run is stopped.
+ * Accepts: arg - Pointer to the worker's rb_worker_t.
+ * Returns: Always NULL.
+ */
+static void* rb_producer_func(void *arg) {
+    rb_worker_t *w = (rb_worker_t *)arg;
+    const rb_params_t *p = w->shared->p;
+    unsigned int seed = (unsigned int)w->id * 2654435761u;
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    if (p->queue_only) bench_fill_message(&msg, p->msg_size, &seed);
+
+    while (!g_terminate_flag) {
+        if (!p->queue_only) bench_fill_message(&msg, p->msg_size, &seed);
+        uint64_t seq = atomic_load_explicit(&w->shared->resize_seq, memory_order_acquire);
+        uint64_t t0 = monotonic_ns();
+        msg.enqueue_ns = t0;
+        if (queue_add(w->shared->q, &msg, "Resize Bench Producer") == -1) break;
+        rb_record(w, seq, t0);
+    }
+    atomic_fetch_add(&w->shared->stopped, 1);
+    return NULL;
+}
+
+/*
+ * Purpose: Consumer body: times each queue_remove and verifies the hash
+ *          (unless queue_only) until the run is stopped.
+ * Accepts: arg - Pointer to the worker's rb_worker_t.
+ * Returns: Always NULL.
+ */
+static void* rb_consumer_func(void *arg) {
+    rb_worker_t *w = (rb_worker_t *)arg;
+    const rb_params_t *p = w->shared->p;
+    message_t msg;
+
+    while (!g_terminate_flag) {
+        uint64_t seq = atomic_load_explicit(&w->shared->resize_seq, memory_order_acquire);
+        uint64_t t0 = monotonic_ns();
+        if (queue_remove(w->shared->q, &msg, "Resize Bench Consumer") == -1) break;
+        rb_record(w, seq, t0);
+        if (!p->queue_only) {
+            unsigned short original_hash = msg.hash;
+            msg.hash = 0;
+            if (calculate_message_hash(&msg) != original_hash) w->hash_failures++;
+        }
+    }
+    atomic_fetch_add(&w->shared->stopped, 1);
+    return NULL;
+}
+
+/*
+ * Purpose: Records the duration of the operation that just returned, in the
+ *          resize window histogram if a resize was in progress when it
+ *          started or began/ended before it returned (the sequence moved).
+ * Accepts: w         - The worker.
+ *          start_seq - resize_seq read before the call.
+ *          start_ns  - monotonic_ns() before the call.
+ * Returns: None.
+ */
+static void rb_record(rb_worker_t *w, uint64_t start_seq, uint64_t start_ns) {
+    uint64_t end_ns = monotonic_ns();
+    if (atomic_load_explicit(&w->shared->phase, memory_order_relaxed) != RB_PHASE_MEASURE) return;
+    uint64_t end_seq = atomic_load_explicit(&w->shared->resize_seq, memory_order_acquire);
+    rb_window_t win = ((start_seq & 1) != 0 || end_seq != start_seq) ? RB_WINDOW_RESIZE : RB_WINDOW_STEADY;
+    hist_record(&w->latency[win], end_ns - start_ns);
+}
+
+/*
+ * Purpose: Resizer body: every interval, resizes the queue to the next
+ *          target of the cycle and, while measuring, records the call's
+ *          duration for that step. resize_seq is odd for the length of the
+ *          call.
+ * Accepts: arg - Pointer to the run's rb_shared_t.
+ * Returns: Always NULL.
+ */
+static void* rb_resizer_func(void *arg) {
+    rb_shared_t *shared = (rb_shared_t *)arg;
+    const rb_params_t *p = shared->p;
+    int step = 0;
+    while (!atomic_load(&shared->resizer_stop)) {
+        bench_sleep_ns((uint64_t)p->interval_ms * 1000000ULL);
+        long change = p->targets[step] - (long)queue_get_capacity(shared->q);
+        if (change != 0) {
+            size_t count = queue_get_count(shared->q);
+            atomic_fetch_add_explicit(&shared->resize_seq, 1, memory_order_acq_rel);
+            uint64_t t0 = monotonic_ns();
+            int ret = queue_resize(shared->q, (int)change);
+            uint64_t elapsed = monotonic_ns() - t0;
+            atomic_fetch_add_explicit(&shared->resize_seq, 1, memory_order_acq_rel);
+            if (atomic_load(&shared->phase) == RB_PHASE_MEASURE) {
+                rb_step_t *s = &shared->steps[step];
+                if (ret == 0) {
+                    hist_record(&s->duration, elapsed);
+                    s->count_sum += count;
+                } else {
+                    s->failed++;
+                }
+                shared->resize_ns += elapsed;
+                shared->resizes++;
+            }
+        }
+        step = (step + 1) % p->target_count;
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Stops the started workers: raises the termination flag and wakes
+ *          them (bench_wake_until_stopped), joins them and lowers the flag
+ *          again for the next engine.
+ * Accepts: shared  - The run's shared state.
+ *          workers - The worker array.
+ *          started - How many workers were started.
+ * Returns: None.
+ */
+static void stop_workers(rb_shared_t *shared, rb_worker_t *workers, int started) {
+    bench_wake_until_stopped(shared->q, &shared->stopped, started);
+    for (int i = 0; i < started; ++i) {
+        int ret = pthread_join(workers[i].thread, NULL);
+        if (ret != 0) { errno = ret; print_error("Resize Bench", "pthread_join failed"); }
+    }
+    g_terminate_flag = 0;
+}
+
+/*
+ * Purpose: Prints one engine's results: the share of time spent in resize
+ *          calls, operation latency per window with the operation rate, and
+ *          the resize call times per step.
+ * Accepts: p       - The options.
+ *          shared  - The finished run.
+ *          merged  - Latency per operation and window, all workers merged.
+ *          seconds - Length of the measured window.
+ *          hash_failures - Messages whose hash did not match.
+ * Returns: None.
+ */
+static void print_report(const rb_params_t *p, const rb_shared_t *shared, hist_t merged[RB_OP_COUNT][RB_WINDOW_COUNT],
+                         double seconds, unsigned long hash_failures) {
+    static const char *op_names[RB_OP_COUNT] = { "add", "remove" };
+    static const char *window_names[RB_WINDOW_COUNT] = { "steady", "resize" };
+    double resize_s = (double)shared->resize_ns / 1e9;
+    printf("\n%s: %lu resizes, %.1f ms inside queue_resize (%.1f%% of %.0f ms)\n", queue_engine_name(p->mode),
+           shared->resizes, resize_s * 1e3, seconds > 0 ? resize_s / seconds * 100.0 : 0.0, seconds * 1e3);
+    if (hash_failures > 0) printf("FAIL: %lu messages with a bad hash\n", hash_failures);
+    printf("%-7s %-7s %10s %12s %9s %9s %9s %9s %10s\n", "OP", "WINDOW", "OPS", "OPS/S", "P50 us", "P99 us",
+           "P99.9 us", "MAX us", "MEAN us");
+    for (int op = 0; op < RB_OP_COUNT; ++op) {
+        for (int win = 0; win < RB_WINDOW_COUNT; ++win) {
+            const hist_t *h = &merged[op][win];
+            unsigned long n = atomic_load(&h->count);
+            // Operations overlapping a resize ran within (roughly) the resize time
+            double span = win == RB_WINDOW_RESIZE ? resize_s : seconds - resize_s;
+            printf("%-7s %-7s %10lu %12.0f %9.1f %9.1f %9.1f %9.1f %10.2f\n", op_names[op], window_names[win], n,
+                   span > 0 ? (double)n / span : 0.0, us(hist_percentile(h, 50.0)), us(hist_percentile(h, 99.0)),
+                   us(hist_percentile(h, 99.9)), us(atomic_load(&h->max)),
+                   n > 0 ? us(atomic_load(&h->sum)) / (double)n : 0.0);
+        }
+    }
+    printf("%-5s %15s %7s %7s %10s %10s %10s %10s %10s\n", "STEP", "TO CAPACITY", "CALLS", "FAILED", "AVG COUNT",
+           "P50 us", "P99 us", "MAX us", "MEAN us");
+    for (int i = 0; i < p->target_count; ++i) {
+        const rb_step_t *s = &shared->steps[i];
+        unsigned long n = atomic_load(&s->duration.count);
+        printf("%-5d %15ld %7lu %7lu %10.0f %10.1f %10.1f %10.1f %10.1f\n", i + 1, p->targets[i], n, s->failed,
+               n > 0 ? (double)s->count_sum / (double)n : 0.0, us(hist_percentile(&s->duration, 50.0)),
+               us(hist_percentile(&s->duration, 99.0)), us(atomic_load(&s->duration.max)),
+               n > 0 ? us(atomic_load(&s->duration.sum)) / (double)n : 0.0);
+    }
+    printf("FAILED: rejected calls, e.g. a cond-engine shrink below the queued count; the capacity stays, so\n"
+           "the following steps start from it. AVG COUNT: messages queued when a successful call started.\n");
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Appends one engine's results to the JSON file (one object per
+ *          line).
+ * Accepts: json    - The open file.
+ *          first   - true for the first result.
+ *          p       - The options.
+ *          shared  - The finished run.
+ *          merged  - Latency per operation and window.
+ *          seconds - Length of the measured window.
+ * Returns: None.
+ */
+static void write_json(FILE *json, bool first, const rb_params_t *p, const rb_shared_t *shared,
+                       hist_t merged[RB_OP_COUNT][RB_WINDOW_COUNT], double seconds) {
+    static const char *keys[RB_OP_COUNT][RB_WINDOW_COUNT] = { { "add_steady", "add_resize" },
+                                                              { "remove_steady", "remove_resize" } };
+    fprintf(json, "%s    {\"engine\": \"%s\", \"producers\": %d, \"consumers\": %d, \"capacity\": %zu, \"msg_size\": %d, "
+            "\"queue_only\": %s, \"interval_ms\": %ld, \"seconds\": %.3f, \"resizes\": %lu, \"resize_ns\": %llu",
+            first ? "" : ",\n", queue_engine_name(p->mode), p->producers, p->consumers, p->capacity, p->msg_size,
+            p->queue_only ? "true" : "false", p->interval_ms, seconds, shared->resizes,
+            (unsigned long long)shared->resize_ns);
+    for (int op = 0; op < RB_OP_COUNT; ++op) {
+        for (int win = 0; win < RB_WINDOW_COUNT; ++win) {
+            const hist_t *h = &merged[op][win];
+            fprintf(json, ", \"%s\": {\"ops\": %lu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %lu}",
+                    keys[op][win], atomic_load(&h->count), (unsigned long long)hist_percentile(h, 50.0),
+                    (unsigned long long)hist_percentile(h, 99.0), (unsigned long long)hist_percentile(h, 99.9),
+                    atomic_load(&h->max));
+        }
+    }
+    fprintf(json, ", \"steps\": [");
+    for (int i = 0; i < p->target_count; ++i) {
+        const rb_step_t *s = &shared->steps[i];
+        fprintf(json, "%s{\"to\": %ld, \"calls\": %lu, \"failed\": %lu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %lu}",
+                i ? ", " : "", p->targets[i], atomic_load(&s->duration.count), s->failed,
+                (unsigned long long)hist_percentile(&s->duration, 50.0),
+                (unsigned long long)hist_percentile(&s->duration, 99.0), atomic_load(&s->duration.max));
+    }
+    fprintf(json, "]}");
+}
+
+/*
+ * Purpose: Converts nanoseconds to microseconds.
+ * Accepts: ns - Nanoseconds.
+ * Returns: Microseconds.
+ */
+static double us(uint64_t ns) {
+    return (double)ns / 1e3;
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m LIST] [-p N] [-c N] [-q CAP] [-t LIST] [-i MS] [-s SIZE] [-d MS] [-w MS] [-k] [-j FILE]\n", prog_name);
+    fprintf(stderr, "  -m LIST  : Engines, sem and/or cond (default: sem,cond).\n");
+    fprintf(stderr, "  -p N     : Producers (default: 4).\n");
+    fprintf(stderr, "  -c N     : Consumers (default: 4).\n");
+    fprintf(stderr, "  -q CAP   : Initial capacity (default: 1000).\n");
+    fprintf(stderr, "  -t LIST  : Target capacities, cycled (default: %s).\n", RB_DEFAULT_TARGETS);
+    fprintf(stderr, "  -i MS    : Pause between resizes; 0 disables the resizer (default: 10).\n");
+    fprintf(stderr, "  -s SIZE  : Payload bytes (default: 16).\n");
+    fprintf(stderr, "  -d MS    : Measured duration per engine (default: 2000).\n");
+    fprintf(stderr, "  -w MS    : Warmup (default: 200).\n");
+    fprintf(stderr, "  -k       : Queue only: no payload fill or hash check.\n");
+    fprintf(stderr, "  -j FILE  : Write the results as JSON.\n");
+}
@@ -0,0 +1,496 @@
+// Scalability sweep: runs the real queue at load levels from 1 to the core
+// count in balanced and skewed producer/consumer shapes, plots throughput
+// against the thread count and fits the Universal Scalability Law
+//     X(n) = lambda * n / (1 + sigma * (n - 1) + kappa * n * (n - 1))
+// and Amdahl's law (kappa = 0), n being producers plus consumers. sigma is
+// the contention coefficient (the serialized share of the work, here mostly
+// q->mutex), kappa the coherency coefficient (the pairwise cost of keeping
+// the lock and the ring's cache lines consistent between cores).
+// Usage: scale [-m LIST] [-S LIST] [-n MAX] [-l LIST] [-q CAP] [-s SIZE] [-d MS] [-w MS] [-k] [-o CSV] [-j FILE]
+#include "bench_run.h"
+#include "queue_manager.h"
+#include <math.h>
+
+// --- Constants ---
+#define SCALE_DEFAULT_DURATION_MS 500
+#define SCALE_DEFAULT_WARMUP_MS 100
+#define SCALE_SKEW 4                // Skewed shapes: one thread of the small side per SCALE_SKEW of the large
+#define SCALE_BAR_WIDTH 48
+#define SCALE_SIGMA_STEPS 200       // Coarse grid of the fit
+#define SCALE_KAPPA_STEPS 160       // Log-spaced, SCALE_KAPPA_MIN..1
+#define SCALE_KAPPA_MIN 1e-8
+#define SCALE_REFINE_ROUNDS 6
+
+// --- Producer/Consumer Shapes at Load Level k ---
+typedef enum {
+    SCALE_SHAPE_BALANCED,   // k producers, k consumers
+    SCALE_SHAPE_PRODUCERS,  // k producers, ceil(k / SCALE_SKEW) consumers
+    SCALE_SHAPE_CONSUMERS,  // ceil(k / SCALE_SKEW) producers, k consumers
+    SCALE_SHAPE_COUNT
+} scale_shape_t;
+
+// --- Model Fit ---
+typedef struct scale_fit_s {
+    bool valid;
+    double lambda;          // Throughput per thread without contention (msgs/s)
+    double sigma;           // Contention
+    double kappa;           // Coherency (0 for Amdahl)
+    double r2;
+} scale_fit_t;
+
+// --- One Sweep (engine x shape) ---
+typedef struct scale_series_s {
+    sync_mode_t mode;
+    scale_shape_t shape;
+    int points;
+    int producers[BENCH_LIST_MAX];
+    int consumers[BENCH_LIST_MAX];
+    double threads[BENCH_LIST_MAX];
+    double msgs_per_s[BENCH_LIST_MAX];
+    scale_fit_t usl;
+    scale_fit_t amdahl;
+} scale_series_t;
+
+// --- Internal Helper Function Declarations ---
+static int parse_shapes(const char *value, bool *shapes);
+static int default_levels(long max, long *levels);
+static void shape_threads(scale_shape_t shape, long k, int *producers, int *consumers);
+static void fit_model(const scale_series_t *s, bool amdahl, scale_fit_t *out);
+static double fit_sse(const scale_series_t *s, double sigma, double kappa, double *lambda);
+static double model_throughput(const scale_fit_t *f, double n);
+static void print_series(const scale_series_t *s);
+static void print_fit_table(const scale_series_t *series, int count, long cores);
+static int write_csv(const char *path, const scale_series_t *series, int count);
+static int write_json(const char *path, const scale_series_t *series, int count, const bench_params_t *base);
+static const char* shape_name(scale_shape_t shape);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs every engine x shape x load level, prints each
+ *          curve with its fit and the coefficient table, and writes the
+ *          optional CSV and JSON.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage or a failed run.
+ */
+int main(int argc, char *argv[]) {
+    sync_mode_t modes[BENCH_MODES_MAX] = { SYNC_MODE_SEM, SYNC_MODE_CONDVAR };
+    int mode_count = 2;
+    bool shapes[SCALE_SHAPE_COUNT] = { true, true, true };
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long max_level = cores > 0 ? cores : 1;
+    long levels[BENCH_LIST_MAX];
+    int level_count = 0;
+    bench_params_t base = {
+        .capacity = 1000, .msg_size = 16, .queue_only = false,
+        .warmup_ms = SCALE_DEFAULT_WARMUP_MS, .duration_ms = SCALE_DEFAULT_DURATION_MS,
+    };
+    const char *csv_path = NULL;
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:S:n:l:q:s:d:w:ko:j:h")) != -1) {
+        int bad = 0;
+        long v;
+        switch (opt) {
+            case 'm': mode_count = bench_parse_modes(optarg, modes); bad = mode_count == -1; break;
+            case 'S': bad = parse_shapes(optarg, shapes) == -1; break;
+            case 'n': max_level = strtol(optarg, NULL, 10); bad = max_level < 1 || max_level > PRODUCER_THREAD_LIMIT; break;
+            case 'l': level_count = bench_parse_list(optarg, 1, PRODUCER_THREAD_LIMIT, levels, BENCH_LIST_MAX);
+                      bad = level_count == -1; break;
+            case 'q': v = strtol(optarg, NULL, 10); bad = v < 1 || v > QUEUE_CAPACITY_LIMIT; base.capacity = (size_t)v; break;
+            case 's': v = strtol(optarg, NULL, 10); bad = v < 0 || v >= MAX_DATA_SIZE; base.msg_size = (int)v; break;
+            case 'd': base.duration_ms = strtol(optarg, NULL, 10); bad = base.duration_ms <= 0; break;
+            case 'w': base.warmup_ms = strtol(optarg, NULL, 10); bad = base.warmup_ms < 0; break;
+            case 'k': base.queue_only = true; break;
+            case 'o': csv_path = optarg; break;
+            case 'j': json_path = optarg; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc) { print_usage(argv[0]); return EXIT_FAILURE; }
+    if (level_count == 0) level_count = default_levels(max_level, levels);
+
+    int shape_count = 0;
+    for (int sh = 0; sh < SCALE_SHAPE_COUNT; ++sh) shape_count += shapes[sh] ? 1 : 0;
+    scale_series_t *series = calloc((size_t)(mode_count * shape_count), sizeof(scale_series_t));
+    if (!series) { fprintf(stderr, "Error: calloc for the series failed\n"); return EXIT_FAILURE; }
+
+    printf("scale: %ld online CPUs, load levels", cores);
+    for (int i = 0; i < level_count; ++i) printf("%s%ld", i ? "," : " ", levels[i]);
+    printf(", capacity %zu, %d-byte payload%s, %ld ms per point\n", base.capacity, base.msg_size,
+           base.queue_only ? " (queue only)" : "", base.duration_ms);
+    fflush(stdout);
+
+    bench_setup();
+    int count = 0;
+    int status = EXIT_SUCCESS;
+    for (int mi = 0; mi < mode_count; ++mi) {
+        for (int sh = 0; sh < SCALE_SHAPE_COUNT; ++sh) {
+            if (!shapes[sh]) continue;
+            scale_series_t *s = &series[count++];
+            s->mode = modes[mi];
+            s->shape = (scale_shape_t)sh;
+            for (int li = 0; li < level_count; ++li) {
+                bench_params_t p = base;
+                p.mode = s->mode;
+                shape_threads(s->shape, levels[li], &p.producers, &p.consumers);
+                // Skewed shapes repeat thread counts at low levels; measure each once
+                if (s->points > 0 && s->producers[s->points - 1] == p.producers && s->consumers[s->points - 1] == p.consumers) continue;
+                bench_result_t r;
+                if (bench_run(&p, &r) == -1) { status = EXIT_FAILURE; continue; }
+                s->producers[s->points] = p.producers;
+                s->consumers[s->points] = p.consumers;
+                s->threads[s->points] = (double)(p.producers + p.consumers);
+                s->msgs_per_s[s->points] = r.msgs_per_s;
+                s->points++;
+            }
+            fit_model(s, false, &s->usl);
+            fit_model(s, true, &s->amdahl);
+            print_series(s);
+        }
+    }
+    print_fit_table(series, count, cores);
+
+    if (csv_path) {
+        if (write_csv(csv_path, series, count) == -1) status = EXIT_FAILURE;
+        else printf("Curves written to %s\n", csv_path);
+    }
+    if (json_path) {
+        if (write_json(json_path, series, count, &base) == -1) status = EXIT_FAILURE;
+        else printf("Fits written to %s\n", json_path);
+    }
+    free(series);
+    return status;
+}
+
+/*
+ * Purpose: Parses the shape list (balanced, producers, consumers).
+ * Accepts: value  - The text to parse.
+ *          shapes - Flags to set, one per scale_shape_t.
+ * Returns: 0 on success, -1 on invalid input.
+ */
+static int parse_shapes(const char *value, bool *shapes) {
+    for (int sh = 0; sh < SCALE_SHAPE_COUNT; ++sh) shapes[sh] = false;
+    const char *cur = value;
+    int count = 0;
+    while (*cur != '\0') {
+        size_t len = strcspn(cur, ",");
+        int found = -1;
+        for (int sh = 0; sh < SCALE_SHAPE_COUNT; ++sh) {
+            const char *name = shape_name((scale_shape_t)sh);
+            if (strlen(name) == len && strncmp(cur, name, len) == 0) found = sh;
+        }
+        if (found == -1) return -1;
+        shapes[found] = true;
+        count++;
+        cur += len;
+        if (*cur == ',') cur++;
+    }
+    return count > 0 ? 0 : -1;
+}
+
+/*
+ * Purpose: Builds the default load levels: 1, 2, 3, 4, 6, 8, 12, 16, ...
+ *          (powers of two and the midpoints between them) up to max, with
+ *          max itself always included.
+ * Accepts: max    - Highest load level.
+ *          levels - Array of BENCH_LIST_MAX to fill.
+ * Returns: Number of levels.
+ */
+static int default_levels(long max, long *levels) {
+    int count = 0;
+    for (long p = 1; p <= max && count < BENCH_LIST_MAX - 1; p *= 2) {
+        levels[count++] = p;
+        long mid = p + p / 2;
+        if (p >= 2 && mid <= max && mid < p * 2 && count < BENCH_LIST_MAX - 1) levels[count++] = mid;
+    }
+    if (levels[count - 1] != max) levels[count++] = max;
+    return count;
+}
+
+/*
+ * Purpose: Maps a shape and load level to thread counts.
+ * Accepts: shape     - The shape.
+ *          k         - Load level (threads on the large side).
+ *          producers - Where to store the producer count.
+ *          consumers - Where to store the consumer count.
+ * Returns: None.
+ */
+static void shape_threads(scale_shape_t shape, long k, int *producers, int *consumers) {
+    int small = (int)((k + SCALE_SKEW - 1) / SCALE_SKEW);
+    switch (shape) {
+        case SCALE_SHAPE_BALANCED: *producers = (int)k; *consumers = (int)k; break;
+        case SCALE_SHAPE_PRODUCERS: *producers = (int)k; *consumers = small; break;
+        case SCALE_SHAPE_CONSUMERS: *producers = small; *consumers = (int)k; break;
+        case SCALE_SHAPE_COUNT: break;
+    }
+}
+
+/*
+ * Purpose: Least-squares fit of the USL (or Amdahl with kappa = 0) to a
+ *          series. lambda has a closed form for given sigma and kappa, so
+ *          only those two are searched: a coarse grid (kappa log-spaced)
+ *          refined around the best cell a few times.
+ * Accepts: s      - The series.
+ *          amdahl - true to fix kappa at 0.
+ *          out    - Where to store the fit (valid is false with fewer than
+ *                   3 points, 2 for Amdahl).
+ * Returns: None.
+ */
+static void fit_model(const scale_series_t *s, bool amdahl, scale_fit_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (s->points < (amdahl ? 2 : 3)) return;
+
+    double best_sse = -1.0, best_sigma = 0.0, best_kappa = 0.0;
+    double log_min = log(SCALE_KAPPA_MIN);
+    for (int i = 0; i <= SCALE_SIGMA_STEPS; ++i) {
+        double sigma = (double)i / SCALE_SIGMA_STEPS;
+        for (int j = 0; j <= (amdahl ? 0 : SCALE_KAPPA_STEPS); ++j) {
+            double kappa = j == 0 ? 0.0 : exp(log_min + (0.0 - log_min) * (j - 1) / (SCALE_KAPPA_STEPS - 1));
+            double sse = fit_sse(s, sigma, kappa, NULL);
+            if (best_sse < 0.0 || sse < best_sse) { best_sse = sse; best_sigma = sigma; best_kappa = kappa; }
+        }
+    }
+    double sigma_span = 1.0 / SCALE_SIGMA_STEPS, kappa_span = best_kappa > 0.0 ? best_kappa : SCALE_KAPPA_MIN;
+    for (int round = 0; round < SCALE_REFINE_ROUNDS; ++round) {
+        double center_sigma = best_sigma, center_kappa = best_kappa;
+        for (int i = -10; i <= 10; ++i) {
+            double sigma = center_sigma + sigma_span * i / 10.0;
+            if (sigma < 0.0 || sigma > 1.0) continue;
+            for (int j = amdahl ? 0 : -10; j <= (amdahl ? 0 : 10); ++j) {
+                double kappa = amdahl ? 0.0 : center_kappa + kappa_span * j / 10.0;
+                if (kappa < 0.0) continue;
+                double sse = fit_sse(s, sigma, kappa, NULL);
+                if (sse < best_sse) { best_sse = sse; best_sigma = sigma; best_kappa = kappa; }
+            }
+        }
+        sigma_span /= 5.0;
+        kappa_span /= 5.0;
+    }
+
+    double mean = 0.0, sst = 0.0;
+    for (int i = 0; i < s->points; ++i) mean += s->msgs_per_s[i];
+    mean /= s->points;
+    for (int i = 0; i < s->points; ++i) sst += (s->msgs_per_s[i] - mean) * (s->msgs_per_s[i] - mean);
+    out->valid = true;
+    out->sigma = best_sigma;
+    out->kappa = best_kappa;
+    fit_sse(s, best_sigma, best_kappa, &out->lambda);
+    out->r2 = sst > 0.0 ? 1.0 - best_sse / sst : 1.0;
+}
+
+/*
+ * Purpose: Sum of squared errors of the model with the given coefficients
+ *          and the best lambda for them (linear least squares).
+ * Accepts: s      - The series.
+ *          sigma  - Contention coefficient.
+ *          kappa  - Coherency coefficient.
+ *          lambda - Where to store that lambda (may be NULL).
+ * Returns: The SSE in (msgs/s)^2.
+ */
+static double fit_sse(const scale_series_t *s, double sigma, double kappa, double *lambda) {
+    double fx = 0.0, ff = 0.0;
+    double f[BENCH_LIST_MAX];
+    for (int i = 0; i < s->points; ++i) {
+        double n = s->threads[i];
+        f[i] = n / (1.0 + sigma * (n - 1.0) + kappa * n * (n - 1.0));
+        fx += f[i] * s->msgs_per_s[i];
+        ff += f[i] * f[i];
+    }
+    double l = ff > 0.0 ? fx / ff : 0.0;
+    if (lambda) *lambda = l;
+    double sse = 0.0;
+    for (int i = 0; i < s->points; ++i) {
+        double e = s->msgs_per_s[i] - l * f[i];
+        sse += e * e;
+    }
+    return sse;
+}
+
+/*
+ * Purpose: Evaluates a fitted model.
+ * Accepts: f - The fit.
+ *          n - Thread count.
+ * Returns: Predicted throughput in msgs/s.
+ */
+static double model_throughput(const scale_fit_t *f, double n) {
+    return f->lambda * n / (1.0 + f->sigma * (n - 1.0) + f->kappa * n * (n - 1.0));
+}
+
+/*
+ * Purpose: Prints one series as a text plot: measured throughput as a bar
+ *          per point, with the USL prediction next to it.
+ * Accepts: s - The series.
+ * Returns: None.
+ */
+static void print_series(const scale_series_t *s) {
+    double peak = 0.0;
+    for (int i = 0; i < s->points; ++i) if (s->msgs_per_s[i] > peak) peak = s->msgs_per_s[i];
+    printf("\n%s, %s:\n%5s %5s %7s %12s %12s\n", queue_engine_name(s->mode), shape_name(s->shape), "P", "C", "THREADS",
+           "MSGS/S", "USL FIT");
+    for (int i = 0; i < s->points; ++i) {
+        char fit_text[16] = "-";
+        if (s->usl.valid) snprintf(fit_text, sizeof(fit_text), "%.0f", model_throughput(&s->usl, s->threads[i]));
+        int bar = peak > 0.0 ? (int)(s->msgs_per_s[i] / peak * SCALE_BAR_WIDTH + 0.5) : 0;
+        printf("%5d %5d %7.0f %12.0f %12s |", s->producers[i], s->consumers[i], s->threads[i], s->msgs_per_s[i], fit_text);
+        for (int b = 0; b < bar; ++b) putchar('#');
+        putchar('\n');
+    }
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Prints the coefficients of every series with the derived figures:
+ *          where the USL curve peaks (sqrt((1 - sigma) / kappa) threads),
+ *          the throughput there and the prediction at the shape's thread
+ *          counts for a load level of one thread per CPU (2 x cores for
+ *          the balanced shape), flagged when outside the measured range.
+ * Accepts: series - The series.
+ *          count  - How many.
+ *          cores  - Online CPUs.
+ * Returns: None.
+ */
+static void print_fit_table(const scale_series_t *series, int count, long cores) {
+    printf("\nUSL fit, X(n) = lambda*n / (1 + sigma*(n-1) + kappa*n*(n-1)), n = producers + consumers:\n");
+    printf("%-6s %-10s %6s %12s %9s %11s %6s %8s %12s %12s %9s %6s\n", "ENGINE", "SHAPE", "POINTS", "LAMBDA",
+           "SIGMA", "KAPPA", "R2", "PEAK N", "PEAK MSGS/S", "AT CORES", "AMDAHL S", "R2");
+    for (int i = 0; i < count; ++i) {
+        const scale_series_t *s = &series[i];
+        if (!s->usl.valid) {
+            printf("%-6s %-10s %6d  (too few points to fit)\n", queue_engine_name(s->mode), shape_name(s->shape), s->points);
+            continue;
+        }
+        const scale_fit_t *f = &s->usl;
+        char peak_n[16] = "none", peak_x[16] = "-", amdahl_s[16] = "-", amdahl_r2[16] = "-";
+        if (f->kappa > 0.0 && f->sigma < 1.0) {
+            double n_star = sqrt((1.0 - f->sigma) / f->kappa);
+            snprintf(peak_n, sizeof(peak_n), "%.0f", n_star);
+            snprintf(peak_x, sizeof(peak_x), "%.0f", model_throughput(f, n_star));
+        }
+        int at_producers = 0, at_consumers = 0;
+        shape_threads(s->shape, cores > 0 ? cores : 1, &at_producers, &at_consumers);
+        double at_n = (double)(at_producers + at_consumers), min_n = s->threads[0], max_n = s->threads[0];
+        for (int pt = 1; pt < s->points; ++pt) {
+            if (s->threads[pt] < min_n) min_n = s->threads[pt];
+            if (s->threads[pt] > max_n) max_n = s->threads[pt];
+        }
+        char at_cores[24];
+        snprintf(at_cores, sizeof(at_cores), "%.0f%s", model_throughput(f, at_n), (at_n < min_n || at_n > max_n) ? "*" : "");
+        if (s->amdahl.valid) {
+            snprintf(amdahl_s, sizeof(amdahl_s), "%.4f", s->amdahl.sigma);
+            snprintf(amdahl_r2, sizeof(amdahl_r2), "%.3f", s->amdahl.r2);
+        }
+        printf("%-6s %-10s %6d %12.0f %9.4f %11.3e %6.3f %8s %12s %12s %9s %6s\n", queue_engine_name(s->mode),
+               shape_name(s->shape), s->points, f->lambda, f->sigma, f->kappa, f->r2, peak_n, peak_x,
+               at_cores, amdahl_s, amdahl_r2);
+    }
+    printf("SIGMA: contention (serialized share, the q->mutex critical section). KAPPA: coherency (crosstalk\n"
+           "between threads). PEAK N: thread count past which adding threads lowers throughput. AT CORES: USL\n"
+           "prediction at load level %ld (the large side has one thread per CPU; balanced: %ld threads in all).\n"
+           "Fits beyond the measured thread counts are extrapolations; * marks such an AT CORES value.\n",
+           cores > 0 ? cores : 1, 2 * (cores > 0 ? cores : 1));
+    fflush(stdout);
+}
+
+/*
+ * Purpose: Writes every measured point with its USL and Amdahl predictions
+ *          as CSV, ready for a plotting tool.
+ * Accepts: path   - The CSV file.
+ *          series - The series.
+ *          count  - How many.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+static int write_csv(const char *path, const scale_series_t *series, int count) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) { fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno)); return -1; }
+    fprintf(fp, "engine,shape,producers,consumers,threads,msgs_per_s,usl_msgs_per_s,amdahl_msgs_per_s\n");
+    for (int i = 0; i < count; ++i) {
+        const scale_series_t *s = &series[i];
+        for (int p = 0; p < s->points; ++p) {
+            fprintf(fp, "%s,%s,%d,%d,%.0f,%.1f,", queue_engine_name(s->mode), shape_name(s->shape), s->producers[p],
+                    s->consumers[p], s->threads[p], s->msgs_per_s[p]);
+            if (s->usl.valid) fprintf(fp, "%.1f", model_throughput(&s->usl, s->threads[p]));
+            fputc(',', fp);
+            if (s->amdahl.valid) fprintf(fp, "%.1f", model_throughput(&s->amdahl, s->threads[p]));
+            fputc('\n', fp);
+        }
+    }
+    int write_error = ferror(fp);
+    if (fclose(fp) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", path); return -1; }
+    return 0;
+}
+
+/*
+ * Purpose: Writes the fits and the measured points as JSON, one series per
+ *          line.
+ * Accepts: path   - The JSON file.
+ *          series - The series.
+ *          count  - How many.
+ *          base   - The shared run parameters.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+static int write_json(const char *path, const scale_series_t *series, int count, const bench_params_t *base) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) { fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno)); return -1; }
+    fprintf(fp, "{\n  \"bench\": \"scale\",\n  \"version\": 1,\n  \"cpus\": %ld,\n  \"capacity\": %zu,\n  \"msg_size\": %d,\n"
+            "  \"queue_only\": %s,\n  \"duration_ms\": %ld,\n  \"series\": [\n", sysconf(_SC_NPROCESSORS_ONLN),
+            base->capacity, base->msg_size, base->queue_only ? "true" : "false", base->duration_ms);
+    for (int i = 0; i < count; ++i) {
+        const scale_series_t *s = &series[i];
+        fprintf(fp, "%s    {\"engine\": \"%s\", \"shape\": \"%s\", \"usl\": {\"valid\": %s, \"lambda\": %.1f, \"sigma\": %.6f, "
+                "\"kappa\": %.6e, \"r2\": %.4f}, \"amdahl\": {\"valid\": %s, \"lambda\": %.1f, \"sigma\": %.6f, \"r2\": %.4f}, "
+                "\"points\": [", i ? ",\n" : "", queue_engine_name(s->mode), shape_name(s->shape),
+                s->usl.valid ? "true" : "false", s->usl.lambda, s->usl.sigma, s->usl.kappa, s->usl.r2,
+                s->amdahl.valid ? "true" : "false", s->amdahl.lambda, s->amdahl.sigma, s->amdahl.r2);
+        for (int p = 0; p < s->points; ++p) {
+            fprintf(fp, "%s{\"producers\": %d, \"consumers\": %d, \"msgs_per_s\": %.1f}", p ? ", " : "",
+                    s->producers[p], s->consumers[p], s->msgs_per_s[p]);
+        }
+        fprintf(fp, "]}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    int write_error = ferror(fp);
+    if (fclose(fp) != 0 || write_error) { fprintf(stderr, "Error: writing %s failed\n", path); return -1; }
+    return 0;
+}
+
+/*
+ * Purpose: Names a shape as accepted by -S.
+ * Accepts: shape - The shape.
+ * Returns: Pointer to a static string.
+ */
+static const char* shape_name(scale_shape_t shape) {
+    switch (shape) {
+        case SCALE_SHAPE_BALANCED: return "balanced";
+        case SCALE_SHAPE_PRODUCERS: return "producers";
+        case SCALE_SHAPE_CONSUMERS: return "consumers";
+        case SCALE_SHAPE_COUNT: break;
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m LIST] [-S LIST] [-n MAX] [-l LIST] [-q CAP] [-s SIZE] [-d MS] [-w MS] [-k] [-o CSV] [-j FILE]\n", prog_name);
+    fprintf(stderr, "  -m LIST  : Engines, sem and/or cond (default: sem,cond).\n");
+    fprintf(stderr, "  -S LIST  : Shapes at load level k (default: all):\n");
+    fprintf(stderr, "             balanced  = k producers, k consumers\n");
+    fprintf(stderr, "             producers = k producers, k/%d consumers (rounded up)\n", SCALE_SKEW);
+    fprintf(stderr, "             consumers = k/%d producers (rounded up), k consumers\n", SCALE_SKEW);
+    fprintf(stderr, "  -n MAX   : Highest load level (default: online CPUs).\n");
+    fprintf(stderr, "  -l LIST  : Explicit load levels instead of 1,2,3,4,6,8,12,...,MAX.\n");
+    fprintf(stderr, "  -q CAP   : Queue capacity (default: 1000).\n");
+    fprintf(stderr, "  -s SIZE  : Payload bytes (default: 16).\n");
+    fprintf(stderr, "  -d MS    : Measured duration per point (default: %d).\n", SCALE_DEFAULT_DURATION_MS);
+    fprintf(stderr, "  -w MS    : Warmup per point (default: %d).\n", SCALE_DEFAULT_WARMUP_MS);
+    fprintf(stderr, "  -k       : Queue only: no payload fill or hash check, so the queue's own scaling shows.\n");
+    fprintf(stderr, "  -o CSV   : Write the measured points and model predictions as CSV.\n");
+    fprintf(stderr, "  -j FILE  : Write the fits and points as JSON.\n");
+}
@@ -0,0 +1,887 @@
+// Deterministic schedule exploration: producers, consumers and a resizer run
+// as cooperatively scheduled tasks over a queue whose primitives are routed
+// through sched_hooks.h. At every mutex, condition variable or semaphore call
+// a seeded choice picks the task that runs next, so each seed is exactly one
+// interleaving. Every schedule is checked for deadlock, lost, duplicated or
+// reordered messages and leftover semaphore tokens; a failing seed replays
+// step by step with -s SEED -n 1 -v.
+// Usage: sched_explore [-m sem|cond] [-q CAP] [-Q MAX] [-p N] [-c N] [-k N] [-r LIST] [-s SEED] [-n COUNT] [-x STEPS] [-v]
+#include <stdarg.h>
+#include "sched_hooks.h"
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "config.h"
+
+// --- Constants ---
+#define SX_MAX_TASKS 16
+#define SX_MAX_OBJECTS 16
+#define SX_MAX_MESSAGES 64      // Per producer
+#define SX_TRACE_KEEP 24        // Scheduling decisions shown with a failure
+#define SX_OWNER_NONE (-1)
+#define SX_OWNER_MAIN (-2)      // Taken by the harness thread (setup and checks)
+
+// --- Shadow Synchronization Objects ---
+typedef enum {
+    SX_OBJ_MUTEX,
+    SX_OBJ_COND,
+    SX_OBJ_SEM
+} sx_obj_kind_t;
+
+typedef struct sx_object_s {
+    const void *addr;
+    sx_obj_kind_t kind;
+    int value;                  // Mutex: owning task index or SX_OWNER_*; semaphore: count
+    const char *name;
+} sx_object_t;
+
+// --- Tasks ---
+typedef enum {
+    SX_ROLE_PRODUCER,
+    SX_ROLE_CONSUMER,
+    SX_ROLE_RESIZER
+} sx_role_t;
+
+typedef enum {
+    SX_TASK_RUNNABLE,
+    SX_TASK_BLOCKED,
+    SX_TASK_DONE
+} sx_task_state_t;
+
+typedef struct sx_task_s {
+    pthread_t thread;
+    pthread_cond_t turn;        // Signaled when the task is handed the baton
+    int index;
+    sx_role_t role;
+    int number;                 // 1-based within its role
+    int quota;                  // Messages to add or remove
+    char name[24];
+    sx_task_state_t state;
+    const void *blocked_on;
+    const char *blocked_op;
+    int last_seq[SX_MAX_TASKS]; // Consumers: last sequence seen per producer
+} sx_task_t;
+
+typedef struct sx_step_s {
+    unsigned long step;
+    int from;                   // Task at the scheduling point
+    int to;                     // Task chosen to continue
+    const char *op;
+    const void *obj;
+} sx_step_t;
+
+// --- Scenario (fixed for a whole exploration) ---
+typedef struct sx_scenario_s {
+    sync_mode_t mode;
+    long capacity;
+    long max_capacity;
+    int producers;
+    int consumers;
+    int messages;               // Per producer
+    long resizes[BENCH_LIST_MAX];
+    int resize_count;
+    const char *resize_text;
+    unsigned long max_steps;
+} sx_scenario_t;
+
+// --- Static Variables ---
+static pthread_mutex_t sx_lock = PTHREAD_MUTEX_INITIALIZER; // Protects all scheduler state
+static pthread_cond_t sx_main_cond = PTHREAD_COND_INITIALIZER;
+static sx_task_t tasks[SX_MAX_TASKS];
+static int task_count = 0;
+static int current = SX_OWNER_NONE;     // Task holding the baton
+static bool finished = false;           // Schedule over: every task done, or aborted
+static atomic_bool aborting = false;    // A failure unwinds every task; hooks turn into no-ops
+static char failure[256];
+static unsigned long steps = 0;
+static uint64_t rng_state = 0;
+static bool verbose = false;
+static sx_object_t objects[SX_MAX_OBJECTS];
+static int object_count = 0;
+static sx_step_t recent[SX_TRACE_KEEP];
+static const sx_scenario_t *scenario = NULL;
+static queue_t *queue = NULL;
+static bool seen[SX_MAX_TASKS][SX_MAX_MESSAGES];
+static unsigned long resizes_applied = 0;
+static _Thread_local sx_task_t *self_task = NULL;
+
+// --- Internal Helper Function Declarations ---
+static int run_schedule(const sx_scenario_t *sc, uint64_t seed);
+static void* sx_task_main(void *arg);
+static void run_producer(sx_task_t *t);
+static void run_consumer(sx_task_t *t);
+static void run_resizer(sx_task_t *t);
+static void check_final_state(const sx_scenario_t *sc);
+static void sx_reschedule(sx_task_t *self, const char *op, const void *obj);
+static void sx_block(sx_task_t *self, const char *op, const void *obj);
+static void sx_wake(const void *obj, bool all);
+static void sx_fail_locked(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void sx_task_fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static sx_object_t* sx_object(const void *addr, sx_obj_kind_t kind);
+static uint64_t sx_random(void);
+static const char* object_name(const void *addr);
+static void report_failure(const sx_scenario_t *sc, uint64_t seed, const char *prog_name);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs the scenario under COUNT consecutive seeds and
+ *          stops at the first failing schedule, printing its diagnosis and
+ *          the command that replays it.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS if every schedule passed, EXIT_FAILURE otherwise.
+ */
+int main(int argc, char *argv[]) {
+    sx_scenario_t sc = {
+        .mode = SYNC_MODE_SEM, .capacity = 2, .max_capacity = 8, .producers = 2, .consumers = 2, .messages = 4,
+        .resizes = { -1, 2, -2, 1 }, .resize_count = 4, .resize_text = "-1,2,-2,1", .max_steps = 200000,
+    };
+    uint64_t first_seed = 1;
+    unsigned long count = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:q:Q:p:c:k:r:s:n:x:vh")) != -1) {
+        int bad = 0;
+        switch (opt) {
+            case 'm': if (strcmp(optarg, "sem") == 0) sc.mode = SYNC_MODE_SEM;
+                      else if (strcmp(optarg, "cond") == 0) sc.mode = SYNC_MODE_CONDVAR;
+                      else bad = 1;
+                      break;
+            case 'q': sc.capacity = strtol(optarg, NULL, 10); bad = sc.capacity < 1; break;
+            case 'Q': sc.max_capacity = strtol(optarg, NULL, 10); bad = sc.max_capacity < 1 || sc.max_capacity > QUEUE_CAPACITY_LIMIT; break;
+            case 'p': sc.producers = (int)strtol(optarg, NULL, 10); bad = sc.producers < 1; break;
+            case 'c': sc.consumers = (int)strtol(optarg, NULL, 10); bad = sc.consumers < 1; break;
+            case 'k': sc.messages = (int)strtol(optarg, NULL, 10); bad = sc.messages < 1 || sc.messages > SX_MAX_MESSAGES; break;
+            case 'r': sc.resize_text = optarg;
+                      if (strcmp(optarg, "none") == 0) { sc.resize_count = 0; break; }
+                      sc.resize_count = bench_parse_list(optarg, -QUEUE_CAPACITY_LIMIT, QUEUE_CAPACITY_LIMIT, sc.resizes, BENCH_LIST_MAX);
+                      bad = sc.resize_count == -1;
+                      for (int i = 0; !bad && i < sc.resize_count; ++i) bad = sc.resizes[i] == 0;
+                      break;
+            case 's': first_seed = strtoull(optarg, NULL, 10); break;
+            case 'n': count = strtoul(optarg, NULL, 10); bad = count == 0; break;
+            case 'x': sc.max_steps = strtoul(optarg, NULL, 10); bad = sc.max_steps == 0; break;
+            case 'v': verbose = true; break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    int task_total = sc.producers + sc.consumers + (sc.resize_count > 0 ? 1 : 0);
+    if (optind != argc || sc.capacity > sc.max_capacity || task_total > SX_MAX_TASKS) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_setup();
+    g_config.max_capacity = (size_t)sc.max_capacity;
+    printf("sched_explore: engine %s, capacity %ld (max %ld), %d producers x %d messages, %d consumers, resizes %s, "
+           "seeds %llu..%llu\n", queue_engine_name(sc.mode), sc.capacity, sc.max_capacity, sc.producers, sc.messages,
+           sc.consumers, sc.resize_count > 0 ? sc.resize_text : "none", (unsigned long long)first_seed,
+           (unsigned long long)(first_seed + count - 1));
+    fflush(stdout);
+
+    unsigned long total_steps = 0, total_resizes = 0, max_run_steps = 0;
+    for (unsigned long i = 0; i < count; ++i) {
+        uint64_t seed = first_seed + i;
+        if (run_schedule(&sc, seed) == -1) {
+            report_failure(&sc, seed, argv[0]);
+            return EXIT_FAILURE;
+        }
+        total_steps += steps;
+        total_resizes += resizes_applied;
+        if (steps > max_run_steps) max_run_steps = steps;
+    }
+    printf("PASS: %lu schedules, %lu scheduling points (%.0f avg, %lu max), %lu resizes applied\n", count,
+           total_steps, (double)total_steps / (double)count, max_run_steps, total_resizes);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Purpose: Runs one schedule: creates the queue and the tasks, hands the
+ *          baton to the first seeded choice, waits until every task is done
+ *          or the schedule is aborted, then checks the final state.
+ * Accepts: sc   - The scenario.
+ *          seed - Seed of this schedule.
+ * Returns: 0 if the schedule passed, -1 if it failed (the reason is in
+ *          failure).
+ */
+static int run_schedule(const sx_scenario_t *sc, uint64_t seed) {
+    scenario = sc;
+    rng_state = seed;
+    current = SX_OWNER_NONE;
+    steps = 0;
+    resizes_applied = 0;
+    finished = false;
+    failure[0] = '\0';
+    atomic_store(&aborting, false);
+    object_count = 0;
+    memset(recent, 0, sizeof(recent));
+    memset(seen, 0, sizeof(seen));
+
+    queue = queue_create((size_t)sc->capacity, sc->mode);
+    if (!queue) { snprintf(failure, sizeof(failure), "queue_create failed"); return -1; }
+    sx_object(&queue->mutex, SX_OBJ_MUTEX)->name = "q->mutex";
+    sx_object(&queue->empty_slots, SX_OBJ_SEM)->name = "q->empty_slots";
+    sx_object(&queue->full_slots, SX_OBJ_SEM)->name = "q->full_slots";
+    sx_object(&queue->not_empty, SX_OBJ_COND)->name = "q->not_empty";
+    sx_object(&queue->not_full, SX_OBJ_COND)->name = "q->not_full";
+
+    // Task layout: producers, consumers, then the resizer
+    task_count = 0;
+    int total_messages = sc->producers * sc->messages;
+    for (int i = 0; i < sc->producers + sc->consumers + (sc->resize_count > 0 ? 1 : 0); ++i) {
+        sx_task_t *t = &tasks[task_count];
+        memset(t, 0, sizeof(*t));
+        t->index = task_count++;
+        if (i < sc->producers) {
+            t->role = SX_ROLE_PRODUCER; t->number = i + 1; t->quota = sc->messages;
+            snprintf(t->name, sizeof(t->name), "Producer %d", t->number);
+        } else if (i < sc->producers + sc->consumers) {
+            int c = i - sc->producers;
+            t->role = SX_ROLE_CONSUMER; t->number = c + 1;
+            t->quota = total_messages / sc->consumers + (c < total_messages % sc->consumers ? 1 : 0);
+            for (int p = 0; p < SX_MAX_TASKS; ++p) t->last_seq[p] = -1;
+            snprintf(t->name, sizeof(t->name), "Consumer %d", t->number);
+        } else {
+            t->role = SX_ROLE_RESIZER; t->number = 1;
+            snprintf(t->name, sizeof(t->name), "Resizer");
+        }
+        t->state = SX_TASK_RUNNABLE;
+        pthread_cond_init(&t->turn, NULL);
+    }
+
+    int started = 0;
+    for (; started < task_count; ++started) {
+        int ret = pthread_create(&tasks[started].thread, NULL, sx_task_main, &tasks[started]);
+        if (ret != 0) { errno = ret; print_error("Explore", "pthread_create failed"); break; }
+    }
+
+    int ret = pthread_mutex_lock(&sx_lock); PTHREAD_CHECK(ret, "Explore: Lock Scheduler");
+    if (started < task_count) {
+        sx_fail_locked("could not start every task");
+    } else {
+        current = (int)(sx_random() % (uint64_t)task_count);
+        if (verbose) printf("#0 start -> %s\n", tasks[current].name);
+        pthread_cond_signal(&tasks[current].turn);
+    }
+    while (!finished) pthread_cond_wait(&sx_main_cond, &sx_lock);
+    ret = pthread_mutex_unlock(&sx_lock); PTHREAD_CHECK(ret, "Explore: Unlock Scheduler");
+
+    for (int i = 0; i < started; ++i) pthread_join(tasks[i].thread, NULL);
+    if (failure[0] == '\0') check_final_state(sc);
+    int result = failure[0] == '\0' ? 0 : -1;
+
+    if (result == -1) atomic_store(&aborting, true); // The shadow state is stale; let destroy pass through
+    queue_destroy(queue, sc->mode);
+    queue = NULL;
+    for (int i = 0; i < task_count; ++i) pthread_cond_destroy(&tasks[i].turn);
+    return result;
+}
+
+/*
+ * Purpose: Thread body of every task: waits for the baton, runs the role,
+ *          then marks the task done and passes the baton on.
+ * Accepts: arg - Pointer to the task's sx_task_t.
+ * Returns: Always NULL.
+ */
+static void* sx_task_main(void *arg) {
+    sx_task_t *t = (sx_task_t *)arg;
+    self_task = t;
+    int ret = pthread_mutex_lock(&sx_lock); PTHREAD_CHECK(ret, "Explore: Lock Scheduler");
+    while (current != t->index && !atomic_load(&aborting)) pthread_cond_wait(&t->turn, &sx_lock);
+    pthread_mutex_unlock(&sx_lock);
+    if (atomic_load(&aborting)) return NULL;
+
+    switch (t->role) {
+        case SX_ROLE_PRODUCER: run_producer(t); break;
+        case SX_ROLE_CONSUMER: run_consumer(t); break;
+        case SX_ROLE_RESIZER: run_resizer(t); break;
+    }
+
+    ret = pthread_mutex_lock(&sx_lock); PTHREAD_CHECK(ret, "Explore: Lock Scheduler");
+    t->state = SX_TASK_DONE;
+    sx_reschedule(t, "exit", NULL);
+    pthread_mutex_unlock(&sx_lock);
+    return NULL;
+}
+
+/*
+ * Purpose: Producer role: adds its messages, each stamped with the producer
+ *          number and sequence and sealed with the hash.
+ * Accepts: t - The task.
+ * Returns: None (a failed add aborts the schedule).
+ */
+static void run_producer(sx_task_t *t) {
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    for (int seq = 0; seq < t->quota; ++seq) {
+        msg.type = (unsigned char)t->number;
+        msg.size = 2;
+        msg.data[0] = (unsigned char)t->number;
+        msg.data[1] = (unsigned char)seq;
+        msg.hash = 0;
+        msg.hash = calculate_message_hash(&msg);
+        if (queue_add(queue, &msg, t->name) != 0) sx_task_fail("%s: queue_add of message %d failed", t->name, seq);
+    }
+}
+
+/*
+ * Purpose: Consumer role: removes its share of the messages and checks
+ *          each one (hash, known producer and sequence, first delivery,
+ *          per-producer order as seen by this consumer).
+ * Accepts: t - The task.
+ * Returns: None (a bad message aborts the schedule).
+ */
+static void run_consumer(sx_task_t *t) {
+    message_t msg;
+    for (int i = 0; i < t->quota; ++i) {
+        if (queue_remove(queue, &msg, t->name) != 0) sx_task_fail("%s: queue_remove %d failed", t->name, i);
+        unsigned short hash = msg.hash;
+        msg.hash = 0;
+        int producer = msg.data[0], seq = msg.data[1];
+        if (calculate_message_hash(&msg) != hash || producer < 1 || producer > scenario->producers ||
+            seq >= scenario->messages) {
+            sx_task_fail("%s: corrupt message (producer %d, sequence %d)", t->name, producer, seq);
+        }
+        if (seen[producer - 1][seq]) sx_task_fail("%s: Producer %d message %d delivered twice", t->name, producer, seq);
+        if (seq <= t->last_seq[producer - 1]) {
+            sx_task_fail("%s: Producer %d message %d after message %d", t->name, producer, seq, t->last_seq[producer - 1]);
+        }
+        seen[producer - 1][seq] = true;
+        t->last_seq[producer - 1] = seq;
+    }
+}
+
+/*
+ * Purpose: Resizer role: applies the scenario's capacity changes in order.
+ *          A shrink refused because the queue holds too many items is a
+ *          legitimate outcome, not a failure.
+ * Accepts: t - The task.
+ * Returns: None.
+ */
+static void run_resizer(sx_task_t *t) {
+    (void)t;
+    for (int i = 0; i < scenario->resize_count; ++i) {
+        if (queue_resize(queue, (int)scenario->resizes[i]) == 0) resizes_applied++;
+    }
+}
+
+/*
+ * Purpose: Checks the state left by a completed schedule: every message
+ *          delivered, queue empty with matching totals, the mutex free and,
+ *          for the semaphore engine, the token counts matching the buffer.
+ * Accepts: sc - The scenario.
+ * Returns: None (sets failure on the first mismatch).
+ */
+static void check_final_state(const sx_scenario_t *sc) {
+    for (int p = 0; p < sc->producers; ++p) {
+        for (int seq = 0; seq < sc->messages; ++seq) {
+            if (!seen[p][seq]) { snprintf(failure, sizeof(failure), "Producer %d message %d was never delivered", p + 1, seq); return; }
+        }
+    }
+    unsigned long total = (unsigned long)sc->producers * (unsigned long)sc->messages;
+    if (queue->count != 0 || queue->added_count_total != total || queue->extracted_count_total != total) {
+        snprintf(failure, sizeof(failure), "queue not drained: count %zu, added %lu, extracted %lu (expected %lu)",
+                 queue->count, queue->added_count_total, queue->extracted_count_total, total);
+        return;
+    }
+    if (sx_object(&queue->mutex, SX_OBJ_MUTEX)->value != SX_OWNER_NONE) {
+        snprintf(failure, sizeof(failure), "q->mutex still held after every task finished");
+        return;
+    }
+    if (sc->mode == SYNC_MODE_SEM) {
+        int empty = sx_object(&queue->empty_slots, SX_OBJ_SEM)->value;
+        int full = sx_object(&queue->full_slots, SX_OBJ_SEM)->value;
+        if (empty != (int)queue->capacity || full != 0) {
+            snprintf(failure, sizeof(failure), "semaphore tokens out of step: empty_slots %d, full_slots %d, capacity %zu",
+                     empty, full, queue->capacity);
+        }
+    }
+}
+
+/*
+ * Purpose: Scheduling point. Records the step, picks the next task among the
+ *          runnable ones and hands it the baton; the caller then sleeps
+ *          until it is chosen again. Detects deadlock (tasks left but none
+ *          runnable) and the step limit. Must be called with sx_lock held;
+ *          an aborting task leaves through pthread_exit from here.
+ * Accepts: self - The calling task (state already updated: runnable, blocked
+ *                 or done).
+ *          op   - Name of the primitive being called.
+ *          obj  - The object it operates on (may be NULL).
+ * Returns: None.
+ */
+static void sx_reschedule(sx_task_t *self, const char *op, const void *obj) {
+    steps++;
+    if (steps > scenario->max_steps) sx_fail_locked("step limit %lu reached (livelock?)", scenario->max_steps);
+    if (!atomic_load(&aborting)) {
+        int runnable = 0, done = 0;
+        for (int i = 0; i < task_count; ++i) {
+            if (tasks[i].state == SX_TASK_RUNNABLE) runnable++;
+            else if (tasks[i].state == SX_TASK_DONE) done++;
+        }
+        if (runnable == 0 && done == task_count) {
+            finished = true;
+            pthread_cond_signal(&sx_main_cond);
+        } else if (runnable == 0) {
+            sx_fail_locked("deadlock: no task can run");
+        } else {
+            int pick = (int)(sx_random() % (uint64_t)runnable);
+            int next = 0;
+            for (; next < task_count; ++next) {
+                if (tasks[next].state == SX_TASK_RUNNABLE && pick-- == 0) break;
+            }
+            sx_step_t *s = &recent[steps % SX_TRACE_KEEP];
+            s->step = steps; s->from = self->index; s->to = next; s->op = op; s->obj = obj;
+            if (verbose) printf("#%lu %-10s %-14s %-16s -> %s\n", steps, self->name, op, obj ? object_name(obj) : "", tasks[next].name);
+            current = next;
+            if (next != self->index) pthread_cond_signal(&tasks[next].turn);
+        }
+    }
+    if (self->state == SX_TASK_DONE) return;
+    while (current != self->index && !atomic_load(&aborting)) pthread_cond_wait(&self->turn, &sx_lock);
+    if (atomic_load(&aborting)) {
+        pthread_mutex_unlock(&sx_lock);
+        pthread_exit(NULL);
+    }
+}
+
+/*
+ * Purpose: Blocks the calling task on an object until sx_wake makes it
+ *          runnable and the scheduler chooses it again. Called with sx_lock
+ *          held.
+ * Accepts: self - The calling task.
+ *          op   - Name of the blocking primitive.
+ *          obj  - The object waited for.
+ * Returns: None.
+ */
+static void sx_block(sx_task_t *self, const char *op, const void *obj) {
+    self->state = SX_TASK_BLOCKED;
+    self->blocked_on = obj;
+    self->blocked_op = op;
+    sx_reschedule(self, op, obj);
+}
+
+/*
+ * Purpose: Makes tasks blocked on an object runnable again. Called with
+ *          sx_lock held.
+ * Accepts: obj - The object.
+ *          all - true to wake every waiter, false for one seeded choice.
+ * Returns: None.
+ */
+static void sx_wake(const void *obj, bool all) {
+    int waiting = 0;
+    for (int i = 0; i < task_count; ++i) {
+        if (tasks[i].state == SX_TASK_BLOCKED && tasks[i].blocked_on == obj) waiting++;
+    }
+    if (waiting == 0) return;
+    int pick = all ? -1 : (int)(sx_random() % (uint64_t)waiting);
+    for (int i = 0; i < task_count; ++i) {
+        if (tasks[i].state != SX_TASK_BLOCKED || tasks[i].blocked_on != obj) continue;
+        if (all || pick-- == 0) {
+            tasks[i].state = SX_TASK_RUNNABLE;
+            tasks[i].blocked_on = NULL;
+            if (!all) return;
+        }
+    }
+}
+
+/*
+ * Purpose: Records the failure of the current schedule and aborts it: every
+ *          task is woken and leaves, and the harness thread is released.
+ *          Called with sx_lock held; the first failure wins.
+ * Accepts: fmt - printf-style description, followed by its arguments.
+ * Returns: None.
+ */
+static void sx_fail_locked(const char *fmt, ...) {
+    if (atomic_load(&aborting)) return;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(failure, sizeof(failure), fmt, args);
+    va_end(args);
+    atomic_store(&aborting, true);
+    finished = true;
+    for (int i = 0; i < task_count; ++i) pthread_cond_signal(&tasks[i].turn);
+    pthread_cond_signal(&sx_main_cond);
+}
+
+/*
+ * Purpose: Fails the schedule from inside a task's role and ends the task.
+ * Accepts: fmt - printf-style description, followed by its arguments.
+ * Returns: Does not return.
+ */
+static void sx_task_fail(const char *fmt, ...) {
+    char text[sizeof(failure)];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    pthread_mutex_lock(&sx_lock);
+    sx_fail_locked("%s", text);
+    pthread_mutex_unlock(&sx_lock);
+    pthread_exit(NULL);
+}
+
+/*
+ * Purpose: Finds the shadow record of a primitive, creating it on first use
+ *          (a mutex starts free, a semaphore at zero). Called with sx_lock
+ *          held or from the harness thread while no task runs.
+ * Accepts: addr - The primitive's address.
+ *          kind - Its kind.
+ * Returns: Pointer to the record (aborts the process if the table is full).
+ */
+static sx_object_t* sx_object(const void *addr, sx_obj_kind_t kind) {
+    for (int i = 0; i < object_count; ++i) {
+        if (objects[i].addr == addr) return &objects[i];
+    }
+    if (object_count >= SX_MAX_OBJECTS) { fprintf(stderr, "sched_explore: too many primitives\n"); abort(); }
+    sx_object_t *o = &objects[object_count++];
+    o->addr = addr;
+    o->kind = kind;
+    o->value = kind == SX_OBJ_MUTEX ? SX_OWNER_NONE : 0;
+    o->name = NULL;
+    return o;
+}
+
+/*
+ * Purpose: Draws the next scheduling choice (splitmix64 over the seed).
+ * Accepts: None.
+ * Returns: 64 random bits.
+ */
+static uint64_t sx_random(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Purpose: Names a primitive for the trace ("q->mutex", ...).
+ * Accepts: addr - The primitive's address.
+ * Returns: Pointer to a static string.
+ */
+static const char* object_name(const void *addr) {
+    for (int i = 0; i < object_count; ++i) {
+        if (objects[i].addr == addr && objects[i].name) return objects[i].name;
+    }
+    return "?";
+}
+
+/*
+ * Purpose: Prints a failed schedule: the reason, where every task stands,
+ *          the last scheduling decisions and the replay command.
+ * Accepts: sc        - The scenario.
+ *          seed      - The failing seed.
+ *          prog_name - argv[0], for the replay command.
+ * Returns: None.
+ */
+static void report_failure(const sx_scenario_t *sc, uint64_t seed, const char *prog_name) {
+    printf("FAIL seed %llu at step %lu: %s\n", (unsigned long long)seed, steps, failure);
+    for (int i = 0; i < task_count; ++i) {
+        const sx_task_t *t = &tasks[i];
+        if (t->state == SX_TASK_DONE) { printf("  %-10s done\n", t->name); continue; }
+        if (t->state == SX_TASK_RUNNABLE) { printf("  %-10s runnable\n", t->name); continue; }
+        const sx_object_t *o = sx_object(t->blocked_on, SX_OBJ_MUTEX);
+        if (o->kind == SX_OBJ_MUTEX) {
+            printf("  %-10s blocked in %s on %s (held by %s)\n", t->name, t->blocked_op, object_name(o->addr),
+                   o->value >= 0 ? tasks[o->value].name : "nobody");
+        } else if (o->kind == SX_OBJ_SEM) {
+            printf("  %-10s blocked in %s on %s (value %d)\n", t->name, t->blocked_op, object_name(o->addr), o->value);
+        } else {
+            printf("  %-10s blocked in %s on %s\n", t->name, t->blocked_op, object_name(o->addr));
+        }
+    }
+    printf("  Last scheduling decisions:\n");
+    unsigned long first = steps > SX_TRACE_KEEP ? steps - SX_TRACE_KEEP + 1 : 1;
+    for (unsigned long s = first; s <= steps; ++s) {
+        const sx_step_t *st = &recent[s % SX_TRACE_KEEP];
+        if (st->step != s) continue;
+        printf("    #%lu %-10s %-14s %-16s -> %s\n", s, tasks[st->from].name, st->op,
+               st->obj ? object_name(st->obj) : "", tasks[st->to].name);
+    }
+    printf("  Replay: %s -m %s -q %ld -Q %ld -p %d -c %d -k %d -r %s -x %lu -s %llu -n 1 -v\n", prog_name,
+           queue_engine_name(sc->mode), sc->capacity, sc->max_capacity, sc->producers, sc->consumers, sc->messages,
+           sc->resize_count > 0 ? sc->resize_text : "none", sc->max_steps, (unsigned long long)seed);
+}
+
+// --- Scheduler Hooks (sched_hooks.h) ---
+// Every hook is a no-op once the schedule is aborting, so the cleanup
+// handlers of tasks leaving through pthread_exit cannot block. Calls from
+// the harness thread (queue creation and destruction) never yield.
+
+/*
+ * Purpose: Registers a mutex with the scheduler (unlocked).
+ * Accepts: mutex - The mutex.
+ *          attr  - Ignored.
+ * Returns: 0.
+ */
+int sx_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
+    (void)attr;
+    if (atomic_load(&aborting)) return 0;
+    pthread_mutex_lock(&sx_lock);
+    sx_object(mutex, SX_OBJ_MUTEX)->value = SX_OWNER_NONE;
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Unregisters a mutex (the record is dropped with the schedule).
+ * Accepts: mutex - The mutex.
+ * Returns: 0.
+ */
+int sx_mutex_destroy(pthread_mutex_t *mutex) {
+    (void)mutex;
+    return 0;
+}
+
+/*
+ * Purpose: Scheduling point, then takes the mutex, blocking the task while
+ *          another task owns it.
+ * Accepts: mutex - The mutex.
+ * Returns: 0.
+ */
+int sx_mutex_lock(pthread_mutex_t *mutex) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *o = sx_object(mutex, SX_OBJ_MUTEX);
+    if (self) {
+        sx_reschedule(self, "mutex_lock", mutex);
+        while (o->value != SX_OWNER_NONE) sx_block(self, "mutex_lock", mutex);
+    }
+    o->value = self ? self->index : SX_OWNER_MAIN;
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Scheduling point, then takes the mutex if it is free.
+ * Accepts: mutex - The mutex.
+ * Returns: 0 on success, EBUSY if another task owns it.
+ */
+int sx_mutex_trylock(pthread_mutex_t *mutex) {
+    if (atomic_load(&aborting)) return EBUSY;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *o = sx_object(mutex, SX_OBJ_MUTEX);
+    if (self) sx_reschedule(self, "mutex_trylock", mutex);
+    int result = EBUSY;
+    if (o->value == SX_OWNER_NONE) {
+        o->value = self ? self->index : SX_OWNER_MAIN;
+        result = 0;
+    }
+    pthread_mutex_unlock(&sx_lock);
+    return result;
+}
+
+/*
+ * Purpose: Releases the mutex, makes its waiters runnable, then a
+ *          scheduling point.
+ * Accepts: mutex - The mutex.
+ * Returns: 0, or EPERM if the calling task does not own it.
+ */
+int sx_mutex_unlock(pthread_mutex_t *mutex) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *o = sx_object(mutex, SX_OBJ_MUTEX);
+    int result = 0;
+    if (o->value != (self ? self->index : SX_OWNER_MAIN)) {
+        if (self) sx_fail_locked("%s unlocked %s it does not own", self->name, object_name(mutex));
+        result = EPERM;
+    } else {
+        o->value = SX_OWNER_NONE;
+        sx_wake(mutex, true);
+    }
+    if (self) sx_reschedule(self, "mutex_unlock", mutex);
+    pthread_mutex_unlock(&sx_lock);
+    return result;
+}
+
+/*
+ * Purpose: Registers a condition variable with the scheduler.
+ * Accepts: cond - The condition variable.
+ *          attr - Ignored.
+ * Returns: 0.
+ */
+int sx_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) {
+    (void)attr;
+    if (atomic_load(&aborting)) return 0;
+    pthread_mutex_lock(&sx_lock);
+    sx_object(cond, SX_OBJ_COND);
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Unregisters a condition variable.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_destroy(pthread_cond_t *cond) {
+    (void)cond;
+    return 0;
+}
+
+/*
+ * Purpose: Releases the mutex, blocks until signaled, then re-takes the
+ *          mutex.
+ * Accepts: cond  - The condition variable.
+ *          mutex - The mutex the task owns.
+ * Returns: 0.
+ */
+int sx_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *m = sx_object(mutex, SX_OBJ_MUTEX);
+    sx_object(cond, SX_OBJ_COND);
+    if (!self || m->value != self->index) {
+        sx_fail_locked("cond_wait on %s without owning %s", object_name(cond), object_name(mutex));
+        pthread_mutex_unlock(&sx_lock);
+        return EPERM;
+    }
+    m->value = SX_OWNER_NONE;
+    sx_wake(mutex, true);
+    sx_block(self, "cond_wait", cond);
+    pthread_mutex_unlock(&sx_lock);
+    return sx_mutex_lock(mutex);
+}
+
+/*
+ * Purpose: Makes one waiter (a seeded choice among them) runnable, then a
+ *          scheduling point.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_signal(pthread_cond_t *cond) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_wake(cond, false);
+    if (self) sx_reschedule(self, "cond_signal", cond);
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Makes every waiter runnable, then a scheduling point.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_broadcast(pthread_cond_t *cond) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_wake(cond, true);
+    if (self) sx_reschedule(self, "cond_broadcast", cond);
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Registers a semaphore with its initial value.
+ * Accepts: sem     - The semaphore.
+ *          pshared - Ignored.
+ *          value   - Initial value.
+ * Returns: 0.
+ */
+int sx_sem_init(sem_t *sem, int pshared, unsigned int value) {
+    (void)pshared;
+    if (atomic_load(&aborting)) return 0;
+    pthread_mutex_lock(&sx_lock);
+    sx_object(sem, SX_OBJ_SEM)->value = (int)value;
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Unregisters a semaphore.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_destroy(sem_t *sem) {
+    (void)sem;
+    return 0;
+}
+
+/*
+ * Purpose: Scheduling point, then decrements the semaphore, blocking the
+ *          task while it is zero.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_wait(sem_t *sem) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *o = sx_object(sem, SX_OBJ_SEM);
+    if (self) {
+        sx_reschedule(self, "sem_wait", sem);
+        while (o->value == 0) sx_block(self, "sem_wait", sem);
+    } else if (o->value == 0) {
+        sx_fail_locked("harness thread would block on %s", object_name(sem));
+        pthread_mutex_unlock(&sx_lock);
+        return 0;
+    }
+    o->value--;
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Scheduling point, then decrements the semaphore if positive.
+ * Accepts: sem - The semaphore.
+ * Returns: 0 on success, -1 with errno EAGAIN if it is zero.
+ */
+int sx_sem_trywait(sem_t *sem) {
+    if (atomic_load(&aborting)) { errno = EAGAIN; return -1; }
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object_t *o = sx_object(sem, SX_OBJ_SEM);
+    if (self) sx_reschedule(self, "sem_trywait", sem);
+    int result = 0;
+    if (o->value > 0) o->value--;
+    else result = -1;
+    pthread_mutex_unlock(&sx_lock);
+    if (result == -1) errno = EAGAIN;
+    return result;
+}
+
+/*
+ * Purpose: Increments the semaphore, makes its waiters runnable, then a
+ *          scheduling point.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_post(sem_t *sem) {
+    if (atomic_load(&aborting)) return 0;
+    sx_task_t *self = self_task;
+    pthread_mutex_lock(&sx_lock);
+    sx_object(sem, SX_OBJ_SEM)->value++;
+    sx_wake(sem, true);
+    if (self) sx_reschedule(self, "sem_post", sem);
+    pthread_mutex_unlock(&sx_lock);
+    return 0;
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m sem|cond] [-q CAP] [-Q MAX] [-p N] [-c N] [-k N] [-r LIST] [-s SEED] [-n COUNT] [-x STEPS] [-v]\n", prog_name);
+    fprintf(stderr, "  -m ENGINE : Queue engine (default: sem).\n");
+    fprintf(stderr, "  -q CAP    : Initial capacity (default: 2).\n");
+    fprintf(stderr, "  -Q MAX    : Capacity limit for grows (default: 8).\n");
+    fprintf(stderr, "  -p N      : Producer tasks (default: 2).\n");
+    fprintf(stderr, "  -c N      : Consumer tasks; they share the messages (default: 2).\n");
+    fprintf(stderr, "  -k N      : Messages per producer, 1-%d (default: 4).\n", SX_MAX_MESSAGES);
+    fprintf(stderr, "  -r LIST   : Capacity changes applied in order by the resizer task, or none (default: -1,2,-2,1).\n");
+    fprintf(stderr, "  -s SEED   : First seed (default: 1).\n");
+    fprintf(stderr, "  -n COUNT  : Schedules to explore, one per seed (default: 1000).\n");
+    fprintf(stderr, "  -x STEPS  : Scheduling points before a schedule counts as a livelock (default: 200000).\n");
+    fprintf(stderr, "  -v        : Print every scheduling decision (use with -n 1 to replay a seed).\n");
+    fprintf(stderr, "At most %d tasks (producers + consumers + resizer).\n", SX_MAX_TASKS);
+}
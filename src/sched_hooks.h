@@ -0,0 +1,162 @@
+#ifndef SCHED_HOOKS_H
+#define SCHED_HOOKS_H
+
+#include "common.h"
+#include "lockprof.h"
+
+// Scheduler hooks of the sched_explore harness. queue_manager.c includes
+// this header last when compiled with -DSCHED_EXPLORE, which routes every
+// mutex, condition variable and semaphore call of the queue to a cooperative
+// scheduler: only one task runs at a time, each call is a scheduling point,
+// and a seeded choice decides which runnable task continues. The same seed
+// replays the same schedule. The harness itself includes it without the
+// define and only gets the declarations.
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Registers a mutex with the scheduler (unlocked).
+ * Accepts: mutex - The mutex.
+ *          attr  - Ignored.
+ * Returns: 0.
+ */
+int sx_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+
+/*
+ * Purpose: Unregisters a mutex.
+ * Accepts: mutex - The mutex.
+ * Returns: 0.
+ */
+int sx_mutex_destroy(pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Scheduling point, then takes the mutex, blocking the task while
+ *          another task owns it.
+ * Accepts: mutex - The mutex.
+ * Returns: 0.
+ */
+int sx_mutex_lock(pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Scheduling point, then takes the mutex if it is free.
+ * Accepts: mutex - The mutex.
+ * Returns: 0 on success, EBUSY if another task owns it.
+ */
+int sx_mutex_trylock(pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Releases the mutex, makes its waiters runnable, then a
+ *          scheduling point.
+ * Accepts: mutex - The mutex.
+ * Returns: 0, or EPERM if the calling task does not own it.
+ */
+int sx_mutex_unlock(pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Registers a condition variable with the scheduler.
+ * Accepts: cond - The condition variable.
+ *          attr - Ignored.
+ * Returns: 0.
+ */
+int sx_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
+
+/*
+ * Purpose: Unregisters a condition variable.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_destroy(pthread_cond_t *cond);
+
+/*
+ * Purpose: Releases the mutex, blocks until signaled, then re-takes the
+ *          mutex.
+ * Accepts: cond  - The condition variable.
+ *          mutex - The mutex the task owns.
+ * Returns: 0.
+ */
+int sx_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+
+/*
+ * Purpose: Makes one waiter (a seeded choice among them) runnable, then a
+ *          scheduling point.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_signal(pthread_cond_t *cond);
+
+/*
+ * Purpose: Makes every waiter runnable, then a scheduling point.
+ * Accepts: cond - The condition variable.
+ * Returns: 0.
+ */
+int sx_cond_broadcast(pthread_cond_t *cond);
+
+/*
+ * Purpose: Registers a semaphore with its initial value.
+ * Accepts: sem     - The semaphore.
+ *          pshared - Ignored.
+ *          value   - Initial value.
+ * Returns: 0.
+ */
+int sx_sem_init(sem_t *sem, int pshared, unsigned int value);
+
+/*
+ * Purpose: Unregisters a semaphore.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_destroy(sem_t *sem);
+
+/*
+ * Purpose: Scheduling point, then decrements the semaphore, blocking the
+ *          task while it is zero.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_wait(sem_t *sem);
+
+/*
+ * Purpose: Scheduling point, then decrements the semaphore if positive.
+ * Accepts: sem - The semaphore.
+ * Returns: 0 on success, -1 with errno EAGAIN if it is zero.
+ */
+int sx_sem_trywait(sem_t *sem);
+
+/*
+ * Purpose: Increments the semaphore, makes its waiters runnable, then a
+ *          scheduling point.
+ * Accepts: sem - The semaphore.
+ * Returns: 0.
+ */
+int sx_sem_post(sem_t *sem);
+
+#ifdef SCHED_EXPLORE
+// --- Redirection ---
+#define pthread_mutex_init sx_mutex_init
+#define pthread_mutex_destroy sx_mutex_destroy
+#define pthread_mutex_lock sx_mutex_lock
+#define pthread_mutex_trylock sx_mutex_trylock
+#define pthread_mutex_unlock sx_mutex_unlock
+#define pthread_cond_init sx_cond_init
+#define pthread_cond_destroy sx_cond_destroy
+#define pthread_cond_wait sx_cond_wait
+#define pthread_cond_signal sx_cond_signal
+#define pthread_cond_broadcast sx_cond_broadcast
+#define sem_init sx_sem_init
+#define sem_destroy sx_sem_destroy
+#define sem_wait sx_sem_wait
+#define sem_trywait sx_sem_trywait
+#define sem_post sx_sem_post
+
+// The contention profiler times real lock calls; the harness needs plain ones
+#undef QUEUE_LOCK
+#undef QUEUE_UNLOCK
+#undef QUEUE_HOLD_PAUSE
+#undef QUEUE_HOLD_RESUME
+#define QUEUE_LOCK(q, site) pthread_mutex_lock(&(q)->mutex)
+#define QUEUE_UNLOCK(q) pthread_mutex_unlock(&(q)->mutex)
+#define QUEUE_HOLD_PAUSE() ((void)0)
+#define QUEUE_HOLD_RESUME() ((void)0)
+#endif // SCHED_EXPLORE
+
+#endif // SCHED_HOOKS_H
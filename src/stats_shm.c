@@ -0,0 +1,179 @@
+#include "stats_shm.h"
+#include "queue_manager.h"
+#include "consumer.h"
+#include "thread_stats.h"
+#include "rates.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// --- Static Variables ---
+static stats_shm_page_t *page = NULL;
+static char shm_name[STATS_SHM_NAME_MAX];
+static pthread_t stats_shm_thread;
+static bool stats_shm_running = false;
+static atomic_bool stats_shm_stop_requested = false;
+static queue_t *published_queue = NULL;
+
+// --- Internal Helper Function Declarations ---
+static void* stats_shm_thread_func(void *arg);
+static void stats_shm_publish(void);
+static void stats_shm_unmap(void);
+
+/*
+ * Purpose: Creates the shared-memory stats page and starts the thread that
+ *          republishes queue and thread statistics into it every
+ *          STATS_SHM_TICK_NS. External tools map the page read-only and never
+ *          interact with this process.
+ * Accepts: q    - Pointer to the queue to publish.
+ *          name - POSIX shared memory name (e.g. "/pcq-stats-1234").
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int stats_shm_start(queue_t *q, const char *name) {
+    if (!q || !name) { errno = EINVAL; print_error("StatsShm", "NULL queue or name."); return -1; }
+    if (stats_shm_running) return 0;
+    if (strlen(name) >= sizeof(shm_name)) { errno = ENAMETOOLONG; print_error("StatsShm", "Shared memory name too long"); return -1; }
+    published_queue = q;
+
+    // A page left behind by a crashed run with a recycled PID is simply reused
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) { print_error("StatsShm", "shm_open failed"); return -1; }
+    strcpy(shm_name, name);
+    if (ftruncate(fd, (off_t)sizeof(stats_shm_page_t)) == -1) {
+        print_error("StatsShm", "ftruncate failed");
+        close(fd);
+        stats_shm_unmap();
+        return -1;
+    }
+    void *addr = mmap(NULL, sizeof(stats_shm_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the object alive
+    if (addr == MAP_FAILED) { print_error("StatsShm", "mmap failed"); stats_shm_unmap(); return -1; }
+    page = addr;
+
+    // Readers reject the page until the magic is in place, so write it last
+    memset(page, 0, sizeof(*page));
+    page->version = STATS_SHM_VERSION;
+    page->page_size = (uint32_t)sizeof(stats_shm_page_t);
+    page->pid = (uint32_t)getpid();
+    stats_shm_publish();
+    atomic_thread_fence(memory_order_release);
+    memcpy(page->magic, STATS_SHM_MAGIC, STATS_SHM_MAGIC_LEN);
+
+    atomic_store(&stats_shm_stop_requested, false);
+    int ret = pthread_create(&stats_shm_thread, NULL, stats_shm_thread_func, NULL);
+    if (ret != 0) { errno = ret; print_error("StatsShm", "pthread_create (stats-shm) failed"); stats_shm_unmap(); return -1; }
+    stats_shm_running = true;
+
+    char info[STATS_SHM_NAME_MAX + 64];
+    snprintf(info, sizeof(info), "Publishing stats to shared memory %s.", shm_name);
+    print_info("StatsShm", info);
+    return 0;
+}
+
+/*
+ * Purpose: Stops the publisher, unmaps the page and unlinks the shared
+ *          memory object. Safe to call when it was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void stats_shm_stop(void) {
+    if (!stats_shm_running) return;
+    atomic_store(&stats_shm_stop_requested, true);
+    int ret = pthread_join(stats_shm_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("StatsShm", "pthread_join (stats-shm) failed"); }
+    stats_shm_running = false;
+    stats_shm_unmap();
+}
+
+/*
+ * Purpose: Publisher thread body. Rewrites the page every STATS_SHM_TICK_NS.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* stats_shm_thread_func(void *arg) {
+    (void)arg;
+    while (!atomic_load(&stats_shm_stop_requested)) {
+        struct timespec tick = { 0, (long)STATS_SHM_TICK_NS };
+        nanosleep(&tick, NULL); // EINTR just shortens one tick
+        stats_shm_publish();
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Rewrites the page under the seqlock. Only lock-free snapshots,
+ *          per-thread counters and the published rates are read, so the
+ *          workers never wait for the publisher.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void stats_shm_publish(void) {
+    // Gather everything first so the odd-sequence window stays short
+    queue_stats_t st;
+    queue_get_stats_snapshot(published_queue, &st);
+    rate_t producer_rate, consumer_rate;
+    rates_get_role(THREAD_ROLE_PRODUCER, &producer_rate);
+    rates_get_role(THREAD_ROLE_CONSUMER, &consumer_rate);
+    unsigned long hash_failures = consumer_hash_failures();
+
+    uint64_t seq = atomic_load_explicit(&page->seq, memory_order_relaxed);
+    atomic_store_explicit(&page->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // Odd sequence is visible before any field changes
+
+    page->update_ns = monotonic_ns();
+    page->mode = (uint32_t)st.mode;
+    page->count = st.count;
+    page->capacity = st.capacity;
+    page->added_total = st.added_total;
+    page->extracted_total = st.extracted_total;
+    page->resize_total = st.resize_total;
+    page->swap_total = st.swap_total;
+    page->hash_failures = hash_failures;
+    page->waiting_producers = st.waiting_producers;
+    page->waiting_consumers = st.waiting_consumers;
+    page->waiting_resizers = st.waiting_resizers;
+    for (int w = 0; w < STATS_SHM_RATE_WINDOWS && w < RATE_WINDOWS; ++w) {
+        page->producer_rate[w] = producer_rate.msgs[w];
+        page->consumer_rate[w] = consumer_rate.msgs[w];
+    }
+
+    int32_t threads = 0;
+    uint32_t listed = 0;
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire)) continue;
+        threads++;
+        if (listed >= STATS_SHM_MAX_THREADS) continue;
+        stats_shm_thread_t *out = &page->threads[listed++];
+        rate_t rate;
+        thread_role_t rate_role;
+        int rate_id;
+        out->role = (uint32_t)atomic_load(&ts->role);
+        out->id = (uint32_t)atomic_load(&ts->id);
+        out->state = (uint32_t)atomic_load(&ts->state);
+        out->messages = atomic_load_explicit(&ts->messages, memory_order_relaxed);
+        out->waits = atomic_load_explicit(&ts->waits, memory_order_relaxed);
+        out->wait_ns = atomic_load_explicit(&ts->wait_ns, memory_order_relaxed);
+        out->msgs_per_s = rates_get_thread(i, &rate, &rate_role, &rate_id) ? rate.msgs[0] : 0.0;
+    }
+    page->thread_count = threads;
+    page->listed_threads = listed;
+
+    atomic_store_explicit(&page->seq, seq + 2, memory_order_release);
+}
+
+/*
+ * Purpose: Unmaps the page (if mapped) and unlinks the shared memory object.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void stats_shm_unmap(void) {
+    if (page) {
+        if (munmap(page, sizeof(*page)) == -1) print_error("StatsShm", "munmap failed");
+        page = NULL;
+    }
+    if (shm_name[0] != '\0') {
+        if (shm_unlink(shm_name) == -1 && errno != ENOENT) print_error("StatsShm", "shm_unlink failed");
+        shm_name[0] = '\0';
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef STATS_SHM_H
+#define STATS_SHM_H
+
+#include "common.h"
+#include "stats_shm_format.h"
+
+// --- Constants ---
+#define STATS_SHM_TICK_NS 100000000ULL // 100ms publishing period (10 Hz)
+#define STATS_SHM_NAME_MAX 64
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Creates the shared-memory stats page and starts the thread that
+ *          republishes queue and thread statistics into it every
+ *          STATS_SHM_TICK_NS. External tools map the page read-only and never
+ *          interact with this process.
+ * Accepts: q    - Pointer to the queue to publish.
+ *          name - POSIX shared memory name (e.g. "/pcq-stats-1234").
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int stats_shm_start(queue_t *q, const char *name);
+
+/*
+ * Purpose: Stops the publisher, unmaps the page and unlinks the shared
+ *          memory object. Safe to call when it was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void stats_shm_stop(void);
+
+#endif // STATS_SHM_H
@@ -0,0 +1,61 @@
+#ifndef STATS_SHM_FORMAT_H
+#define STATS_SHM_FORMAT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Layout of the shared-memory stats page, shared by the publisher
+// (stats_shm.c) and external monitors (queue_top.c). The publisher rewrites
+// the page in place under a seqlock: 'seq' is odd while an update is in
+// progress, and a reader retries if it changed while the page was copied.
+
+// --- Constants ---
+#define STATS_SHM_MAGIC "PCSTATS1"
+#define STATS_SHM_MAGIC_LEN 8
+#define STATS_SHM_VERSION 1
+#define STATS_SHM_PREFIX "pcq-stats-"   // Default object name: "/" STATS_SHM_PREFIX "<pid>"
+#define STATS_SHM_MAX_THREADS 64        // Threads listed in the page (the rest are counted only)
+#define STATS_SHM_RATE_WINDOWS 3        // 1 s, 10 s and 60 s EWMAs
+
+// --- Per-Thread Entry (48 bytes) ---
+typedef struct stats_shm_thread_s {
+    uint32_t role;       // thread_role_t: 0 producer, 1 consumer, 2 control
+    uint32_t id;
+    uint32_t state;      // thread_state_t
+    uint32_t reserved;
+    uint64_t messages;
+    uint64_t waits;      // Blocking queue waits
+    uint64_t wait_ns;    // Total time blocked
+    double msgs_per_s;   // 1 s EWMA
+} stats_shm_thread_t;
+
+// --- Page ---
+typedef struct stats_shm_page_s {
+    char magic[STATS_SHM_MAGIC_LEN];
+    uint32_t version;
+    uint32_t page_size;          // sizeof(stats_shm_page_t) of the publisher
+    _Atomic uint64_t seq;        // Seqlock sequence (odd: update in progress)
+    uint32_t pid;
+    uint32_t mode;               // sync_mode_t: 0 sem, 1 cond
+    uint64_t update_ns;          // CLOCK_MONOTONIC of the last update
+    uint64_t count;
+    uint64_t capacity;
+    uint64_t added_total;
+    uint64_t extracted_total;
+    uint64_t resize_total;
+    uint64_t swap_total;
+    uint64_t hash_failures;
+    int32_t waiting_producers;
+    int32_t waiting_consumers;
+    int32_t waiting_resizers;
+    int32_t thread_count;        // Registered threads (may exceed the listed ones)
+    double producer_rate[STATS_SHM_RATE_WINDOWS]; // Messages per second
+    double consumer_rate[STATS_SHM_RATE_WINDOWS];
+    uint32_t listed_threads;     // Valid entries in threads[]
+    uint32_t reserved;
+    stats_shm_thread_t threads[STATS_SHM_MAX_THREADS];
+} stats_shm_page_t;
+
+_Static_assert(sizeof(stats_shm_thread_t) == 48, "stats_shm_thread_t must stay 48 bytes");
+
+#endif // STATS_SHM_FORMAT_H
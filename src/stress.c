@@ -0,0 +1,466 @@
+// Conservation checker: producers stamp every message with (producer id,
+// sequence); consumers prove that nothing is lost, nothing is delivered
+// twice and each producer's messages arrive in order, while the queue is
+// resized at random and threads are retired and replaced.
+// Usage: stress [-m sem|cond] [-p N] [-c N] [-d MS] [-q CAP] [-Q MAX] [-R MS] [-x STEP] [-T MS] [-S MS] [-s SEED]
+#include "bench_run.h"
+#include "queue_manager.h"
+#include "config.h"
+
+// --- Constants ---
+#define STRESS_MAX_PRODUCER_IDS 256    // Producer IDs over a whole run, replacements included
+#define STRESS_MAX_WORKERS 128         // Live producers plus consumers
+#define STRESS_SEQ_LIMIT (1UL << 24)   // Sequences per producer ID (its bitmap covers these)
+#define STRESS_TICK_NS 1000000L        // Control loop period (1ms)
+#define STRESS_STAMP_SIZE 12           // Payload: 4-byte producer ID, 8-byte sequence
+#define STRESS_BITS_PER_WORD 64
+
+// --- Per-Producer-ID Record ---
+typedef struct stress_stream_s {
+    atomic_ulong *seen;         // Bitmap of delivered sequences (lazily touched calloc)
+    atomic_ulong produced;      // Sequences queue_add accepted (0..produced-1)
+} stress_stream_t;
+
+// --- Worker Slot ---
+typedef struct stress_worker_s {
+    pthread_t thread;
+    bool in_use;
+    bool producer;
+    uint32_t id;                // Producer ID (producers) or consumer number
+    atomic_bool stop;           // Leave the loop after the current operation
+    atomic_bool exited;
+} stress_worker_t;
+
+// --- Run Totals (consumers add with relaxed atomics) ---
+typedef struct stress_totals_s {
+    atomic_ulong consumed;
+    atomic_ulong duplicates;
+    atomic_ulong order_violations;
+    atomic_ulong corrupt;       // Bad hash, unknown producer ID or out-of-range sequence
+} stress_totals_t;
+
+// --- Static Variables ---
+static queue_t *queue = NULL;
+static stress_stream_t streams[STRESS_MAX_PRODUCER_IDS];
+static uint32_t next_producer_id = 0;
+static stress_worker_t workers[STRESS_MAX_WORKERS];
+static stress_totals_t totals;
+static atomic_bool resizer_stop = false;
+static atomic_bool resizer_exited = false;
+static atomic_ulong resizes_done = 0;
+static long resize_interval_ms = 20;
+static int resize_step = 16;
+static unsigned int resizer_seed = 1;
+
+// --- Internal Helper Function Declarations ---
+static void* stress_producer_func(void *arg);
+static void* stress_consumer_func(void *arg);
+static void* stress_resizer_func(void *arg);
+static int start_worker(bool producer);
+static void retire_random_worker(bool producer, unsigned int *seed);
+static void reap_workers(void);
+static int live_workers(bool producer);
+static bool wait_until(bool (*done)(void), long stall_ms);
+static bool producers_gone(void);
+static bool all_delivered(void);
+static bool resizer_gone(void);
+static unsigned long produced_total(void);
+static void report_stall(const char *phase);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Runs the stress phase with resizes and churn, then
+ *          stops producers, drains the queue and checks every stream.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS if every check passed, EXIT_FAILURE otherwise.
+ */
+int main(int argc, char *argv[]) {
+    sync_mode_t mode = SYNC_MODE_SEM;
+    int producers = 4, consumers = 4;
+    long duration_ms = 5000, churn_ms = 50, stall_ms = 2000;
+    long capacity = 64, max_capacity = 1024;
+    unsigned int seed = (unsigned int)time(NULL);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:c:d:q:Q:R:x:T:S:s:h")) != -1) {
+        int bad = 0;
+        switch (opt) {
+            case 'm': if (strcmp(optarg, "sem") == 0) mode = SYNC_MODE_SEM;
+                      else if (strcmp(optarg, "cond") == 0) mode = SYNC_MODE_CONDVAR;
+                      else bad = 1;
+                      break;
+            case 'p': producers = (int)strtol(optarg, NULL, 10); bad = producers < 1; break;
+            case 'c': consumers = (int)strtol(optarg, NULL, 10); bad = consumers < 1; break;
+            case 'd': duration_ms = strtol(optarg, NULL, 10); bad = duration_ms <= 0; break;
+            case 'q': capacity = strtol(optarg, NULL, 10); bad = capacity < 1; break;
+            case 'Q': max_capacity = strtol(optarg, NULL, 10); bad = max_capacity < 1 || max_capacity > QUEUE_CAPACITY_LIMIT; break;
+            case 'R': resize_interval_ms = strtol(optarg, NULL, 10); bad = resize_interval_ms < 0; break;
+            case 'x': resize_step = (int)strtol(optarg, NULL, 10); bad = resize_step < 1; break;
+            case 'T': churn_ms = strtol(optarg, NULL, 10); bad = churn_ms < 0; break;
+            case 'S': stall_ms = strtol(optarg, NULL, 10); bad = stall_ms <= 0; break;
+            case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: bad = 1; break;
+        }
+        if (bad) { print_usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (optind != argc || capacity > max_capacity || producers + consumers + 2 > STRESS_MAX_WORKERS) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_setup();
+    g_config.max_capacity = (size_t)max_capacity;
+    queue = queue_create((size_t)capacity, mode);
+    if (!queue) return EXIT_FAILURE;
+    printf("stress: engine %s, %d producers, %d consumers, capacity %ld..%ld, resize every %ld ms (step <= %d), "
+           "churn every %ld ms, %ld ms, seed %u\n", queue_engine_name(mode), producers, consumers, capacity, max_capacity,
+           resize_interval_ms, resize_step, churn_ms, duration_ms, seed);
+    fflush(stdout);
+
+    resizer_seed = seed ^ 0x9e3779b9u;
+    for (int i = 0; i < consumers; ++i) if (start_worker(false) == -1) return EXIT_FAILURE;
+    for (int i = 0; i < producers; ++i) if (start_worker(true) == -1) return EXIT_FAILURE;
+    pthread_t resizer;
+    bool resizer_started = false;
+    if (resize_interval_ms > 0) {
+        int ret = pthread_create(&resizer, NULL, stress_resizer_func, NULL);
+        PTHREAD_CHECK(ret, "Stress: Create Resizer");
+        resizer_started = true;
+    }
+
+    // Stress phase: churn threads and watch for progress
+    unsigned long churn_events = 0;
+    uint64_t start_ns = monotonic_ns();
+    uint64_t next_churn_ns = start_ns + (uint64_t)churn_ms * 1000000ULL;
+    uint64_t last_progress_ns = start_ns;
+    unsigned long last_consumed = 0;
+    for (;;) {
+        bench_sleep_ns(STRESS_TICK_NS);
+        uint64_t now = monotonic_ns();
+        reap_workers();
+        unsigned long consumed = atomic_load(&totals.consumed);
+        if (consumed != last_consumed) { last_consumed = consumed; last_progress_ns = now; }
+        else if (now - last_progress_ns > (uint64_t)stall_ms * 1000000ULL) report_stall("stress");
+        if (now - start_ns >= (uint64_t)duration_ms * 1000000ULL) break;
+
+        if (churn_ms > 0 && now >= next_churn_ns) {
+            next_churn_ns = now + (uint64_t)churn_ms * 1000000ULL;
+            // Replace first, retire second, so each role keeps at least one live thread
+            bool producer = rand_r(&seed) % 2 == 0;
+            if (producer && next_producer_id >= STRESS_MAX_PRODUCER_IDS) producer = false;
+            if (start_worker(producer) == 0) {
+                retire_random_worker(producer, &seed);
+                churn_events++;
+            }
+        }
+    }
+    double stress_s = (double)(monotonic_ns() - start_ns) / 1e9;
+
+    // Drain: no more resizes or producers, then every produced message must arrive
+    atomic_store(&resizer_stop, true);
+    if (resizer_started) {
+        if (!wait_until(resizer_gone, stall_ms)) report_stall("stopping the resizer");
+        pthread_join(resizer, NULL);
+    }
+    for (int i = 0; i < STRESS_MAX_WORKERS; ++i) {
+        if (workers[i].in_use && workers[i].producer) atomic_store(&workers[i].stop, true);
+    }
+    if (!wait_until(producers_gone, stall_ms)) report_stall("stopping producers");
+    if (!wait_until(all_delivered, stall_ms)) report_stall("draining");
+
+    g_terminate_flag = 1;
+    while (live_workers(false) > 0) {
+        queue_wake_all(queue, STRESS_MAX_WORKERS);
+        bench_sleep_ns(STRESS_TICK_NS);
+        reap_workers();
+    }
+
+    // Every accepted sequence must have been delivered exactly once
+    unsigned long lost = 0, phantom = 0;
+    for (uint32_t id = 0; id < next_producer_id; ++id) {
+        unsigned long produced = atomic_load(&streams[id].produced);
+        for (unsigned long w = 0; w < STRESS_SEQ_LIMIT / STRESS_BITS_PER_WORD; ++w) {
+            unsigned long bits = atomic_load_explicit(&streams[id].seen[w], memory_order_relaxed);
+            unsigned long base = w * STRESS_BITS_PER_WORD;
+            if (base >= produced) { if (bits) phantom += (unsigned long)__builtin_popcountl(bits); continue; }
+            unsigned long valid = produced - base >= STRESS_BITS_PER_WORD ? ~0UL : (1UL << (produced - base)) - 1;
+            lost += (unsigned long)__builtin_popcountl(~bits & valid);
+            phantom += (unsigned long)__builtin_popcountl(bits & ~valid);
+        }
+        free(streams[id].seen);
+    }
+
+    unsigned long consumed = atomic_load(&totals.consumed);
+    unsigned long duplicates = atomic_load(&totals.duplicates);
+    unsigned long order = atomic_load(&totals.order_violations);
+    unsigned long corrupt = atomic_load(&totals.corrupt);
+    printf("Delivered %lu messages from %u producer streams (%.0f msg/s during %.1f s of stress)\n", consumed,
+           next_producer_id, (double)consumed / stress_s, stress_s);
+    printf("Resizes %lu, thread replacements %lu, final capacity %zu\n", atomic_load(&resizes_done), churn_events,
+           queue_get_capacity(queue));
+    printf("Lost %lu, duplicated %lu, out of order %lu, corrupt %lu, never produced %lu\n", lost, duplicates, order,
+           corrupt, phantom);
+    bool ok = lost == 0 && duplicates == 0 && order == 0 && corrupt == 0 && phantom == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    queue_destroy(queue, mode);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Purpose: Producer body: adds messages stamped with its ID and the next
+ *          sequence number, with no think time, until told to stop or its
+ *          sequence space is used up.
+ * Accepts: arg - Pointer to the worker's slot.
+ * Returns: Always NULL.
+ */
+static void* stress_producer_func(void *arg) {
+    stress_worker_t *w = (stress_worker_t *)arg;
+    stress_stream_t *stream = &streams[w->id];
+    message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = (unsigned char)w->id;
+    msg.size = STRESS_STAMP_SIZE;
+    memcpy(msg.data, &w->id, sizeof(uint32_t));
+
+    for (uint64_t seq = 0; seq < STRESS_SEQ_LIMIT && !atomic_load_explicit(&w->stop, memory_order_relaxed); ++seq) {
+        memcpy(msg.data + sizeof(uint32_t), &seq, sizeof(uint64_t));
+        msg.hash = 0;
+        msg.hash = calculate_message_hash(&msg);
+        if (queue_add(queue, &msg, "Stress Producer") == -1) break;
+        atomic_store_explicit(&stream->produced, seq + 1, memory_order_release);
+    }
+    atomic_store(&w->exited, true);
+    return NULL;
+}
+
+/*
+ * Purpose: Consumer body: removes messages and checks each one: intact
+ *          hash, a known producer and sequence, not seen before, and later
+ *          than the last sequence this consumer saw from that producer
+ *          (a FIFO queue hands each consumer every stream in order).
+ * Accepts: arg - Pointer to the worker's slot.
+ * Returns: Always NULL.
+ */
+static void* stress_consumer_func(void *arg) {
+    stress_worker_t *w = (stress_worker_t *)arg;
+    int64_t *last_seq = malloc(STRESS_MAX_PRODUCER_IDS * sizeof(int64_t));
+    if (!last_seq) { print_error("Stress Consumer", "malloc failed"); atomic_store(&w->exited, true); return NULL; }
+    for (int i = 0; i < STRESS_MAX_PRODUCER_IDS; ++i) last_seq[i] = -1;
+    message_t msg;
+
+    while (!atomic_load_explicit(&w->stop, memory_order_relaxed)) {
+        if (queue_remove(queue, &msg, "Stress Consumer") == -1) break;
+        atomic_fetch_add_explicit(&totals.consumed, 1, memory_order_relaxed);
+
+        unsigned short original_hash = msg.hash;
+        msg.hash = 0;
+        uint32_t id;
+        uint64_t seq;
+        memcpy(&id, msg.data, sizeof(uint32_t));
+        memcpy(&seq, msg.data + sizeof(uint32_t), sizeof(uint64_t));
+        if (calculate_message_hash(&msg) != original_hash || msg.size != STRESS_STAMP_SIZE ||
+            id >= STRESS_MAX_PRODUCER_IDS || seq >= STRESS_SEQ_LIMIT || !streams[id].seen) {
+            atomic_fetch_add_explicit(&totals.corrupt, 1, memory_order_relaxed);
+            continue;
+        }
+        unsigned long bit = 1UL << (seq % STRESS_BITS_PER_WORD);
+        unsigned long prior = atomic_fetch_or_explicit(&streams[id].seen[seq / STRESS_BITS_PER_WORD], bit, memory_order_relaxed);
+        if (prior & bit) atomic_fetch_add_explicit(&totals.duplicates, 1, memory_order_relaxed);
+        if ((int64_t)seq <= last_seq[id]) atomic_fetch_add_explicit(&totals.order_violations, 1, memory_order_relaxed);
+        else last_seq[id] = (int64_t)seq;
+    }
+    free(last_seq);
+    atomic_store(&w->exited, true);
+    return NULL;
+}
+
+/*
+ * Purpose: Resizer body: every interval grows or shrinks the queue by a
+ *          random step (up to the configured maximum), staying within the
+ *          configured capacity range. Shrinks may block until consumers
+ *          free enough slots.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* stress_resizer_func(void *arg) {
+    (void)arg;
+    while (!atomic_load(&resizer_stop)) {
+        bench_sleep_ns((uint64_t)resize_interval_ms * 1000000ULL);
+        int change = 1 + rand_r(&resizer_seed) % resize_step;
+        size_t cap = atomic_load_explicit(&queue->snap_capacity, memory_order_relaxed);
+        // Lean toward the middle of the range so both directions keep happening
+        bool grow = rand_r(&resizer_seed) % (g_config.max_capacity + 1) >= cap;
+        if (queue_resize(queue, grow ? change : -change) == 0) atomic_fetch_add(&resizes_done, 1);
+    }
+    atomic_store(&resizer_exited, true);
+    return NULL;
+}
+
+/*
+ * Purpose: Starts a producer (with a new producer ID) or a consumer in a
+ *          free worker slot.
+ * Accepts: producer - true for a producer.
+ * Returns: 0 on success, -1 if no slot or ID is left or the thread could
+ *          not be created.
+ */
+static int start_worker(bool producer) {
+    static uint32_t next_consumer_id = 1;
+    int slot = -1;
+    for (int i = 0; i < STRESS_MAX_WORKERS && slot == -1; ++i) if (!workers[i].in_use) slot = i;
+    if (slot == -1 || (producer && next_producer_id >= STRESS_MAX_PRODUCER_IDS)) return -1;
+
+    stress_worker_t *w = &workers[slot];
+    w->producer = producer;
+    atomic_store(&w->stop, false);
+    atomic_store(&w->exited, false);
+    if (producer) {
+        stress_stream_t *stream = &streams[next_producer_id];
+        stream->seen = calloc(STRESS_SEQ_LIMIT / STRESS_BITS_PER_WORD, sizeof(atomic_ulong));
+        if (!stream->seen) { print_error("Stress", "calloc for a sequence bitmap failed"); return -1; }
+        atomic_store(&stream->produced, 0);
+        w->id = next_producer_id++;
+    } else {
+        w->id = next_consumer_id++;
+    }
+    int ret = pthread_create(&w->thread, NULL, producer ? stress_producer_func : stress_consumer_func, w);
+    if (ret != 0) { errno = ret; print_error("Stress", "pthread_create failed"); return -1; }
+    w->in_use = true;
+    return 0;
+}
+
+/*
+ * Purpose: Asks a random live, not yet retiring worker of a role to stop.
+ * Accepts: producer - Role to pick from.
+ *          seed     - The caller's rand_r seed.
+ * Returns: None.
+ */
+static void retire_random_worker(bool producer, unsigned int *seed) {
+    int candidates[STRESS_MAX_WORKERS];
+    int count = 0;
+    for (int i = 0; i < STRESS_MAX_WORKERS; ++i) {
+        if (workers[i].in_use && workers[i].producer == producer && !atomic_load(&workers[i].stop)) candidates[count++] = i;
+    }
+    if (count > 1) atomic_store(&workers[candidates[rand_r(seed) % (unsigned int)count]].stop, true);
+}
+
+/*
+ * Purpose: Joins workers that have left their loop and frees their slots.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void reap_workers(void) {
+    for (int i = 0; i < STRESS_MAX_WORKERS; ++i) {
+        if (!workers[i].in_use || !atomic_load(&workers[i].exited)) continue;
+        int ret = pthread_join(workers[i].thread, NULL);
+        if (ret != 0) { errno = ret; print_error("Stress", "pthread_join failed"); }
+        workers[i].in_use = false;
+    }
+}
+
+/*
+ * Purpose: Counts the workers of a role that have not been reaped.
+ * Accepts: producer - Role to count.
+ * Returns: The count.
+ */
+static int live_workers(bool producer) {
+    int count = 0;
+    for (int i = 0; i < STRESS_MAX_WORKERS; ++i) if (workers[i].in_use && workers[i].producer == producer) count++;
+    return count;
+}
+
+/*
+ * Purpose: Polls a condition, reaping workers meanwhile, as long as
+ *          messages keep being delivered; gives up after stall_ms without
+ *          any delivery.
+ * Accepts: done     - The condition.
+ *          stall_ms - Longest tolerated time without progress.
+ * Returns: true once the condition holds, false on a stall.
+ */
+static bool wait_until(bool (*done)(void), long stall_ms) {
+    unsigned long last = atomic_load(&totals.consumed);
+    uint64_t last_progress_ns = monotonic_ns();
+    while (!done()) {
+        bench_sleep_ns(STRESS_TICK_NS);
+        reap_workers();
+        unsigned long consumed = atomic_load(&totals.consumed);
+        uint64_t now = monotonic_ns();
+        if (consumed != last) { last = consumed; last_progress_ns = now; }
+        else if (now - last_progress_ns > (uint64_t)stall_ms * 1000000ULL) return false;
+    }
+    return true;
+}
+
+/*
+ * Purpose: Condition for wait_until: every producer has exited.
+ * Accepts: None.
+ * Returns: true when no producer is left.
+ */
+static bool producers_gone(void) {
+    return live_workers(true) == 0;
+}
+
+/*
+ * Purpose: Condition for wait_until: every accepted message was consumed.
+ * Accepts: None.
+ * Returns: true when the consumed count has reached the produced count.
+ */
+static bool all_delivered(void) {
+    return atomic_load(&totals.consumed) >= produced_total();
+}
+
+/*
+ * Purpose: Condition for wait_until: the resizer thread has exited.
+ * Accepts: None.
+ * Returns: true once it has.
+ */
+static bool resizer_gone(void) {
+    return atomic_load(&resizer_exited);
+}
+
+/*
+ * Purpose: Sums the accepted sequences of every producer ID.
+ * Accepts: None.
+ * Returns: The total.
+ */
+static unsigned long produced_total(void) {
+    unsigned long sum = 0;
+    for (uint32_t id = 0; id < next_producer_id; ++id) sum += atomic_load(&streams[id].produced);
+    return sum;
+}
+
+/*
+ * Purpose: Reports that no message was delivered for the stall timeout,
+ *          with the queue's lock-free snapshot, and exits: the stuck
+ *          threads cannot be joined.
+ * Accepts: phase - What the run was doing.
+ * Returns: None (exits with EXIT_FAILURE).
+ */
+static void report_stall(const char *phase) {
+    queue_stats_t st;
+    queue_get_stats_snapshot(queue, &st);
+    printf("STALL while %s: no delivery; count %zu/%zu, waiting producers %d, consumers %d, resizers %d, "
+           "delivered %lu of %lu\n", phase, st.count, st.capacity, st.waiting_producers, st.waiting_consumers,
+           st.waiting_resizers, atomic_load(&totals.consumed), produced_total());
+    printf("FAIL\n");
+    fflush(stdout);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Purpose: Prints usage information.
+ * Accepts: prog_name - argv[0].
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-m sem|cond] [-p N] [-c N] [-d MS] [-q CAP] [-Q MAX] [-R MS] [-x STEP] [-T MS] [-S MS] [-s SEED]\n", prog_name);
+    fprintf(stderr, "  -m ENGINE : sem or cond (default: sem).\n");
+    fprintf(stderr, "  -p N, -c N: Producers and consumers kept running (default: 4 and 4).\n");
+    fprintf(stderr, "  -d MS     : Length of the stress phase (default: 5000).\n");
+    fprintf(stderr, "  -q CAP    : Initial capacity (default: 64); -Q MAX: largest capacity (default: 1024).\n");
+    fprintf(stderr, "  -R MS     : Resize every MS, 0 disables (default: 20); -x STEP: largest change (default: 16).\n");
+    fprintf(stderr, "  -T MS     : Replace a random producer or consumer every MS, 0 disables (default: 50).\n");
+    fprintf(stderr, "  -S MS     : Fail when nothing is delivered for MS (default: 2000).\n");
+    fprintf(stderr, "  -s SEED   : Seed for resize sizes and churn choices (default: time).\n");
+}
@@ -0,0 +1,159 @@
+#include "thread_stats.h"
+
+thread_stats_t g_thread_stats[THREAD_STATS_SLOTS];
+_Thread_local thread_stats_t *tls_thread_stats = NULL;
+
+// Counters of threads that have already exited, so role totals never go backwards
+static atomic_ulong retired_messages[THREAD_ROLE_COUNT];
+static atomic_ulong retired_bytes[THREAD_ROLE_COUNT];
+static atomic_ulong retired_waits[THREAD_ROLE_COUNT];
+static atomic_ulong retired_wait_ns[THREAD_ROLE_COUNT];
+static hist_t retired_wait_hist[THREAD_ROLE_COUNT];
+// Makes retiring a slot atomic for the role total readers: without it a reader
+// could count an exiting thread twice (retired and still live) or not at all
+static pthread_mutex_t retire_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const role_names[THREAD_ROLE_COUNT] = { "producer", "consumer", "control" };
+static const char *const state_names[THREAD_STATE_COUNT] = {
+    "RUN", "PROD", "CONS", "WAIT", "INQ", "SLEEP", "RESIZE"
+};
+
+/*
+ * Purpose: Claims a free stats slot for the calling thread and makes it the
+ *          thread's current slot. Pair with thread_stats_unregister (use a
+ *          pthread cleanup handler for cancelable threads).
+ * Accepts: role - The thread's role.
+ *          id   - The thread's 1-based ID within its role.
+ * Returns: Pointer to the claimed slot, or NULL if all slots are taken.
+ */
+thread_stats_t* thread_stats_register(thread_role_t role, int id) {
+    if (tls_thread_stats) return tls_thread_stats;
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        bool expected = false;
+        if (atomic_load_explicit(&ts->in_use, memory_order_relaxed)) continue;
+        if (!atomic_compare_exchange_strong(&ts->in_use, &expected, true)) continue;
+
+        ts->role = role;
+        ts->id = id;
+        atomic_store_explicit(&ts->state, THREAD_STATE_RUNNING, memory_order_relaxed);
+        atomic_store_explicit(&ts->messages, 0, memory_order_relaxed);
+        atomic_store_explicit(&ts->bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&ts->waits, 0, memory_order_relaxed);
+        atomic_store_explicit(&ts->wait_ns, 0, memory_order_relaxed);
+        hist_reset(&ts->wait_hist);
+        atomic_fetch_add_explicit(&ts->generation, 1, memory_order_release); // Publishes role/id to monitors
+        tls_thread_stats = ts;
+        return ts;
+    }
+    print_info("Thread Stats", "No free stats slot; thread runs unmonitored.");
+    return NULL;
+}
+
+/*
+ * Purpose: Folds the calling thread's counters into its role's retired totals
+ *          and releases its slot, as one step for the role total readers.
+ *          Safe to call when not registered.
+ * Accepts: None.
+ * Returns: None.
+ */
+void thread_stats_unregister(void) {
+    thread_stats_t *ts = tls_thread_stats;
+    if (!ts) return;
+    tls_thread_stats = NULL;
+    int role = atomic_load_explicit(&ts->role, memory_order_relaxed);
+    int ret = pthread_mutex_lock(&retire_mutex); PTHREAD_CHECK(ret, "Thread Stats Unregister: Lock Mutex");
+    atomic_fetch_add(&retired_messages[role], atomic_load_explicit(&ts->messages, memory_order_relaxed));
+    atomic_fetch_add(&retired_bytes[role], atomic_load_explicit(&ts->bytes, memory_order_relaxed));
+    atomic_fetch_add(&retired_waits[role], atomic_load_explicit(&ts->waits, memory_order_relaxed));
+    atomic_fetch_add(&retired_wait_ns[role], atomic_load_explicit(&ts->wait_ns, memory_order_relaxed));
+    hist_merge(&retired_wait_hist[role], &ts->wait_hist);
+    atomic_store_explicit(&ts->messages, 0, memory_order_relaxed);
+    atomic_store_explicit(&ts->bytes, 0, memory_order_relaxed);
+    atomic_store_explicit(&ts->waits, 0, memory_order_relaxed);
+    atomic_store_explicit(&ts->wait_ns, 0, memory_order_relaxed);
+    hist_reset(&ts->wait_hist);
+    atomic_store(&ts->in_use, false);
+    ret = pthread_mutex_unlock(&retire_mutex); PTHREAD_CHECK(ret, "Thread Stats Unregister: Unlock Mutex");
+}
+
+/*
+ * Purpose: Cleanup-handler adapter for thread_stats_unregister, suitable for
+ *          pthread_cleanup_push.
+ * Accepts: arg - Unused.
+ * Returns: None.
+ */
+void thread_stats_cleanup_handler(void *arg) {
+    (void)arg;
+    thread_stats_unregister();
+}
+
+/*
+ * Purpose: Sums message and byte counters of live and retired threads.
+ *          Takes the retire mutex, so it must not run on the message path.
+ * Accepts: role     - Role to sum.
+ *          messages - Where to store the message total (may be NULL).
+ *          bytes    - Where to store the byte total (may be NULL).
+ * Returns: None.
+ */
+void thread_stats_role_totals(thread_role_t role, unsigned long *messages, unsigned long *bytes) {
+    int ret = pthread_mutex_lock(&retire_mutex); PTHREAD_CHECK(ret, "Role Totals: Lock Mutex");
+    unsigned long msg_sum = atomic_load(&retired_messages[role]);
+    unsigned long byte_sum = atomic_load(&retired_bytes[role]);
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire) || (thread_role_t)atomic_load(&ts->role) != role) continue;
+        msg_sum += atomic_load_explicit(&ts->messages, memory_order_relaxed);
+        byte_sum += atomic_load_explicit(&ts->bytes, memory_order_relaxed);
+    }
+    ret = pthread_mutex_unlock(&retire_mutex); PTHREAD_CHECK(ret, "Role Totals: Unlock Mutex");
+    if (messages) *messages = msg_sum;
+    if (bytes) *bytes = byte_sum;
+}
+
+/*
+ * Purpose: Sums blocking-wait counters of live and retired threads and
+ *          optionally merges their wait-duration histograms.
+ * Accepts: role    - Role to sum.
+ *          waits   - Where to store the number of blocking waits (may be NULL).
+ *          wait_ns - Where to store the total blocked time (may be NULL).
+ *          hist    - Histogram to fill (reset first; may be NULL).
+ * Returns: None.
+ */
+void thread_stats_role_waits(thread_role_t role, unsigned long *waits, uint64_t *wait_ns, hist_t *hist) {
+    int ret = pthread_mutex_lock(&retire_mutex); PTHREAD_CHECK(ret, "Role Waits: Lock Mutex");
+    unsigned long wait_sum = atomic_load(&retired_waits[role]);
+    uint64_t ns_sum = atomic_load(&retired_wait_ns[role]);
+    if (hist) {
+        hist_reset(hist);
+        hist_merge(hist, &retired_wait_hist[role]);
+    }
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire) || (thread_role_t)atomic_load(&ts->role) != role) continue;
+        wait_sum += atomic_load_explicit(&ts->waits, memory_order_relaxed);
+        ns_sum += atomic_load_explicit(&ts->wait_ns, memory_order_relaxed);
+        if (hist) hist_merge(hist, &ts->wait_hist);
+    }
+    ret = pthread_mutex_unlock(&retire_mutex); PTHREAD_CHECK(ret, "Role Waits: Unlock Mutex");
+    if (waits) *waits = wait_sum;
+    if (wait_ns) *wait_ns = ns_sum;
+}
+
+/*
+ * Purpose: Returns a short fixed name for a role, for reports.
+ * Accepts: role - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* thread_role_name(thread_role_t role) {
+    return (role >= 0 && role < THREAD_ROLE_COUNT) ? role_names[role] : "?";
+}
+
+/*
+ * Purpose: Returns a short fixed name for a state, for reports.
+ * Accepts: state - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* thread_state_name(thread_state_t state) {
+    return (state >= 0 && state < THREAD_STATE_COUNT) ? state_names[state] : "?";
+}
@@ -0,0 +1,158 @@
+#ifndef THREAD_STATS_H
+#define THREAD_STATS_H
+
+#include "common.h"
+#include "hist.h"
+#include "trace.h"
+
+// --- Constants ---
+#define THREAD_STATS_EXTRA_SLOTS 16 // Main, control and helper threads
+#define THREAD_STATS_SLOTS (PRODUCER_THREAD_LIMIT + CONSUMER_THREAD_LIMIT + THREAD_STATS_EXTRA_SLOTS)
+
+// --- Thread Roles ---
+typedef enum {
+    THREAD_ROLE_PRODUCER,
+    THREAD_ROLE_CONSUMER,
+    THREAD_ROLE_CONTROL, // Main thread, control socket and other helpers
+    THREAD_ROLE_COUNT
+} thread_role_t;
+
+// --- Thread States (what the thread is doing right now) ---
+typedef enum {
+    THREAD_STATE_RUNNING,   // Generic work outside the queue
+    THREAD_STATE_PRODUCING, // Building a message
+    THREAD_STATE_CONSUMING, // Processing (verifying) a message
+    THREAD_STATE_WAITING,   // Blocked for a slot, an item or a shrink
+    THREAD_STATE_IN_QUEUE,  // Inside a queue critical section
+    THREAD_STATE_SLEEPING,  // Think time
+    THREAD_STATE_RESIZING,  // Inside queue_resize
+    THREAD_STATE_COUNT
+} thread_state_t;
+
+// --- Per-Thread Stats Slot ---
+// Counters are written only by the owning thread (relaxed load+store, no RMW)
+// and read by monitors without locks.
+typedef struct thread_stats_s {
+    atomic_bool in_use;
+    atomic_uint generation;  // Bumped on every registration so monitors notice slot reuse
+    atomic_int role;         // thread_role_t
+    atomic_int id;
+    atomic_int state;
+    atomic_ulong messages;   // Completed queue operations (the heartbeat)
+    atomic_ulong bytes;      // Payload bytes moved
+    atomic_ulong waits;      // Queue waits that actually blocked
+    atomic_ulong wait_ns;    // Total time blocked in those waits
+    hist_t wait_hist;        // Duration of each blocking wait
+} thread_stats_t;
+
+extern thread_stats_t g_thread_stats[THREAD_STATS_SLOTS];
+extern _Thread_local thread_stats_t *tls_thread_stats;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Claims a free stats slot for the calling thread and makes it the
+ *          thread's current slot. Pair with thread_stats_unregister (use a
+ *          pthread cleanup handler for cancelable threads).
+ * Accepts: role - The thread's role.
+ *          id   - The thread's 1-based ID within its role.
+ * Returns: Pointer to the claimed slot, or NULL if all slots are taken.
+ */
+thread_stats_t* thread_stats_register(thread_role_t role, int id);
+
+/*
+ * Purpose: Folds the calling thread's counters into its role's retired totals
+ *          and releases its slot, as one step for the role total readers.
+ *          Safe to call when not registered.
+ * Accepts: None.
+ * Returns: None.
+ */
+void thread_stats_unregister(void);
+
+/*
+ * Purpose: Cleanup-handler adapter for thread_stats_unregister, suitable for
+ *          pthread_cleanup_push.
+ * Accepts: arg - Unused.
+ * Returns: None.
+ */
+void thread_stats_cleanup_handler(void *arg);
+
+/*
+ * Purpose: Sums message and byte counters of live and retired threads.
+ *          Takes the retire mutex, so it must not run on the message path.
+ * Accepts: role     - Role to sum.
+ *          messages - Where to store the message total (may be NULL).
+ *          bytes    - Where to store the byte total (may be NULL).
+ * Returns: None.
+ */
+void thread_stats_role_totals(thread_role_t role, unsigned long *messages, unsigned long *bytes);
+
+/*
+ * Purpose: Sums blocking-wait counters of live and retired threads and
+ *          optionally merges their wait-duration histograms.
+ * Accepts: role    - Role to sum.
+ *          waits   - Where to store the number of blocking waits (may be NULL).
+ *          wait_ns - Where to store the total blocked time (may be NULL).
+ *          hist    - Histogram to fill (reset first; may be NULL).
+ * Returns: None.
+ */
+void thread_stats_role_waits(thread_role_t role, unsigned long *waits, uint64_t *wait_ns, hist_t *hist);
+
+/*
+ * Purpose: Returns a short fixed name for a role, for reports.
+ * Accepts: role - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* thread_role_name(thread_role_t role);
+
+/*
+ * Purpose: Returns a short fixed name for a state, for reports.
+ * Accepts: state - The value to name.
+ * Returns: Pointer to a static string.
+ */
+const char* thread_state_name(thread_state_t state);
+
+/*
+ * Purpose: Records the calling thread's current state, and traces the change
+ *          when tracing is active (the spans of trace_decode -f chrome).
+ *          No-op for threads without a stats slot.
+ * Accepts: state - The new state.
+ * Returns: None.
+ */
+static inline void thread_stats_set_state(thread_state_t state) {
+    thread_stats_t *ts = tls_thread_stats;
+    if (!ts) return;
+    if (atomic_load_explicit(&g_trace_active, memory_order_relaxed)) {
+        int previous = atomic_load_explicit(&ts->state, memory_order_relaxed);
+        if (previous != (int)state) trace_record_slow(TRACE_EV_STATE, (uint32_t)state, 0, (uint32_t)previous);
+    }
+    atomic_store_explicit(&ts->state, (int)state, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Records one completed queue operation (the watchdog heartbeat).
+ * Accepts: bytes - Payload bytes moved by the operation.
+ * Returns: None.
+ */
+static inline void thread_stats_note_message(size_t bytes) {
+    thread_stats_t *ts = tls_thread_stats;
+    if (!ts) return;
+    atomic_store_explicit(&ts->messages, atomic_load_explicit(&ts->messages, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&ts->bytes, atomic_load_explicit(&ts->bytes, memory_order_relaxed) + bytes, memory_order_relaxed);
+}
+
+/*
+ * Purpose: Records one queue wait that blocked (semaphore, condition variable,
+ *          shrink or engine-swap gate). No-op for threads without a slot.
+ * Accepts: ns - Time spent blocked.
+ * Returns: None.
+ */
+static inline void thread_stats_note_wait(uint64_t ns) {
+    thread_stats_t *ts = tls_thread_stats;
+    if (!ts) return;
+    atomic_store_explicit(&ts->waits, atomic_load_explicit(&ts->waits, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&ts->wait_ns, atomic_load_explicit(&ts->wait_ns, memory_order_relaxed) + ns, memory_order_relaxed);
+    hist_record(&ts->wait_hist, ns);
+}
+
+#endif // THREAD_STATS_H
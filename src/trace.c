@@ -0,0 +1,199 @@
+#include "trace.h"
+#include "thread_stats.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+atomic_bool g_trace_active = false;
+
+// --- Static Variables ---
+typedef struct trace_buffer_s {
+    trace_file_header_t *header; // Start of the mapping
+    trace_event_t *events;
+    uint64_t capacity;
+    size_t map_len;
+} trace_buffer_t;
+
+static char trace_dir[512];
+static long trace_events = TRACE_DEFAULT_EVENTS;
+static uint64_t trace_clock_base = 0;
+static bool trace_started = false;
+static atomic_uint trace_file_seq = 0;
+
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static _Thread_local trace_buffer_t tls_trace = { NULL, NULL, 0, 0 };
+static _Thread_local bool tls_trace_failed = false; // Do not retry a failed file per event
+
+// --- Internal Helper Function Declarations ---
+static trace_buffer_t* trace_thread_buffer(void);
+static void trace_key_init(void);
+static void trace_buffer_release(void *arg);
+
+/*
+ * Purpose: Enables binary tracing into per-thread files in a directory
+ *          (created if missing). Each thread maps its own file when it
+ *          starts (trace_thread_attach; the calling thread's here), so
+ *          recording never takes a lock or makes a syscall.
+ * Accepts: dir               - Directory for the trace files.
+ *          events_per_thread - Event slots per file; older events are
+ *                              overwritten once a file is full.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int trace_start(const char *dir, long events_per_thread) {
+    if (!dir || events_per_thread <= 0) { errno = EINVAL; print_error("Trace", "Invalid trace directory or size."); return -1; }
+    if (strlen(dir) >= sizeof(trace_dir) - 32) { errno = ENAMETOOLONG; print_error("Trace", "Trace directory path too long"); return -1; }
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) { print_error("Trace", "mkdir of trace directory failed"); return -1; }
+
+    strcpy(trace_dir, dir);
+    trace_events = events_per_thread;
+    trace_clock_base = monotonic_ns();
+    trace_started = true;
+    atomic_store(&g_trace_active, true);
+    trace_thread_attach(); // The main thread resizes from the keyboard
+
+    char info[sizeof(trace_dir) + 64];
+    snprintf(info, sizeof(info), "Recording to %s (%ld events per thread).", trace_dir, trace_events);
+    print_info("Trace", info);
+    return 0;
+}
+
+/*
+ * Purpose: Pauses or resumes recording after trace_start. Files of threads
+ *          that already traced stay mapped.
+ * Accepts: active - true to record, false to pause.
+ * Returns: 0 on success, -1 if tracing was never started.
+ */
+int trace_set_active(bool active) {
+    if (!trace_started) return -1;
+    atomic_store(&g_trace_active, active);
+    return 0;
+}
+
+/*
+ * Purpose: Maps the calling thread's trace file if tracing was started (also
+ *          while paused), so recording never does file I/O: a thread's first
+ *          event can come inside a queue critical section. Call right after
+ *          thread_stats_register (the header records role and ID). Does
+ *          nothing without tracing.
+ * Accepts: None.
+ * Returns: None.
+ */
+void trace_thread_attach(void) {
+    if (!trace_started) return;
+    int old_state;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state); // open() is a cancellation point
+    trace_thread_buffer();
+    pthread_setcancelstate(old_state, NULL);
+}
+
+/*
+ * Purpose: Stops recording. Mapped files are written back by the kernel and
+ *          unmapped when their threads exit.
+ * Accepts: None.
+ * Returns: None.
+ */
+void trace_stop(void) {
+    if (!trace_started) return;
+    atomic_store(&g_trace_active, false);
+    char info[64];
+    snprintf(info, sizeof(info), "Stopped; %u trace file(s) written.", atomic_load(&trace_file_seq));
+    print_info("Trace", info);
+}
+
+/*
+ * Purpose: Records an event in the calling thread's trace file (slow path of
+ *          trace_record). A thread that never attached records nothing.
+ * Accepts: type      - Event type.
+ *          queue_idx - Queue slot or other type-specific value.
+ *          size      - Message payload size.
+ *          aux       - Type-specific value (see trace_format.h).
+ * Returns: None.
+ */
+void trace_record_slow(trace_event_type_t type, uint32_t queue_idx, uint16_t size, uint32_t aux) {
+    trace_buffer_t *buf = &tls_trace;
+    if (!buf->header) return; // Not attached, the file failed, or the thread is exiting
+    trace_file_header_t *hdr = buf->header;
+    trace_event_t *ev = &buf->events[hdr->written % buf->capacity];
+    ev->ts_ns = monotonic_ns();
+    ev->queue_idx = queue_idx;
+    ev->aux = aux;
+    ev->size = size;
+    ev->thread_id = (uint16_t)hdr->thread_id;
+    ev->type = (uint8_t)type;
+    ev->role = (uint8_t)hdr->role;
+    hdr->written++; // Only this thread writes its file
+}
+
+/*
+ * Purpose: Returns the calling thread's trace buffer, creating, sizing and
+ *          mapping its file on first use (from trace_thread_attach only). The file is named after the
+ *          process ID and a run-wide sequence number; the header records the
+ *          thread's role and ID from its stats slot.
+ * Accepts: None.
+ * Returns: The buffer, or NULL if the file could not be created.
+ */
+static trace_buffer_t* trace_thread_buffer(void) {
+    if (tls_trace.header) return &tls_trace;
+    if (tls_trace_failed) return NULL;
+    tls_trace_failed = true; // Cleared below on success
+
+    if (pthread_once(&trace_key_once, trace_key_init) != 0) return NULL;
+    unsigned seq = atomic_fetch_add(&trace_file_seq, 1);
+    char path[sizeof(trace_dir) + 64];
+    snprintf(path, sizeof(path), "%s/trace-%d-%03u.bin", trace_dir, (int)getpid(), seq);
+
+    size_t map_len = sizeof(trace_file_header_t) + (size_t)trace_events * sizeof(trace_event_t);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) { print_error("Trace", "open of trace file failed"); return NULL; }
+    if (ftruncate(fd, (off_t)map_len) == -1) { print_error("Trace", "ftruncate of trace file failed"); close(fd); return NULL; }
+    void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (map == MAP_FAILED) { print_error("Trace", "mmap of trace file failed"); return NULL; }
+
+    trace_file_header_t *hdr = (trace_file_header_t *)map;
+    memcpy(hdr->magic, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    hdr->version = TRACE_VERSION;
+    hdr->header_size = sizeof(trace_file_header_t);
+    hdr->event_size = sizeof(trace_event_t);
+    thread_stats_t *ts = tls_thread_stats;
+    hdr->role = ts ? (uint32_t)atomic_load(&ts->role) : (uint32_t)THREAD_ROLE_CONTROL;
+    hdr->thread_id = ts ? (uint32_t)atomic_load(&ts->id) : 0;
+    hdr->pid = (uint32_t)getpid();
+    hdr->capacity = (uint64_t)trace_events;
+    hdr->clock_base_ns = trace_clock_base;
+    hdr->written = 0;
+
+    tls_trace.header = hdr;
+    tls_trace.events = (trace_event_t *)(hdr + 1);
+    tls_trace.capacity = (uint64_t)trace_events;
+    tls_trace.map_len = map_len;
+    tls_trace_failed = false;
+    pthread_setspecific(trace_key, &tls_trace);
+    return &tls_trace;
+}
+
+/*
+ * Purpose: Creates the thread-specific-data key whose destructor unmaps a
+ *          thread's trace file. Run once through pthread_once.
+ * Accepts: None.
+ * Returns: None.
+ */
+static void trace_key_init(void) {
+    int ret = pthread_key_create(&trace_key, trace_buffer_release);
+    if (ret != 0) { errno = ret; print_error("Trace", "pthread_key_create failed"); }
+}
+
+/*
+ * Purpose: Thread exit destructor: unmaps the thread's trace file (the data
+ *          is already in the page cache, so nothing is lost).
+ * Accepts: arg - The exiting thread's trace buffer.
+ * Returns: None.
+ */
+static void trace_buffer_release(void *arg) {
+    trace_buffer_t *buf = (trace_buffer_t *)arg;
+    if (!buf || !buf->header) return;
+    munmap(buf->header, buf->map_len);
+    buf->header = NULL;
+    buf->events = NULL;
+    tls_trace_failed = true; // Late events of this thread are not recorded
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+#include "trace_format.h"
+
+// --- Constants ---
+#define TRACE_DEFAULT_EVENTS 65536L // Event slots per thread file (1.5 MiB)
+
+extern atomic_bool g_trace_active;
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Enables binary tracing into per-thread files in a directory
+ *          (created if missing). Each thread maps its own file when it
+ *          starts (trace_thread_attach; the calling thread's here), so
+ *          recording never takes a lock or makes a syscall.
+ * Accepts: dir               - Directory for the trace files.
+ *          events_per_thread - Event slots per file; older events are
+ *                              overwritten once a file is full.
+ * Returns: 0 on success, -1 on failure (prints error message).
+ */
+int trace_start(const char *dir, long events_per_thread);
+
+/*
+ * Purpose: Pauses or resumes recording after trace_start. Files of threads
+ *          that already traced stay mapped.
+ * Accepts: active - true to record, false to pause.
+ * Returns: 0 on success, -1 if tracing was never started.
+ */
+int trace_set_active(bool active);
+
+/*
+ * Purpose: Maps the calling thread's trace file if tracing was started (also
+ *          while paused), so recording never does file I/O: a thread's first
+ *          event can come inside a queue critical section. Call right after
+ *          thread_stats_register (the header records role and ID). Does
+ *          nothing without tracing.
+ * Accepts: None.
+ * Returns: None.
+ */
+void trace_thread_attach(void);
+
+/*
+ * Purpose: Stops recording. Mapped files are written back by the kernel and
+ *          unmapped when their threads exit.
+ * Accepts: None.
+ * Returns: None.
+ */
+void trace_stop(void);
+
+/*
+ * Purpose: Records an event in the calling thread's trace file (slow path of
+ *          trace_record). A thread that never attached records nothing.
+ * Accepts: type      - Event type.
+ *          queue_idx - Queue slot or other type-specific value.
+ *          size      - Message payload size.
+ *          aux       - Type-specific value (see trace_format.h).
+ * Returns: None.
+ */
+void trace_record_slow(trace_event_type_t type, uint32_t queue_idx, uint16_t size, uint32_t aux);
+
+/*
+ * Purpose: Records an event if tracing is active; a single relaxed load
+ *          otherwise.
+ * Accepts: type      - Event type.
+ *          queue_idx - Queue slot or other type-specific value.
+ *          size      - Message payload size.
+ *          aux       - Type-specific value (see trace_format.h).
+ * Returns: None.
+ */
+static inline void trace_record(trace_event_type_t type, uint32_t queue_idx, uint16_t size, uint32_t aux) {
+    if (atomic_load_explicit(&g_trace_active, memory_order_relaxed)) trace_record_slow(type, queue_idx, size, aux);
+}
+
+#endif // TRACE_H
@@ -0,0 +1,468 @@
+// Offline decoder for the binary traces written with --trace-dir.
+// Usage: trace_decode [-f text|csv|summary|chrome] FILE...
+#include "trace_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// --- Types ---
+typedef enum { FORMAT_TEXT, FORMAT_CSV, FORMAT_SUMMARY, FORMAT_CHROME } output_format_t;
+
+typedef struct trace_input_s {
+    const char *path;
+    trace_file_header_t hdr;
+    uint64_t kept;      // Events still in the file
+    uint64_t lost;      // Events overwritten because the ring wrapped
+} trace_input_t;
+
+typedef struct loaded_event_s {
+    trace_event_t ev;
+    int input;          // Index into the input array
+    uint64_t seq;       // Order within its file, keeps the sort stable
+} loaded_event_t;
+
+// Per-thread accumulators for the summary
+typedef struct thread_summary_s {
+    uint64_t by_type[TRACE_EV_COUNT];
+    uint64_t bytes;
+    uint64_t waits;
+    uint64_t wait_ns;
+    uint64_t wait_max_ns;
+    uint64_t wait_begin_ns; // 0 when not inside a wait
+    uint64_t first_ns;
+    uint64_t last_ns;
+} thread_summary_t;
+
+// Indexed by thread_role_t
+static const char role_tags[] = { 'P', 'C', 'M' };
+static const char *const event_names[TRACE_EV_COUNT] = {
+    "?", "ADD", "REMOVE", "WAIT_BEGIN", "WAIT_END", "RESIZE", "SWAP", "STATE",
+    "OP_BEGIN", "OP_END", "SIGNAL", "RESIZE_PH"
+};
+static const char *const op_names[] = { "queue_add", "queue_remove", "queue_resize" };
+static const char *const signal_names[] = { "full_slots", "empty_slots", "not_empty", "not_full", "broadcast" };
+static const char *const resize_phase_names[] = { "locked", "copied", "synced" };
+#define NAME_OF(table, value) ((value) < sizeof(table) / sizeof((table)[0]) ? (table)[value] : "?")
+static const char *const wait_names[] = { "slot", "item", "shrink", "gate" };
+// Indexed by thread_state_t; span names of the Chrome export
+static const char *const state_names[] = { "running", "producing", "verifying", "waiting", "critical-section", "sleeping", "resizing" };
+#define STATE_RUNNING 0  // Gaps between the other states, not exported as spans
+#define STATE_WAITING 3  // Named after the wait kind in the Chrome export
+
+// --- Internal Helper Function Declarations ---
+static int load_input(trace_input_t *in, int index, loaded_event_t **events, size_t *count, size_t *cap);
+static int compare_events(const void *a, const void *b);
+static char role_tag(uint32_t role);
+static const char* event_name(unsigned type);
+static const char* wait_name(uint32_t kind);
+static const char* state_name(uint32_t state);
+static void print_text(const loaded_event_t *events, size_t count, uint64_t base_ns);
+static void print_csv(const loaded_event_t *events, size_t count, uint64_t base_ns);
+static void print_summary(const trace_input_t *inputs, int input_count, const loaded_event_t *events, size_t count);
+static void print_chrome(const trace_input_t *inputs, int input_count, const loaded_event_t *events, size_t count, uint64_t base_ns);
+static void print_chrome_span(unsigned pid, int tid, uint32_t state, uint32_t wait_kind, uint64_t start_ns, uint64_t end_ns, uint64_t base_ns);
+static void print_usage(const char *prog_name);
+
+/*
+ * Purpose: Entry point. Loads every trace file, merges the events of all
+ *          threads by timestamp and prints them in the requested format.
+ * Accepts: argc - Argument count.
+ *          argv - Argument vector.
+ * Returns: EXIT_SUCCESS, or EXIT_FAILURE on bad usage or unreadable input.
+ */
+int main(int argc, char *argv[]) {
+    output_format_t format = FORMAT_TEXT;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "text") == 0) format = FORMAT_TEXT;
+                else if (strcmp(optarg, "csv") == 0) format = FORMAT_CSV;
+                else if (strcmp(optarg, "summary") == 0) format = FORMAT_SUMMARY;
+                else if (strcmp(optarg, "chrome") == 0) format = FORMAT_CHROME;
+                else { print_usage(argv[0]); return EXIT_FAILURE; }
+                break;
+            case 'h': print_usage(argv[0]); return EXIT_SUCCESS;
+            default: print_usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    int input_count = argc - optind;
+    if (input_count <= 0) { print_usage(argv[0]); return EXIT_FAILURE; }
+
+    trace_input_t *inputs = calloc((size_t)input_count, sizeof(trace_input_t));
+    if (!inputs) { perror("calloc"); return EXIT_FAILURE; }
+    loaded_event_t *events = NULL;
+    size_t count = 0, cap = 0;
+    for (int i = 0; i < input_count; ++i) {
+        inputs[i].path = argv[optind + i];
+        if (load_input(&inputs[i], i, &events, &count, &cap) == -1) { free(events); free(inputs); return EXIT_FAILURE; }
+    }
+    qsort(events, count, sizeof(loaded_event_t), compare_events);
+
+    uint64_t base_ns = inputs[0].hdr.clock_base_ns; // Shared by all files of one run
+    if (format == FORMAT_TEXT) print_text(events, count, base_ns);
+    else if (format == FORMAT_CSV) print_csv(events, count, base_ns);
+    else if (format == FORMAT_SUMMARY) print_summary(inputs, input_count, events, count);
+    else print_chrome(inputs, input_count, events, count, base_ns);
+
+    free(events);
+    free(inputs);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Purpose: Reads and validates one trace file and appends its surviving
+ *          events, oldest first, to the event array (grown as needed).
+ * Accepts: in     - Input descriptor; path set, header and counts filled here.
+ *          index  - Index of the input, stored with each event.
+ *          events - In/out pointer to the event array.
+ *          count  - In/out number of events in the array.
+ *          cap    - In/out allocated size of the array.
+ * Returns: 0 on success, -1 on error (message printed).
+ */
+static int load_input(trace_input_t *in, int index, loaded_event_t **events, size_t *count, size_t *cap) {
+    FILE *fp = fopen(in->path, "rb");
+    if (!fp) { fprintf(stderr, "Error: %s: %s\n", in->path, strerror(errno)); return -1; }
+    if (fread(&in->hdr, sizeof(in->hdr), 1, fp) != 1 || memcmp(in->hdr.magic, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0) {
+        fprintf(stderr, "Error: %s: not a trace file.\n", in->path); fclose(fp); return -1;
+    }
+    if (in->hdr.version != TRACE_VERSION || in->hdr.header_size != sizeof(trace_file_header_t) ||
+        in->hdr.event_size != sizeof(trace_event_t) || in->hdr.capacity == 0) {
+        fprintf(stderr, "Error: %s: unsupported trace version or layout.\n", in->path); fclose(fp); return -1;
+    }
+
+    uint64_t capacity = in->hdr.capacity, written = in->hdr.written;
+    in->kept = written < capacity ? written : capacity;
+    in->lost = written - in->kept;
+    trace_event_t *ring = malloc((size_t)capacity * sizeof(trace_event_t));
+    if (!ring) { fprintf(stderr, "Error: %s: out of memory.\n", in->path); fclose(fp); return -1; }
+    if (fread(ring, sizeof(trace_event_t), (size_t)capacity, fp) != (size_t)capacity) {
+        fprintf(stderr, "Error: %s: truncated trace file.\n", in->path); free(ring); fclose(fp); return -1;
+    }
+    fclose(fp);
+
+    if (*count + in->kept > *cap) {
+        size_t new_cap = (*cap == 0) ? 1024 : *cap;
+        while (new_cap < *count + in->kept) new_cap *= 2;
+        loaded_event_t *grown = realloc(*events, new_cap * sizeof(loaded_event_t));
+        if (!grown) { fprintf(stderr, "Error: out of memory.\n"); free(ring); return -1; }
+        *events = grown;
+        *cap = new_cap;
+    }
+    uint64_t start = written - in->kept; // Index of the oldest surviving event
+    for (uint64_t i = 0; i < in->kept; ++i) {
+        loaded_event_t *le = &(*events)[(*count)++];
+        le->ev = ring[(start + i) % capacity];
+        le->input = index;
+        le->seq = i;
+    }
+    free(ring);
+    return 0;
+}
+
+/*
+ * Purpose: qsort comparator: by timestamp, then input, then order in file.
+ * Accepts: a, b - Pointers to loaded_event_t.
+ * Returns: Negative, zero or positive like strcmp.
+ */
+static int compare_events(const void *a, const void *b) {
+    const loaded_event_t *x = a, *y = b;
+    if (x->ev.ts_ns != y->ev.ts_ns) return x->ev.ts_ns < y->ev.ts_ns ? -1 : 1;
+    if (x->input != y->input) return x->input < y->input ? -1 : 1;
+    if (x->seq != y->seq) return x->seq < y->seq ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Purpose: Returns the one-letter tag of a thread role (P, C or M).
+ * Accepts: role - thread_role_t value from the trace.
+ * Returns: The tag, '?' for unknown roles.
+ */
+static char role_tag(uint32_t role) {
+    return role < sizeof(role_tags) ? role_tags[role] : '?';
+}
+
+/*
+ * Purpose: Returns the name of an event type.
+ * Accepts: type - trace_event_type_t value from the trace.
+ * Returns: Pointer to a static string.
+ */
+static const char* event_name(unsigned type) {
+    return type < TRACE_EV_COUNT ? event_names[type] : "?";
+}
+
+/*
+ * Purpose: Returns the name of a wait kind.
+ * Accepts: kind - trace_wait_kind_t value from the trace.
+ * Returns: Pointer to a static string.
+ */
+static const char* wait_name(uint32_t kind) {
+    return kind < sizeof(wait_names) / sizeof(wait_names[0]) ? wait_names[kind] : "?";
+}
+
+/*
+ * Purpose: Returns the name of a thread state.
+ * Accepts: state - thread_state_t value from the trace.
+ * Returns: Pointer to a static string.
+ */
+static const char* state_name(uint32_t state) {
+    return state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "?";
+}
+
+/*
+ * Purpose: Prints one human-readable line per event, with time relative to
+ *          the start of tracing.
+ * Accepts: events  - Sorted events.
+ *          count   - Number of events.
+ *          base_ns - Trace start time.
+ * Returns: None.
+ */
+static void print_text(const loaded_event_t *events, size_t count, uint64_t base_ns) {
+    for (size_t i = 0; i < count; ++i) {
+        const trace_event_t *ev = &events[i].ev;
+        printf("%14.6f ms  %c%-3u %-10s ", (double)(ev->ts_ns - base_ns) / 1e6, role_tag(ev->role), ev->thread_id, event_name(ev->type));
+        switch (ev->type) {
+            case TRACE_EV_ADD:
+            case TRACE_EV_REMOVE:
+                printf("idx=%u size=%u count=%u\n", ev->queue_idx, ev->size, ev->aux); break;
+            case TRACE_EV_WAIT_BEGIN:
+            case TRACE_EV_WAIT_END:
+                printf("%s\n", wait_name(ev->aux)); break;
+            case TRACE_EV_RESIZE:
+                printf("capacity %u -> %u\n", ev->queue_idx, ev->aux); break;
+            case TRACE_EV_SWAP:
+                printf("engine=%s pause=%u us\n", ev->queue_idx == 0 ? "sem" : "cond", ev->aux); break;
+            case TRACE_EV_STATE:
+                printf("%s -> %s\n", state_name(ev->aux), state_name(ev->queue_idx)); break;
+            case TRACE_EV_OP_BEGIN:
+                printf("%s\n", NAME_OF(op_names, ev->queue_idx)); break;
+            case TRACE_EV_OP_END:
+                printf("%s %s\n", NAME_OF(op_names, ev->queue_idx), ev->aux ? "failed" : "ok"); break;
+            case TRACE_EV_SIGNAL:
+                printf("%s posts=%u\n", NAME_OF(signal_names, ev->queue_idx), ev->aux); break;
+            case TRACE_EV_RESIZE_PHASE:
+                printf("%s capacity=%u\n", NAME_OF(resize_phase_names, ev->queue_idx), ev->aux); break;
+            default:
+                printf("idx=%u size=%u aux=%u\n", ev->queue_idx, ev->size, ev->aux); break;
+        }
+    }
+}
+
+/*
+ * Purpose: Prints all events as CSV with a header row.
+ * Accepts: events  - Sorted events.
+ *          count   - Number of events.
+ *          base_ns - Trace start time.
+ * Returns: None.
+ */
+static void print_csv(const loaded_event_t *events, size_t count, uint64_t base_ns) {
+    printf("ts_ns,rel_ns,role,thread,event,queue_idx,size,aux\n");
+    for (size_t i = 0; i < count; ++i) {
+        const trace_event_t *ev = &events[i].ev;
+        printf("%llu,%llu,%c,%u,%s,%u,%u,%u\n", (unsigned long long)ev->ts_ns, (unsigned long long)(ev->ts_ns - base_ns),
+               role_tag(ev->role), ev->thread_id, event_name(ev->type), ev->queue_idx, ev->size, ev->aux);
+    }
+}
+
+/*
+ * Purpose: Prints per-thread and overall statistics: operation counts and
+ *          rates, bytes, time spent blocked, and events lost to wrapping.
+ * Accepts: inputs      - Loaded trace files (one per thread).
+ *          input_count - Number of files.
+ *          events      - Sorted events.
+ *          count       - Number of events.
+ * Returns: None.
+ */
+static void print_summary(const trace_input_t *inputs, int input_count, const loaded_event_t *events, size_t count) {
+    thread_summary_t *sum = calloc((size_t)input_count, sizeof(thread_summary_t));
+    if (!sum) { fprintf(stderr, "Error: out of memory.\n"); return; }
+    uint64_t wait_by_kind[4] = { 0, 0, 0, 0 };
+
+    for (size_t i = 0; i < count; ++i) {
+        const trace_event_t *ev = &events[i].ev;
+        thread_summary_t *ts = &sum[events[i].input];
+        if (ts->first_ns == 0) ts->first_ns = ev->ts_ns;
+        ts->last_ns = ev->ts_ns;
+        if (ev->type < TRACE_EV_COUNT) ts->by_type[ev->type]++;
+        if (ev->type == TRACE_EV_ADD || ev->type == TRACE_EV_REMOVE) ts->bytes += ev->size;
+        if (ev->type == TRACE_EV_WAIT_BEGIN) ts->wait_begin_ns = ev->ts_ns;
+        if (ev->type == TRACE_EV_WAIT_END && ts->wait_begin_ns != 0) {
+            uint64_t waited = ev->ts_ns - ts->wait_begin_ns;
+            ts->waits++;
+            ts->wait_ns += waited;
+            if (waited > ts->wait_max_ns) ts->wait_max_ns = waited;
+            if (ev->aux < 4) wait_by_kind[ev->aux] += waited;
+            ts->wait_begin_ns = 0;
+        }
+    }
+
+    printf("%-6s %10s %10s %10s %12s %8s %12s %12s %10s\n",
+           "thread", "adds", "removes", "ops/s", "bytes", "waits", "wait_ms", "max_wait_ms", "lost");
+    uint64_t total_ops = 0, total_lost = 0, first = 0, last = 0;
+    for (int i = 0; i < input_count; ++i) {
+        const thread_summary_t *ts = &sum[i];
+        uint64_t ops = ts->by_type[TRACE_EV_ADD] + ts->by_type[TRACE_EV_REMOVE];
+        double span_s = ts->last_ns > ts->first_ns ? (double)(ts->last_ns - ts->first_ns) / 1e9 : 0.0;
+        char name[16];
+        snprintf(name, sizeof(name), "%c%u", role_tag(inputs[i].hdr.role), inputs[i].hdr.thread_id);
+        printf("%-6s %10llu %10llu %10.0f %12llu %8llu %12.3f %12.3f %10llu\n", name,
+               (unsigned long long)ts->by_type[TRACE_EV_ADD], (unsigned long long)ts->by_type[TRACE_EV_REMOVE],
+               span_s > 0 ? (double)ops / span_s : 0.0, (unsigned long long)ts->bytes, (unsigned long long)ts->waits,
+               (double)ts->wait_ns / 1e6, (double)ts->wait_max_ns / 1e6, (unsigned long long)inputs[i].lost);
+        total_ops += ops;
+        total_lost += inputs[i].lost;
+        if (ts->first_ns != 0 && (first == 0 || ts->first_ns < first)) first = ts->first_ns;
+        if (ts->last_ns > last) last = ts->last_ns;
+    }
+
+    double span_s = last > first ? (double)(last - first) / 1e9 : 0.0;
+    printf("\nevents: %zu in %d file(s), %llu lost to wrapping\n", count, input_count, (unsigned long long)total_lost);
+    printf("span: %.3f s, queue ops: %llu (%.0f/s)\n", span_s, (unsigned long long)total_ops, span_s > 0 ? (double)total_ops / span_s : 0.0);
+    printf("blocked: slot %.3f ms, item %.3f ms, shrink %.3f ms, gate %.3f ms\n",
+           (double)wait_by_kind[0] / 1e6, (double)wait_by_kind[1] / 1e6, (double)wait_by_kind[2] / 1e6, (double)wait_by_kind[3] / 1e6);
+    uint64_t resizes = 0, swaps = 0;
+    for (int i = 0; i < input_count; ++i) { resizes += sum[i].by_type[TRACE_EV_RESIZE]; swaps += sum[i].by_type[TRACE_EV_SWAP]; }
+    printf("resizes: %llu, engine swaps: %llu\n", (unsigned long long)resizes, (unsigned long long)swaps);
+    free(sum);
+}
+
+/*
+ * Purpose: Prints the events as a Chrome trace (JSON object format), for
+ *          chrome://tracing or ui.perfetto.dev. Every thread becomes a track
+ *          of complete ("X") spans built from its STATE events: producing,
+ *          waiting (named after the wait kind, e.g. waiting-for-slot),
+ *          critical-section, verifying, sleeping and resizing. Tracepoint
+ *          builds add enclosing queue_add/queue_remove/queue_resize spans and
+ *          signal and resize phase markers. Resizes and engine swaps are
+ *          global instant events and the count reported by each add/remove
+ *          feeds a queue depth counter track.
+ * Accepts: inputs      - Loaded trace files (one per thread).
+ *          input_count - Number of files.
+ *          events      - Sorted events.
+ *          count       - Number of events.
+ *          base_ns     - Trace start time (timestamps are relative to it).
+ * Returns: None.
+ */
+static void print_chrome(const trace_input_t *inputs, int input_count, const loaded_event_t *events, size_t count, uint64_t base_ns) {
+    // Open span per thread: state and start time, plus the kind of the pending wait
+    uint32_t *state = malloc((size_t)input_count * sizeof(uint32_t));
+    uint64_t *since = malloc((size_t)input_count * sizeof(uint64_t));
+    uint32_t *wait_kind = malloc((size_t)input_count * sizeof(uint32_t));
+    uint64_t *last_ns = calloc((size_t)input_count, sizeof(uint64_t));
+    int *open_ops = calloc((size_t)input_count, sizeof(int)); // OP_BEGIN spans awaiting their OP_END
+    if (!state || !since || !wait_kind || !last_ns || !open_ops) {
+        fprintf(stderr, "Error: out of memory.\n");
+        free(state); free(since); free(wait_kind); free(last_ns); free(open_ops);
+        return;
+    }
+    unsigned pid = input_count > 0 ? inputs[0].hdr.pid : 0;
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    printf("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":\"prod_cons_threads %u\"}}", pid, pid);
+    for (int i = 0; i < input_count; ++i) {
+        state[i] = STATE_RUNNING;
+        since[i] = 0;
+        wait_kind[i] = TRACE_WAIT_SLOT;
+        // tid: one track per trace file, sorted producers, consumers, control
+        printf(",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%u,\"tid\":%d,\"args\":{\"name\":\"%c%u\"}}",
+               pid, i + 1, role_tag(inputs[i].hdr.role), inputs[i].hdr.thread_id);
+        printf(",\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%u,\"tid\":%d,\"args\":{\"sort_index\":%u}}",
+               pid, i + 1, inputs[i].hdr.role * 1000 + inputs[i].hdr.thread_id);
+    }
+
+    for (size_t e = 0; e <= count; ++e) {
+        // One pass past the end closes the spans still open at each thread's last event
+        if (e == count) {
+            for (int i = 0; i < input_count; ++i) {
+                if (state[i] != STATE_RUNNING && last_ns[i] > since[i]) print_chrome_span(pid, i + 1, state[i], wait_kind[i], since[i], last_ns[i], base_ns);
+                for (; open_ops[i] > 0; open_ops[i]--) {
+                    printf(",\n{\"ph\":\"E\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f}", pid, i + 1, (double)(last_ns[i] - base_ns) / 1e3);
+                }
+            }
+            break;
+        }
+        const trace_event_t *ev = &events[e].ev;
+        int i = events[e].input;
+        double ts_us = (double)(ev->ts_ns - base_ns) / 1e3;
+        last_ns[i] = ev->ts_ns;
+        switch (ev->type) {
+            case TRACE_EV_STATE:
+                if (state[i] != STATE_RUNNING && since[i] != 0) print_chrome_span(pid, i + 1, state[i], wait_kind[i], since[i], ev->ts_ns, base_ns);
+                state[i] = ev->queue_idx;
+                since[i] = ev->ts_ns;
+                break;
+            case TRACE_EV_WAIT_BEGIN:
+                wait_kind[i] = ev->aux;
+                break;
+            case TRACE_EV_ADD:
+            case TRACE_EV_REMOVE:
+                printf(",\n{\"ph\":\"C\",\"name\":\"queue depth\",\"pid\":%u,\"tid\":0,\"ts\":%.3f,\"args\":{\"count\":%u}}",
+                       pid, ts_us, ev->aux);
+                break;
+            case TRACE_EV_RESIZE:
+                printf(",\n{\"ph\":\"i\",\"s\":\"g\",\"name\":\"resize %u -> %u\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f}",
+                       ev->queue_idx, ev->aux, pid, i + 1, ts_us);
+                break;
+            case TRACE_EV_SWAP:
+                printf(",\n{\"ph\":\"i\",\"s\":\"g\",\"name\":\"swap to %s (%u us)\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f}",
+                       ev->queue_idx == 0 ? "sem" : "cond", ev->aux, pid, i + 1, ts_us);
+                break;
+            case TRACE_EV_OP_BEGIN:
+                open_ops[i]++;
+                printf(",\n{\"ph\":\"B\",\"name\":\"%s\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f}",
+                       NAME_OF(op_names, ev->queue_idx), pid, i + 1, ts_us);
+                break;
+            case TRACE_EV_OP_END:
+                if (open_ops[i] == 0) break; // Its OP_BEGIN was overwritten in the ring
+                open_ops[i]--;
+                printf(",\n{\"ph\":\"E\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f,\"args\":{\"result\":\"%s\"}}",
+                       pid, i + 1, ts_us, ev->aux ? "failed" : "ok");
+                break;
+            case TRACE_EV_SIGNAL:
+                printf(",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"signal %s\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f}",
+                       NAME_OF(signal_names, ev->queue_idx), pid, i + 1, ts_us);
+                break;
+            case TRACE_EV_RESIZE_PHASE:
+                printf(",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"resize %s\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f,\"args\":{\"capacity\":%u}}",
+                       NAME_OF(resize_phase_names, ev->queue_idx), pid, i + 1, ts_us, ev->aux);
+                break;
+            default:
+                break;
+        }
+    }
+    printf("\n]}\n");
+    free(state); free(since); free(wait_kind); free(last_ns); free(open_ops);
+}
+
+/*
+ * Purpose: Prints one complete ("X") span of the Chrome export.
+ * Accepts: pid       - Process ID of the run.
+ *          tid       - Track of the thread.
+ *          state     - thread_state_t of the span.
+ *          wait_kind - trace_wait_kind_t, names WAITING spans.
+ *          start_ns  - Span start.
+ *          end_ns    - Span end.
+ *          base_ns   - Trace start time.
+ * Returns: None.
+ */
+static void print_chrome_span(unsigned pid, int tid, uint32_t state, uint32_t wait_kind, uint64_t start_ns, uint64_t end_ns, uint64_t base_ns) {
+    char name[32];
+    if (state == STATE_WAITING) snprintf(name, sizeof(name), "waiting-for-%s", wait_name(wait_kind));
+    else snprintf(name, sizeof(name), "%s", state_name(state));
+    printf(",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+           name, pid, tid, (double)(start_ns - base_ns) / 1e3, (double)(end_ns - start_ns) / 1e3);
+}
+
+/*
+ * Purpose: Prints command-line usage to stderr.
+ * Accepts: prog_name - The name of the executable (argv[0]).
+ * Returns: None.
+ */
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s [-f text|csv|summary|chrome] FILE...\n", prog_name);
+    fprintf(stderr, "  -f format : Output format (default: text); chrome writes a Chrome/Perfetto\n");
+    fprintf(stderr, "              trace JSON of per-thread state spans.\n");
+    fprintf(stderr, "  FILE      : Trace files written with --trace-dir (trace-PID-SEQ.bin).\n");
+}
@@ -0,0 +1,94 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+
+// On-disk layout of a binary trace file, shared by the recorder (trace.c)
+// and the offline decoder (trace_decode.c). One file per thread: a header
+// followed by 'capacity' fixed-size events used as a ring; 'written' counts
+// every event recorded, so once it exceeds capacity the oldest were overwritten.
+
+// --- Constants ---
+#define TRACE_MAGIC "PCTRACE1"
+#define TRACE_MAGIC_LEN 8
+#define TRACE_VERSION 1
+
+// --- Event Types ---
+typedef enum {
+    TRACE_EV_ADD = 1,     // queue_idx: slot written, size: payload, aux: count after the add
+    TRACE_EV_REMOVE,      // queue_idx: slot read, size: payload, aux: count after the remove
+    TRACE_EV_WAIT_BEGIN,  // aux: trace_wait_kind_t
+    TRACE_EV_WAIT_END,    // aux: trace_wait_kind_t
+    TRACE_EV_RESIZE,      // queue_idx: old capacity, aux: new capacity
+    TRACE_EV_SWAP,        // queue_idx: new sync_mode_t, aux: pause in microseconds
+    TRACE_EV_STATE,       // queue_idx: new thread_state_t, aux: previous thread_state_t
+    // Tracepoints (tracepoint.h), only in builds with TRACEPOINTS defined
+    TRACE_EV_OP_BEGIN,    // queue_idx: trace_op_t
+    TRACE_EV_OP_END,      // queue_idx: trace_op_t, aux: 0 on success, 1 on failure
+    TRACE_EV_SIGNAL,      // queue_idx: trace_signal_t, aux: semaphore posts (0 for condvars)
+    TRACE_EV_RESIZE_PHASE,// queue_idx: trace_resize_phase_t, aux: capacity at that point
+    TRACE_EV_COUNT
+} trace_event_type_t;
+
+// --- Operations of OP_BEGIN/OP_END ---
+typedef enum {
+    TRACE_OP_ADD,
+    TRACE_OP_REMOVE,
+    TRACE_OP_RESIZE
+} trace_op_t;
+
+// --- What a SIGNAL event woke ---
+typedef enum {
+    TRACE_SIGNAL_FULL_SLOTS,  // sem_post(full_slots): an item for a consumer
+    TRACE_SIGNAL_EMPTY_SLOTS, // sem_post(empty_slots): a slot for a producer
+    TRACE_SIGNAL_NOT_EMPTY,   // pthread_cond_signal(not_empty)
+    TRACE_SIGNAL_NOT_FULL,    // pthread_cond_signal(not_full)
+    TRACE_SIGNAL_BROADCAST    // Both condition variables broadcast (resize)
+} trace_signal_t;
+
+// --- Phases of a resize ---
+typedef enum {
+    TRACE_RESIZE_LOCKED,      // Queue mutex acquired
+    TRACE_RESIZE_COPIED,      // Messages moved to the new buffer
+    TRACE_RESIZE_SYNCED       // Semaphore counts adjusted or waiters woken
+} trace_resize_phase_t;
+
+// --- What a WAIT event waited for ---
+typedef enum {
+    TRACE_WAIT_SLOT,      // Producer waiting for a free slot
+    TRACE_WAIT_ITEM,      // Consumer waiting for a message
+    TRACE_WAIT_SHRINK,    // Resize waiting for slots to reclaim
+    TRACE_WAIT_GATE       // Operation held while the engine is swapped
+} trace_wait_kind_t;
+
+// --- File Header (64 bytes) ---
+typedef struct trace_file_header_s {
+    char magic[TRACE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t event_size;
+    uint32_t role;           // thread_role_t of the recording thread
+    uint32_t thread_id;
+    uint32_t pid;
+    uint64_t capacity;       // Number of event slots following the header
+    uint64_t clock_base_ns;  // CLOCK_MONOTONIC at trace start, common to all files of a run
+    uint64_t written;        // Events recorded so far (slot = index % capacity)
+    uint64_t reserved;
+} trace_file_header_t;
+
+// --- Event (24 bytes) ---
+typedef struct trace_event_s {
+    uint64_t ts_ns;          // CLOCK_MONOTONIC
+    uint32_t queue_idx;
+    uint32_t aux;
+    uint16_t size;
+    uint16_t thread_id;
+    uint8_t type;            // trace_event_type_t
+    uint8_t role;            // thread_role_t
+    uint8_t reserved[2];
+} trace_event_t;
+
+_Static_assert(sizeof(trace_file_header_t) == 64, "trace header layout changed");
+_Static_assert(sizeof(trace_event_t) == 24, "trace event layout changed");
+
+#endif // TRACE_FORMAT_H
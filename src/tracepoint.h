@@ -0,0 +1,19 @@
+#ifndef TRACEPOINT_H
+#define TRACEPOINT_H
+
+#include "trace.h"
+
+// Fine-grained tracepoints for the queue internals (operation enter/exit,
+// signals, resize phases). They record into the binary trace like
+// trace_record, but exist only in builds with TRACEPOINTS defined: debug
+// builds by default, release builds with make TRACEPOINTS=1. Otherwise every
+// TRACEPOINT compiles to nothing, not even the check of g_trace_active.
+
+#ifdef TRACEPOINTS
+#define TRACEPOINT(type, queue_idx, size, aux) \
+    trace_record((type), (uint32_t)(queue_idx), (uint16_t)(size), (uint32_t)(aux))
+#else
+#define TRACEPOINT(type, queue_idx, size, aux) ((void)0)
+#endif
+
+#endif // TRACEPOINT_H
@@ -1,4 +1,8 @@
 #include "common.h"
+#include "log.h"
+
+// --- Constants ---
+#define THINK_SLICE_US 100000L // Longest think-time sleep between termination checks
 
 // --- Static Variables for Terminal Handling ---
 static struct termios original_termios;
@@ -13,8 +17,9 @@ static int original_fcntl_flags;
  * Returns: None.
  */
 void print_error(const char *prefix, const char *msg) {
-    fprintf(stderr, "ERROR: [%s] %s (errno %d: %s)\r\n", prefix, msg, errno, strerror(errno));
-    fflush(stderr);
+    int saved_errno = errno; // Formatting below may clobber it
+    log_write(LOG_LEVEL_ERROR, "ERROR: [%s] %s (errno %d: %s)", prefix, msg, saved_errno, strerror(saved_errno));
+    errno = saved_errno;
 }
 
 /*
@@ -24,8 +29,7 @@ void print_error(const char *prefix, const char *msg) {
  * Returns: None.
  */
 void print_info(const char *prefix, const char *msg) {
-    printf("[%s] %s\r\n", prefix, msg);
-    fflush(stdout);
+    log_write(LOG_LEVEL_INFO, "[%s] %s", prefix, msg);
 }
 
 /*
@@ -143,3 +147,48 @@ unsigned short calculate_message_hash(const message_t *msg) {
     }
     return hash;
 }
+
+/*
+ * Purpose: Reads the monotonic clock.
+ * Accepts: None.
+ * Returns: Nanoseconds since an arbitrary fixed point (CLOCK_MONOTONIC).
+ */
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Purpose: Sleeps for a random duration within the given think time range.
+ *          Sleeps in slices of at most THINK_SLICE_US and returns early once
+ *          termination has been requested, since the signal that sets the
+ *          flag interrupts only one thread's sleep.
+ * Accepts: think  - Pointer to the think time range to draw from.
+ *          seed   - Pointer to the caller's rand_r seed.
+ *          prefix - String prefix for error messages.
+ * Returns: None.
+ */
+void think_time_sleep(think_time_t *think, unsigned int *seed, const char *prefix) {
+    long min_us = atomic_load_explicit(&think->min_us, memory_order_relaxed);
+    long max_us = atomic_load_explicit(&think->max_us, memory_order_relaxed);
+    long delay_us = min_us;
+    if (max_us > min_us) delay_us += rand_r(seed) % (max_us - min_us);
+    while (delay_us > 0 && !g_terminate_flag) {
+        long slice_us = delay_us < THINK_SLICE_US ? delay_us : THINK_SLICE_US;
+        delay_us -= slice_us;
+
+        struct timespec delay_req = {0, 0};
+        struct timespec delay_rem;
+        delay_req.tv_sec = slice_us / 1000000L;
+        delay_req.tv_nsec = (slice_us % 1000000L) * 1000L;
+        while (nanosleep(&delay_req, &delay_rem) == -1) {
+            if (errno == EINTR) {
+                if (g_terminate_flag) return;
+                delay_req = delay_rem;
+            } else {
+                print_error(prefix, "nanosleep failed"); return;
+            }
+        }
+    }
+}
@@ -0,0 +1,221 @@
+#include "watchdog.h"
+#include "config.h"
+#include "thread_stats.h"
+#include "queue_manager.h"
+
+// --- Constants ---
+#define WATCHDOG_TICK_NS 100000000ULL // 100ms sampling period
+
+// --- Static Variables ---
+// What the watchdog last saw in each stats slot (owned by the watchdog thread)
+typedef struct slot_track_s {
+    unsigned generation;
+    unsigned long messages;
+    int state;
+    uint64_t progress_ns; // Last time the message counter moved
+    uint64_t changed_ns;  // Last time the counter or the state moved
+    bool reported;        // Already reported in the current stall episode
+} slot_track_t;
+
+static slot_track_t track[THREAD_STATS_SLOTS];
+static pthread_t watchdog_thread;
+static bool watchdog_running = false;
+static atomic_bool watchdog_stop_requested = false;
+static queue_t *watched_queue = NULL;
+
+// --- Internal Helper Function Declarations ---
+static void* watchdog_thread_func(void *arg);
+static void watchdog_check_threads(uint64_t now);
+static void watchdog_check_queue(uint64_t now);
+
+/*
+ * Purpose: Starts the watchdog thread for a queue. The thread samples the
+ *          per-thread progress counters and the queue's lock-free stats and
+ *          reports stalls according to g_config.watchdog_stall_ms and
+ *          g_config.watchdog_queue_ms. Does nothing if both are 0.
+ * Accepts: q - Pointer to the queue to watch.
+ * Returns: 0 on success (or when disabled), -1 on failure.
+ */
+int watchdog_start(queue_t *q) {
+    if (!q) return -1;
+    if (watchdog_running) return 0;
+    if (g_config.watchdog_stall_ms <= 0 && g_config.watchdog_queue_ms <= 0) return 0;
+
+    watched_queue = q;
+    memset(track, 0, sizeof(track));
+    atomic_store(&watchdog_stop_requested, false);
+    int ret = pthread_create(&watchdog_thread, NULL, watchdog_thread_func, NULL);
+    if (ret != 0) { errno = ret; print_error("Watchdog", "pthread_create (watchdog) failed"); return -1; }
+    watchdog_running = true;
+    print_info("Watchdog", "Started.");
+    return 0;
+}
+
+/*
+ * Purpose: Stops and joins the watchdog thread. Safe to call when the
+ *          watchdog was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void watchdog_stop(void) {
+    if (!watchdog_running) return;
+    atomic_store(&watchdog_stop_requested, true);
+    int ret = pthread_join(watchdog_thread, NULL);
+    if (ret != 0) { errno = ret; print_error("Watchdog", "pthread_join (watchdog) failed"); }
+    watchdog_running = false;
+}
+
+/*
+ * Purpose: Writes a compact state report: queue indices and counters, mutex
+ *          state, waiter counts and the state of every registered thread.
+ * Accepts: q      - Pointer to the queue to describe.
+ *          out    - Stream to write to.
+ *          reason - Headline describing why the report was produced.
+ * Returns: None.
+ */
+void watchdog_dump_report(queue_t *q, FILE *out, const char *reason) {
+    queue_stats_t st;
+    queue_get_stats_snapshot(q, &st);
+
+    // A trylock tells whether someone is sitting on the mutex without risking a hang here
+    const char *mutex_state = "free";
+    int ret = pthread_mutex_trylock(&q->mutex);
+    if (ret == 0) pthread_mutex_unlock(&q->mutex);
+    else if (ret == EBUSY) mutex_state = "held";
+    else mutex_state = "error";
+
+    uint64_t now = monotonic_ns();
+    fprintf(out, "WATCHDOG: %s\r\n", reason);
+    fprintf(out, "  queue: mode=%s cap=%zu count=%zu head=%d tail=%d added=%lu extracted=%lu mutex=%s\r\n",
+            queue_engine_name(st.mode), st.capacity, st.count, st.head_idx, st.tail_idx,
+            st.added_total, st.extracted_total, mutex_state);
+    fprintf(out, "  waiters: producers=%d consumers=%d resizers=%d\r\n",
+            st.waiting_producers, st.waiting_consumers, st.waiting_resizers);
+    fprintf(out, "  threads:");
+    int printed = 0;
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire)) continue;
+        thread_role_t role = (thread_role_t)atomic_load(&ts->role);
+        int state = atomic_load_explicit(&ts->state, memory_order_relaxed);
+        char tag = role == THREAD_ROLE_PRODUCER ? 'P' : role == THREAD_ROLE_CONSUMER ? 'C' : 'M';
+        uint64_t since = role == THREAD_ROLE_CONTROL ? track[i].changed_ns : track[i].progress_ns;
+        double age_s = (since != 0 && now > since) ? (double)(now - since) / 1e9 : 0.0;
+        if (printed > 0 && printed % 6 == 0) fprintf(out, "\r\n          ");
+        fprintf(out, " %c%d:%s/%.1fs", tag, atomic_load(&ts->id), thread_state_name((thread_state_t)state), age_s);
+        printed++;
+    }
+    if (printed == 0) fprintf(out, " (none)");
+    fprintf(out, "\r\n");
+    fflush(out);
+}
+
+/*
+ * Purpose: Watchdog thread body. Samples threads and the queue every tick
+ *          until a stop is requested.
+ * Accepts: arg - Unused.
+ * Returns: Always NULL.
+ */
+static void* watchdog_thread_func(void *arg) {
+    (void)arg;
+    while (!atomic_load(&watchdog_stop_requested)) {
+        struct timespec tick = { 0, (long)WATCHDOG_TICK_NS };
+        nanosleep(&tick, NULL); // EINTR just shortens one tick
+
+        uint64_t now = monotonic_ns();
+        if (g_config.watchdog_stall_ms > 0) watchdog_check_threads(now);
+        if (g_config.watchdog_queue_ms > 0) watchdog_check_queue(now);
+    }
+    return NULL;
+}
+
+/*
+ * Purpose: Flags producers and consumers whose message counter has not moved
+ *          for the stall interval, and control threads stuck in a resize.
+ *          Each stall episode is reported once.
+ * Accepts: now - Current monotonic time in nanoseconds.
+ * Returns: None.
+ */
+static void watchdog_check_threads(uint64_t now) {
+    uint64_t stall_ns = (uint64_t)g_config.watchdog_stall_ms * 1000000ULL;
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        thread_stats_t *ts = &g_thread_stats[i];
+        slot_track_t *tr = &track[i];
+        if (!atomic_load_explicit(&ts->in_use, memory_order_acquire)) { tr->generation = 0; continue; }
+
+        unsigned gen = atomic_load_explicit(&ts->generation, memory_order_acquire);
+        unsigned long messages = atomic_load_explicit(&ts->messages, memory_order_relaxed);
+        int state = atomic_load_explicit(&ts->state, memory_order_relaxed);
+        if (gen != tr->generation) { // New thread in this slot: start tracking afresh
+            tr->generation = gen; tr->messages = messages; tr->state = state;
+            tr->progress_ns = now; tr->changed_ns = now; tr->reported = false;
+            continue;
+        }
+        bool moved = messages != tr->messages;
+        if (moved) { tr->messages = messages; tr->progress_ns = now; tr->reported = false; }
+        if (moved || state != tr->state) { tr->state = state; tr->changed_ns = now; }
+
+        thread_role_t role = (thread_role_t)atomic_load(&ts->role);
+        bool stalled;
+        if (role == THREAD_ROLE_CONTROL) {
+            stalled = state == THREAD_STATE_RESIZING && now - tr->changed_ns >= stall_ns;
+            if (state != THREAD_STATE_RESIZING) tr->reported = false;
+        } else {
+            stalled = now - tr->progress_ns >= stall_ns;
+        }
+        if (!stalled || tr->reported) continue;
+
+        char reason[128];
+        if (role == THREAD_ROLE_CONTROL) {
+            snprintf(reason, sizeof(reason), "queue_resize has not finished after %ld ms", g_config.watchdog_stall_ms);
+        } else {
+            snprintf(reason, sizeof(reason), "%s %d made no progress for %ld ms (state %s)",
+                     role == THREAD_ROLE_PRODUCER ? "Producer" : "Consumer", atomic_load(&ts->id),
+                     g_config.watchdog_stall_ms, thread_state_name((thread_state_t)state));
+        }
+        tr->reported = true;
+        watchdog_dump_report(watched_queue, stderr, reason);
+    }
+}
+
+/*
+ * Purpose: Flags the queue when it has stayed full (while producers exist)
+ *          or empty (while consumers exist) for the queue interval. Each
+ *          episode is reported once.
+ * Accepts: now - Current monotonic time in nanoseconds.
+ * Returns: None.
+ */
+static void watchdog_check_queue(uint64_t now) {
+    static uint64_t full_since = 0, empty_since = 0;
+    static bool full_reported = false, empty_reported = false;
+    uint64_t limit_ns = (uint64_t)g_config.watchdog_queue_ms * 1000000ULL;
+
+    queue_stats_t st;
+    queue_get_stats_snapshot(watched_queue, &st);
+    bool have_producers = false, have_consumers = false;
+    for (int i = 0; i < THREAD_STATS_SLOTS; ++i) {
+        if (!atomic_load_explicit(&g_thread_stats[i].in_use, memory_order_acquire)) continue;
+        thread_role_t role = (thread_role_t)atomic_load(&g_thread_stats[i].role);
+        if (role == THREAD_ROLE_PRODUCER) have_producers = true;
+        if (role == THREAD_ROLE_CONSUMER) have_consumers = true;
+    }
+
+    bool full = have_producers && st.count >= st.capacity;
+    bool empty = have_consumers && st.count == 0;
+    if (!full) { full_since = 0; full_reported = false; }
+    else if (full_since == 0) full_since = now;
+    if (!empty) { empty_since = 0; empty_reported = false; }
+    else if (empty_since == 0) empty_since = now;
+
+    char reason[96];
+    if (full && !full_reported && now - full_since >= limit_ns) {
+        snprintf(reason, sizeof(reason), "queue has been full for %ld ms", g_config.watchdog_queue_ms);
+        full_reported = true;
+        watchdog_dump_report(watched_queue, stderr, reason);
+    }
+    if (empty && !empty_reported && now - empty_since >= limit_ns) {
+        snprintf(reason, sizeof(reason), "queue has been empty for %ld ms", g_config.watchdog_queue_ms);
+        empty_reported = true;
+        watchdog_dump_report(watched_queue, stderr, reason);
+    }
+}
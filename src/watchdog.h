@@ -0,0 +1,36 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "common.h"
+
+// --- Function Declarations ---
+
+/*
+ * Purpose: Starts the watchdog thread for a queue. The thread samples the
+ *          per-thread progress counters and the queue's lock-free stats and
+ *          reports stalls according to g_config.watchdog_stall_ms and
+ *          g_config.watchdog_queue_ms. Does nothing if both are 0.
+ * Accepts: q - Pointer to the queue to watch.
+ * Returns: 0 on success (or when disabled), -1 on failure.
+ */
+int watchdog_start(queue_t *q);
+
+/*
+ * Purpose: Stops and joins the watchdog thread. Safe to call when the
+ *          watchdog was never started.
+ * Accepts: None.
+ * Returns: None.
+ */
+void watchdog_stop(void);
+
+/*
+ * Purpose: Writes a compact state report: queue indices and counters, mutex
+ *          state, waiter counts and the state of every registered thread.
+ * Accepts: q      - Pointer to the queue to describe.
+ *          out    - Stream to write to.
+ *          reason - Headline describing why the report was produced.
+ * Returns: None.
+ */
+void watchdog_dump_report(queue_t *q, FILE *out, const char *reason);
+
+#endif // WATCHDOG_H